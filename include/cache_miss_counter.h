@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Counts the cache misses of the thread that created it, with a hardware
+// counter read through perf_event_open on Linux. The counter is unavailable
+// on other platforms, on machines without a PMU, e.g. most VMs, and when
+// /proc/sys/kernel/perf_event_paranoid is above 2; read() then returns 0.
+//
+// Reading costs a system call, so it is meant for measuring searches, not for
+// production.
+class CacheMissCounter
+{
+  public:
+    DISKANN_DLLEXPORT CacheMissCounter();
+    DISKANN_DLLEXPORT ~CacheMissCounter();
+
+    DISKANN_DLLEXPORT bool is_available() const;
+
+    // misses of the calling thread since the counter was created
+    DISKANN_DLLEXPORT uint64_t read() const;
+
+  private:
+    CacheMissCounter(const CacheMissCounter &) = delete;
+    CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+    int _fd = -1;
+};
+} // namespace diskann
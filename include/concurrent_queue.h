@@ -3,14 +3,18 @@
 
 #pragma once
 #include <atomic>
+#include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <type_traits>
 #include <unordered_set>
 
+#include "utils.h"
+
 namespace diskann
 {
 
@@ -28,7 +32,7 @@ template <typename T> class ConcurrentQueue
     T null_T;
 
   public:
-    ConcurrentQueue()
+    ConcurrentQueue() : null_T()
     {
     }
 
@@ -129,4 +133,236 @@ template <typename T> class ConcurrentQueue
         this->pop_cv.notify_all();
     }
 };
+//
+// Pool of items, such as scratch spaces, that threads take for a while and
+// give back. Every item added has a slot of its own, on its own cache line,
+// holding whether it is free; acquire() claims a free slot with an atomic
+// exchange and release() frees it, so neither takes a lock. Each thread first
+// tries the slot it last acquired, which gets it back the item it warmed up
+// unless another thread holds it, and spreads the threads over the slots
+// otherwise. Threads only sleep when every item is taken, and a release wakes
+// a single one of them. The pool does not own the items, see delete_all().
+//
+template <typename T> class ConcurrentPool
+{
+    typedef std::unique_lock<std::mutex> mutex_locker;
+
+    static const uint32_t SLOTS_PER_CHUNK = 64;
+    static const uint32_t MAX_CHUNKS = 1024;
+    static const uint32_t HINTS_PER_THREAD = 8;
+
+    // Padded to a cache line, in chunks allocated aligned to one, so that the
+    // fields of a slot never share a cache line with those of another.
+    struct Slot
+    {
+        T *item;
+        std::atomic<bool> free;
+        char padding[64 - sizeof(T *) - sizeof(std::atomic<bool>)];
+    };
+    static_assert(sizeof(Slot) == 64, "a slot must take exactly one cache line");
+
+    struct ThreadHint
+    {
+        uint64_t pool_id;
+        uint32_t slot;
+    };
+
+    // Slots are allocated by chunks and never move, so that acquire() may
+    // read them while push() adds more. Only push() and delete_all() write
+    // _chunks and _size, under _push_mut.
+    Slot *_chunks[MAX_CHUNKS];
+    std::atomic<uint32_t> _size;
+    std::mutex _push_mut;
+
+    std::atomic<uint32_t> _num_waiters;
+    std::mutex _wait_mut;
+    std::condition_variable _wait_cv;
+
+    // never reused, so that a thread does not take the hint of a deleted
+    // pool for that of a new one
+    const uint64_t _id;
+
+    static uint64_t new_pool_id()
+    {
+        static std::atomic<uint64_t> next_id(1);
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Slot &slot(const uint32_t index)
+    {
+        return _chunks[index / SLOTS_PER_CHUNK][index % SLOTS_PER_CHUNK];
+    }
+
+    static Slot *new_chunk()
+    {
+        Slot *chunk = nullptr;
+        diskann::alloc_aligned((void **)&chunk, SLOTS_PER_CHUNK * sizeof(Slot), 64);
+        for (uint32_t i = 0; i < SLOTS_PER_CHUNK; i++)
+            new (chunk + i) Slot();
+        return chunk;
+    }
+
+    static void delete_chunk(Slot *chunk)
+    {
+        for (uint32_t i = 0; i < SLOTS_PER_CHUNK; i++)
+            chunk[i].~Slot();
+        diskann::aligned_free(chunk);
+    }
+
+    // Slot the calling thread last acquired in this pool. A thread keeps the
+    // hints of the last pools it used, one per pool id modulo
+    // HINTS_PER_THREAD. The hint of a pool it has none for starts at its
+    // ordinal, which spreads the threads over the slots.
+    uint32_t &thread_slot()
+    {
+        static std::atomic<uint32_t> next_thread(0);
+        thread_local uint32_t thread_ordinal = next_thread.fetch_add(1, std::memory_order_relaxed);
+        thread_local ThreadHint hints[HINTS_PER_THREAD] = {};
+        ThreadHint &hint = hints[_id % HINTS_PER_THREAD];
+        if (hint.pool_id != _id)
+        {
+            hint.pool_id = _id;
+            hint.slot = thread_ordinal;
+        }
+        return hint.slot;
+    }
+
+    bool try_claim(const uint32_t index)
+    {
+        Slot &s = slot(index);
+        return s.free.load(std::memory_order_relaxed) && s.free.exchange(false, std::memory_order_acquire);
+    }
+
+    // claims a free slot, starting from the one of the calling thread
+    bool try_acquire(uint32_t &index)
+    {
+        const uint32_t size = _size.load(std::memory_order_acquire);
+        if (size == 0)
+            return false;
+        uint32_t &hint = thread_slot();
+        const uint32_t start = hint % size;
+        for (uint32_t i = 0; i < size; i++)
+        {
+            const uint32_t candidate = start + i < size ? start + i : start + i - size;
+            if (try_claim(candidate))
+            {
+                hint = candidate;
+                index = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Sleeps until claim() succeeds. The waiter increments _num_waiters then
+    // reads the slots, while a release frees its slot then reads
+    // _num_waiters. The fences here and in wake_one() order these, so that
+    // the release finds the waiter to wake or the retry finds the slot freed,
+    // and no wake-up is lost.
+    template <typename Claim> void wait_until(Claim claim)
+    {
+        _num_waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mutex_locker lk(this->_wait_mut);
+        while (!claim())
+            this->_wait_cv.wait(lk);
+        lk.unlock();
+        _num_waiters.fetch_sub(1);
+    }
+
+    void wake_one()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_num_waiters.load() == 0)
+            return;
+        {
+            mutex_locker lk(this->_wait_mut);
+        }
+        this->_wait_cv.notify_one();
+    }
+
+  public:
+    ConcurrentPool() : _size(0), _num_waiters(0), _id(new_pool_id())
+    {
+    }
+
+    ~ConcurrentPool()
+    {
+        for (uint32_t i = 0; i < (_size.load() + SLOTS_PER_CHUNK - 1) / SLOTS_PER_CHUNK; i++)
+            delete_chunk(_chunks[i]);
+    }
+
+    // number of items added, taken or not
+    uint64_t size()
+    {
+        return _size.load(std::memory_order_acquire);
+    }
+
+    bool empty()
+    {
+        return (this->size() == 0);
+    }
+
+    // Adds a free item to the pool.
+    void push(T *item)
+    {
+        mutex_locker lk(this->_push_mut);
+        const uint32_t index = _size.load(std::memory_order_relaxed);
+        if (index % SLOTS_PER_CHUNK == 0)
+        {
+            if (index / SLOTS_PER_CHUNK >= MAX_CHUNKS)
+                throw diskann::ANNException("ConcurrentPool holds at most " +
+                                                std::to_string(MAX_CHUNKS * SLOTS_PER_CHUNK) + " items",
+                                            -1, __FUNCSIG__, __FILE__, __LINE__);
+            _chunks[index / SLOTS_PER_CHUNK] = new_chunk();
+        }
+        slot(index).item = item;
+        slot(index).free.store(true, std::memory_order_relaxed);
+        _size.store(index + 1, std::memory_order_release);
+        lk.unlock();
+        wake_one();
+    }
+
+    // Takes a free item, waiting for one if all are taken, and returns its
+    // slot, to be passed to get() and release().
+    uint32_t acquire()
+    {
+        uint32_t index = 0;
+        if (!try_acquire(index))
+            wait_until([&]() { return try_acquire(index); });
+        return index;
+    }
+
+    T *get(const uint32_t index)
+    {
+        return slot(index).item;
+    }
+
+    // Gives back the item of a slot returned by acquire().
+    void release(const uint32_t index)
+    {
+        slot(index).free.store(true);
+        wake_one();
+    }
+
+    // Waits until every item is given back, deletes them and empties the
+    // pool. No thread may use the pool meanwhile, besides giving items back.
+    void delete_all()
+    {
+        mutex_locker lk(this->_push_mut);
+        const uint32_t size = _size.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < size; i++)
+        {
+            if (!try_claim(i))
+                wait_until([&]() { return try_claim(i); });
+            delete slot(i).item;
+        }
+        for (uint32_t i = 0; i < (size + SLOTS_PER_CHUNK - 1) / SLOTS_PER_CHUNK; i++)
+            delete_chunk(_chunks[i]);
+        _size.store(0, std::memory_order_release);
+    }
+
+    ConcurrentPool(const ConcurrentPool<T> &) = delete;
+    ConcurrentPool &operator=(const ConcurrentPool<T> &) = delete;
+};
 } // namespace diskann
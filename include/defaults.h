@@ -14,11 +14,17 @@ const uint32_t MAX_OCCLUSION_SIZE = 750;
 const uint32_t FILTER_LIST_SIZE = 0;
 const uint32_t NUM_FROZEN_POINTS_STATIC = 0;
 const uint32_t NUM_FROZEN_POINTS_DYNAMIC = 1;
+const uint32_t INSERT_BATCH_SIZE = 0;
+const bool DETERMINISTIC_BUILD = false;
+// largest batch of a deterministic build, as a fraction of the points
+const float MAX_BATCH_FRACTION = 0.02f;
 // following constants should always be specified, but are useful as a
 // sensible default at cli / python boundaries
 const uint32_t MAX_DEGREE = 64;
 const uint32_t BUILD_LIST_SIZE = 100;
 const uint32_t SATURATE_GRAPH = false;
 const uint32_t SEARCH_LIST_SIZE = 100;
+// number of vectors a search prefetches ahead of the one it compares
+const uint32_t PREFETCH_DISTANCE = 4;
 } // namespace defaults
 } // namespace diskann
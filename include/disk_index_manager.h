@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "pq_flash_index.h"
+
+namespace diskann
+{
+// Hosts the disk indices of many tenants in one process. On Linux all of
+// them search with one pool of num_threads scratch spaces and IO contexts, so
+// the scratch memory and the number of aio contexts follow the number of
+// concurrent searches instead of the number of indices. Their PQ data and
+// node caches share one memory budget.
+//
+// Indices are loaded on their first search. When the loaded ones exceed the
+// budget, the least recently searched ones are unloaded, and are loaded again
+// on their next search. Searches in flight keep the index they started on
+// loaded until they return, so the budget can be exceeded by the indices they
+// hold.
+template <typename T, typename LabelT = uint32_t> class DiskIndexManager
+{
+  public:
+    // num_threads: the number of searches that run at a time, across all
+    // indices. max_dim: the largest dimension of the indices to be added.
+    // memory_budget: bytes of get_memory_usage() of the loaded indices, 0 for
+    // no limit. num_nodes_to_cache: nodes around the medoid each index caches
+    // on load.
+    DISKANN_DLLEXPORT DiskIndexManager(const diskann::Metric metric, const uint32_t num_threads, const size_t max_dim,
+                                       const size_t memory_budget, const uint32_t num_nodes_to_cache = 0);
+    DISKANN_DLLEXPORT ~DiskIndexManager();
+
+    // Registers the index with the given path prefix under name, to be loaded
+    // on its first search.
+    DISKANN_DLLEXPORT void add_index(const std::string &name, const std::string &index_prefix);
+    DISKANN_DLLEXPORT void remove_index(const std::string &name);
+
+    // Loads the index now instead of on its first search.
+    DISKANN_DLLEXPORT void load_index(const std::string &name);
+    DISKANN_DLLEXPORT void unload_index(const std::string &name);
+
+    DISKANN_DLLEXPORT void search(const std::string &name, const T *query, const uint64_t k_search,
+                                  const uint64_t l_search, uint64_t *res_ids, float *res_dists,
+                                  const uint64_t beam_width, QueryStats *stats = nullptr);
+
+    // Returns the index, loading it if needed, for the searches search()
+    // does not cover. It stays loaded while the pointer is held.
+    DISKANN_DLLEXPORT std::shared_ptr<PQFlashIndex<T, LabelT>> get_index(const std::string &name);
+
+    DISKANN_DLLEXPORT size_t get_num_indices();
+    DISKANN_DLLEXPORT size_t get_num_loaded_indices();
+    DISKANN_DLLEXPORT size_t get_memory_usage();
+
+    // dimension of the index with the given path prefix, read from its PQ
+    // pivots
+    DISKANN_DLLEXPORT static size_t get_index_dim(const std::string &index_prefix);
+
+  private:
+    // a PQFlashIndex keeps a reference to its reader, so the two live and die
+    // together; the index is declared last to be destroyed first
+    struct LoadedIndex
+    {
+        std::shared_ptr<AlignedFileReader> reader;
+        std::unique_ptr<PQFlashIndex<T, LabelT>> index;
+        size_t memory_usage = 0;
+    };
+
+    struct Tenant
+    {
+        std::string index_prefix;
+        std::shared_ptr<LoadedIndex> loaded;
+        // position in _lru, valid while loaded
+        typename std::list<Tenant *>::iterator lru_pos;
+        // serializes the loads of this tenant
+        std::mutex load_lock;
+    };
+
+    std::shared_ptr<LoadedIndex> acquire(const std::string &name);
+    std::shared_ptr<LoadedIndex> load(const std::string &index_prefix);
+    // unloads the least recently used tenants other than keep until the
+    // loaded ones fit the budget. Call with _lock held.
+    void evict(const Tenant *keep);
+    void unload(Tenant *tenant);
+
+    diskann::Metric _metric;
+    uint32_t _num_threads;
+    size_t _max_dim;
+    size_t _memory_budget;
+    uint32_t _num_nodes_to_cache;
+
+    std::shared_ptr<SSDScratchPool<T>> _scratch_pool;
+
+    // guards the members below
+    std::mutex _lock;
+    std::unordered_map<std::string, std::shared_ptr<Tenant>> _tenants;
+    // loaded tenants, most recently searched first
+    std::list<Tenant *> _lru;
+    size_t _memory_usage = 0;
+};
+} // namespace diskann
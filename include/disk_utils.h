@@ -98,7 +98,17 @@ DISKANN_DLLEXPORT int build_disk_index(
     bool use_filters = false,
     const std::string &label_file = std::string(""), // default is empty string for no label_file
     const std::string &universal_label = "", const uint32_t filter_threshold = 0,
-    const uint32_t Lf = 0); // default is empty string for no universal label
+    const uint32_t Lf = 0,                 // default is empty string for no universal label
+    const double nav_sampling_rate = 0.0); // fraction of points in the navigation index, 0 for none
+
+// Builds an in-memory Vamana index over a random sample of the points of
+// data_file, which PQFlashIndex searches to pick the entry points of its
+// disk search. Writes disk_index_file + "_nav.index" with its ".data" and
+// disk_index_file + "_nav_ids.bin", which maps its points to disk ids.
+template <typename T>
+DISKANN_DLLEXPORT void build_nav_index(const std::string &data_file, const std::string &disk_index_file,
+                                       const double sampling_rate, const uint32_t R, const uint32_t L,
+                                       const uint32_t num_threads);
 
 template <typename T>
 DISKANN_DLLEXPORT void create_disk_layout(const std::string base_file, const std::string mem_index_file,
@@ -1,5 +1,6 @@
 #pragma once
 #include "windows_customizations.h"
+#include "half_float.h"
 #include <cstring>
 
 namespace diskann
@@ -230,6 +231,57 @@ class AVXNormalizedCosineDistanceFloat : public Distance<float>
                                                     float *scratch_query_vector) override;
 };
 
+// Distances over float16/bfloat16 vectors. Both operands are widened to float
+// (F16C/AVX-512 conversions) and accumulated in float, so the results match
+// the float kernels on the rounded values.
+template <typename T> class DistanceL2Half : public Distance<T>
+{
+  public:
+    DistanceL2Half() : Distance<T>(diskann::Metric::L2)
+    {
+    }
+    DISKANN_DLLEXPORT virtual float compare(const T *a, const T *b, uint32_t length) const;
+};
+
+template <typename T> class DistanceInnerProductHalf : public Distance<T>
+{
+  public:
+    DistanceInnerProductHalf() : Distance<T>(diskann::Metric::INNER_PRODUCT)
+    {
+    }
+    // Returns the negated inner product, like AVXDistanceInnerProductFloat.
+    DISKANN_DLLEXPORT virtual float compare(const T *a, const T *b, uint32_t length) const;
+};
+
+template <typename T> class DistanceCosineHalf : public Distance<T>
+{
+  public:
+    DistanceCosineHalf() : Distance<T>(diskann::Metric::COSINE)
+    {
+    }
+    DISKANN_DLLEXPORT virtual float compare(const T *a, const T *b, uint32_t length) const;
+};
+
+// Cosine distance over vectors normalized by preprocess_base_points and
+// preprocess_query, as AVXNormalizedCosineDistanceFloat, so that a comparison
+// is a single inner product.
+template <typename T> class DistanceNormalizedCosineHalf : public Distance<T>
+{
+  public:
+    DistanceNormalizedCosineHalf() : Distance<T>(diskann::Metric::COSINE)
+    {
+    }
+    DISKANN_DLLEXPORT virtual float compare(const T *a, const T *b, uint32_t length) const;
+
+    DISKANN_DLLEXPORT virtual bool preprocessing_required() const;
+
+    DISKANN_DLLEXPORT virtual void preprocess_base_points(T *original_data, const size_t orig_dim,
+                                                          const size_t num_points) override;
+
+    DISKANN_DLLEXPORT virtual void preprocess_query(const T *query_vec, const size_t query_dim,
+                                                    T *scratch_query_vector) override;
+};
+
 template <typename T> Distance<T> *get_distance_function(Metric m);
 
 } // namespace diskann
@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "index.h"
+#include "pq_flash_index.h"
+
+namespace diskann
+{
+// An SSD index that accepts inserts and deletes without a rebuild, following
+// FreshDiskANN (Singh et al., 2021). It has three tiers:
+//
+//  - the long term index, a PQFlashIndex over <prefix>_disk.index,
+//  - a dynamic in-memory Index (the temp index) that receives the inserts,
+//  - a set of deleted ids, filtered out of the search results.
+//
+// merge() folds the temp index and the deletes into the disk index: deleted
+// nodes are unlinked by connecting their in-neighbors to their out-neighbors,
+// the inserted points are linked using the long term index, and only the
+// affected sectors of _disk.index and the tail of _pq_compressed.bin are
+// rewritten, in place.
+// Searches and updates keep running while a merge computes the new sectors,
+// against the old disk index and a frozen copy of the temp index, and wait
+// while the sectors are written and the merged index loads. The new sectors
+// are staged in a file and recorded in a journal before the index files
+// change, so that a merge interrupted by a crash is applied again by load(),
+// and one interrupted by an error by the next merge(). A merge that fails
+// before that leaves the index as it was, with the frozen temp index still
+// searched, and the next merge() retries it.
+//
+// save() writes the temp indices and the deleted ids next to the disk index,
+// and load() restores them, leaving out the points that merges folded into
+// the disk index since. Inserts and deletes made after the last save() and
+// not merged are lost on a restart, and the ids of those inserts are handed
+// out again.
+//
+// Ids are locations in the disk index: inserted points get the ids following
+// the last point of the disk index, and keep them once merged. The slots of
+// deleted points are not reused, so a periodic rebuild is still needed to
+// reclaim them. Only L2 indices without reorder data, frozen points, labels,
+// multiple medoids or a navigation index are supported.
+template <typename T> class FreshDiskIndex
+{
+  public:
+    // temp_index_params configures the temp index and the graph updates of a
+    // merge; max_degree is taken from the disk index.
+    DISKANN_DLLEXPORT FreshDiskIndex(diskann::Metric metric, const std::string &index_prefix,
+                                     const uint32_t num_threads, const IndexWriteParameters &temp_index_params,
+                                     const size_t initial_temp_points = 100000);
+    DISKANN_DLLEXPORT ~FreshDiskIndex();
+
+    DISKANN_DLLEXPORT int load();
+
+    // Persists the inserts and deletes that are not merged yet. Waits for a
+    // running merge, and blocks searches and updates while it writes.
+    DISKANN_DLLEXPORT void save();
+
+    // Returns the id assigned to the point. The temp index holds at most
+    // initial_temp_points points: an insert that finds it full merges it
+    // first, and waits for that merge, which throws if it fails.
+    DISKANN_DLLEXPORT uint32_t insert(const T *point);
+
+    // Hides id from searches right away; it is removed from the graph by the
+    // next merge.
+    DISKANN_DLLEXPORT void lazy_delete(const uint32_t id);
+
+    // Searches every tier and returns the number of results written.
+    DISKANN_DLLEXPORT size_t search(const T *query, const uint64_t K, const uint64_t L, const uint64_t beam_width,
+                                    uint32_t *ids, float *distances);
+
+    // Throws if the merge fails, after which calling it again retries it.
+    DISKANN_DLLEXPORT void merge();
+
+    // Runs merge() on a background thread, after waiting for the previous one.
+    DISKANN_DLLEXPORT void merge_async();
+    DISKANN_DLLEXPORT void wait_for_merge();
+
+    // Points in the disk index plus the points inserted since, including
+    // deleted ones.
+    DISKANN_DLLEXPORT size_t get_num_points();
+
+  private:
+    // A loaded disk index and the reader it refers to, which is destroyed
+    // after it.
+    struct DiskTier
+    {
+        std::shared_ptr<AlignedFileReader> reader;
+        std::unique_ptr<PQFlashIndex<T>> index;
+    };
+
+    // the uint64_t fields of the header sector of _disk.index
+    std::vector<uint64_t> read_disk_header();
+    std::unique_ptr<Index<T, uint32_t>> create_temp_index();
+    std::unique_ptr<DiskTier> load_disk_index(const std::string &disk_index_file,
+                                              const std::string &pq_compressed_file);
+
+    // the temp indices and deleted ids written by save()
+    void load_saved_updates();
+
+    // merge() without taking _merge_lock, which the caller holds
+    void merge_temp_index();
+
+    // Writes the sectors and the header staged by a merge to _disk.index, and
+    // the PQ codes of the new points to _pq_compressed.bin, in place. Applying
+    // the journal again gives the same files. Returns the number of sectors
+    // written, and keeps the journal.
+    uint64_t apply_merge_journal();
+
+    // Writes the merged graph to a staging file of sectors and the PQ codes of
+    // the new points to new_codes. Does not modify the index files.
+    void compute_merge(Index<T, uint32_t> &temp_index, const uint32_t first_id, const uint32_t end_id,
+                       const tsl::robin_set<uint32_t> &deleted, std::vector<uint64_t> &staged_sectors,
+                       std::vector<uint8_t> &new_codes, uint64_t &new_medoid);
+
+    // Records the staged sectors, the new header and new_codes in the
+    // journal, which only exists once complete.
+    void write_merge_journal(const uint32_t first_id, const uint32_t end_id,
+                             const std::vector<uint64_t> &staged_sectors, const std::vector<uint8_t> &new_codes,
+                             const uint64_t new_medoid);
+
+    diskann::Metric _metric;
+    std::string _index_prefix, _disk_index_file, _pq_pivots_file, _pq_compressed_file, _staging_file;
+    std::string _merge_journal_file;
+    // written by save()
+    std::string _state_file, _temp_index_file, _merging_temp_index_file, _deleted_file;
+    uint32_t _num_threads;
+    IndexWriteParameters _params;
+    size_t _initial_temp_points;
+
+    uint64_t _dim = 0;
+    // header sector of the disk index
+    uint64_t _max_node_len = 0, _nnodes_per_sector = 0, _max_degree = 0;
+
+    // null while a failed merge leaves the index files half written
+    std::unique_ptr<DiskTier> _disk;
+    // receives the inserts
+    std::unique_ptr<Index<T, uint32_t>> _temp_index;
+    // slots of the temp index reserved by inserts
+    std::atomic<size_t> _temp_index_size;
+    // the temp index being merged, still searched until the merge is applied
+    // or, if it failed, until it is retried
+    std::unique_ptr<Index<T, uint32_t>> _merging_temp_index;
+    // ids [_disk_points, _merging_end_id) are in _merging_temp_index
+    uint32_t _merging_end_id = 0;
+    // the deletes folded in by the merge of _merging_temp_index
+    tsl::robin_set<uint32_t> _merging_deleted;
+
+    // ids [0, _disk_points) are in the disk index
+    uint32_t _disk_points = 0;
+    std::atomic<uint32_t> _next_id;
+    tsl::robin_set<uint32_t> _deleted;
+
+    // Held shared by searches and updates, exclusively while a merge swaps
+    // the tiers.
+    std::shared_timed_mutex _tier_lock;
+    std::shared_timed_mutex _delete_lock;
+    // one merge at a time
+    std::mutex _merge_lock;
+    // held while _merge_thread is started or joined, so that any thread may
+    // call merge_async() and wait_for_merge()
+    std::mutex _merge_thread_lock;
+    std::thread _merge_thread;
+};
+} // namespace diskann
@@ -0,0 +1,158 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace diskann
+{
+// Half precision storage types for vector data. They only store the bits;
+// all arithmetic happens in float through the implicit conversions, so the
+// templated code paths written for float/int8_t/uint8_t work unchanged. The
+// distance kernels in distance.cpp widen 8 or 16 values at a time instead of
+// converting element-wise.
+
+inline uint16_t float_to_half_bits(const float value)
+{
+#ifdef __F16C__
+    return (uint16_t)_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const uint32_t abs_x = x & 0x7FFFFFFF;
+
+    if (abs_x >= 0x7F800000) // inf or nan
+        return (uint16_t)(sign | 0x7C00 | (abs_x > 0x7F800000 ? 0x200 : 0));
+    if (abs_x >= 0x477FF000) // rounds to a value beyond the largest half
+        return (uint16_t)(sign | 0x7C00);
+    if (abs_x < 0x38800000) // subnormal half or zero
+    {
+        if (abs_x < 0x33000000)
+            return (uint16_t)sign;
+        const uint32_t shift = 126 - (abs_x >> 23);
+        const uint32_t mantissa = (abs_x & 0x7FFFFF) | 0x800000;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rem = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+    // normal: rebias the exponent and round the mantissa to nearest even
+    uint32_t half = ((abs_x - 0x38000000) >> 13);
+    const uint32_t rem = abs_x & 0x1FFF;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)(sign | half);
+#endif
+}
+
+inline float half_bits_to_float(const uint16_t bits)
+{
+#ifdef __F16C__
+    return _cvtsh_ss(bits);
+#else
+    const uint32_t sign = (uint32_t)(bits & 0x8000) << 16;
+    const uint32_t exponent = (bits >> 10) & 0x1F;
+    uint32_t mantissa = bits & 0x3FF;
+    uint32_t x;
+    if (exponent == 0x1F)
+    {
+        x = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        x = sign;
+    }
+    else
+    {
+        // subnormal half, normalize it
+        uint32_t e = 113;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            e--;
+        }
+        x = sign | (e << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+#endif
+}
+
+inline uint16_t float_to_bfloat16_bits(const float value)
+{
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    if ((x & 0x7FFFFFFF) > 0x7F800000) // keep nans quiet instead of rounding them to inf
+        return (uint16_t)((x >> 16) | 0x40);
+    // round to nearest even
+    return (uint16_t)((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+}
+
+inline float bfloat16_bits_to_float(const uint16_t bits)
+{
+    const uint32_t x = (uint32_t)bits << 16;
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+// IEEE 754 binary16: 5 exponent bits, 10 mantissa bits.
+struct float16
+{
+    uint16_t bits;
+
+    float16() = default;
+    float16(const float value) : bits(float_to_half_bits(value))
+    {
+    }
+    operator float() const
+    {
+        return half_bits_to_float(bits);
+    }
+};
+
+// bfloat16: the upper half of a float, 8 exponent bits and 7 mantissa bits.
+struct bfloat16
+{
+    uint16_t bits;
+
+    bfloat16() = default;
+    bfloat16(const float value) : bits(float_to_bfloat16_bits(value))
+    {
+    }
+    operator float() const
+    {
+        return bfloat16_bits_to_float(bits);
+    }
+};
+
+// Trivial so that the buffers holding them can be memset/memcpy'd like the
+// other data types.
+static_assert(sizeof(float16) == 2 && sizeof(bfloat16) == 2, "half precision types must be 2 bytes");
+static_assert(std::is_trivial<float16>::value && std::is_trivial<bfloat16>::value,
+              "half precision types must be trivial");
+
+template <typename T> struct is_half_float : std::false_type
+{
+};
+template <> struct is_half_float<float16> : std::true_type
+{
+};
+template <> struct is_half_float<bfloat16> : std::true_type
+{
+};
+} // namespace diskann
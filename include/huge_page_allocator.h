@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Backing store for the large, randomly accessed arrays of an index (the
+// in-memory vectors, PQ codes and the optimized graph layout). With 4KB pages
+// a random probe into a multi-GB array almost always misses the TLB, so these
+// arrays can be placed on 2MB/1GB pages instead.
+//
+//  NONE        - plain alloc_aligned, the default.
+//  TRANSPARENT - anonymous mapping aligned to 2MB with MADV_HUGEPAGE, so that
+//                transparent hugepages back it whenever THP is not disabled.
+//  HUGETLB_2MB - explicit 2MB pages from the hugetlbfs pool
+//                (vm.nr_hugepages), falling back to TRANSPARENT.
+//  HUGETLB_1GB - explicit 1GB pages, falling back to HUGETLB_2MB.
+//
+// Allocations smaller than one 2MB page always use alloc_aligned. Hugepages
+// are only supported on Linux; elsewhere every mode behaves like NONE.
+enum class HugePageMode
+{
+    NONE,
+    TRANSPARENT,
+    HUGETLB_2MB,
+    HUGETLB_1GB
+};
+
+struct HugePageConfig
+{
+    HugePageMode mode = HugePageMode::NONE;
+    // NUMA node to bind the pages to, -1 to keep the default (first touch)
+    // policy.
+    int numa_node = -1;
+};
+
+// Process wide; applies to allocations made after the call.
+DISKANN_DLLEXPORT void set_huge_page_config(const HugePageConfig &config);
+DISKANN_DLLEXPORT HugePageConfig get_huge_page_config();
+
+// Accepts none/thp/2mb/1gb.
+DISKANN_DLLEXPORT HugePageMode huge_page_mode_from_string(const std::string &mode);
+
+// Same contract as alloc_aligned, except that size need not be a multiple of
+// align. Memory must be released with aligned_free_huge.
+DISKANN_DLLEXPORT void alloc_aligned_huge(void **ptr, size_t size, size_t align);
+// As above, but binds the pages to numa_node instead of the configured node.
+// -1 leaves placement to the first touch of each page.
+DISKANN_DLLEXPORT void alloc_aligned_huge(void **ptr, size_t size, size_t align, int numa_node);
+DISKANN_DLLEXPORT void aligned_free_huge(void *ptr);
+} // namespace diskann
@@ -15,15 +15,25 @@
 #include "natural_number_set.h"
 #include "neighbor.h"
 #include "parameters.h"
+#include "percentile_stats.h"
 #include "utils.h"
 #include "windows_customizations.h"
 #include "scratch.h"
 #include "in_mem_data_store.h"
+#include "sq_data_store.h"
 
 #define OVERHEAD_FACTOR 1.1
 #define EXPAND_IF_FULL 0
 #define DEFAULT_MAXC 750
 
+// build_entry_points runs k-means on this many sampled points per entry point
+#define ENTRY_POINT_SAMPLES_PER_CENTER 256
+#define ENTRY_POINT_KMEANS_REPS 12
+
+// With SQ reranking, range_search reranks the candidates whose quantized
+// distance is within the range widened by this factor
+#define RANGE_SEARCH_SQ_SLACK 1.2f
+
 namespace diskann
 {
 
@@ -60,6 +70,8 @@ struct consolidation_report
     }
 };
 
+template <typename T, typename TagT, typename LabelT> class SearchIterator;
+
 template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> class Index
 {
     /**************************************************************************
@@ -76,14 +88,16 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     DISKANN_DLLEXPORT Index(Metric m, const size_t dim, const size_t max_points = 1, const bool dynamic_index = false,
                             const bool enable_tags = false, const bool concurrent_consolidate = false,
                             const bool pq_dist_build = false, const size_t num_pq_chunks = 0,
-                            const bool use_opq = false, const size_t num_frozen_pts = 0);
+                            const bool use_opq = false, const size_t num_frozen_pts = 0,
+                            const uint32_t num_sq_bits = 0);
 
     // Constructor for incremental index
     DISKANN_DLLEXPORT Index(Metric m, const size_t dim, const size_t max_points, const bool dynamic_index,
                             const IndexWriteParameters &indexParameters, const uint32_t initial_search_list_size,
                             const uint32_t search_threads, const bool enable_tags = false,
                             const bool concurrent_consolidate = false, const bool pq_dist_build = false,
-                            const size_t num_pq_chunks = 0, const bool use_opq = false);
+                            const size_t num_pq_chunks = 0, const bool use_opq = false,
+                            const uint32_t num_sq_bits = 0);
 
     DISKANN_DLLEXPORT ~Index();
 
@@ -117,6 +131,11 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     DISKANN_DLLEXPORT void build(const T *data, const size_t num_points_to_load, const IndexWriteParameters &parameters,
                                  const std::vector<TagT> &tags);
 
+    // For indices with scalar quantized data (num_sq_bits > 0): attach the
+    // full precision data file the index was built from, so that search
+    // re-ranks its candidate list with exact distances.
+    DISKANN_DLLEXPORT void set_full_precision_data_for_reranking(const std::string &data_file);
+
     // Filtered Support
     DISKANN_DLLEXPORT void build_filtered_index(const char *filename, const std::string &label_file,
                                                 const size_t num_points_to_load, IndexWriteParameters &parameters,
@@ -135,17 +154,53 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // to have higher consistency between index builds.
     DISKANN_DLLEXPORT void set_start_points_at_random(T radius, uint32_t random_seed = 0);
 
-    // For FastL2 search on a static index, we interleave the data with graph
+    // Picks the points closest to the k-means centroids of a sample of the
+    // data as extra entry points of a static index. Every search then starts
+    // from them as well as from the medoid, so queries in clusters far from
+    // the medoid need fewer hops. The entry points are saved with the index.
+    // The same random_seed picks the same entry points on the same index.
+    DISKANN_DLLEXPORT void build_entry_points(const uint32_t num_entry_points, const uint32_t random_seed = 0);
+
+    // Number of neighbor vectors, or rows of PQ codes, a search prefetches
+    // ahead of the distance it computes. 0 disables prefetching, including
+    // that of the adjacency list of the next candidate.
+    DISKANN_DLLEXPORT void set_prefetch_distance(const uint32_t prefetch_distance);
+
+    // Interleaves the vector, norm and adjacency list of every node in one
+    // cache line aligned, fixed size slot, so that expanding a node touches
+    // one contiguous range of memory. Use after build or load; all the search
+    // functions then read the graph and vectors from the layout. The layout
+    // holds no vectors for PQ or SQ based distances. A dynamic index keeps its
+    // adjacency lists for updates and writes every change through to its
+    // slot, which has room for the degree an insert may reach before pruning.
+    // save() stores the layout along with the index, and load() restores it:
+    // a static index reads its slots as they are, without the graph file.
     DISKANN_DLLEXPORT void optimize_index_layout();
 
-    // For FastL2 search on optimized layout
+    // Same as search() without distances, kept for existing callers.
     DISKANN_DLLEXPORT void search_with_optimized_layout(const T *query, size_t K, size_t L, uint32_t *indices);
 
     // Added search overload that takes L as parameter, so that we
-    // can customize L on a per-query basis without tampering with "Parameters"
+    // can customize L on a per-query basis without tampering with "Parameters".
+    // If stats is set, the search adds its counters and timings to it.
     template <typename IDType>
     DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> search(const T *query, const size_t K, const uint32_t L,
-                                                           IDType *indices, float *distances = nullptr);
+                                                           IDType *indices, float *distances = nullptr,
+                                                           QueryStats *stats = nullptr);
+
+    // Returns the points within range of the query in indices and distances,
+    // closest first. The search starts with a list of size min_L and, while at
+    // least half of the list is within range, doubles it up to max_L and
+    // resumes from the candidates scored so far. For inner product, range is a
+    // lower bound on the inner product. At most max_results points are
+    // returned if it is not 0. With full precision data for reranking, the
+    // points are selected by their full precision distances. Returns the
+    // number of hops and comparisons.
+    DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> range_search(const T *query, const float range,
+                                                                 const uint32_t min_L, const uint32_t max_L,
+                                                                 std::vector<uint32_t> &indices,
+                                                                 std::vector<float> &distances,
+                                                                 const size_t max_results = 0);
 
     // Initialize space for res_vectors before calling.
     DISKANN_DLLEXPORT size_t search_with_tags(const T *query, const uint64_t K, const uint32_t L, TagT *tags,
@@ -155,7 +210,8 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     template <typename IndexType>
     DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> search_with_filters(const T *query, const LabelT &filter_label,
                                                                         const size_t K, const uint32_t L,
-                                                                        IndexType *indices, float *distances);
+                                                                        IndexType *indices, float *distances,
+                                                                        QueryStats *stats = nullptr);
 
     // Will fail if tag already in the index or if tag=0.
     DISKANN_DLLEXPORT int insert_point(const T *point, const TagT tag);
@@ -210,6 +266,9 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // ********************************
 
   protected:
+    // resumes searches on the query scratch spaces of the index
+    friend class SearchIterator<T, TagT, LabelT>;
+
     // No copy/assign.
     Index(const Index<T, TagT, LabelT> &) = delete;
     Index<T, TagT, LabelT> &operator=(const Index<T, TagT, LabelT> &) = delete;
@@ -233,10 +292,48 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // with iterate_to_fixed_point.
     std::vector<uint32_t> get_init_ids();
 
+    // If scored_nodes is set, every candidate whose distance is computed is
+    // appended to it, including those that do not make it into the best L,
+    // and the expanded nodes are appended to the pool of the scratch.
+    // Passing no init_ids on a scratch that holds the state of a previous call
+    // resumes that search, e.g. with a larger Lindex.
     std::pair<uint32_t, uint32_t> iterate_to_fixed_point(const T *node_coords, const uint32_t Lindex,
                                                          const std::vector<uint32_t> &init_ids,
                                                          InMemQueryScratch<T> *scratch, bool use_filter,
-                                                         const std::vector<LabelT> &filters, bool search_invocation);
+                                                         const std::vector<LabelT> &filters, bool search_invocation,
+                                                         std::vector<Neighbor> *scored_nodes = nullptr,
+                                                         QueryStats *stats = nullptr);
+
+    // Adjacency list of location, from the optimized layout once it is built.
+    void get_neighbors(const uint32_t location, const uint32_t *&neighbors, uint32_t &num_neighbors) const;
+
+    // Bytes of a slot of the optimized layout before the adjacency list: the
+    // vector and its norm, none when distances come from PQ or SQ codes.
+    size_t get_optimized_layout_data_len() const;
+
+    // (Re)allocates the optimized layout for all the locations and fills every
+    // slot from _data_store and _final_graph.
+    void populate_optimized_layout();
+
+    // Copy the vector, or the adjacency list, of location to its slot of the
+    // optimized layout, if there is one. The adjacency list is copied under
+    // _locks[location] for a dynamic index.
+    void update_optimized_layout_vector(const uint32_t location);
+    void update_optimized_layout_neighbors(const uint32_t location);
+
+    // The slots of the _nd + _num_frozen_pts first locations, after a header
+    // describing their format. Loading returns the number of slots.
+    size_t save_optimized_layout(const std::string &layout_file);
+    size_t load_optimized_layout(const std::string &layout_file, size_t expected_num_points);
+
+    // Distance from a preprocessed query to the vector of location in the
+    // optimized layout.
+    float get_optimized_layout_distance(const T *query, const uint32_t location) const;
+
+    // Recomputes the distances of the candidates in scratch->best_l_nodes()
+    // against the full precision data of a scalar quantized index and re-sorts.
+    void rerank_with_full_precision(const T *aligned_query, InMemQueryScratch<T> *scratch,
+                                    QueryStats *stats = nullptr);
 
     void search_for_point_and_prune(int location, uint32_t Lindex, std::vector<uint32_t> &pruned_list,
                                     InMemQueryScratch<T> *scratch, bool use_filter = false,
@@ -261,6 +358,21 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
 
     void inter_insert(uint32_t n, std::vector<uint32_t> &pruned_list, InMemQueryScratch<T> *scratch);
 
+    // Links visit_order in rounds of at most batch_size points. The reverse
+    // edges of a round are buffered and merged into the neighbor lists
+    // afterwards, so that each list is pruned at most once per round and no
+    // per-neighbor locks are taken. With frozen_snapshot, the out neighbors of
+    // a round are also only published once the round is done, which makes the
+    // graph independent of the number of threads.
+    void link_in_batches(const std::vector<uint32_t> &visit_order, const uint32_t batch_size,
+                         const bool frozen_snapshot);
+
+    // Adds the reverse edges of the points visit_order[begin, end), whose out
+    // neighbors are already set. edge_buckets holds the per-thread buffers,
+    // reused across rounds.
+    void batch_inter_insert(const std::vector<uint32_t> &visit_order, const size_t begin, const size_t end,
+                            std::vector<std::vector<std::vector<std::pair<uint32_t, uint32_t>>>> &edge_buckets);
+
     // Acquire exclusive _update_lock before calling
     void link(const IndexWriteParameters &parameters);
 
@@ -316,7 +428,9 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     std::shared_ptr<Distance<T>> _distance;
 
     // Data
-    std::unique_ptr<InMemDataStore<T>> _data_store;
+    std::unique_ptr<AbstractDataStore<T>> _data_store;
+    // Non-owning view of _data_store when it is scalar quantized, else null.
+    SQDataStore<T> *_sq_data_store = nullptr;
     char *_opt_graph = nullptr;
 
     // Graph related data structures
@@ -334,11 +448,18 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     // See also _start below.
     size_t _num_frozen_pts = 0;
     size_t _max_range_of_loaded_graph = 0;
-    size_t _node_size;
-    size_t _data_len;
-    size_t _neighbor_len;
+
+    // Optimized layout: each node of _opt_graph takes _node_size bytes, the
+    // vector and its norm (_data_len bytes), then the degree and the
+    // neighbor slots (_neighbor_len bytes).
+    size_t _node_size = 0;
+    size_t _data_len = 0;
+    size_t _neighbor_len = 0;
 
     uint32_t _max_observed_degree = 0;
+    // Locations the searches of a static index start from besides _start,
+    // see build_entry_points.
+    std::vector<uint32_t> _entry_points;
     // Start point of the search. When _num_frozen_pts is greater than zero,
     // this is the location of the first frozen point. Otherwise, this is a
     // location of one of the points in index.
@@ -371,7 +492,8 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     float _indexingAlpha;
 
     // Query scratch data structures
-    ConcurrentQueue<InMemQueryScratch<T> *> _query_scratch;
+    ConcurrentPool<InMemQueryScratch<T>> _query_scratch;
+    uint32_t _prefetch_distance = defaults::PREFETCH_DISTANCE;
 
     // Flags for PQ based distance calculation
     bool _pq_dist = false;
@@ -381,6 +503,9 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> clas
     bool _pq_generated = false;
     FixedChunkPQTable _pq_table;
 
+    // Bits per dimension for scalar quantized data, 0 for full precision
+    uint32_t _num_sq_bits = 0;
+
     //
     // Data structures, locks and flags for dynamic indexing and tags
     //
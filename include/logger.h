@@ -2,8 +2,12 @@
 // Licensed under the MIT license.
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include "windows_customizations.h"
 
 namespace diskann
@@ -11,14 +15,76 @@ namespace diskann
 DISKANN_DLLEXPORT extern std::basic_ostream<char> cout;
 DISKANN_DLLEXPORT extern std::basic_ostream<char> cerr;
 
+// diskann::cout logs at LL_Info and diskann::cerr at LL_Error. LL_Debug is
+// only logged through DISKANN_LOG.
 enum class DISKANN_DLLEXPORT LogLevel
 {
+    LL_Debug = -1,
     LL_Info = 0,
     LL_Error,
     LL_Count
 };
 
-#ifdef EXEC_ENV_OLS
+// Sends every message to logger instead of stdout and stderr. Set it before
+// anything is logged.
 DISKANN_DLLEXPORT void SetCustomLogger(std::function<void(LogLevel, const char *)> logger);
-#endif
+
+// Messages below level are dropped; LL_Info by default.
+DISKANN_DLLEXPORT void set_log_level(LogLevel level);
+DISKANN_DLLEXPORT bool is_log_level_enabled(LogLevel level);
+
+// From now on, messages are handed to a background thread through a ring
+// buffer per logging thread, so that the threads that log never wait for the
+// output, nor for each other, unless their ring is full. The messages of a
+// thread keep their order; those of different threads may interleave
+// differently than they were logged. LL_Error messages are written before
+// the call that logs them returns. Meant for servers; the command line tools
+// log synchronously so that their output stays in order with std::cout.
+DISKANN_DLLEXPORT void enable_async_logging(size_t ring_size = 1024);
+
+// Waits until the messages logged so far are written.
+DISKANN_DLLEXPORT void flush_logs();
+
+// Logs message, which should end with a newline, at level.
+DISKANN_DLLEXPORT void log_message(LogLevel level, const std::string &message);
+
+// Whether a message of a call site that last logged at last_log_ms may log
+// now, at most once per interval_ms. Updates last_log_ms if so.
+DISKANN_DLLEXPORT bool is_log_rate_allowed(std::atomic<int64_t> &last_log_ms, int64_t interval_ms);
 } // namespace diskann
+
+// Messages of the levels below DISKANN_MIN_LOG_LEVEL are compiled out, along
+// with the formatting of their arguments. LL_Debug is compiled out unless
+// this is defined to -1.
+#ifndef DISKANN_MIN_LOG_LEVEL
+#define DISKANN_MIN_LOG_LEVEL 0
+#endif
+
+// Logs the stream expression msg as one line, e.g.
+// DISKANN_LOG(diskann::LogLevel::LL_Debug, "Expanded " << n << " nodes");
+// msg is not evaluated if level is compiled out or below the log level.
+#define DISKANN_LOG(level, msg)                                                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((int)(level) >= DISKANN_MIN_LOG_LEVEL && diskann::is_log_level_enabled(level))                             \
+        {                                                                                                              \
+            std::ostringstream diskann_log_stream;                                                                     \
+            diskann_log_stream << msg << "\n";                                                                         \
+            diskann::log_message(level, diskann_log_stream.str());                                                     \
+        }                                                                                                              \
+    } while (0)
+
+// As DISKANN_LOG, for messages of hot paths: each call site logs at most once
+// per interval_ms, and drops its messages in between.
+#define DISKANN_LOG_EVERY_MS(level, interval_ms, msg)                                                                  \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        static std::atomic<int64_t> diskann_last_log_ms(INT64_MIN);                                                    \
+        if ((int)(level) >= DISKANN_MIN_LOG_LEVEL && diskann::is_log_level_enabled(level) &&                           \
+            diskann::is_log_rate_allowed(diskann_last_log_ms, interval_ms))                                            \
+        {                                                                                                              \
+            std::ostringstream diskann_log_stream;                                                                     \
+            diskann_log_stream << msg << "\n";                                                                         \
+            diskann::log_message(level, diskann_log_stream.str());                                                     \
+        }                                                                                                              \
+    } while (0)
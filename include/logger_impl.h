@@ -4,13 +4,20 @@
 #pragma once
 
 #include <sstream>
-#include <mutex>
+#include <string>
 
 #include "ann_exception.h"
 #include "logger.h"
 
 namespace diskann
 {
+// Stream buffer of diskann::cout and diskann::cerr. It keeps no put area, so
+// every write reaches overflow() or xsputn(), which collect the text in a
+// buffer of the calling thread. A message is logged once it ends with a
+// newline, or when the calling code outputs std::flush; partial lines are
+// thus never interleaved with the text of other threads, and the threads
+// share no lock. This implies calling code _must_ end its messages with
+// std::endl, a newline or std::flush for them to be written.
 class ANNStreamBuf : public std::basic_streambuf<char>
 {
   public:
@@ -24,40 +31,17 @@ class ANNStreamBuf : public std::basic_streambuf<char>
     DISKANN_DLLEXPORT void close();
     DISKANN_DLLEXPORT virtual int underflow();
     DISKANN_DLLEXPORT virtual int overflow(int c);
+    DISKANN_DLLEXPORT virtual std::streamsize xsputn(const char *s, std::streamsize n);
     DISKANN_DLLEXPORT virtual int sync();
 
   private:
     FILE *_fp;
-    char *_buf;
-    int _bufIndex;
-    std::mutex _mutex;
     LogLevel _logLevel;
 
-    int flush();
-    void logImpl(char *str, int numchars);
-
-// Why the two buffer-sizes? If we are running normally, we are basically
-// interacting with a character output system, so we short-circuit the
-// output process by keeping an empty buffer and writing each character
-// to stdout/stderr. But if we are running in OLS, we have to take all
-// the text that is written to diskann::cout/diskann:cerr, consolidate it
-// and push it out in one-shot, because the OLS infra does not give us
-// character based output. Therefore, we use a larger buffer that is large
-// enough to store the longest message, and continuously add characters
-// to it. When the calling code outputs a std::endl or std::flush, sync()
-// will be called and will output a log level, component name, and the text
-// that has been collected. (sync() is also called if the buffer is full, so
-// overflows/missing text are not a concern).
-// This implies calling code _must_ either print std::endl or std::flush
-// to ensure that the message is written immediately.
-#ifdef EXEC_ENV_OLS
-    static const int BUFFER_SIZE = 1024;
-#else
-    // Allocating an arbitrarily small buffer here because the overflow() and
-    // other function implementations push the BUFFER_SIZE chars into the
-    // buffer before flushing to fwrite.
-    static const int BUFFER_SIZE = 4;
-#endif
+    // text of the calling thread not logged yet
+    std::string &thread_buffer();
+    // logs the complete lines of the buffer, or all of it if partial is set
+    void flush(std::string &buffer, bool partial);
 
     ANNStreamBuf(const ANNStreamBuf &);
     ANNStreamBuf &operator=(const ANNStreamBuf &);
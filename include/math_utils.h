@@ -82,6 +82,11 @@ float run_lloyds(float *data, size_t num_points, size_t dim, float *centers, con
 // assumes already memory allocated for pivot_data as new
 // float[num_centers*dim] and select randomly num_centers points as pivots
 void selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers);
+void selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers,
+                      const uint32_t random_seed);
 
+// The overloads without random_seed draw one from std::random_device.
 void kmeanspp_selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers);
+void kmeanspp_selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers,
+                               const uint32_t random_seed);
 } // namespace kmeans
@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <mutex>
 #include <vector>
+#include "tsl/robin_set.h"
 #include "utils.h"
 
 namespace diskann
@@ -104,11 +105,34 @@ class NeighborPriorityQueue
         return _data[pre];
     }
 
+    // The candidate the next closest_unexpanded() would return if no closer
+    // one is inserted first. Only valid if has_unexpanded_node().
+    const Neighbor &peek_closest_unexpanded() const
+    {
+        return _data[_cur];
+    }
+
     bool has_unexpanded_node() const
     {
         return _cur < _size;
     }
 
+    // Marks the items whose ids are in expanded_ids as expanded, for items an
+    // earlier search of the same query expanded before they were dropped.
+    void mark_expanded(const tsl::robin_set<uint32_t> &expanded_ids)
+    {
+        for (size_t i = 0; i < _size; i++)
+        {
+            if (expanded_ids.find(_data[i].id) != expanded_ids.end())
+                _data[i].expanded = true;
+        }
+        _cur = 0;
+        while (_cur < _size && _data[_cur].expanded)
+        {
+            _cur++;
+        }
+    }
+
     size_t size() const
     {
         return _size;
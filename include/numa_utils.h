@@ -0,0 +1,29 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// NUMA topology helpers, read from /sys/devices/system/node on Linux. On
+// other platforms (or when sysfs is not available) the machine is reported
+// as a single node holding every CPU, and pinning is a no-op.
+
+DISKANN_DLLEXPORT uint32_t get_num_numa_nodes();
+
+// CPUs belonging to the given node.
+DISKANN_DLLEXPORT const std::vector<uint32_t> &get_numa_node_cpus(const uint32_t node);
+
+// Node of the CPU the calling thread is currently running on. Only stable if
+// the thread has been pinned.
+DISKANN_DLLEXPORT uint32_t get_current_numa_node();
+
+// Restricts the calling thread to the CPUs of the given node. Returns false if
+// the affinity could not be set.
+DISKANN_DLLEXPORT bool pin_thread_to_numa_node(const uint32_t node);
+} // namespace diskann
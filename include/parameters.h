@@ -5,6 +5,7 @@
 #include <sstream>
 #include <typeinfo>
 #include <unordered_map>
+#include <omp.h>
 
 #include "defaults.h"
 
@@ -23,14 +24,22 @@ class IndexWriteParameters
     const uint32_t num_threads;
     const uint32_t filter_list_size; // Lf
     const uint32_t num_frozen_points;
+    // Points per round when reverse edges are merged in batches, 0 to insert
+    // them one at a time as each point is linked.
+    const uint32_t insert_batch_size;
+    // Insert points in doubling batches that search a frozen snapshot of the
+    // graph, so that the graph does not depend on thread scheduling.
+    const bool deterministic_build;
 
   private:
     IndexWriteParameters(const uint32_t search_list_size, const uint32_t max_degree, const bool saturate_graph,
                          const uint32_t max_occlusion_size, const float alpha, const uint32_t num_threads,
-                         const uint32_t filter_list_size, const uint32_t num_frozen_points)
+                         const uint32_t filter_list_size, const uint32_t num_frozen_points,
+                         const uint32_t insert_batch_size, const bool deterministic_build)
         : search_list_size(search_list_size), max_degree(max_degree), saturate_graph(saturate_graph),
           max_occlusion_size(max_occlusion_size), alpha(alpha), num_threads(num_threads),
-          filter_list_size(filter_list_size), num_frozen_points(num_frozen_points)
+          filter_list_size(filter_list_size), num_frozen_points(num_frozen_points),
+          insert_batch_size(insert_batch_size), deterministic_build(deterministic_build)
     {
     }
 
@@ -87,16 +96,30 @@ class IndexWriteParametersBuilder
         return *this;
     }
 
+    IndexWriteParametersBuilder &with_insert_batch_size(const uint32_t insert_batch_size)
+    {
+        _insert_batch_size = insert_batch_size;
+        return *this;
+    }
+
+    IndexWriteParametersBuilder &with_deterministic_build(const bool deterministic_build)
+    {
+        _deterministic_build = deterministic_build;
+        return *this;
+    }
+
     IndexWriteParameters build() const
     {
         return IndexWriteParameters(_search_list_size, _max_degree, _saturate_graph, _max_occlusion_size, _alpha,
-                                    _num_threads, _filter_list_size, _num_frozen_points);
+                                    _num_threads, _filter_list_size, _num_frozen_points, _insert_batch_size,
+                                    _deterministic_build);
     }
 
     IndexWriteParametersBuilder(const IndexWriteParameters &wp)
         : _search_list_size(wp.search_list_size), _max_degree(wp.max_degree),
           _max_occlusion_size(wp.max_occlusion_size), _saturate_graph(wp.saturate_graph), _alpha(wp.alpha),
-          _filter_list_size(wp.filter_list_size), _num_frozen_points(wp.num_frozen_points)
+          _filter_list_size(wp.filter_list_size), _num_frozen_points(wp.num_frozen_points),
+          _insert_batch_size(wp.insert_batch_size), _deterministic_build(wp.deterministic_build)
     {
     }
     IndexWriteParametersBuilder(const IndexWriteParametersBuilder &) = delete;
@@ -111,6 +134,8 @@ class IndexWriteParametersBuilder
     uint32_t _num_threads{defaults::NUM_THREADS};
     uint32_t _filter_list_size{defaults::FILTER_LIST_SIZE};
     uint32_t _num_frozen_points{defaults::NUM_FROZEN_POINTS_STATIC};
+    uint32_t _insert_batch_size{defaults::INSERT_BATCH_SIZE};
+    bool _deterministic_build{defaults::DETERMINISTIC_BUILD};
 };
 
 } // namespace diskann
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
@@ -18,21 +20,41 @@
 
 namespace diskann
 {
+// One hop of a search, i.e. the expansion of one beam of candidates, or of one
+// candidate for the in-memory index.
+struct HopTrace
+{
+    float start_us = 0;        // since the start of the query
+    float io_us = 0;           // reading the beam from disk
+    unsigned n_ios = 0;        // # nodes of the beam read from disk
+    unsigned n_cache_hits = 0; // # nodes of the beam found in the cache
+    unsigned n_pq_cmps = 0;    // # distances on PQ codes
+    unsigned n_full_cmps = 0;  // # distances on full precision or SQ vectors
+};
+
 struct QueryStats
 {
-    float total_us = 0; // total time to process query in micros
-    float io_us = 0;    // total time spent in IO
-    float cpu_us = 0;   // total time spent in CPU
-
-    unsigned n_4k = 0;         // # of 4kB reads
-    unsigned n_8k = 0;         // # of 8kB reads
-    unsigned n_12k = 0;        // # of 12kB reads
-    unsigned n_ios = 0;        // total # of IOs issued
-    unsigned read_size = 0;    // total # of bytes read
-    unsigned n_cmps_saved = 0; // # cmps saved
-    unsigned n_cmps = 0;       // # cmps
-    unsigned n_cache_hits = 0; // # cache_hits
-    unsigned n_hops = 0;       // # search hops
+    float total_us = 0;     // total time to process query in micros
+    float io_us = 0;        // total time spent in IO
+    float cpu_us = 0;       // total time spent in CPU
+    float lock_wait_us = 0; // waiting for a scratch space and the index locks
+
+    unsigned n_4k = 0;             // # of 4kB reads
+    unsigned n_8k = 0;             // # of 8kB reads; deprecated, searches read 4kB sectors
+    unsigned n_12k = 0;            // # of 12kB reads; deprecated, searches read 4kB sectors
+    unsigned n_ios = 0;            // total # of IOs issued
+    unsigned read_size = 0;        // total # of bytes read
+    unsigned n_cmps_saved = 0;     // # neighbors skipped as already visited
+    unsigned n_cmps = 0;           // # cmps
+    unsigned n_pq_cmps = 0;        // # distances on PQ codes
+    unsigned n_full_cmps = 0;      // # distances on full precision or SQ vectors
+    unsigned n_cache_hits = 0;     // # cache_hits
+    unsigned n_filter_rejects = 0; // # neighbors skipped for not matching the filter
+    unsigned n_hops = 0;           // # search hops
+
+    // If set, the search appends one entry per hop. Meant for a sample of the
+    // queries, as it grows the vector by one entry per hop.
+    std::vector<HopTrace> *hops = nullptr;
 };
 
 template <typename T>
@@ -62,4 +84,78 @@ inline double get_mean_stats(QueryStats *stats, uint64_t len, const std::functio
     }
     return avg / len;
 }
+
+// Whether query i is in the sample of about sampling_rate of the queries whose
+// hops are traced. The sample is spread evenly over the queries and is the
+// same on every run.
+inline bool is_traced_query(uint64_t i, float sampling_rate)
+{
+    return std::floor((i + 1) * (double)sampling_rate) > std::floor(i * (double)sampling_rate);
+}
+
+// Number of queries per power of 2 bucket of member_fn: bucket 0 counts the
+// values below 1 and bucket b > 0 those in [2^(b-1), 2^b).
+template <typename T>
+inline std::vector<uint64_t> get_histogram_stats(QueryStats *stats, uint64_t len,
+                                                 const std::function<T(const QueryStats &)> &member_fn)
+{
+    std::vector<uint64_t> counts;
+    for (uint64_t i = 0; i < len; i++)
+    {
+        const double val = (double)member_fn(stats[i]);
+        const size_t bucket = val < 1 ? 0 : (size_t)std::floor(std::log2(val)) + 1;
+        if (bucket >= counts.size())
+            counts.resize(bucket + 1, 0);
+        counts[bucket]++;
+    }
+    return counts;
+}
+
+// Writes the histograms of the per query statistics as CSV rows of the
+// statistic, the upper bound of the bucket and the number of queries in it.
+inline void save_query_stats_histograms(const std::string &filename, QueryStats *stats, uint64_t len)
+{
+    const std::vector<std::pair<std::string, std::function<double(const QueryStats &)>>> columns = {
+        {"total_us", [](const QueryStats &s) { return s.total_us; }},
+        {"io_us", [](const QueryStats &s) { return s.io_us; }},
+        {"cpu_us", [](const QueryStats &s) { return s.cpu_us; }},
+        {"lock_wait_us", [](const QueryStats &s) { return s.lock_wait_us; }},
+        {"n_ios", [](const QueryStats &s) { return s.n_ios; }},
+        {"n_hops", [](const QueryStats &s) { return s.n_hops; }},
+        {"n_pq_cmps", [](const QueryStats &s) { return s.n_pq_cmps; }},
+        {"n_full_cmps", [](const QueryStats &s) { return s.n_full_cmps; }},
+        {"n_cache_hits", [](const QueryStats &s) { return s.n_cache_hits; }},
+        {"n_cmps_saved", [](const QueryStats &s) { return s.n_cmps_saved; }},
+        {"n_filter_rejects", [](const QueryStats &s) { return s.n_filter_rejects; }}};
+
+    std::ofstream out(filename);
+    out << "stat,upper_bound,count" << std::endl;
+    for (auto &column : columns)
+    {
+        const std::vector<uint64_t> counts = get_histogram_stats<double>(stats, len, column.second);
+        for (size_t bucket = 0; bucket < counts.size(); bucket++)
+        {
+            if (counts[bucket] > 0)
+                out << column.first << "," << ((uint64_t)1 << bucket) << "," << counts[bucket] << std::endl;
+        }
+    }
+}
+
+// Writes the hops of the queries that were traced as CSV rows, one per hop.
+inline void save_query_traces(const std::string &filename, QueryStats *stats, uint64_t len)
+{
+    std::ofstream out(filename);
+    out << "query,hop,start_us,io_us,n_ios,n_cache_hits,n_pq_cmps,n_full_cmps" << std::endl;
+    for (uint64_t i = 0; i < len; i++)
+    {
+        if (stats[i].hops == nullptr)
+            continue;
+        for (size_t hop = 0; hop < stats[i].hops->size(); hop++)
+        {
+            const HopTrace &trace = (*stats[i].hops)[hop];
+            out << i << "," << hop << "," << trace.start_us << "," << trace.io_us << "," << trace.n_ios << ","
+                << trace.n_cache_hits << "," << trace.n_pq_cmps << "," << trace.n_full_cmps << std::endl;
+        }
+    }
+}
 } // namespace diskann
@@ -38,7 +38,9 @@ class FixedChunkPQTable
 
     uint32_t get_num_chunks();
 
-    void preprocess_query(float *query_vec);
+    // centers the query and rotates it if we have a rotation matrix; writes
+    // the result to rotated_query without any per-call allocation
+    void preprocess_query(const float *query_vec, float *rotated_query);
 
     // assumes pre-processed query
     void populate_chunk_distances(const float *query_vec, float *dist_vec);
@@ -50,6 +52,9 @@ class FixedChunkPQTable
     // assumes no rotation is involved
     void inflate_vector(uint8_t *base_vec, float *out_vec);
 
+    // inverse of inflate_vector: the code of the nearest center in each chunk
+    void compress_vector(const float *vec, uint8_t *out_code);
+
     void populate_chunk_inner_products(const float *query_vec, float *dist_vec);
 };
 
@@ -6,6 +6,7 @@
 
 #include "aligned_file_reader.h"
 #include "concurrent_queue.h"
+#include "index.h"
 #include "neighbor.h"
 #include "parameters.h"
 #include "percentile_stats.h"
@@ -13,10 +14,15 @@
 #include "utils.h"
 #include "windows_customizations.h"
 #include "scratch.h"
+#include "timer.h"
 #include "tsl/robin_map.h"
 #include "tsl/robin_set.h"
 
 #define FULL_PRECISION_REORDER_MULTIPLIER 3
+#define MAX_TOMBSTONE_L_EXPANSION 4
+#define RANGE_SEARCH_PQ_SLACK 1.2f
+#define NAV_INDEX_NUM_ENTRY_POINTS 4
+#define NAV_INDEX_SEARCH_L 32
 
 namespace diskann
 {
@@ -46,6 +52,18 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
 
     DISKANN_DLLEXPORT void load_cache_list(std::vector<uint32_t> &node_list);
 
+    // Writes the loaded node cache to cache_file, generated for a cache of
+    // num_nodes_to_cache nodes and stamped with the header sector of the disk
+    // index and a hash of its PQ codes, so that a restart can skip computing
+    // the cache list and reading its sectors.
+    DISKANN_DLLEXPORT void save_cache(const std::string &cache_file, uint64_t num_nodes_to_cache);
+
+    // Loads up to num_nodes_to_cache nodes of a cache written by save_cache,
+    // with sequential reads. Returns false, leaving the index uncached, if the
+    // file does not exist, was saved for fewer nodes or for a different index,
+    // or if a sample of its nodes differs from their records on disk.
+    DISKANN_DLLEXPORT bool load_cache(const std::string &cache_file, uint64_t num_nodes_to_cache);
+
 #ifdef EXEC_ENV_OLS
     DISKANN_DLLEXPORT void generate_cache_list_from_sample_queries(MemoryMappedFiles &files, std::string sample_bin,
                                                                    uint64_t l_search, uint64_t beamwidth,
@@ -61,6 +79,49 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void cache_bfs_levels(uint64_t num_nodes_to_cache, std::vector<uint32_t> &node_list,
                                             const bool shuffle = false);
 
+    // Gives every NUMA node its own copy of the PQ codes and of the node cache,
+    // plus num_threads scratch spaces allocated on that node. Searches then only
+    // touch the memory of the node the calling thread runs on, so the search
+    // threads should be pinned with pin_thread_to_numa_node(). Call after the
+    // cache has been loaded; no-op on single node machines.
+    DISKANN_DLLEXPORT void enable_numa_replication(uint32_t num_threads);
+
+    // Number of entry points a search takes from the navigation index, see
+    // build_nav_index, up to NAV_INDEX_SEARCH_L. 0 starts from the medoids
+    // instead. Has no effect on indices loaded without a navigation index.
+    DISKANN_DLLEXPORT void set_num_nav_entry_points(const uint32_t num_entry_points);
+
+    // Searches with the scratch spaces and IO contexts of scratch_pool instead
+    // of allocating num_threads of them in load(), which must come after this
+    // call. The pool must fit the dimension of the index. Not supported in
+    // the OLS environment.
+    DISKANN_DLLEXPORT void use_shared_scratch(std::shared_ptr<SSDScratchPool<T>> scratch_pool);
+
+    // Approximate bytes of memory held by the loaded index: the PQ codes and
+    // tables and the node cache.
+    DISKANN_DLLEXPORT uint64_t get_memory_usage();
+
+    // Deleted points are still traversed, so the graph stays navigable, but
+    // are left out of the search results. To keep the recall of an index
+    // with many deletes, the search list of a query grows by the number of
+    // deleted candidates it holds, up to MAX_TOMBSTONE_L_EXPANSION times
+    // l_search. All of these may run concurrently with searches;
+    // set_deleted_points and load_deleted_points swap in the new set
+    // atomically, so a query sees either the old or the new set. Ids are
+    // those of the points; in a filtered index, deleting a point also
+    // deletes its dummy points.
+    DISKANN_DLLEXPORT void set_deleted_points(const std::vector<uint32_t> &ids);
+    // ids in the format of save_bin<uint32_t>, one per row
+    DISKANN_DLLEXPORT void load_deleted_points(const std::string &deleted_points_file);
+    DISKANN_DLLEXPORT void mark_deleted(const uint32_t id);
+    DISKANN_DLLEXPORT void unmark_deleted(const uint32_t id);
+    DISKANN_DLLEXPORT void clear_deleted_points();
+    DISKANN_DLLEXPORT bool is_deleted(const uint32_t id);
+
+    // If fewer than k_search points are found, which can happen when most of
+    // the candidates are deleted, the remaining ids are set to
+    // std::numeric_limits<uint64_t>::max() and their distances to
+    // std::numeric_limits<float>::max().
     DISKANN_DLLEXPORT void cached_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
                                               uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
                                               const bool use_reorder_data = false, QueryStats *stats = nullptr);
@@ -86,7 +147,7 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT uint32_t range_search(const T *query1, const double range, const uint64_t min_l_search,
                                             const uint64_t max_l_search, std::vector<uint64_t> &indices,
                                             std::vector<float> &distances, const uint64_t min_beam_width,
-                                            QueryStats *stats = nullptr);
+                                            QueryStats *stats = nullptr, const bool stop_beyond_range = false);
 
     DISKANN_DLLEXPORT uint64_t get_data_dim();
 
@@ -107,6 +168,23 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void get_label_file_metadata(std::string map_file, uint32_t &num_pts, uint32_t &num_total_labels);
     DISKANN_DLLEXPORT inline int32_t get_filter_number(const LabelT &filter_label);
 
+    // Reads the first sector of the disk index, which holds its metadata.
+    void read_index_header(std::vector<char> &header);
+
+    // hash of the PQ codes of all the points, which stamps a saved cache with
+    // the content of the index
+    uint64_t hash_pq_codes();
+
+    // Reads the on-disk records of node_ids, each sector once even if several
+    // of the nodes share it, with the reads spread over all the registered IO
+    // contexts. node_visitor is called concurrently with the position of a
+    // node in node_ids and its record.
+    void read_nodes_parallel(const std::vector<uint32_t> &node_ids,
+                             const std::function<void(size_t, char *)> &node_visitor);
+
+    // the scratch spaces searches take theirs from, shared or not
+    ConcurrentPool<SSDThreadData<T>> &scratch_queue();
+
     // index info
     // nhood of node `i` is in sector: [i / nnodes_per_sector]
     // offset in sector: [(i % nnodes_per_sector) * max_node_len]
@@ -167,6 +245,13 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     // closest centroid as the starting point of search
     float *centroid_data = nullptr;
 
+    // optional in-memory graph over a sample of the points, searched for the
+    // entry points of a query instead of the medoids. _nav_ids maps its
+    // locations to disk ids.
+    std::unique_ptr<Index<T>> _nav_index;
+    std::vector<uint32_t> _nav_ids;
+    uint32_t _num_nav_entry_points = NAV_INDEX_NUM_ENTRY_POINTS;
+
     // nhood_cache
     unsigned *nhood_cache_buf = nullptr;
     tsl::robin_map<uint32_t, std::pair<uint32_t, uint32_t *>> nhood_cache;
@@ -175,8 +260,22 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     T *coord_cache_buf = nullptr;
     tsl::robin_map<uint32_t, T *> coord_cache;
 
-    // thread-specific scratch
-    ConcurrentQueue<SSDThreadData<T> *> thread_data;
+    // thread-specific scratch, unused if _shared_scratch is set
+    ConcurrentPool<SSDThreadData<T>> thread_data;
+    std::shared_ptr<SSDScratchPool<T>> _shared_scratch;
+
+    // per NUMA node copies of the above, see enable_numa_replication(). Once
+    // they exist, `data` aliases the PQ codes of the first replica.
+    struct NumaReplica
+    {
+        uint8_t *data = nullptr;
+        uint32_t *nhood_cache_buf = nullptr;
+        T *coord_cache_buf = nullptr;
+        tsl::robin_map<uint32_t, std::pair<uint32_t, uint32_t *>> nhood_cache;
+        tsl::robin_map<uint32_t, T *> coord_cache;
+        ConcurrentPool<SSDThreadData<T>> thread_data;
+    };
+    std::vector<std::unique_ptr<NumaReplica>> numa_replicas;
     uint64_t max_nthreads;
     bool load_flag = false;
     bool count_visited_nodes = false;
@@ -197,6 +296,66 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     tsl::robin_map<uint32_t, std::vector<uint32_t>> _real_to_dummy_map;
     std::unordered_map<std::string, LabelT> _label_map;
 
+    // one bit per point. Searches take a reference with std::atomic_load, so
+    // that set_deleted_points can replace it while they run.
+    typedef std::vector<std::atomic<uint64_t>> DeletedBitmap;
+    std::shared_ptr<DeletedBitmap> _deleted_points;
+    // serializes the updates of _deleted_points
+    std::mutex _deleted_points_lock;
+    // sets or clears the bit of id and those of its dummy points
+    void set_deleted_bits(DeletedBitmap &bitmap, const uint32_t id, const bool deleted);
+
+    // A query of cached_beam_search or range_search: the copies of the index
+    // it reads, its scratch space and the deleted points as of its start.
+    struct QueryContext
+    {
+        const uint8_t *pq_data = nullptr;
+        const tsl::robin_map<uint32_t, std::pair<uint32_t, uint32_t *>> *nhood_cache = nullptr;
+        const tsl::robin_map<uint32_t, T *> *coord_cache = nullptr;
+        SSDThreadData<T> *thread_data = nullptr;
+        float query_norm = 0;
+        bool use_filter = false;
+        int32_t filter_num = 0;
+        std::shared_ptr<DeletedBitmap> deleted_points;
+        QueryStats *stats = nullptr;
+        Timer query_timer;
+
+        // cleared by every expand_beam
+        std::vector<uint32_t> frontier;
+        std::vector<std::pair<uint32_t, char *>> frontier_nhoods;
+        std::vector<AlignedRead> frontier_read_reqs;
+        std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t *>>> cached_nhoods;
+
+        bool is_live(const uint32_t id) const
+        {
+            return deleted_points == nullptr ||
+                   !(((*deleted_points)[id / 64].load(std::memory_order_relaxed) >> (id % 64)) & 1);
+        }
+    };
+
+    // the replica of the NUMA node the calling thread runs on, if any
+    NumaReplica *current_replica();
+
+    // Sets up query to search for query1 with the scratch space thread_data,
+    // taken from the scratch spaces of replica if it is not null.
+    void start_query(const T *query1, NumaReplica *replica, SSDThreadData<T> *thread_data, const bool use_filter,
+                     const int32_t filter_num, QueryStats *stats, QueryContext &query);
+
+    // Adds the entry points of the query to retset: the closest points of the
+    // navigation index if there is one, else the medoid of the closest
+    // centroid, or that of filter_label for a filtered query.
+    void add_entry_points(QueryContext &query, const LabelT &filter_label, NeighborPriorityQueue &retset);
+
+    void compute_pq_dists(const QueryContext &query, const uint32_t *ids, const uint64_t n_ids, float *dists_out);
+
+    // Expands the nodes of beam, reading from disk those that are not cached.
+    // The live ones are added to full_retset with their full precision
+    // distance, and their neighbors not visited before, that pass the filter,
+    // are inserted into retset with their PQ distance, and appended to scored
+    // if it is not null. Returns the number of nodes read from disk.
+    uint32_t expand_beam(QueryContext &query, const std::vector<uint32_t> &beam, NeighborPriorityQueue &retset,
+                         std::vector<Neighbor> *scored);
+
 #ifdef EXEC_ENV_OLS
     // Set to a larger value than the actual header to accommodate
     // any additions we make to the header. This is an outer limit
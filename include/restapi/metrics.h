@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <percentile_stats.h>
+
+namespace diskann
+{
+// Lock-free histogram of non-negative integer values with log-linear buckets
+// as in HdrHistogram: the values below 2^SUB_BUCKET_BITS have a bucket each,
+// and every larger power of 2 range is split in 2^SUB_BUCKET_BITS buckets, so
+// a percentile is within 1/2^SUB_BUCKET_BITS of the exact one. Any number of
+// threads may record and read at a time; a read sees each bucket at some point
+// during the read.
+class LatencyHistogram
+{
+  public:
+    static const uint32_t SUB_BUCKET_BITS = 5;
+    static const uint32_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    LatencyHistogram();
+
+    void record(const uint64_t value);
+
+    uint64_t get_count() const;
+    uint64_t get_sum() const;
+    // highest value of the bucket holding the given fraction of the values
+    // at or below it, 0 if there are none
+    uint64_t get_percentile(const double fraction) const;
+
+    // Appends the histogram as a Prometheus summary with the 0.5, 0.99 and
+    // 0.999 quantiles. labels are the labels of every sample, without braces,
+    // e.g. "index=\"0\"", or empty.
+    void write_prometheus(std::ostringstream &out, const std::string &name, const std::string &labels) const;
+
+  private:
+    static uint32_t get_bucket(const uint64_t value);
+    static uint64_t get_bucket_max(const uint32_t bucket);
+
+    std::atomic<uint64_t> _counts[NUM_BUCKETS];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+};
+
+// Counters and histograms of the searches of one BaseSearch, recorded from the
+// QueryStats of each search.
+class SearchMetrics
+{
+  public:
+    SearchMetrics();
+
+    void record(const uint64_t latency_us, const QueryStats &stats);
+
+    // Appends the samples of the given metric, 0 to NUM_METRICS - 1, in the
+    // Prometheus text format, after its HELP and TYPE lines if write_headers
+    // is set. Prometheus wants the samples of a metric together, so the
+    // metrics of several searchers are written metric by metric.
+    static const uint32_t NUM_METRICS = 8;
+    void write_prometheus(std::ostringstream &out, const uint32_t metric, const std::string &labels,
+                          const bool write_headers) const;
+
+  private:
+    std::atomic<uint64_t> _num_searches;
+    std::atomic<uint64_t> _num_ios;
+    std::atomic<uint64_t> _num_cache_hits;
+    LatencyHistogram _latency_us;
+    LatencyHistogram _lock_wait_us;
+    LatencyHistogram _ios;
+    LatencyHistogram _hops;
+};
+} // namespace diskann
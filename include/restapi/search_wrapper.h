@@ -9,6 +9,8 @@
 
 #include <index.h>
 #include <pq_flash_index.h>
+#include <disk_index_manager.h>
+#include <restapi/metrics.h>
 
 namespace diskann
 {
@@ -104,9 +106,16 @@ class BaseSearch
 
     void lookup_tags(const unsigned K, const unsigned *indices, std::string *ret_tags);
 
+    // metrics of the searches so far, which the searches update without locks
+    const SearchMetrics &get_metrics() const
+    {
+        return _metrics;
+    }
+
   protected:
     bool _tags_enabled;
     std::vector<std::string> _tags_str;
+    SearchMetrics _metrics;
 };
 
 template <typename T> class InMemorySearch : public BaseSearch
@@ -137,4 +146,21 @@ template <typename T> class PQFlashSearch : public BaseSearch
     std::unique_ptr<diskann::PQFlashIndex<T>> _index;
     std::shared_ptr<AlignedFileReader> reader;
 };
+
+// Searches one of the indices of a DiskIndexManager, which the searchers of
+// all the indices of a server share, so that the indices share their scratch,
+// IO contexts and memory budget and are loaded on their first search.
+template <typename T> class ManagedPQFlashSearch : public BaseSearch
+{
+  public:
+    ManagedPQFlashSearch(std::shared_ptr<diskann::DiskIndexManager<T>> manager, const std::string &indexPrefix,
+                         const std::string &tagsFile);
+    virtual ~ManagedPQFlashSearch();
+
+    SearchResult search(const T *query, const unsigned int dimensions, const unsigned int K, const unsigned int Ls);
+
+  private:
+    std::shared_ptr<diskann::DiskIndexManager<T>> _manager;
+    std::string _name;
+};
 } // namespace diskann
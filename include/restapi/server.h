@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <restapi/common.h>
 #include <cpprest/http_listener.h>
 
@@ -11,8 +13,11 @@ namespace diskann
 class Server
 {
   public:
+    // A request searches all the searchers, or only the one at the position
+    // given by its "partition" field. With route_by_partition, requests must
+    // give that field.
     Server(web::uri &url, std::vector<std::unique_ptr<diskann::BaseSearch>> &multi_searcher,
-           const std::string &typestring);
+           const std::string &typestring, const bool route_by_partition = false);
     virtual ~Server();
 
     pplx::task<void> open();
@@ -20,6 +25,11 @@ class Server
 
   protected:
     template <class T> void handle_post(web::http::http_request message);
+    // serves the metrics of the server and its searchers on /metrics
+    void handle_get(web::http::http_request message);
+
+    // the metrics in the Prometheus text format
+    std::string get_metrics();
 
     template <typename T>
     web::json::value toJsonArray(const std::vector<T> &v, std::function<web::json::value(const T &)> valConverter);
@@ -27,7 +37,7 @@ class Server
 
     template <class T>
     void parseJson(const utility::string_t &body, unsigned int &k, int64_t &queryId, T *&queryVector,
-                   unsigned int &dimensions, unsigned &Ls);
+                   unsigned int &dimensions, unsigned &Ls, int64_t &partition);
 
     web::json::value idsToJsonArray(const diskann::SearchResult &result);
     web::json::value distancesToJsonArray(const diskann::SearchResult &result);
@@ -40,6 +50,11 @@ class Server
     bool _isDebug;
     std::unique_ptr<web::http::experimental::listener::http_listener> _listener;
     const bool _multi_search;
+    const bool _route_by_partition;
     std::vector<std::unique_ptr<diskann::BaseSearch>> _multi_searcher;
+
+    std::atomic<uint64_t> _num_requests;
+    std::atomic<uint64_t> _num_errors;
+    LatencyHistogram _request_latency_us;
 };
 } // namespace diskann
@@ -5,8 +5,6 @@
 
 #include <vector>
 
-#include "boost_dynamic_bitset_fwd.h"
-//#include "boost/dynamic_bitset.hpp"
 #include "tsl/robin_set.h"
 #include "tsl/robin_map.h"
 #include "tsl/sparse_map.h"
@@ -15,6 +13,7 @@
 #include "concurrent_queue.h"
 #include "pq.h"
 #include "aligned_file_reader.h"
+#include "visited_set.h"
 
 // In-mem index related limits
 #define GRAPH_SLACK_FACTOR 1.3
@@ -73,13 +72,9 @@ template <typename T> class InMemQueryScratch
     {
         return _occlude_factor;
     }
-    inline tsl::robin_set<uint32_t> &inserted_into_pool_rs()
+    inline VisitedSet &inserted_into_pool()
     {
-        return _inserted_into_pool_rs;
-    }
-    inline boost::dynamic_bitset<> &inserted_into_pool_bs()
-    {
-        return *_inserted_into_pool_bs;
+        return _inserted_into_pool;
     }
     inline std::vector<uint32_t> &id_scratch()
     {
@@ -101,11 +96,16 @@ template <typename T> class InMemQueryScratch
     {
         return _occlude_list_output;
     }
+    // Returns a zero padded buffer for num_vectors vectors of aligned_dim
+    // elements each, growing it if needed.
+    T *occlude_tile(size_t num_vectors);
 
   private:
     uint32_t _L;
     uint32_t _R;
     uint32_t _maxc;
+    size_t _aligned_dim;
+    size_t _alignment_factor;
 
     T *_aligned_query = nullptr;
 
@@ -125,13 +125,8 @@ template <typename T> class InMemQueryScratch
     // _occlude_factor is initialized to maxc size
     std::vector<float> _occlude_factor;
 
-    // Capacity initialized to 20L
-    tsl::robin_set<uint32_t> _inserted_into_pool_rs;
-
-    // Use a pointer here to allow for forward declaration of dynamic_bitset
-    // in public headers to avoid making boost a dependency for clients
-    // of DiskANN.
-    boost::dynamic_bitset<> *_inserted_into_pool_bs;
+    // Capacity initialized to 20L for large indices
+    VisitedSet _inserted_into_pool;
 
     // _id_scratch.size() must be > R*GRAPH_SLACK_FACTOR for iterate_to_fp
     std::vector<uint32_t> _id_scratch;
@@ -144,6 +139,13 @@ template <typename T> class InMemQueryScratch
     tsl::robin_set<uint32_t> _expanded_nodes_set;
     std::vector<Neighbor> _expanded_nghrs_vec;
     std::vector<uint32_t> _occlude_list_output;
+
+    // The occlude_list candidates copied contiguously, so that the pairwise
+    // distances of prune stream through memory instead of gathering two random
+    // vectors per pair. Allocated on first use; search only threads never
+    // need it.
+    T *_occlude_tile = nullptr;
+    size_t _occlude_tile_capacity = 0;
 };
 
 //
@@ -163,7 +165,7 @@ template <typename T> class SSDQueryScratch
 
     PQScratch<T> *_pq_scratch;
 
-    tsl::robin_set<size_t> visited;
+    VisitedSet visited;
     NeighborPriorityQueue retset;
     std::vector<Neighbor> full_retset;
 
@@ -184,19 +186,54 @@ template <typename T> class SSDThreadData
 };
 
 //
-// Class to avoid the hassle of pushing and popping the query scratch.
+// Scratch spaces and IO contexts that several PQFlashIndex instances search
+// with, see PQFlashIndex::use_shared_scratch, so that their number follows the
+// number of concurrent searches rather than the number of indices. The IO
+// contexts are registered with io_reader, which is never opened: they are not
+// bound to a file on Linux, but are on Windows, where the pool is not
+// supported. Every scratch space fits indices of up to max_aligned_dim
+// dimensions.
+//
+template <typename T> class SSDScratchPool
+{
+  public:
+    SSDScratchPool(std::shared_ptr<AlignedFileReader> io_reader, uint64_t num_threads, uint64_t max_aligned_dim,
+                   uint64_t visited_reserve = 4096);
+    ~SSDScratchPool();
+
+    ConcurrentPool<SSDThreadData<T>> &thread_data()
+    {
+        return _thread_data;
+    }
+    uint64_t get_num_threads() const
+    {
+        return _num_threads;
+    }
+    uint64_t get_aligned_dim() const
+    {
+        return _aligned_dim;
+    }
+
+  private:
+    std::shared_ptr<AlignedFileReader> _io_reader;
+    ConcurrentPool<SSDThreadData<T>> _thread_data;
+    uint64_t _num_threads;
+    uint64_t _aligned_dim;
+
+    SSDScratchPool(const SSDScratchPool<T> &) = delete;
+    SSDScratchPool &operator=(const SSDScratchPool<T> &) = delete;
+};
+
+//
+// Class to avoid the hassle of acquiring and releasing the query scratch.
 //
 template <typename T> class ScratchStoreManager
 {
   public:
-    ScratchStoreManager(ConcurrentQueue<T *> &query_scratch) : _scratch_pool(query_scratch)
+    ScratchStoreManager(ConcurrentPool<T> &query_scratch) : _scratch_pool(query_scratch)
     {
-        _scratch = query_scratch.pop();
-        while (_scratch == nullptr)
-        {
-            query_scratch.wait_for_push_notify();
-            _scratch = query_scratch.pop();
-        }
+        _slot = query_scratch.acquire();
+        _scratch = query_scratch.get(_slot);
     }
     T *scratch_space()
     {
@@ -205,28 +242,25 @@ template <typename T> class ScratchStoreManager
 
     ~ScratchStoreManager()
     {
+        if (_scratch == nullptr)
+            return;
         _scratch->clear();
-        _scratch_pool.push(_scratch);
-        _scratch_pool.push_notify_all();
+        _scratch_pool.release(_slot);
     }
 
+    // Deletes every scratch of the pool, this one included, once they are
+    // all released.
     void destroy()
     {
-        while (!_scratch_pool.empty())
-        {
-            auto scratch = _scratch_pool.pop();
-            while (scratch == nullptr)
-            {
-                _scratch_pool.wait_for_push_notify();
-                scratch = _scratch_pool.pop();
-            }
-            delete scratch;
-        }
+        _scratch_pool.release(_slot);
+        _scratch_pool.delete_all();
+        _scratch = nullptr;
     }
 
   private:
     T *_scratch;
-    ConcurrentQueue<T *> &_scratch_pool;
+    uint32_t _slot;
+    ConcurrentPool<T> &_scratch_pool;
     ScratchStoreManager(const ScratchStoreManager<T> &);
     ScratchStoreManager &operator=(const ScratchStoreManager<T> &);
 };
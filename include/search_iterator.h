@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "index.h"
+#include "tsl/robin_set.h"
+
+namespace diskann
+{
+// Returns the results of one query against an in-memory Index page by page,
+// in distance order, without searching again for each page.
+//
+// The iterator keeps the query scratch of its search, i.e. the best L list
+// and the visited set, plus every candidate whose distance was computed. When
+// the best L list runs out of points to return, L is doubled, the scored
+// candidates that had fallen out of the list are put back in, and the search
+// continues from there, so only nodes not visited before cost distance
+// computations.
+//
+// The iterator holds one of the query scratch spaces of the index until it is
+// destroyed, so at most num_threads iterators and searches run at a time, and
+// it must be destroyed before the index. Pages are consistent only while no
+// consolidate_deletes or compaction moves points between calls to next().
+//
+// With a scalar quantized index and full precision data for reranking, the
+// points are split into pages by their quantized distances and each page is
+// sorted by the full precision ones, so the pages are only approximately in
+// order: a point of a page may be closer than some of the previous page.
+template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t> class SearchIterator
+{
+  public:
+    // Runs the initial search for query with a search list of size L.
+    DISKANN_DLLEXPORT SearchIterator(Index<T, TagT, LabelT> &index, const T *query, const uint32_t L);
+
+    // Writes up to K locations not returned by previous calls, closest first,
+    // along with their distances if distances is not null. Returns the number
+    // written, fewer than K only once every point reachable from the start
+    // points has been returned.
+    DISKANN_DLLEXPORT size_t next(const size_t K, uint32_t *indices, float *distances = nullptr);
+
+    // current size of the search list
+    DISKANN_DLLEXPORT uint32_t get_L() const;
+
+    // distance computations so far
+    DISKANN_DLLEXPORT size_t get_num_cmps() const;
+
+  private:
+    // Doubles the search list, refills it from _scored_nodes and searches to
+    // the new fixed point. Returns false if no scored candidate is left out.
+    bool expand();
+    // moves the nodes the last search expanded from the scratch to _expanded
+    void collect_expanded();
+
+    SearchIterator(const SearchIterator &) = delete;
+    SearchIterator &operator=(const SearchIterator &) = delete;
+
+    Index<T, TagT, LabelT> &_index;
+    ScratchStoreManager<InMemQueryScratch<T>> _manager;
+    InMemQueryScratch<T> *_scratch;
+    uint32_t _L;
+
+    // every candidate scored so far, which are all the visited nodes
+    std::vector<Neighbor> _scored_nodes;
+    tsl::robin_set<uint32_t> _returned;
+    // every node expanded so far
+    tsl::robin_set<uint32_t> _expanded;
+};
+} // namespace diskann
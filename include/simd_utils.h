@@ -103,4 +103,15 @@ static inline float _mm256_reduce_add_ps(__m256 x)
     /* Conversion to float is a no-op on x86-64 */
     return _mm_cvtss_f32(x32);
 }
+
+#ifdef __AVX512F__
+// GCC's _mm512_reduce_add_ps and _mm512_castps512_ps256 trip -Wuninitialized
+// through _mm256_undefined_pd, so fold the halves with zero-masked extracts
+static inline float _mm512_horizontal_add_ps(__m512 x)
+{
+    const __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(x), 0));
+    const __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, _mm512_castps_pd(x), 1));
+    return _mm256_reduce_add_ps(_mm256_add_ps(lo, hi));
+}
+#endif
 } // namespace diskann
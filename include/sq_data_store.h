@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <memory>
+
+#include "abstract_data_store.h"
+#include "distance.h"
+#include "memory_mapper.h"
+
+namespace diskann
+{
+// Scalar quantized data store. Every dimension is mapped linearly from its
+// [min, max] range over the data onto 2^num_bits levels, so a vector takes
+// dim bytes (SQ8) or dim/2 bytes (SQ4) instead of dim * sizeof(data_t).
+// Distances are computed asymmetrically: queries stay in full precision and
+// codes are decoded on the fly inside the SIMD kernels.
+//
+// The quantizer is trained on the data passed to populate_data(), so this
+// store only supports bulk-built indices; set_vector() can be used after
+// that to overwrite individual points with the trained parameters.
+template <typename data_t> class SQDataStore : public AbstractDataStore<data_t>
+{
+  public:
+    SQDataStore(const location_t capacity, const size_t dim, std::shared_ptr<Distance<data_t>> distance_fn,
+                const uint32_t num_bits);
+    virtual ~SQDataStore();
+
+    virtual location_t load(const std::string &filename) override;
+    virtual size_t save(const std::string &filename, const location_t num_points) override;
+
+    virtual size_t get_aligned_dim() const override;
+
+    // Trains the quantizer over the given vectors (after any normalization
+    // required by the metric) and encodes them.
+    virtual void populate_data(const data_t *vectors, const location_t num_pts) override;
+    virtual void populate_data(const std::string &filename, const size_t offset) override;
+
+    // Writes the decoded (lossy) vectors.
+    virtual void extract_data_to_bin(const std::string &filename, const location_t num_pts) override;
+
+    virtual void get_vector(const location_t i, data_t *target) const override;
+    virtual void set_vector(const location_t i, const data_t *const vector) override;
+    virtual void prefetch_vector(const location_t loc) override;
+
+    virtual void move_vectors(const location_t old_location_start, const location_t new_location_start,
+                              const location_t num_points) override;
+    virtual void copy_vectors(const location_t from_loc, const location_t to_loc, const location_t num_points) override;
+
+    virtual float get_distance(const data_t *query, const location_t loc) const override;
+    virtual float get_distance(const location_t loc1, const location_t loc2) const override;
+    virtual void get_distance(const data_t *query, const location_t *locations, const uint32_t location_count,
+                              float *distances) const override;
+
+    virtual location_t calculate_medoid() const override;
+
+    virtual size_t get_alignment_factor() const override;
+
+    uint32_t get_num_bits() const;
+
+    // Attaches the full precision vectors for re-ranking. The file must be a
+    // bin file with the points in the same order as this store (i.e. the file
+    // the index was built from). It is memory mapped, so only the pages of the
+    // re-ranked candidates are read from disk.
+    void set_full_precision_data(const std::string &filename);
+    bool has_full_precision_data() const;
+
+    // Exact distance between a pre-processed query and the full precision
+    // vector at loc. Requires set_full_precision_data().
+    float get_full_precision_distance(const data_t *query, const location_t loc) const;
+
+  protected:
+    virtual location_t expand(const location_t new_size) override;
+    virtual location_t shrink(const location_t new_size) override;
+
+  private:
+    void train(const data_t *vectors, const size_t num_pts, std::vector<float> &dim_min,
+               std::vector<float> &dim_max) const;
+    void set_quantizer(const std::vector<float> &dim_min, const std::vector<float> &dim_max);
+    void encode(const data_t *vector, uint8_t *code) const;
+    void decode(const uint8_t *code, float *out) const;
+    float distance_from_sums(const float l2, const float dot, const float a_sq, const float b_sq) const;
+
+    uint8_t *_codes = nullptr;
+
+    // dimensions padded to a multiple of 8 so the kernels never need a tail
+    size_t _aligned_dim;
+    size_t _code_len;
+    uint32_t _num_bits;
+    uint32_t _max_level;
+
+    // per-dimension decoding: x = _mins[d] + _scales[d] * code. Padded
+    // dimensions have zero min and scale and decode to zero.
+    float *_mins = nullptr;
+    float *_scales = nullptr;
+    bool _trained = false;
+
+    std::shared_ptr<Distance<data_t>> _distance_fn;
+    bool _use_l2;
+
+    std::unique_ptr<MemoryMapper> _full_precision_mapper;
+    const data_t *_full_precision_data = nullptr;
+    location_t _full_precision_num_points = 0;
+};
+
+} // namespace diskann
@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <cstddef>
 
+#include "half_float.h"
+
 namespace diskann
 {
 typedef uint32_t location_t;
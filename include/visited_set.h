@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Indices with up to this many points get a visited stamp per point; larger
+// ones keep the visited ids in a hash table. A stamp takes a byte, so each
+// search scratch holds up to 1MB of them.
+#define MAX_POINTS_FOR_DENSE_VISITED_SET 1000000
+
+namespace diskann
+{
+// The set of points visited by a search, cleared in constant time between
+// searches. Every slot holds the epoch it was written in and only counts in
+// that epoch, so clear() just starts the next epoch; the stamps are zeroed
+// when the 8-bit epoch wraps around, once every 255 searches.
+//
+// The stamps are indexed by id for indices of up to
+// MAX_POINTS_FOR_DENSE_VISITED_SET points, at a byte per point in each
+// scratch. Larger ones use an open addressing table with linear probing,
+// which doubles when it is half full and so only grows with the number of
+// points a search visits. Sets created as hashed use the table whatever the
+// number of points, for searches that visit few of them, like those of a disk
+// index.
+class VisitedSet
+{
+  public:
+    explicit VisitedSet(const bool hashed = false) : _hashed(hashed), _dense(!hashed)
+    {
+    }
+
+    // Sets the range [0, num_points) of the ids. Call before the first insert
+    // of a search.
+    void resize(const size_t num_points)
+    {
+        _dense = !_hashed && num_points <= MAX_POINTS_FOR_DENSE_VISITED_SET;
+        if (_dense && _stamps.size() < num_points)
+        {
+            _stamps.resize(num_points, 0);
+        }
+    }
+
+    // Sizes the hash table for num_visited points.
+    void reserve(const size_t num_visited)
+    {
+        size_t capacity = MIN_TABLE_SIZE;
+        while (capacity < 2 * num_visited)
+            capacity *= 2;
+        if (capacity > _table_ids.size())
+            rehash(capacity);
+    }
+
+    bool is_visited(const uint32_t id) const
+    {
+        if (_dense)
+            return _stamps[id] == _epoch;
+        if (_table_ids.empty())
+            return false;
+        for (size_t slot = hash(id);; slot = (slot + 1) & (_table_ids.size() - 1))
+        {
+            if (_table_stamps[slot] != _epoch)
+                return false;
+            if (_table_ids[slot] == id)
+                return true;
+        }
+    }
+
+    // Returns true if id was not visited before.
+    bool insert(const uint32_t id)
+    {
+        if (_dense)
+        {
+            if (_stamps[id] == _epoch)
+                return false;
+            _stamps[id] = _epoch;
+            _size++;
+            return true;
+        }
+
+        if (2 * (_size + 1) > _table_ids.size())
+            rehash(std::max((size_t)MIN_TABLE_SIZE, 2 * _table_ids.size()));
+        return table_insert(id);
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    void clear()
+    {
+        _size = 0;
+        if (++_epoch == 0)
+        {
+            std::fill(_stamps.begin(), _stamps.end(), (uint8_t)0);
+            std::fill(_table_stamps.begin(), _table_stamps.end(), (uint8_t)0);
+            _epoch = 1;
+        }
+    }
+
+  private:
+    static const size_t MIN_TABLE_SIZE = 1024;
+
+    // Fibonacci hashing, the table size is a power of 2
+    size_t hash(const uint32_t id) const
+    {
+        return (size_t)((id * 0x9E3779B97F4A7C15ull) >> _hash_shift);
+    }
+
+    bool table_insert(const uint32_t id)
+    {
+        for (size_t slot = hash(id);; slot = (slot + 1) & (_table_ids.size() - 1))
+        {
+            if (_table_stamps[slot] != _epoch)
+            {
+                _table_stamps[slot] = _epoch;
+                _table_ids[slot] = id;
+                _size++;
+                return true;
+            }
+            if (_table_ids[slot] == id)
+                return false;
+        }
+    }
+
+    void rehash(const size_t capacity)
+    {
+        std::vector<uint32_t> old_ids(capacity);
+        std::vector<uint8_t> old_stamps(capacity, 0);
+        old_ids.swap(_table_ids);
+        old_stamps.swap(_table_stamps);
+        _hash_shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+            _hash_shift--;
+
+        for (size_t i = 0; i < old_ids.size(); i++)
+        {
+            if (old_stamps[i] == _epoch)
+            {
+                _size--;
+                table_insert(old_ids[i]);
+            }
+        }
+    }
+
+    bool _hashed;
+    bool _dense;
+    uint8_t _epoch = 1;
+    size_t _size = 0;
+
+    // dense mode, indexed by id
+    std::vector<uint8_t> _stamps;
+
+    // hashed mode
+    std::vector<uint32_t> _table_ids;
+    std::vector<uint8_t> _table_stamps;
+    uint32_t _hash_shift = 64;
+};
+} // namespace diskann
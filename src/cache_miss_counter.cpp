@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cache_miss_counter.h"
+
+namespace diskann
+{
+CacheMissCounter::CacheMissCounter()
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // calling thread, any CPU
+    _fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+#ifdef __linux__
+    if (_fd >= 0)
+        close(_fd);
+#endif
+}
+
+bool CacheMissCounter::is_available() const
+{
+    return _fd >= 0;
+}
+
+uint64_t CacheMissCounter::read() const
+{
+    uint64_t count = 0;
+#ifdef __linux__
+    if (_fd >= 0 && ::read(_fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+#endif
+    return count;
+}
+} // namespace diskann
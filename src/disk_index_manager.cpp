@@ -0,0 +1,259 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "disk_index_manager.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#else
+#ifdef USE_BING_INFRA
+#include "bing_aligned_file_reader.h"
+#else
+#include "windows_aligned_file_reader.h"
+#endif
+#endif
+
+namespace diskann
+{
+template <typename T, typename LabelT>
+DiskIndexManager<T, LabelT>::DiskIndexManager(const diskann::Metric metric, const uint32_t num_threads,
+                                              const size_t max_dim, const size_t memory_budget,
+                                              const uint32_t num_nodes_to_cache)
+    : _metric(metric), _num_threads(num_threads), _max_dim(max_dim), _memory_budget(memory_budget),
+      _num_nodes_to_cache(num_nodes_to_cache)
+{
+    if (num_threads == 0 || max_dim == 0)
+    {
+        throw ANNException("num_threads and max_dim must be positive", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+#ifndef _WINDOWS
+    // on Windows IO contexts are bound to a file, so every index keeps its own
+    std::shared_ptr<AlignedFileReader> io_reader(new LinuxAlignedFileReader());
+    _scratch_pool = std::make_shared<SSDScratchPool<T>>(io_reader, num_threads, max_dim);
+#endif
+}
+
+template <typename T, typename LabelT> DiskIndexManager<T, LabelT>::~DiskIndexManager()
+{
+}
+
+template <typename T, typename LabelT>
+void DiskIndexManager<T, LabelT>::add_index(const std::string &name, const std::string &index_prefix)
+{
+    const size_t dim = get_index_dim(index_prefix);
+    if (dim > _max_dim)
+    {
+        std::stringstream stream;
+        stream << "Index " << index_prefix << " has " << dim << " dimensions, more than the " << _max_dim
+               << " the manager was created for" << std::endl;
+        throw ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    std::shared_ptr<Tenant> tenant = std::make_shared<Tenant>();
+    tenant->index_prefix = index_prefix;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_tenants.emplace(name, tenant).second)
+    {
+        throw ANNException("An index named " + name + " already exists", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+template <typename T, typename LabelT> void DiskIndexManager<T, LabelT>::remove_index(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    auto iter = _tenants.find(name);
+    if (iter == _tenants.end())
+    {
+        throw ANNException("No index named " + name, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    unload(iter->second.get());
+    _tenants.erase(iter);
+}
+
+template <typename T, typename LabelT> void DiskIndexManager<T, LabelT>::load_index(const std::string &name)
+{
+    acquire(name);
+}
+
+template <typename T, typename LabelT> void DiskIndexManager<T, LabelT>::unload_index(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    auto iter = _tenants.find(name);
+    if (iter == _tenants.end())
+    {
+        throw ANNException("No index named " + name, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    unload(iter->second.get());
+}
+
+template <typename T, typename LabelT>
+void DiskIndexManager<T, LabelT>::search(const std::string &name, const T *query, const uint64_t k_search,
+                                         const uint64_t l_search, uint64_t *res_ids, float *res_dists,
+                                         const uint64_t beam_width, QueryStats *stats)
+{
+    std::shared_ptr<LoadedIndex> loaded = acquire(name);
+    loaded->index->cached_beam_search(query, k_search, l_search, res_ids, res_dists, beam_width, false, stats);
+}
+
+template <typename T, typename LabelT>
+std::shared_ptr<PQFlashIndex<T, LabelT>> DiskIndexManager<T, LabelT>::get_index(const std::string &name)
+{
+    std::shared_ptr<LoadedIndex> loaded = acquire(name);
+    // shares the ownership of loaded, so that the reader outlives the index
+    return std::shared_ptr<PQFlashIndex<T, LabelT>>(loaded, loaded->index.get());
+}
+
+template <typename T, typename LabelT> size_t DiskIndexManager<T, LabelT>::get_num_indices()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _tenants.size();
+}
+
+template <typename T, typename LabelT> size_t DiskIndexManager<T, LabelT>::get_num_loaded_indices()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _lru.size();
+}
+
+template <typename T, typename LabelT> size_t DiskIndexManager<T, LabelT>::get_memory_usage()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _memory_usage;
+}
+
+template <typename T, typename LabelT>
+size_t DiskIndexManager<T, LabelT>::get_index_dim(const std::string &index_prefix)
+{
+    const std::string pq_pivots_file = index_prefix + "_pq_pivots.bin";
+    if (!file_exists(pq_pivots_file))
+    {
+        throw ANNException("PQ pivots file " + pq_pivots_file + " not found", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    size_t num_centroids, dim;
+    get_bin_metadata(pq_pivots_file, num_centroids, dim, METADATA_SIZE);
+    return dim;
+}
+
+template <typename T, typename LabelT>
+std::shared_ptr<typename DiskIndexManager<T, LabelT>::LoadedIndex> DiskIndexManager<T, LabelT>::acquire(
+    const std::string &name)
+{
+    std::shared_ptr<Tenant> tenant;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        auto iter = _tenants.find(name);
+        if (iter == _tenants.end())
+        {
+            throw ANNException("No index named " + name, -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        tenant = iter->second;
+        if (tenant->loaded != nullptr)
+        {
+            _lru.splice(_lru.begin(), _lru, tenant->lru_pos);
+            return tenant->loaded;
+        }
+    }
+
+    // the load runs without _lock, so that the other indices keep serving
+    // searches, and only the first of concurrent searches of this index loads
+    std::lock_guard<std::mutex> load_guard(tenant->load_lock);
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (tenant->loaded != nullptr)
+        {
+            _lru.splice(_lru.begin(), _lru, tenant->lru_pos);
+            return tenant->loaded;
+        }
+    }
+    std::shared_ptr<LoadedIndex> loaded = load(tenant->index_prefix);
+
+    std::lock_guard<std::mutex> guard(_lock);
+    auto iter = _tenants.find(name);
+    if (iter == _tenants.end() || iter->second != tenant)
+    {
+        // removed while loading, serve the calling search only
+        return loaded;
+    }
+    tenant->loaded = loaded;
+    _lru.push_front(tenant.get());
+    tenant->lru_pos = _lru.begin();
+    _memory_usage += loaded->memory_usage;
+    evict(tenant.get());
+    return loaded;
+}
+
+template <typename T, typename LabelT>
+std::shared_ptr<typename DiskIndexManager<T, LabelT>::LoadedIndex> DiskIndexManager<T, LabelT>::load(
+    const std::string &index_prefix)
+{
+#ifdef EXEC_ENV_OLS
+    throw ANNException("DiskIndexManager is not supported in the OLS environment", -1, __FUNCSIG__, __FILE__,
+                       __LINE__);
+#else
+    std::shared_ptr<LoadedIndex> loaded = std::make_shared<LoadedIndex>();
+#ifdef _WINDOWS
+#ifndef USE_BING_INFRA
+    loaded->reader.reset(new WindowsAlignedFileReader());
+#else
+    loaded->reader.reset(new diskann::BingAlignedFileReader());
+#endif
+#else
+    loaded->reader.reset(new LinuxAlignedFileReader());
+#endif
+
+    loaded->index.reset(new PQFlashIndex<T, LabelT>(loaded->reader, _metric));
+    if (_scratch_pool != nullptr)
+    {
+        loaded->index->use_shared_scratch(_scratch_pool);
+    }
+    int res = loaded->index->load(_num_threads, index_prefix.c_str());
+    if (res != 0)
+    {
+        throw ANNException("Unable to load index " + index_prefix, res, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    if (_num_nodes_to_cache > 0)
+    {
+        std::vector<uint32_t> node_list;
+        loaded->index->cache_bfs_levels(_num_nodes_to_cache, node_list);
+        loaded->index->load_cache_list(node_list);
+    }
+    loaded->memory_usage = loaded->index->get_memory_usage();
+    diskann::cout << "Loaded index " << index_prefix << " using " << loaded->memory_usage << " bytes" << std::endl;
+    return loaded;
+#endif
+}
+
+template <typename T, typename LabelT> void DiskIndexManager<T, LabelT>::evict(const Tenant *keep)
+{
+    while (_memory_budget > 0 && _memory_usage > _memory_budget && !_lru.empty() && _lru.back() != keep)
+    {
+        diskann::cout << "Unloading index " << _lru.back()->index_prefix << " to fit the memory budget" << std::endl;
+        unload(_lru.back());
+    }
+}
+
+template <typename T, typename LabelT> void DiskIndexManager<T, LabelT>::unload(Tenant *tenant)
+{
+    if (tenant->loaded == nullptr)
+    {
+        return;
+    }
+    _memory_usage -= tenant->loaded->memory_usage;
+    _lru.erase(tenant->lru_pos);
+    // freed here, or by the last search still holding it
+    tenant->loaded.reset();
+}
+
+template class DiskIndexManager<uint8_t>;
+template class DiskIndexManager<int8_t>;
+template class DiskIndexManager<float>;
+template class DiskIndexManager<float16>;
+template class DiskIndexManager<bfloat16>;
+template class DiskIndexManager<uint8_t, uint16_t>;
+template class DiskIndexManager<int8_t, uint16_t>;
+template class DiskIndexManager<float, uint16_t>;
+template class DiskIndexManager<float16, uint16_t>;
+template class DiskIndexManager<bfloat16, uint16_t>;
+} // namespace diskann
@@ -1021,11 +1021,40 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
     diskann::cout << "Output disk index file written to " << output_file << std::endl;
 }
 
+template <typename T>
+void build_nav_index(const std::string &data_file, const std::string &disk_index_file, const double sampling_rate,
+                     const uint32_t R, const uint32_t L, const uint32_t num_threads)
+{
+    std::string nav_prefix = disk_index_file + "_nav";
+    std::string nav_data_file = nav_prefix + "_data.bin";
+    std::string nav_index_file = nav_prefix + ".index";
+
+    gen_random_slice<T>(data_file, nav_prefix, sampling_rate);
+    size_t nav_num_points, nav_dim;
+    diskann::get_bin_metadata(nav_data_file, nav_num_points, nav_dim);
+    if (nav_num_points == 0)
+    {
+        diskann::cerr << "Sampled no points for the navigation index, not building it" << std::endl;
+        std::remove(nav_data_file.c_str());
+        std::remove((nav_prefix + "_ids.bin").c_str());
+        return;
+    }
+
+    // the disk graph is built with L2, on the preprocessed data for inner
+    // products, and so is its navigation index
+    diskann::IndexWriteParameters params =
+        diskann::IndexWriteParametersBuilder(L, R).with_num_threads(num_threads).build();
+    diskann::Index<T> nav_index(diskann::Metric::L2, nav_dim, nav_num_points);
+    nav_index.build(nav_data_file.c_str(), nav_num_points, params);
+    nav_index.save(nav_index_file.c_str());
+    std::remove(nav_data_file.c_str());
+}
+
 template <typename T, typename LabelT>
 int build_disk_index(const char *dataFilePath, const char *indexFilePath, const char *indexBuildParameters,
                      diskann::Metric compareMetric, bool use_opq, const std::string &codebook_prefix, bool use_filters,
                      const std::string &label_file, const std::string &universal_label, const uint32_t filter_threshold,
-                     const uint32_t Lf)
+                     const uint32_t Lf, const double nav_sampling_rate)
 {
     std::stringstream parser;
     parser << std::string(indexBuildParameters);
@@ -1113,8 +1142,18 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     std::string disk_labels_int_map_file = disk_index_path + "_labels_map.txt";
     std::string dummy_remap_file = disk_index_path + "_dummy_remap.txt"; // remap will be used if we break-up points of
                                                                          // high label-density to create copies
+    std::string disk_dummy_map_file = disk_index_path + "_dummy_map.txt";
 
     std::string sample_base_prefix = index_prefix_path + "_sample";
+
+    // a navigation index or dummy map of an earlier build at this prefix
+    // would be loaded along with the new disk index, whether this build makes
+    // one or not
+    std::remove((disk_index_path + "_nav.index").c_str());
+    std::remove((disk_index_path + "_nav.index.data").c_str());
+    std::remove((disk_index_path + "_nav_ids.bin").c_str());
+    std::remove(disk_dummy_map_file.c_str());
+
     // optional, used if disk index file must store pq data
     std::string disk_pq_pivots_path = index_prefix_path + "_disk.index_pq_pivots.bin";
     // optional, used if disk index must store pq data
@@ -1256,10 +1295,19 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         ten_percent_points > MAX_SAMPLE_POINTS_FOR_WARMUP ? MAX_SAMPLE_POINTS_FOR_WARMUP : ten_percent_points;
     double sample_sampling_rate = num_sample_points / points_num;
     gen_random_slice<T>(data_file_to_use.c_str(), sample_base_prefix, sample_sampling_rate);
+
+    if (nav_sampling_rate > 0)
+    {
+        timer.reset();
+        build_nav_index<T>(data_file_to_use, disk_index_path, nav_sampling_rate, R, L, num_threads);
+        diskann::cout << timer.elapsed_seconds_for_step("building navigation index") << std::endl;
+    }
     if (use_filters)
     {
         copy_file(labels_file_to_use, disk_labels_file);
         std::remove(mem_labels_file.c_str());
+        if (filter_threshold != 0)
+            copy_file(dummy_remap_file, disk_dummy_map_file);
         if (universal_label != "")
         {
             copy_file(mem_univ_label_file, disk_univ_label_file);
@@ -1281,6 +1329,27 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     return 0;
 }
 
+template DISKANN_DLLEXPORT void build_nav_index<int8_t>(const std::string &data_file,
+                                                        const std::string &disk_index_file,
+                                                        const double sampling_rate, const uint32_t R,
+                                                        const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_index<uint8_t>(const std::string &data_file,
+                                                         const std::string &disk_index_file,
+                                                         const double sampling_rate, const uint32_t R,
+                                                         const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_index<float>(const std::string &data_file,
+                                                       const std::string &disk_index_file,
+                                                       const double sampling_rate, const uint32_t R,
+                                                       const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_index<float16>(const std::string &data_file,
+                                                         const std::string &disk_index_file,
+                                                         const double sampling_rate, const uint32_t R,
+                                                         const uint32_t L, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_index<bfloat16>(const std::string &data_file,
+                                                          const std::string &disk_index_file,
+                                                          const double sampling_rate, const uint32_t R,
+                                                          const uint32_t L, const uint32_t num_threads);
+
 template DISKANN_DLLEXPORT void create_disk_layout<int8_t>(const std::string base_file,
                                                            const std::string mem_index_file,
                                                            const std::string output_file,
@@ -1292,6 +1361,14 @@ template DISKANN_DLLEXPORT void create_disk_layout<uint8_t>(const std::string ba
 template DISKANN_DLLEXPORT void create_disk_layout<float>(const std::string base_file, const std::string mem_index_file,
                                                           const std::string output_file,
                                                           const std::string reorder_data_file);
+template DISKANN_DLLEXPORT void create_disk_layout<float16>(const std::string base_file,
+                                                            const std::string mem_index_file,
+                                                            const std::string output_file,
+                                                            const std::string reorder_data_file);
+template DISKANN_DLLEXPORT void create_disk_layout<bfloat16>(const std::string base_file,
+                                                             const std::string mem_index_file,
+                                                             const std::string output_file,
+                                                             const std::string reorder_data_file);
 
 template DISKANN_DLLEXPORT int8_t *load_warmup<int8_t>(const std::string &cache_warmup_file, uint64_t &warmup_num,
                                                        uint64_t warmup_dim, uint64_t warmup_aligned_dim);
@@ -1299,6 +1376,10 @@ template DISKANN_DLLEXPORT uint8_t *load_warmup<uint8_t>(const std::string &cach
                                                          uint64_t warmup_dim, uint64_t warmup_aligned_dim);
 template DISKANN_DLLEXPORT float *load_warmup<float>(const std::string &cache_warmup_file, uint64_t &warmup_num,
                                                      uint64_t warmup_dim, uint64_t warmup_aligned_dim);
+template DISKANN_DLLEXPORT float16 *load_warmup<float16>(const std::string &cache_warmup_file, uint64_t &warmup_num,
+                                                         uint64_t warmup_dim, uint64_t warmup_aligned_dim);
+template DISKANN_DLLEXPORT bfloat16 *load_warmup<bfloat16>(const std::string &cache_warmup_file, uint64_t &warmup_num,
+                                                           uint64_t warmup_dim, uint64_t warmup_aligned_dim);
 
 #ifdef EXEC_ENV_OLS
 template DISKANN_DLLEXPORT int8_t *load_warmup<int8_t>(MemoryMappedFiles &files, const std::string &cache_warmup_file,
@@ -1310,6 +1391,12 @@ template DISKANN_DLLEXPORT uint8_t *load_warmup<uint8_t>(MemoryMappedFiles &file
 template DISKANN_DLLEXPORT float *load_warmup<float>(MemoryMappedFiles &files, const std::string &cache_warmup_file,
                                                      uint64_t &warmup_num, uint64_t warmup_dim,
                                                      uint64_t warmup_aligned_dim);
+template DISKANN_DLLEXPORT float16 *load_warmup<float16>(MemoryMappedFiles &files, const std::string &cache_warmup_file,
+                                                         uint64_t &warmup_num, uint64_t warmup_dim,
+                                                         uint64_t warmup_aligned_dim);
+template DISKANN_DLLEXPORT bfloat16 *load_warmup<bfloat16>(MemoryMappedFiles &files,
+                                                           const std::string &cache_warmup_file, uint64_t &warmup_num,
+                                                           uint64_t warmup_dim, uint64_t warmup_aligned_dim);
 #endif
 
 template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<int8_t, uint32_t>(
@@ -1321,6 +1408,12 @@ template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<uint8_t, uint32_t>(
 template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<float, uint32_t>(
     std::unique_ptr<diskann::PQFlashIndex<float, uint32_t>> &pFlashIndex, float *tuning_sample,
     uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
+template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<float16, uint32_t>(
+    std::unique_ptr<diskann::PQFlashIndex<float16, uint32_t>> &pFlashIndex, float16 *tuning_sample,
+    uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
+template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<bfloat16, uint32_t>(
+    std::unique_ptr<diskann::PQFlashIndex<bfloat16, uint32_t>> &pFlashIndex, bfloat16 *tuning_sample,
+    uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
 
 template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<int8_t, uint16_t>(
     std::unique_ptr<diskann::PQFlashIndex<int8_t, uint16_t>> &pFlashIndex, int8_t *tuning_sample,
@@ -1331,6 +1424,12 @@ template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<uint8_t, uint16_t>(
 template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<float, uint16_t>(
     std::unique_ptr<diskann::PQFlashIndex<float, uint16_t>> &pFlashIndex, float *tuning_sample,
     uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
+template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<float16, uint16_t>(
+    std::unique_ptr<diskann::PQFlashIndex<float16, uint16_t>> &pFlashIndex, float16 *tuning_sample,
+    uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
+template DISKANN_DLLEXPORT uint32_t optimize_beamwidth<bfloat16, uint16_t>(
+    std::unique_ptr<diskann::PQFlashIndex<bfloat16, uint16_t>> &pFlashIndex, bfloat16 *tuning_sample,
+    uint64_t tuning_sample_num, uint64_t tuning_sample_aligned_dim, uint32_t L, uint32_t nthreads, uint32_t start_bw);
 
 template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                   const char *indexBuildParameters,
@@ -1338,21 +1437,40 @@ template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint32_t>(const char *da
                                                                   const std::string &codebook_prefix, bool use_filters,
                                                                   const std::string &label_file,
                                                                   const std::string &universal_label,
-                                                                  const uint32_t filter_threshold, const uint32_t Lf);
+                                                                  const uint32_t filter_threshold, const uint32_t Lf,
+                                                                  const double nav_sampling_rate);
 template DISKANN_DLLEXPORT int build_disk_index<uint8_t, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                    const char *indexBuildParameters,
                                                                    diskann::Metric compareMetric, bool use_opq,
                                                                    const std::string &codebook_prefix, bool use_filters,
                                                                    const std::string &label_file,
                                                                    const std::string &universal_label,
-                                                                   const uint32_t filter_threshold, const uint32_t Lf);
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const double nav_sampling_rate);
 template DISKANN_DLLEXPORT int build_disk_index<float, uint32_t>(const char *dataFilePath, const char *indexFilePath,
                                                                  const char *indexBuildParameters,
                                                                  diskann::Metric compareMetric, bool use_opq,
                                                                  const std::string &codebook_prefix, bool use_filters,
                                                                  const std::string &label_file,
                                                                  const std::string &universal_label,
-                                                                 const uint32_t filter_threshold, const uint32_t Lf);
+                                                                 const uint32_t filter_threshold, const uint32_t Lf,
+                                                                 const double nav_sampling_rate);
+template DISKANN_DLLEXPORT int build_disk_index<float16, uint32_t>(const char *dataFilePath, const char *indexFilePath,
+                                                                   const char *indexBuildParameters,
+                                                                   diskann::Metric compareMetric, bool use_opq,
+                                                                   const std::string &codebook_prefix, bool use_filters,
+                                                                   const std::string &label_file,
+                                                                   const std::string &universal_label,
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const double nav_sampling_rate);
+template DISKANN_DLLEXPORT int build_disk_index<bfloat16, uint32_t>(const char *dataFilePath, const char *indexFilePath,
+                                                                    const char *indexBuildParameters,
+                                                                    diskann::Metric compareMetric, bool use_opq,
+                                                                    const std::string &codebook_prefix,
+                                                                    bool use_filters, const std::string &label_file,
+                                                                    const std::string &universal_label,
+                                                                    const uint32_t filter_threshold, const uint32_t Lf,
+                                                                    const double nav_sampling_rate);
 // LabelT = uint16
 template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                   const char *indexBuildParameters,
@@ -1360,21 +1478,40 @@ template DISKANN_DLLEXPORT int build_disk_index<int8_t, uint16_t>(const char *da
                                                                   const std::string &codebook_prefix, bool use_filters,
                                                                   const std::string &label_file,
                                                                   const std::string &universal_label,
-                                                                  const uint32_t filter_threshold, const uint32_t Lf);
+                                                                  const uint32_t filter_threshold, const uint32_t Lf,
+                                                                  const double nav_sampling_rate);
 template DISKANN_DLLEXPORT int build_disk_index<uint8_t, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                    const char *indexBuildParameters,
                                                                    diskann::Metric compareMetric, bool use_opq,
                                                                    const std::string &codebook_prefix, bool use_filters,
                                                                    const std::string &label_file,
                                                                    const std::string &universal_label,
-                                                                   const uint32_t filter_threshold, const uint32_t Lf);
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const double nav_sampling_rate);
 template DISKANN_DLLEXPORT int build_disk_index<float, uint16_t>(const char *dataFilePath, const char *indexFilePath,
                                                                  const char *indexBuildParameters,
                                                                  diskann::Metric compareMetric, bool use_opq,
                                                                  const std::string &codebook_prefix, bool use_filters,
                                                                  const std::string &label_file,
                                                                  const std::string &universal_label,
-                                                                 const uint32_t filter_threshold, const uint32_t Lf);
+                                                                 const uint32_t filter_threshold, const uint32_t Lf,
+                                                                 const double nav_sampling_rate);
+template DISKANN_DLLEXPORT int build_disk_index<float16, uint16_t>(const char *dataFilePath, const char *indexFilePath,
+                                                                   const char *indexBuildParameters,
+                                                                   diskann::Metric compareMetric, bool use_opq,
+                                                                   const std::string &codebook_prefix, bool use_filters,
+                                                                   const std::string &label_file,
+                                                                   const std::string &universal_label,
+                                                                   const uint32_t filter_threshold, const uint32_t Lf,
+                                                                   const double nav_sampling_rate);
+template DISKANN_DLLEXPORT int build_disk_index<bfloat16, uint16_t>(const char *dataFilePath, const char *indexFilePath,
+                                                                    const char *indexBuildParameters,
+                                                                    diskann::Metric compareMetric, bool use_opq,
+                                                                    const std::string &codebook_prefix,
+                                                                    bool use_filters, const std::string &label_file,
+                                                                    const std::string &universal_label,
+                                                                    const uint32_t filter_threshold, const uint32_t Lf,
+                                                                    const double nav_sampling_rate);
 
 template DISKANN_DLLEXPORT int build_merged_vamana_index<int8_t, uint32_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
@@ -1391,6 +1528,16 @@ template DISKANN_DLLEXPORT int build_merged_vamana_index<uint8_t, uint32_t>(
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
     const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+template DISKANN_DLLEXPORT int build_merged_vamana_index<float16, uint32_t>(
+    std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
+    double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
+    size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+template DISKANN_DLLEXPORT int build_merged_vamana_index<bfloat16, uint32_t>(
+    std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
+    double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
+    size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
 // Label=16_t
 template DISKANN_DLLEXPORT int build_merged_vamana_index<int8_t, uint16_t>(
     std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
@@ -1407,4 +1554,14 @@ template DISKANN_DLLEXPORT int build_merged_vamana_index<uint8_t, uint16_t>(
     double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
     size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
     const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+template DISKANN_DLLEXPORT int build_merged_vamana_index<float16, uint16_t>(
+    std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
+    double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
+    size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
+template DISKANN_DLLEXPORT int build_merged_vamana_index<bfloat16, uint16_t>(
+    std::string base_file, diskann::Metric compareMetric, uint32_t L, uint32_t R, double sampling_rate,
+    double ram_budget, std::string mem_index_path, std::string medoids_path, std::string centroids_file,
+    size_t build_pq_bytes, bool use_opq, uint32_t num_threads, bool use_filters, const std::string &label_file,
+    const std::string &labels_to_medoids_file, const std::string &universal_label, const uint32_t Lf);
 }; // namespace diskann
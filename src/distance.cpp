@@ -599,6 +599,262 @@ void AVXNormalizedCosineDistanceFloat::normalize_and_copy(const float *query_vec
     }
 }
 
+//
+// Half precision distance functions.
+//
+namespace
+{
+#ifdef __AVX512F__
+// The zero-masked conversions avoid GCC's maybe-uninitialized warnings on the
+// undefined pass-through operand of the unmasked intrinsics.
+inline __m512 load_half16(const float16 *p)
+{
+    return _mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256((const __m256i *)p));
+}
+inline __m512 load_half16(const bfloat16 *p)
+{
+    const __m512i widened = _mm512_maskz_cvtepu16_epi32(0xFFFF, _mm256_loadu_si256((const __m256i *)p));
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(0xFFFF, widened, 16));
+}
+#endif
+
+#if defined(USE_AVX2) && defined(__F16C__)
+inline __m256 load_half8(const float16 *p)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)p));
+}
+inline __m256 load_half8(const bfloat16 *p)
+{
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p)), 16));
+}
+#endif
+
+template <typename T> float half_l2(const T *a, const T *b, const uint32_t length)
+{
+    float result = 0;
+    uint32_t d = 0;
+#ifdef __AVX512F__
+    __m512 sum16 = _mm512_setzero_ps();
+    for (; d + 16 <= length; d += 16)
+    {
+        const __m512 diff = _mm512_sub_ps(load_half16(a + d), load_half16(b + d));
+        sum16 = _mm512_fmadd_ps(diff, diff, sum16);
+    }
+    result += _mm512_horizontal_add_ps(sum16);
+#endif
+#if defined(USE_AVX2) && defined(__F16C__)
+    __m256 sum8 = _mm256_setzero_ps();
+    for (; d + 8 <= length; d += 8)
+    {
+        const __m256 diff = _mm256_sub_ps(load_half8(a + d), load_half8(b + d));
+        sum8 = _mm256_fmadd_ps(diff, diff, sum8);
+    }
+    result += _mm256_reduce_add_ps(sum8);
+#endif
+    for (; d < length; d++)
+    {
+        const float diff = (float)a[d] - (float)b[d];
+        result += diff * diff;
+    }
+    return result;
+}
+
+// Inner product of a and b, and when with_norms is set also their squared
+// norms (for cosine).
+template <typename T, bool with_norms>
+void half_dot(const T *a, const T *b, const uint32_t length, float &dot, float &a_sq, float &b_sq)
+{
+    dot = a_sq = b_sq = 0;
+    uint32_t d = 0;
+#ifdef __AVX512BF16__
+    // bfloat16 products are exact in float, so the native dot product
+    // instruction gives the same result as widening, 32 values at a time.
+    if (std::is_same<T, bfloat16>::value)
+    {
+        __m512 dot32 = _mm512_setzero_ps(), a_sq32 = _mm512_setzero_ps(), b_sq32 = _mm512_setzero_ps();
+        for (; d + 32 <= length; d += 32)
+        {
+            const __m512bh a_vec = (__m512bh)_mm512_loadu_si512((const void *)(a + d));
+            const __m512bh b_vec = (__m512bh)_mm512_loadu_si512((const void *)(b + d));
+            dot32 = _mm512_dpbf16_ps(dot32, a_vec, b_vec);
+            if (with_norms)
+            {
+                a_sq32 = _mm512_dpbf16_ps(a_sq32, a_vec, a_vec);
+                b_sq32 = _mm512_dpbf16_ps(b_sq32, b_vec, b_vec);
+            }
+        }
+        dot += _mm512_horizontal_add_ps(dot32);
+        if (with_norms)
+        {
+            a_sq += _mm512_horizontal_add_ps(a_sq32);
+            b_sq += _mm512_horizontal_add_ps(b_sq32);
+        }
+    }
+#endif
+#ifdef __AVX512F__
+    __m512 dot16 = _mm512_setzero_ps(), a_sq16 = _mm512_setzero_ps(), b_sq16 = _mm512_setzero_ps();
+    for (; d + 16 <= length; d += 16)
+    {
+        const __m512 a_vec = load_half16(a + d);
+        const __m512 b_vec = load_half16(b + d);
+        dot16 = _mm512_fmadd_ps(a_vec, b_vec, dot16);
+        if (with_norms)
+        {
+            a_sq16 = _mm512_fmadd_ps(a_vec, a_vec, a_sq16);
+            b_sq16 = _mm512_fmadd_ps(b_vec, b_vec, b_sq16);
+        }
+    }
+    dot += _mm512_horizontal_add_ps(dot16);
+    if (with_norms)
+    {
+        a_sq += _mm512_horizontal_add_ps(a_sq16);
+        b_sq += _mm512_horizontal_add_ps(b_sq16);
+    }
+#endif
+#if defined(USE_AVX2) && defined(__F16C__)
+    __m256 dot8 = _mm256_setzero_ps(), a_sq8 = _mm256_setzero_ps(), b_sq8 = _mm256_setzero_ps();
+    for (; d + 8 <= length; d += 8)
+    {
+        const __m256 a_vec = load_half8(a + d);
+        const __m256 b_vec = load_half8(b + d);
+        dot8 = _mm256_fmadd_ps(a_vec, b_vec, dot8);
+        if (with_norms)
+        {
+            a_sq8 = _mm256_fmadd_ps(a_vec, a_vec, a_sq8);
+            b_sq8 = _mm256_fmadd_ps(b_vec, b_vec, b_sq8);
+        }
+    }
+    dot += _mm256_reduce_add_ps(dot8);
+    if (with_norms)
+    {
+        a_sq += _mm256_reduce_add_ps(a_sq8);
+        b_sq += _mm256_reduce_add_ps(b_sq8);
+    }
+#endif
+    for (; d < length; d++)
+    {
+        const float a_d = a[d], b_d = b[d];
+        dot += a_d * b_d;
+        if (with_norms)
+        {
+            a_sq += a_d * a_d;
+            b_sq += b_d * b_d;
+        }
+    }
+}
+} // namespace
+
+template <typename T> float DistanceL2Half<T>::compare(const T *a, const T *b, uint32_t length) const
+{
+    return half_l2(a, b, length);
+}
+
+template <typename T> float DistanceInnerProductHalf<T>::compare(const T *a, const T *b, uint32_t length) const
+{
+    float dot, a_sq, b_sq;
+    half_dot<T, false>(a, b, length, dot, a_sq, b_sq);
+    return -dot;
+}
+
+template <typename T> float DistanceCosineHalf<T>::compare(const T *a, const T *b, uint32_t length) const
+{
+    float dot, a_sq, b_sq;
+    half_dot<T, true>(a, b, length, dot, a_sq, b_sq);
+    // similarity == 1-cosine distance
+    return 1.0f - (dot / (sqrt(a_sq) * sqrt(b_sq)));
+}
+
+template <typename T> float DistanceNormalizedCosineHalf<T>::compare(const T *a, const T *b, uint32_t length) const
+{
+    float dot, a_sq, b_sq;
+    half_dot<T, false>(a, b, length, dot, a_sq, b_sq);
+    return 1.0f - dot;
+}
+
+template <typename T> bool DistanceNormalizedCosineHalf<T>::preprocessing_required() const
+{
+    return true;
+}
+
+template <typename T>
+void DistanceNormalizedCosineHalf<T>::preprocess_base_points(T *original_data, const size_t orig_dim,
+                                                             const size_t num_points)
+{
+    for (size_t i = 0; i < num_points; i++)
+    {
+        normalize(original_data + i * orig_dim, orig_dim);
+    }
+}
+
+template <typename T>
+void DistanceNormalizedCosineHalf<T>::preprocess_query(const T *query_vec, const size_t query_dim, T *query_scratch)
+{
+    const float norm = get_norm(query_vec, query_dim);
+    for (size_t i = 0; i < query_dim; i++)
+    {
+        query_scratch[i] = (T)((float)query_vec[i] / norm);
+    }
+}
+
+// FAST_L2 over half precision vectors, through the widening kernels rather
+// than the float ones of the generic implementation.
+template <> float DistanceInnerProduct<float16>::inner_product(const float16 *a, const float16 *b, uint32_t size) const
+{
+    float dot, a_sq, b_sq;
+    half_dot<float16, false>(a, b, size, dot, a_sq, b_sq);
+    return dot;
+}
+
+template <>
+float DistanceInnerProduct<bfloat16>::inner_product(const bfloat16 *a, const bfloat16 *b, uint32_t size) const
+{
+    float dot, a_sq, b_sq;
+    half_dot<bfloat16, false>(a, b, size, dot, a_sq, b_sq);
+    return dot;
+}
+
+template <> float DistanceFastL2<float16>::norm(const float16 *a, uint32_t size) const
+{
+    return DistanceInnerProduct<float16>::inner_product(a, a, size);
+}
+
+template <> float DistanceFastL2<bfloat16>::norm(const bfloat16 *a, uint32_t size) const
+{
+    return DistanceInnerProduct<bfloat16>::inner_product(a, a, size);
+}
+
+template <typename T> diskann::Distance<T> *get_half_distance_function(diskann::Metric m, const char *type_name)
+{
+    if (m == diskann::Metric::L2)
+    {
+        diskann::cout << "L2: Using DistanceL2Half<" << type_name << ">" << std::endl;
+        return new diskann::DistanceL2Half<T>();
+    }
+    else if (m == diskann::Metric::COSINE)
+    {
+        diskann::cout << "Cosine: Using DistanceCosineHalf<" << type_name << ">" << std::endl;
+        return new diskann::DistanceCosineHalf<T>();
+    }
+    else if (m == diskann::Metric::INNER_PRODUCT)
+    {
+        diskann::cout << "Inner product: Using DistanceInnerProductHalf<" << type_name << ">" << std::endl;
+        return new diskann::DistanceInnerProductHalf<T>();
+    }
+    else if (m == diskann::Metric::FAST_L2)
+    {
+        diskann::cout << "Fast_L2: Using DistanceFastL2<" << type_name << "> with norm memoization" << std::endl;
+        return new diskann::DistanceFastL2<T>();
+    }
+    else
+    {
+        std::stringstream stream;
+        stream << "Only L2, cosine, inner product and fast L2 supported for " << type_name << " vectors."
+               << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
 // Get the right distance function for the given metric.
 template <> diskann::Distance<float> *get_distance_function(diskann::Metric m)
 {
@@ -718,16 +974,45 @@ template <> diskann::Distance<uint8_t> *get_distance_function(diskann::Metric m)
     }
 }
 
+template <> diskann::Distance<float16> *get_distance_function(diskann::Metric m)
+{
+    return get_half_distance_function<float16>(m, "float16");
+}
+
+template <> diskann::Distance<bfloat16> *get_distance_function(diskann::Metric m)
+{
+    return get_half_distance_function<bfloat16>(m, "bfloat16");
+}
+
 template DISKANN_DLLEXPORT class DistanceInnerProduct<float>;
 template DISKANN_DLLEXPORT class DistanceInnerProduct<int8_t>;
 template DISKANN_DLLEXPORT class DistanceInnerProduct<uint8_t>;
+template DISKANN_DLLEXPORT class DistanceInnerProduct<float16>;
+template DISKANN_DLLEXPORT class DistanceInnerProduct<bfloat16>;
 
 template DISKANN_DLLEXPORT class DistanceFastL2<float>;
 template DISKANN_DLLEXPORT class DistanceFastL2<int8_t>;
 template DISKANN_DLLEXPORT class DistanceFastL2<uint8_t>;
+template DISKANN_DLLEXPORT class DistanceFastL2<float16>;
+template DISKANN_DLLEXPORT class DistanceFastL2<bfloat16>;
 
 template DISKANN_DLLEXPORT class SlowDistanceL2<float>;
 template DISKANN_DLLEXPORT class SlowDistanceL2<int8_t>;
 template DISKANN_DLLEXPORT class SlowDistanceL2<uint8_t>;
 
+template DISKANN_DLLEXPORT class Distance<float16>;
+template DISKANN_DLLEXPORT class Distance<bfloat16>;
+
+template DISKANN_DLLEXPORT class DistanceL2Half<float16>;
+template DISKANN_DLLEXPORT class DistanceL2Half<bfloat16>;
+
+template DISKANN_DLLEXPORT class DistanceInnerProductHalf<float16>;
+template DISKANN_DLLEXPORT class DistanceInnerProductHalf<bfloat16>;
+
+template DISKANN_DLLEXPORT class DistanceCosineHalf<float16>;
+template DISKANN_DLLEXPORT class DistanceCosineHalf<bfloat16>;
+
+template DISKANN_DLLEXPORT class DistanceNormalizedCosineHalf<float16>;
+template DISKANN_DLLEXPORT class DistanceNormalizedCosineHalf<bfloat16>;
+
 } // namespace diskann
@@ -267,6 +267,12 @@ template DISKANN_DLLEXPORT void generate_label_indices<uint8_t>(path input_data_
 template DISKANN_DLLEXPORT void generate_label_indices<int8_t>(path input_data_path, path final_index_path_prefix,
                                                                label_set all_labels, uint32_t R, uint32_t L,
                                                                float alpha, uint32_t num_threads);
+template DISKANN_DLLEXPORT void generate_label_indices<float16>(path input_data_path, path final_index_path_prefix,
+                                                                label_set all_labels, uint32_t R, uint32_t L,
+                                                                float alpha, uint32_t num_threads);
+template DISKANN_DLLEXPORT void generate_label_indices<bfloat16>(path input_data_path, path final_index_path_prefix,
+                                                                 label_set all_labels, uint32_t R, uint32_t L,
+                                                                 float alpha, uint32_t num_threads);
 
 template DISKANN_DLLEXPORT tsl::robin_map<std::string, std::vector<uint32_t>>
 generate_label_specific_vector_files_compat<float>(path input_data_path,
@@ -0,0 +1,921 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "fresh_disk_index.h"
+#include "timer.h"
+
+#ifdef _WINDOWS
+#include "windows_aligned_file_reader.h"
+#else
+#include "linux_aligned_file_reader.h"
+#endif
+
+namespace diskann
+{
+namespace
+{
+// positions of the fields in the header sector written by create_disk_layout
+const size_t META_NUM_POINTS = 0;
+const size_t META_MEDOID = 2;
+const size_t META_MAX_NODE_LEN = 3;
+const size_t META_NNODES_PER_SECTOR = 4;
+const size_t META_NUM_FROZEN_POINTS = 5;
+const size_t META_HAS_REORDER_DATA = 7;
+
+// sectors streamed through memory at a time while merging
+const uint64_t MERGE_BLOCK_SECTORS = 16384;
+// beam width of the searches that link the inserted points
+const uint64_t MERGE_BEAM_WIDTH = 4;
+
+float l2_squared(const float *a, const float *b, const size_t dim)
+{
+    float dist = 0;
+    for (size_t d = 0; d < dim; d++)
+        dist += (a[d] - b[d]) * (a[d] - b[d]);
+    return dist;
+}
+
+// RobustPrune as in Index::occlude_list. pool is sorted by distance to the
+// pruned node and vectors holds the vector of each pool entry, dim floats
+// apart.
+void robust_prune(const std::vector<std::pair<float, uint32_t>> &pool, const float *vectors, const size_t dim,
+                  const uint32_t degree, const float alpha, std::vector<uint32_t> &result)
+{
+    result.clear();
+    std::vector<float> occlude_factor(pool.size(), 0.0f);
+    float cur_alpha = 1;
+    while (cur_alpha <= alpha && result.size() < degree)
+    {
+        for (size_t i = 0; i < pool.size() && result.size() < degree; i++)
+        {
+            if (occlude_factor[i] > cur_alpha)
+                continue;
+            occlude_factor[i] = std::numeric_limits<float>::max();
+            result.push_back(pool[i].second);
+            for (size_t j = i + 1; j < pool.size(); j++)
+            {
+                if (occlude_factor[j] > alpha)
+                    continue;
+                const float djk = l2_squared(vectors + i * dim, vectors + j * dim, dim);
+                occlude_factor[j] = (djk == 0) ? std::numeric_limits<float>::max()
+                                               : (std::max)(occlude_factor[j], pool[j].first / djk);
+            }
+        }
+        cur_alpha *= 1.2f;
+    }
+}
+
+// Renames from to to, replacing to if it exists.
+bool replace_file(const std::string &from, const std::string &to)
+{
+#ifdef _WINDOWS
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+} // namespace
+
+template <typename T>
+FreshDiskIndex<T>::FreshDiskIndex(diskann::Metric metric, const std::string &index_prefix, const uint32_t num_threads,
+                                  const IndexWriteParameters &temp_index_params, const size_t initial_temp_points)
+    : _metric(metric), _index_prefix(index_prefix), _disk_index_file(index_prefix + "_disk.index"),
+      _pq_pivots_file(index_prefix + "_pq_pivots.bin"), _pq_compressed_file(index_prefix + "_pq_compressed.bin"),
+      _staging_file(index_prefix + "_disk.index.merge"), _merge_journal_file(index_prefix + "_merge.journal"),
+      _state_file(index_prefix + "_fresh_state.bin"), _temp_index_file(index_prefix + "_temp.index"),
+      _merging_temp_index_file(index_prefix + "_merging_temp.index"), _deleted_file(index_prefix + "_deleted.bin"),
+      _num_threads(num_threads),
+      _params(IndexWriteParametersBuilder(temp_index_params)
+                  .with_num_threads(num_threads)
+                  .with_num_frozen_points(1)
+                  .build()),
+      _initial_temp_points(initial_temp_points), _temp_index_size(0), _next_id(0)
+{
+    if (metric != diskann::Metric::L2)
+    {
+        throw ANNException("FreshDiskIndex only supports L2 indices", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+template <typename T> FreshDiskIndex<T>::~FreshDiskIndex()
+{
+    wait_for_merge();
+}
+
+template <typename T> std::vector<uint64_t> FreshDiskIndex<T>::read_disk_header()
+{
+    std::ifstream reader(_disk_index_file, std::ios::binary);
+    int32_t num_fields = 0, num_cols = 0;
+    reader.read((char *)&num_fields, sizeof(int32_t));
+    reader.read((char *)&num_cols, sizeof(int32_t));
+    std::vector<uint64_t> meta(num_fields > 0 ? num_fields : 0);
+    reader.read((char *)meta.data(), meta.size() * sizeof(uint64_t));
+    if (!reader || meta.size() <= META_HAS_REORDER_DATA)
+    {
+        throw ANNException("Could not read the header of " + _disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    return meta;
+}
+
+template <typename T> int FreshDiskIndex<T>::load()
+{
+    // finish or discard a merge interrupted by a crash
+    if (file_exists(_merge_journal_file))
+    {
+        diskann::cout << "Finishing the merge interrupted in " << _index_prefix << std::endl;
+        apply_merge_journal();
+    }
+    std::remove(_merge_journal_file.c_str());
+    std::remove((_merge_journal_file + ".tmp").c_str());
+    std::remove(_staging_file.c_str());
+    const std::vector<uint64_t> meta = read_disk_header();
+    if (meta[META_NUM_FROZEN_POINTS] != 0 || meta[META_HAS_REORDER_DATA] != 0 ||
+        file_exists(_disk_index_file + "_medoids.bin") || file_exists(_disk_index_file + "_labels.txt") ||
+        file_exists(_disk_index_file + "_pq_pivots.bin") || file_exists(_pq_pivots_file + "_rotation_matrix.bin") ||
+        file_exists(_disk_index_file + "_nav.index"))
+    {
+        // merges do not update the navigation index, whose entry points may
+        // be nodes they delete
+        diskann::cerr << "FreshDiskIndex does not support disk indices with frozen points, reorder data, labels, "
+                         "multiple medoids, PQ compressed nodes, OPQ or a navigation index."
+                      << std::endl;
+        return -1;
+    }
+    _disk_points = (uint32_t)meta[META_NUM_POINTS];
+    _dim = meta[1];
+    _max_node_len = meta[META_MAX_NODE_LEN];
+    _nnodes_per_sector = meta[META_NNODES_PER_SECTOR];
+    _max_degree = ((_max_node_len - _dim * sizeof(T)) / sizeof(uint32_t)) - 1;
+    _next_id = _disk_points;
+
+    _disk = load_disk_index(_disk_index_file, _pq_compressed_file);
+    _temp_index = create_temp_index();
+    _temp_index_size = 0;
+    if (file_exists(_state_file))
+        load_saved_updates();
+    else
+        diskann::cout << "No updates were saved for " << _index_prefix << std::endl;
+    return 0;
+}
+
+template <typename T> void FreshDiskIndex<T>::load_saved_updates()
+{
+    std::unique_ptr<uint64_t[]> state;
+    size_t num_fields, num_cols;
+    diskann::load_bin<uint64_t>(_state_file, state, num_fields, num_cols);
+    if (num_fields * num_cols < 4)
+    {
+        throw ANNException("Could not read " + _state_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    const uint32_t saved_disk_points = (uint32_t)state[0], saved_next_id = (uint32_t)state[1];
+    const uint32_t merging_end_id = (uint32_t)state[2];
+    const bool temp_index_saved = state[3] != 0;
+
+    // Merges that completed after the save folded the saved temp indices whose
+    // ids are now in the disk index.
+    _next_id = (std::max)(_disk_points, saved_next_id);
+    if (merging_end_id != 0 && _disk_points < merging_end_id)
+    {
+        _merging_temp_index = create_temp_index();
+        _merging_temp_index->load(_merging_temp_index_file.c_str(), _num_threads, _params.search_list_size);
+        _merging_end_id = merging_end_id;
+    }
+    const uint32_t temp_first_id = merging_end_id != 0 ? merging_end_id : saved_disk_points;
+    if (temp_index_saved && _disk_points <= temp_first_id)
+    {
+        _temp_index->load(_temp_index_file.c_str(), _num_threads, _params.search_list_size);
+        _temp_index_size = _temp_index->get_num_points();
+    }
+
+    // Deletes already merged are harmless: their nodes have no edges left, and
+    // the next merge only unlinks them again.
+    std::unique_ptr<uint32_t[]> deleted;
+    size_t num_deleted, deleted_dim;
+    diskann::load_bin<uint32_t>(_deleted_file, deleted, num_deleted, deleted_dim);
+    std::vector<uint32_t> disk_deletes;
+    for (size_t i = 0; i < num_deleted; i++)
+    {
+        _deleted.insert(deleted[i]);
+        if (deleted[i] < _disk_points)
+            disk_deletes.push_back(deleted[i]);
+    }
+    _disk->index->set_deleted_points(disk_deletes);
+    diskann::cout << "Restored " << _temp_index_size << " inserted points"
+                  << (_merging_temp_index != nullptr ? ", a temp index waiting to be merged" : "") << " and "
+                  << num_deleted << " deleted ids." << std::endl;
+}
+
+template <typename T> void FreshDiskIndex<T>::save()
+{
+    // waits for a running merge, and keeps the tiers still while they are
+    // saved
+    std::lock_guard<std::mutex> merge_guard(_merge_lock);
+    std::unique_lock<std::shared_timed_mutex> guard(_tier_lock);
+
+    // the state file is written last, so that a save interrupted by a crash
+    // leaves no saved updates rather than a mix of two saves
+    delete_file(_state_file);
+    // compacting moves the frozen point next to the points for the save; the
+    // temp indices have no deletes, so it moves nothing else
+    const bool temp_index_saved = _temp_index->get_num_points() > 0;
+    if (temp_index_saved)
+        _temp_index->save(_temp_index_file.c_str(), true);
+    if (_merging_temp_index != nullptr)
+        _merging_temp_index->save(_merging_temp_index_file.c_str(), true);
+    {
+        std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        std::vector<uint32_t> deleted(_deleted.begin(), _deleted.end());
+        delete_file(_deleted_file);
+        save_bin<uint32_t>(_deleted_file, deleted.data(), deleted.size(), 1);
+    }
+    std::vector<uint64_t> state = {_disk_points, _next_id, _merging_temp_index != nullptr ? _merging_end_id : 0,
+                                   temp_index_saved ? 1u : 0u};
+    save_bin<uint64_t>(_state_file, state.data(), state.size(), 1);
+}
+
+template <typename T>
+std::unique_ptr<typename FreshDiskIndex<T>::DiskTier> FreshDiskIndex<T>::load_disk_index(
+    const std::string &disk_index_file, const std::string &pq_compressed_file)
+{
+    std::unique_ptr<DiskTier> disk(new DiskTier());
+#ifdef _WINDOWS
+    disk->reader.reset(new WindowsAlignedFileReader());
+#else
+    disk->reader.reset(new LinuxAlignedFileReader());
+#endif
+    disk->index.reset(new PQFlashIndex<T>(disk->reader, _metric));
+    if (disk->index->load_from_separate_paths(_num_threads, disk_index_file.c_str(), _pq_pivots_file.c_str(),
+                                              pq_compressed_file.c_str()) != 0)
+    {
+        throw ANNException("Failed to load the disk index " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    return disk;
+}
+
+template <typename T> uint64_t FreshDiskIndex<T>::apply_merge_journal()
+{
+    std::ifstream journal(_merge_journal_file, std::ios::binary);
+    uint64_t first_id = 0, num_meta = 0, num_sectors = 0, num_code_bytes = 0;
+    journal.read((char *)&first_id, sizeof(uint64_t));
+    journal.read((char *)&num_meta, sizeof(uint64_t));
+    std::vector<uint64_t> meta(num_meta);
+    journal.read((char *)meta.data(), num_meta * sizeof(uint64_t));
+    journal.read((char *)&num_sectors, sizeof(uint64_t));
+    std::vector<uint64_t> sectors(num_sectors);
+    journal.read((char *)sectors.data(), num_sectors * sizeof(uint64_t));
+    journal.read((char *)&num_code_bytes, sizeof(uint64_t));
+    std::vector<uint8_t> new_codes(num_code_bytes);
+    journal.read((char *)new_codes.data(), num_code_bytes);
+    if (!journal || num_meta <= META_HAS_REORDER_DATA ||
+        get_file_size(_staging_file) != num_sectors * SECTOR_LEN)
+    {
+        throw ANNException("Could not read the merge journal " + _merge_journal_file, -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+
+    // Staged sectors are in increasing order, and the ones past the end of
+    // the file are contiguous with it, so they simply extend it.
+    {
+        std::fstream disk_writer(_disk_index_file, std::ios::binary | std::ios::in | std::ios::out);
+        std::ifstream staging(_staging_file, std::ios::binary);
+        std::vector<char> block(MERGE_BLOCK_SECTORS * SECTOR_LEN);
+        for (uint64_t i = 0; i < num_sectors; i++)
+        {
+            // read the staging file a block at a time
+            const uint64_t in_block = i % MERGE_BLOCK_SECTORS;
+            if (in_block == 0)
+                staging.read(block.data(), (std::min)(MERGE_BLOCK_SECTORS, num_sectors - i) * SECTOR_LEN);
+            disk_writer.seekp(sectors[i] * SECTOR_LEN);
+            disk_writer.write(block.data() + in_block * SECTOR_LEN, SECTOR_LEN);
+        }
+        disk_writer.seekp(2 * sizeof(int32_t));
+        disk_writer.write((char *)meta.data(), meta.size() * sizeof(uint64_t));
+        disk_writer.close();
+        if (!disk_writer || !staging)
+        {
+            throw ANNException("Failed to write " + _disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+    }
+
+    {
+        std::fstream pq_writer(_pq_compressed_file, std::ios::binary | std::ios::in | std::ios::out);
+        int32_t num_points = 0, n_chunks = 0;
+        pq_writer.read((char *)&num_points, sizeof(int32_t));
+        pq_writer.read((char *)&n_chunks, sizeof(int32_t));
+        // the file already holds the new codes if the journal is applied again
+        if (!pq_writer || get_file_size(_pq_compressed_file) < 2 * sizeof(int32_t) + first_id * n_chunks)
+        {
+            throw ANNException("Unexpected size of " + _pq_compressed_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        num_points = (int32_t)meta[META_NUM_POINTS];
+        pq_writer.seekp(0);
+        pq_writer.write((char *)&num_points, sizeof(int32_t));
+        pq_writer.seekp(2 * sizeof(int32_t) + first_id * n_chunks);
+        pq_writer.write((char *)new_codes.data(), new_codes.size());
+        pq_writer.close();
+        if (!pq_writer)
+        {
+            throw ANNException("Failed to write " + _pq_compressed_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+    }
+    return num_sectors;
+}
+
+template <typename T> std::unique_ptr<Index<T, uint32_t>> FreshDiskIndex<T>::create_temp_index()
+{
+    std::unique_ptr<Index<T, uint32_t>> temp_index(new Index<T, uint32_t>(
+        _metric, _dim, _initial_temp_points, true, _params, _params.search_list_size, _num_threads, true));
+
+    // start from the medoid of the disk index, so that searches enter both
+    // tiers in the same region
+    const std::vector<uint64_t> meta = read_disk_header();
+    const uint64_t medoid = meta[META_MEDOID];
+    std::vector<T> medoid_coords(_dim);
+    std::ifstream reader(_disk_index_file, std::ios::binary);
+    reader.seekg((medoid / _nnodes_per_sector + 1) * SECTOR_LEN + (medoid % _nnodes_per_sector) * _max_node_len);
+    reader.read((char *)medoid_coords.data(), _dim * sizeof(T));
+    temp_index->set_start_points(medoid_coords.data(), _dim);
+    return temp_index;
+}
+
+template <typename T> uint32_t FreshDiskIndex<T>::insert(const T *point)
+{
+    while (true)
+    {
+        {
+            std::shared_lock<std::shared_timed_mutex> guard(_tier_lock);
+            // reserve a slot of the temp index before taking an id, so that a
+            // full temp index does not use up ids
+            if (_temp_index_size++ < _initial_temp_points)
+            {
+                const uint32_t id = _next_id++;
+                // the slot is reserved and the id is new, so this only fails
+                // on an internal error
+                if (_temp_index->insert_point(point, id) != 0)
+                {
+                    throw ANNException("Failed to insert point " + std::to_string(id), -1, __FUNCSIG__, __FILE__,
+                                       __LINE__);
+                }
+                return id;
+            }
+            _temp_index_size--;
+        }
+
+        // The temp index is full: merge it, unless another insert did while
+        // this one waited for the merge lock.
+        std::lock_guard<std::mutex> merge_guard(_merge_lock);
+        bool full;
+        {
+            std::shared_lock<std::shared_timed_mutex> guard(_tier_lock);
+            full = _temp_index_size >= _initial_temp_points;
+        }
+        if (full)
+        {
+            diskann::cout << "The temp index holds " << _initial_temp_points << " points, merging it." << std::endl;
+            merge_temp_index();
+        }
+    }
+}
+
+template <typename T> void FreshDiskIndex<T>::lazy_delete(const uint32_t id)
+{
+    if (id >= _next_id)
+    {
+        throw ANNException("Unknown id " + std::to_string(id), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::shared_lock<std::shared_timed_mutex> tier_guard(_tier_lock);
+    {
+        std::unique_lock<std::shared_timed_mutex> guard(_delete_lock);
+        _deleted.insert(id);
+    }
+    // so that the disk index fills its results with live points
+    if (id < _disk_points && _disk != nullptr)
+        _disk->index->mark_deleted(id);
+}
+
+template <typename T>
+size_t FreshDiskIndex<T>::search(const T *query, const uint64_t K, const uint64_t L, const uint64_t beam_width,
+                                 uint32_t *ids, float *distances)
+{
+    if (K > L)
+    {
+        throw ANNException("Set L to a value of at least K", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    // L results from every tier, so that deleted ids can be dropped
+    std::vector<std::pair<float, uint32_t>> candidates;
+    {
+        std::shared_lock<std::shared_timed_mutex> guard(_tier_lock);
+        if (_disk == nullptr)
+        {
+            throw ANNException("The disk index is closed after a failed merge, call merge() to finish it", -1,
+                               __FUNCSIG__, __FILE__, __LINE__);
+        }
+
+        const uint64_t disk_k = (std::min)(L, (uint64_t)_disk_points);
+        std::vector<uint64_t> disk_ids(disk_k);
+        std::vector<float> disk_dists(disk_k);
+        _disk->index->cached_beam_search(query, disk_k, L, disk_ids.data(), disk_dists.data(), beam_width);
+        for (uint64_t i = 0; i < disk_k; i++)
+        {
+            // fewer than disk_k results if most of the candidates are deleted
+            if (disk_ids[i] != std::numeric_limits<uint64_t>::max())
+                candidates.emplace_back(disk_dists[i], (uint32_t)disk_ids[i]);
+        }
+
+        std::vector<uint32_t> tags(L);
+        std::vector<float> dists(L);
+        std::vector<T *> no_vectors;
+        for (auto temp_index : {_temp_index.get(), _merging_temp_index.get()})
+        {
+            if (temp_index == nullptr)
+                continue;
+            const size_t num_found = temp_index->search_with_tags(query, L, (uint32_t)L, tags.data(), dists.data(),
+                                                                  no_vectors);
+            for (size_t i = 0; i < num_found; i++)
+                candidates.emplace_back(dists[i], tags[i]);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    std::shared_lock<std::shared_timed_mutex> guard(_delete_lock);
+    size_t num_results = 0;
+    for (auto &candidate : candidates)
+    {
+        if (num_results == K)
+            break;
+        if (_deleted.find(candidate.second) != _deleted.end() ||
+            std::find(ids, ids + num_results, candidate.second) != ids + num_results)
+            continue;
+        ids[num_results] = candidate.second;
+        if (distances != nullptr)
+            distances[num_results] = candidate.first;
+        num_results++;
+    }
+    return num_results;
+}
+
+template <typename T>
+void FreshDiskIndex<T>::compute_merge(Index<T, uint32_t> &temp_index, const uint32_t first_id, const uint32_t end_id,
+                                      const tsl::robin_set<uint32_t> &deleted, std::vector<uint64_t> &staged_sectors,
+                                      std::vector<uint8_t> &new_codes, uint64_t &new_medoid)
+{
+    const uint64_t num_new_points = end_id - first_id;
+    const uint32_t degree = (uint32_t)_max_degree;
+    const uint32_t L = _params.search_list_size;
+    auto is_deleted = [&](const uint32_t id) { return deleted.find(id) != deleted.end(); };
+
+    // The disk points only have their PQ codes in memory, which approximate
+    // their vectors while pruning, as in the FreshDiskANN merge.
+    std::unique_ptr<uint8_t[]> codes;
+    size_t num_codes, n_chunks;
+    diskann::load_bin<uint8_t>(_pq_compressed_file, codes, num_codes, n_chunks);
+    FixedChunkPQTable pq_table;
+    pq_table.load_pq_centroid_bin(_pq_pivots_file.c_str(), n_chunks);
+
+    // points inserted into the temp index, zero for the ones deleted since
+    std::vector<T> new_data(num_new_points * _dim, (T)0);
+    std::vector<float> new_vectors(num_new_points * _dim, 0.0f);
+    std::vector<uint8_t> new_live(num_new_points, 0);
+    for (uint32_t id = first_id; id < end_id; id++)
+    {
+        uint32_t tag = id;
+        const size_t offset = (size_t)(id - first_id) * _dim;
+        if (is_deleted(id) || temp_index.get_vector_by_tag(tag, new_data.data() + offset) != 0)
+            continue;
+        for (size_t d = 0; d < _dim; d++)
+            new_vectors[offset + d] = (float)new_data[offset + d];
+        new_live[id - first_id] = 1;
+    }
+    new_codes.assign(num_new_points * n_chunks, 0);
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads)
+    for (int64_t i = 0; i < (int64_t)num_new_points; i++)
+        pq_table.compress_vector(new_vectors.data() + i * _dim, new_codes.data() + i * n_chunks);
+
+    auto get_vector = [&](const uint32_t id, float *out) {
+        if (id >= first_id)
+            memcpy(out, new_vectors.data() + (size_t)(id - first_id) * _dim, _dim * sizeof(float));
+        else
+            pq_table.inflate_vector(codes.get() + (size_t)id * n_chunks, out);
+    };
+    auto prune = [&](const float *node_vector, const std::vector<uint32_t> &candidates, std::vector<uint32_t> &result) {
+        std::vector<float> candidate_vectors(candidates.size() * _dim);
+        std::vector<std::pair<float, uint32_t>> pool;
+        for (uint32_t i = 0; i < candidates.size(); i++)
+        {
+            get_vector(candidates[i], candidate_vectors.data() + i * _dim);
+            pool.emplace_back(l2_squared(node_vector, candidate_vectors.data() + i * _dim, _dim), i);
+        }
+        std::sort(pool.begin(), pool.end());
+        if (pool.size() > _params.max_occlusion_size)
+            pool.resize(_params.max_occlusion_size);
+
+        std::vector<float> pool_vectors(pool.size() * _dim);
+        for (size_t i = 0; i < pool.size(); i++)
+        {
+            memcpy(pool_vectors.data() + i * _dim, candidate_vectors.data() + pool[i].second * _dim,
+                   _dim * sizeof(float));
+            pool[i].second = candidates[pool[i].second];
+        }
+        robust_prune(pool, pool_vectors.data(), _dim, degree, _params.alpha, result);
+    };
+
+    auto node_offset = [&](const uint64_t id) {
+        return (id / _nnodes_per_sector + 1) * SECTOR_LEN + (id % _nnodes_per_sector) * _max_node_len;
+    };
+
+    // out neighbors of the deleted disk points, which replace the edges into
+    // them
+    std::ifstream disk_reader(_disk_index_file, std::ios::binary);
+    std::vector<char> node_buf(_max_node_len);
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> deleted_nbrs;
+    for (const uint32_t id : deleted)
+    {
+        if (id >= first_id)
+            continue;
+        disk_reader.seekg(node_offset(id));
+        disk_reader.read(node_buf.data(), _max_node_len);
+        const uint32_t *nhood = (uint32_t *)(node_buf.data() + _dim * sizeof(T));
+        deleted_nbrs[id] = std::vector<uint32_t>(nhood + 1, nhood + 1 + *nhood);
+    }
+
+    const std::vector<uint64_t> meta = read_disk_header();
+    new_medoid = meta[META_MEDOID];
+    if (is_deleted((uint32_t)new_medoid))
+    {
+        // a live neighbor of the medoid if there is one, else the first live
+        // point; the medoid stays if every point is deleted
+        uint64_t replacement = end_id;
+        auto medoid_nbrs = deleted_nbrs.find((uint32_t)new_medoid);
+        if (medoid_nbrs != deleted_nbrs.end())
+        {
+            for (const uint32_t nbr : medoid_nbrs->second)
+            {
+                if (nbr < end_id && !is_deleted(nbr))
+                {
+                    replacement = nbr;
+                    break;
+                }
+            }
+        }
+        for (uint32_t id = 0; id < end_id && replacement == end_id; id++)
+        {
+            if (!is_deleted(id))
+                replacement = id;
+        }
+        if (replacement != end_id)
+        {
+            new_medoid = replacement;
+            diskann::cout << "The medoid was deleted, entering the graph at " << new_medoid << " instead."
+                          << std::endl;
+        }
+        else
+        {
+            diskann::cout << "Every point is deleted, keeping the medoid " << new_medoid << "." << std::endl;
+        }
+    }
+
+    // Link the inserted points: their candidates come from the disk index and
+    // from the other inserted points.
+    std::vector<std::vector<uint32_t>> new_out(num_new_points);
+#pragma omp parallel for schedule(dynamic, 16) num_threads(_num_threads)
+    for (int64_t i = 0; i < (int64_t)num_new_points; i++)
+    {
+        if (!new_live[i])
+            continue;
+        const uint32_t id = first_id + (uint32_t)i;
+        const T *point = new_data.data() + i * _dim;
+
+        std::vector<uint32_t> candidates;
+        const uint64_t disk_k = (std::min)((uint64_t)L, (uint64_t)first_id);
+        std::vector<uint64_t> disk_ids(disk_k);
+        std::vector<float> disk_dists(disk_k);
+        _disk->index->cached_beam_search(point, disk_k, L, disk_ids.data(), disk_dists.data(), MERGE_BEAM_WIDTH);
+        for (const uint64_t disk_id : disk_ids)
+        {
+            if (disk_id != std::numeric_limits<uint64_t>::max() && !is_deleted((uint32_t)disk_id))
+                candidates.push_back((uint32_t)disk_id);
+        }
+
+        std::vector<uint32_t> tags(L);
+        std::vector<float> dists(L);
+        std::vector<T *> no_vectors;
+        const size_t num_found = temp_index.search_with_tags(point, L, L, tags.data(), dists.data(), no_vectors);
+        for (size_t j = 0; j < num_found; j++)
+        {
+            if (tags[j] != id && !is_deleted(tags[j]))
+                candidates.push_back(tags[j]);
+        }
+        prune(new_vectors.data() + i * _dim, candidates, new_out[i]);
+    }
+
+    // reverse edges of the inserted points, grouped by destination
+    std::vector<std::pair<uint32_t, uint32_t>> reverse_edges;
+    for (uint64_t i = 0; i < num_new_points; i++)
+    {
+        for (const uint32_t des : new_out[i])
+            reverse_edges.emplace_back(des, first_id + (uint32_t)i);
+    }
+    std::sort(reverse_edges.begin(), reverse_edges.end());
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> incoming;
+    for (auto &edge : reverse_edges)
+        incoming[edge.first].push_back(edge.second);
+
+    // New out neighbors of a node, or false if it is unaffected by the merge.
+    // Edges into deleted nodes are replaced by the out neighbors of those.
+    auto update_neighbors = [&](const uint32_t node, const float *node_vector, const std::vector<uint32_t> &nbrs,
+                                std::vector<uint32_t> &result) {
+        bool affected = false;
+        std::vector<uint32_t> candidates;
+        for (const uint32_t nbr : nbrs)
+        {
+            if (!is_deleted(nbr))
+            {
+                candidates.push_back(nbr);
+                continue;
+            }
+            affected = true;
+            auto iter = deleted_nbrs.find(nbr);
+            if (iter == deleted_nbrs.end())
+                continue;
+            for (const uint32_t second_hop : iter->second)
+            {
+                if (second_hop != node && !is_deleted(second_hop))
+                    candidates.push_back(second_hop);
+            }
+        }
+        auto iter = incoming.find(node);
+        if (iter != incoming.end())
+        {
+            affected = true;
+            candidates.insert(candidates.end(), iter->second.begin(), iter->second.end());
+        }
+        if (!affected)
+            return false;
+
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        if (candidates.size() > degree)
+            prune(node_vector, candidates, result);
+        else
+            result = candidates;
+        return true;
+    };
+
+    // Stream the graph and stage every sector that changes, including the
+    // sectors of the inserted points past the end of the file.
+    const uint64_t num_old_sectors = DIV_ROUND_UP((uint64_t)first_id, _nnodes_per_sector);
+    const uint64_t num_sectors = DIV_ROUND_UP((uint64_t)end_id, _nnodes_per_sector);
+    std::ofstream staging(_staging_file, std::ios::binary | std::ios::trunc);
+    std::vector<char> block(MERGE_BLOCK_SECTORS * SECTOR_LEN);
+    disk_reader.clear();
+    disk_reader.seekg(SECTOR_LEN);
+    for (uint64_t block_start = 0; block_start < num_sectors; block_start += MERGE_BLOCK_SECTORS)
+    {
+        const uint64_t block_end = (std::min)(num_sectors, block_start + MERGE_BLOCK_SECTORS);
+        const uint64_t num_old_in_block =
+            block_start < num_old_sectors ? (std::min)(block_end, num_old_sectors) - block_start : 0;
+        disk_reader.read(block.data(), num_old_in_block * SECTOR_LEN);
+        memset(block.data() + num_old_in_block * SECTOR_LEN, 0,
+               (block_end - block_start - num_old_in_block) * SECTOR_LEN);
+
+        const uint64_t first_node = block_start * _nnodes_per_sector;
+        const uint64_t end_node = (std::min)((uint64_t)end_id, block_end * _nnodes_per_sector);
+        std::vector<uint8_t> node_changed(end_node - first_node, 0);
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads)
+        for (int64_t node = (int64_t)first_node; node < (int64_t)end_node; node++)
+        {
+            char *node_record = block.data() + (node / _nnodes_per_sector - block_start) * SECTOR_LEN +
+                                (node % _nnodes_per_sector) * _max_node_len;
+            T *coords = (T *)node_record;
+            uint32_t *nhood = (uint32_t *)(node_record + _dim * sizeof(T));
+
+            std::vector<uint32_t> result;
+            if (node >= first_id)
+            {
+                memcpy(coords, new_data.data() + (node - first_id) * _dim, _dim * sizeof(T));
+                result = new_out[node - first_id];
+                auto iter = incoming.find((uint32_t)node);
+                if (iter != incoming.end() && new_live[node - first_id])
+                {
+                    std::vector<uint32_t> candidates = result;
+                    candidates.insert(candidates.end(), iter->second.begin(), iter->second.end());
+                    std::sort(candidates.begin(), candidates.end());
+                    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+                    if (candidates.size() > degree)
+                        prune(new_vectors.data() + (node - first_id) * _dim, candidates, result);
+                    else
+                        result = candidates;
+                }
+            }
+            else if (is_deleted((uint32_t)node))
+            {
+                if (*nhood == 0)
+                    continue;
+            }
+            else
+            {
+                std::vector<float> node_vector(_dim);
+                for (size_t d = 0; d < _dim; d++)
+                    node_vector[d] = (float)coords[d];
+                const std::vector<uint32_t> nbrs(nhood + 1, nhood + 1 + *nhood);
+                if (!update_neighbors((uint32_t)node, node_vector.data(), nbrs, result))
+                    continue;
+            }
+            *nhood = (uint32_t)result.size();
+            memset(nhood + 1, 0, degree * sizeof(uint32_t));
+            memcpy(nhood + 1, result.data(), result.size() * sizeof(uint32_t));
+            node_changed[node - first_node] = 1;
+        }
+
+        for (uint64_t sector = block_start; sector < block_end; sector++)
+        {
+            const uint64_t sector_first = sector * _nnodes_per_sector - first_node;
+            const uint64_t sector_end = (std::min)(end_node, (sector + 1) * _nnodes_per_sector) - first_node;
+            if (std::find(node_changed.begin() + sector_first, node_changed.begin() + sector_end, 1) ==
+                node_changed.begin() + sector_end)
+                continue;
+            staging.write(block.data() + (sector - block_start) * SECTOR_LEN, SECTOR_LEN);
+            // the file has the header sector in front of the nodes
+            staged_sectors.push_back(sector + 1);
+        }
+    }
+    if (!staging)
+    {
+        throw ANNException("Failed to write " + _staging_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+template <typename T>
+void FreshDiskIndex<T>::write_merge_journal(const uint32_t first_id, const uint32_t end_id,
+                                            const std::vector<uint64_t> &staged_sectors,
+                                            const std::vector<uint8_t> &new_codes, const uint64_t new_medoid)
+{
+    std::vector<uint64_t> meta = read_disk_header();
+    meta[META_NUM_POINTS] = end_id;
+    meta[META_MEDOID] = new_medoid;
+    // the last field is the file size, there is no reorder data
+    meta.back() = (DIV_ROUND_UP((uint64_t)end_id, _nnodes_per_sector) + 1) * SECTOR_LEN;
+
+    // written under another name and renamed, so that the journal exists only
+    // once complete
+    const std::string journal_tmp_file = _merge_journal_file + ".tmp";
+    std::ofstream journal(journal_tmp_file, std::ios::binary | std::ios::trunc);
+    const uint64_t first = first_id, num_meta = meta.size(), num_sectors = staged_sectors.size(),
+                   num_code_bytes = new_codes.size();
+    journal.write((char *)&first, sizeof(uint64_t));
+    journal.write((char *)&num_meta, sizeof(uint64_t));
+    journal.write((char *)meta.data(), num_meta * sizeof(uint64_t));
+    journal.write((char *)&num_sectors, sizeof(uint64_t));
+    journal.write((char *)staged_sectors.data(), num_sectors * sizeof(uint64_t));
+    journal.write((char *)&num_code_bytes, sizeof(uint64_t));
+    journal.write((char *)new_codes.data(), num_code_bytes);
+    journal.close();
+    if (!journal || !replace_file(journal_tmp_file, _merge_journal_file))
+    {
+        throw ANNException("Failed to write " + _merge_journal_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+template <typename T> void FreshDiskIndex<T>::merge()
+{
+    std::lock_guard<std::mutex> merge_guard(_merge_lock);
+    merge_temp_index();
+}
+
+template <typename T> void FreshDiskIndex<T>::merge_temp_index()
+{
+    diskann::Timer timer;
+
+    // A journal is left by a merge that failed while applying it, which only
+    // has to be applied again.
+    const bool computed = file_exists(_merge_journal_file);
+    uint32_t first_id, end_id;
+    {
+        std::unique_lock<std::shared_timed_mutex> guard(_tier_lock);
+        first_id = _disk_points;
+        // a failed merge is retried as it was, the points inserted since stay
+        // in the temp index
+        end_id = _merging_temp_index != nullptr ? _merging_end_id : (uint32_t)_next_id;
+        if (!computed)
+        {
+            std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+            _merging_deleted.clear();
+            for (const uint32_t id : _deleted)
+            {
+                if (id < end_id)
+                    _merging_deleted.insert(id);
+            }
+        }
+        if (_merging_temp_index == nullptr)
+        {
+            if (first_id == end_id && _merging_deleted.empty())
+            {
+                diskann::cout << "Nothing to merge." << std::endl;
+                return;
+            }
+            _merging_temp_index = std::move(_temp_index);
+            _merging_end_id = end_id;
+            _temp_index = create_temp_index();
+            _temp_index_size = 0;
+        }
+        else
+        {
+            diskann::cout << "Retrying the failed merge." << std::endl;
+        }
+    }
+
+    if (!computed)
+    {
+        diskann::cout << "Merging " << end_id - first_id << " inserted and " << _merging_deleted.size()
+                      << " deleted points into " << _disk_index_file << std::endl;
+        try
+        {
+            std::vector<uint64_t> staged_sectors;
+            std::vector<uint8_t> new_codes;
+            uint64_t new_medoid;
+            compute_merge(*_merging_temp_index, first_id, end_id, _merging_deleted, staged_sectors, new_codes,
+                          new_medoid);
+            // from here on the merge is committed, load() finishes it after a
+            // crash
+            write_merge_journal(first_id, end_id, staged_sectors, new_codes, new_medoid);
+        }
+        catch (...)
+        {
+            std::remove(_staging_file.c_str());
+            std::remove((_merge_journal_file + ".tmp").c_str());
+            throw;
+        }
+    }
+
+    uint64_t num_sectors;
+    {
+        // Searches and updates wait while the files change in place and the
+        // merged index loads. The disk index is closed meanwhile, and stays
+        // closed if this fails, until merge() applies the journal again.
+        std::unique_lock<std::shared_timed_mutex> guard(_tier_lock);
+        _disk.reset();
+        num_sectors = apply_merge_journal();
+        _disk = load_disk_index(_disk_index_file, _pq_compressed_file);
+        std::remove(_merge_journal_file.c_str());
+        std::remove(_staging_file.c_str());
+        _merging_temp_index.reset();
+        _disk_points = end_id;
+
+        std::unique_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        for (const uint32_t id : _merging_deleted)
+            _deleted.erase(id);
+        _merging_deleted.clear();
+
+        // the merged disk index only knows about the deletes made during the
+        // merge once told again
+        std::vector<uint32_t> disk_deletes;
+        for (const uint32_t id : _deleted)
+        {
+            if (id < _disk_points)
+                disk_deletes.push_back(id);
+        }
+        _disk->index->set_deleted_points(disk_deletes);
+    }
+    diskann::cout << "Merge done, rewrote " << num_sectors << " sectors in " << (double)timer.elapsed() / 1000000.0
+                  << "s" << std::endl;
+}
+
+template <typename T> void FreshDiskIndex<T>::merge_async()
+{
+    std::lock_guard<std::mutex> guard(_merge_thread_lock);
+    if (_merge_thread.joinable())
+        _merge_thread.join();
+    _merge_thread = std::thread([this]() {
+        try
+        {
+            merge();
+        }
+        catch (const std::exception &e)
+        {
+            diskann::cerr << "Background merge failed: " << e.what() << std::endl;
+        }
+    });
+}
+
+template <typename T> void FreshDiskIndex<T>::wait_for_merge()
+{
+    std::lock_guard<std::mutex> guard(_merge_thread_lock);
+    if (_merge_thread.joinable())
+        _merge_thread.join();
+}
+
+template <typename T> size_t FreshDiskIndex<T>::get_num_points()
+{
+    return _next_id;
+}
+
+template DISKANN_DLLEXPORT class FreshDiskIndex<float>;
+template DISKANN_DLLEXPORT class FreshDiskIndex<int8_t>;
+template DISKANN_DLLEXPORT class FreshDiskIndex<uint8_t>;
+} // namespace diskann
@@ -0,0 +1,223 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WINDOWS
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "huge_page_allocator.h"
+#include "utils.h"
+
+#ifndef _WINDOWS
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+// from numaif.h, to avoid a dependency on libnuma
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#endif
+
+namespace diskann
+{
+namespace
+{
+const size_t HUGE_PAGE_2MB = (size_t)1 << 21;
+const size_t HUGE_PAGE_1GB = (size_t)1 << 30;
+
+std::mutex config_lock;
+HugePageConfig config;
+
+// mmap'd regions and their mapped length. Anything not in here came from
+// alloc_aligned.
+std::mutex mappings_lock;
+std::unordered_map<void *, size_t> mappings;
+
+std::atomic<bool> warned_hugetlb_1gb(false);
+std::atomic<bool> warned_hugetlb_2mb(false);
+std::atomic<bool> warned_numa(false);
+std::atomic<bool> warned_unsupported(false);
+
+void warn_once(std::atomic<bool> &flag, const std::string &message)
+{
+    if (!flag.exchange(true))
+        diskann::cerr << "Warning: " << message << std::endl;
+}
+
+#ifndef _WINDOWS
+void *map_hugetlb(const size_t length, const int page_flag)
+{
+    void *ptr =
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | page_flag, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// Over-maps by one huge page and trims both ends so that the region starts on
+// a 2MB boundary; otherwise the kernel can only use hugepages for the aligned
+// interior of the mapping.
+void *map_transparent(const size_t length)
+{
+    const size_t padded_length = length + HUGE_PAGE_2MB;
+    char *raw = (char *)mmap(nullptr, padded_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return nullptr;
+
+    char *aligned = (char *)ROUND_UP((size_t)raw, HUGE_PAGE_2MB);
+    if (aligned != raw)
+        munmap(raw, aligned - raw);
+    const size_t tail = (raw + padded_length) - (aligned + length);
+    if (tail > 0)
+        munmap(aligned + length, tail);
+
+#ifdef MADV_HUGEPAGE
+    // fails harmlessly when THP is compiled out; the mapping is still usable
+    madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+void bind_to_numa_node(void *ptr, const size_t length, const int node)
+{
+    std::vector<unsigned long> node_mask(node / (8 * sizeof(unsigned long)) + 1, 0);
+    node_mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    const unsigned long max_node = node_mask.size() * 8 * sizeof(unsigned long) + 1;
+    if (syscall(SYS_mbind, ptr, length, MPOL_BIND, node_mask.data(), max_node, 0) != 0)
+    {
+        warn_once(warned_numa, "could not bind memory to NUMA node " + std::to_string(node) +
+                                   ", using the default memory policy.");
+    }
+}
+
+// Returns nullptr if no mapping could be created, in which case the caller
+// falls back to alloc_aligned.
+void *map_huge_pages(const size_t size, const HugePageConfig &cfg, size_t &length)
+{
+    void *ptr = nullptr;
+    const char *kind = nullptr;
+    // a 1GB page for a much smaller array mostly wastes memory
+    if (cfg.mode == HugePageMode::HUGETLB_1GB && size >= HUGE_PAGE_1GB / 2)
+    {
+        length = ROUND_UP(size, HUGE_PAGE_1GB);
+        ptr = map_hugetlb(length, MAP_HUGE_1GB);
+        kind = "1GB hugetlb";
+        if (ptr == nullptr)
+            warn_once(warned_hugetlb_1gb, "no 1GB hugepages available (see "
+                                          "/sys/kernel/mm/hugepages/hugepages-1048576kB), trying 2MB pages.");
+    }
+    if (ptr == nullptr && (cfg.mode == HugePageMode::HUGETLB_1GB || cfg.mode == HugePageMode::HUGETLB_2MB))
+    {
+        length = ROUND_UP(size, HUGE_PAGE_2MB);
+        ptr = map_hugetlb(length, MAP_HUGE_2MB);
+        kind = "2MB hugetlb";
+        if (ptr == nullptr)
+            warn_once(warned_hugetlb_2mb, "not enough 2MB hugepages reserved (vm.nr_hugepages), "
+                                          "falling back to transparent hugepages.");
+    }
+    if (ptr == nullptr)
+    {
+        length = ROUND_UP(size, HUGE_PAGE_2MB);
+        ptr = map_transparent(length);
+        kind = "transparent huge";
+    }
+    if (ptr == nullptr)
+        return nullptr;
+
+    if (cfg.numa_node >= 0)
+        bind_to_numa_node(ptr, length, cfg.numa_node);
+
+    diskann::cout << "Mapped " << length / (1024 * 1024) << "MB on " << kind << " pages";
+    if (cfg.numa_node >= 0)
+        diskann::cout << " bound to NUMA node " << cfg.numa_node;
+    diskann::cout << std::endl;
+    return ptr;
+}
+#endif
+} // namespace
+
+void set_huge_page_config(const HugePageConfig &new_config)
+{
+    std::lock_guard<std::mutex> guard(config_lock);
+    config = new_config;
+}
+
+HugePageConfig get_huge_page_config()
+{
+    std::lock_guard<std::mutex> guard(config_lock);
+    return config;
+}
+
+HugePageMode huge_page_mode_from_string(const std::string &mode)
+{
+    if (mode == "none")
+        return HugePageMode::NONE;
+    else if (mode == "thp")
+        return HugePageMode::TRANSPARENT;
+    else if (mode == "2mb")
+        return HugePageMode::HUGETLB_2MB;
+    else if (mode == "1gb")
+        return HugePageMode::HUGETLB_1GB;
+
+    throw diskann::ANNException("Unknown huge page mode " + mode + ". Use one of none/thp/2mb/1gb.", -1, __FUNCSIG__,
+                                __FILE__, __LINE__);
+}
+
+void alloc_aligned_huge(void **ptr, size_t size, size_t align)
+{
+    alloc_aligned_huge(ptr, size, align, get_huge_page_config().numa_node);
+}
+
+void alloc_aligned_huge(void **ptr, size_t size, size_t align, int numa_node)
+{
+    *ptr = nullptr;
+    HugePageConfig cfg = get_huge_page_config();
+    cfg.numa_node = numa_node;
+    if (cfg.mode != HugePageMode::NONE && size >= HUGE_PAGE_2MB && align <= HUGE_PAGE_2MB)
+    {
+#ifndef _WINDOWS
+        size_t length = 0;
+        *ptr = map_huge_pages(size, cfg, length);
+        if (*ptr != nullptr)
+        {
+            std::lock_guard<std::mutex> guard(mappings_lock);
+            mappings[*ptr] = length;
+            return;
+        }
+#else
+        warn_once(warned_unsupported, "hugepage allocation is not supported on this platform.");
+#endif
+    }
+    alloc_aligned(ptr, ROUND_UP(size, align), align);
+}
+
+void aligned_free_huge(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+#ifndef _WINDOWS
+    {
+        std::lock_guard<std::mutex> guard(mappings_lock);
+        auto iter = mappings.find(ptr);
+        if (iter != mappings.end())
+        {
+            munmap(ptr, iter->second);
+            mappings.erase(iter);
+            return;
+        }
+    }
+#endif
+    aligned_free(ptr);
+}
+} // namespace diskann
@@ -4,6 +4,7 @@
 #include <memory>
 #include "in_mem_data_store.h"
 
+#include "huge_page_allocator.h"
 #include "utils.h"
 
 namespace diskann
@@ -15,7 +16,7 @@ InMemDataStore<data_t>::InMemDataStore(const location_t num_points, const size_t
     : AbstractDataStore<data_t>(num_points, dim), _distance_fn(distance_fn)
 {
     _aligned_dim = ROUND_UP(dim, _distance_fn->get_required_alignment());
-    alloc_aligned(((void **)&_data), this->_capacity * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
+    alloc_aligned_huge(((void **)&_data), this->_capacity * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
     std::memset(_data, 0, this->_capacity * _aligned_dim * sizeof(data_t));
 }
 
@@ -23,7 +24,7 @@ template <typename data_t> InMemDataStore<data_t>::~InMemDataStore()
 {
     if (_data != nullptr)
     {
-        aligned_free(this->_data);
+        aligned_free_huge(this->_data);
     }
 }
 
@@ -55,7 +56,7 @@ template <typename data_t> location_t Index<data_t>::load_impl(AlignedFileReader
         stream << "ERROR: Driver requests loading " << _dim << " dimension,"
                << "but file has " << file_dim << " dimension." << std::endl;
         diskann::cerr << stream.str() << std::endl;
-        aligned_free(_data);
+        aligned_free_huge(_data);
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
@@ -76,7 +77,7 @@ template <typename data_t> location_t InMemDataStore<data_t>::load_impl(const st
         std::stringstream stream;
         stream << "ERROR: data file " << filename << " does not exist." << std::endl;
         diskann::cerr << stream.str() << std::endl;
-        aligned_free(_data);
+        aligned_free_huge(_data);
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
     diskann::get_bin_metadata(filename, file_num_points, file_dim);
@@ -87,7 +88,7 @@ template <typename data_t> location_t InMemDataStore<data_t>::load_impl(const st
         stream << "ERROR: Driver requests loading " << this->_dim << " dimension,"
                << "but file has " << file_dim << " dimension." << std::endl;
         diskann::cerr << stream.str() << std::endl;
-        aligned_free(_data);
+        aligned_free_huge(_data);
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
@@ -210,15 +211,11 @@ template <typename data_t> location_t InMemDataStore<data_t>::expand(const locat
            << this->capacity() << ")" << std::endl;
         throw diskann::ANNException(ss.str(), -1);
     }
-#ifndef _WINDOWS
     data_t *new_data;
-    alloc_aligned((void **)&new_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
+    alloc_aligned_huge((void **)&new_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
     memcpy(new_data, _data, this->capacity() * _aligned_dim * sizeof(data_t));
-    aligned_free(_data);
+    aligned_free_huge(_data);
     _data = new_data;
-#else
-    realloc_aligned((void **)&_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
-#endif
     this->_capacity = new_size;
     return this->_capacity;
 }
@@ -236,15 +233,11 @@ template <typename data_t> location_t InMemDataStore<data_t>::shrink(const locat
            << this->capacity() << ")" << std::endl;
         throw diskann::ANNException(ss.str(), -1);
     }
-#ifndef _WINDOWS
     data_t *new_data;
-    alloc_aligned((void **)&new_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
+    alloc_aligned_huge((void **)&new_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
     memcpy(new_data, _data, new_size * _aligned_dim * sizeof(data_t));
-    aligned_free(_data);
+    aligned_free_huge(_data);
     _data = new_data;
-#else
-    realloc_aligned((void **)&_data, new_size * _aligned_dim * sizeof(data_t), 8 * sizeof(data_t));
-#endif
     this->_capacity = new_size;
     return this->_capacity;
 }
@@ -365,5 +358,7 @@ template <typename data_t> Distance<data_t> *InMemDataStore<data_t>::get_dist_fn
 template DISKANN_DLLEXPORT class InMemDataStore<float>;
 template DISKANN_DLLEXPORT class InMemDataStore<int8_t>;
 template DISKANN_DLLEXPORT class InMemDataStore<uint8_t>;
+template DISKANN_DLLEXPORT class InMemDataStore<float16>;
+template DISKANN_DLLEXPORT class InMemDataStore<bfloat16>;
 
 } // namespace diskann
\ No newline at end of file
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <numeric>
 #include <type_traits>
 #include <omp.h>
 
@@ -8,6 +9,8 @@
 #include "tsl/robin_map.h"
 #include "boost/dynamic_bitset.hpp"
 
+#include "huge_page_allocator.h"
+#include "math_utils.h"
 #include "memory_mapper.h"
 #include "timer.h"
 #include "windows_customizations.h"
@@ -20,8 +23,6 @@
 #endif
 #include "index.h"
 
-#define MAX_POINTS_FOR_USING_BITSET 10000000
-
 namespace diskann
 {
 // Initialize an index with metric m, load the data of type T with filename
@@ -30,9 +31,10 @@ template <typename T, typename TagT, typename LabelT>
 Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_points, const bool dynamic_index,
                               const IndexWriteParameters &indexParams, const uint32_t initial_search_list_size,
                               const uint32_t search_threads, const bool enable_tags, const bool concurrent_consolidate,
-                              const bool pq_dist_build, const size_t num_pq_chunks, const bool use_opq)
+                              const bool pq_dist_build, const size_t num_pq_chunks, const bool use_opq,
+                              const uint32_t num_sq_bits)
     : Index(m, dim, max_points, dynamic_index, enable_tags, concurrent_consolidate, pq_dist_build, num_pq_chunks,
-            use_opq, indexParams.num_frozen_points)
+            use_opq, indexParams.num_frozen_points, num_sq_bits)
 {
     _indexingQueueSize = indexParams.search_list_size;
     _indexingRange = indexParams.max_degree;
@@ -50,10 +52,11 @@ Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_point
 template <typename T, typename TagT, typename LabelT>
 Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_points, const bool dynamic_index,
                               const bool enable_tags, const bool concurrent_consolidate, const bool pq_dist_build,
-                              const size_t num_pq_chunks, const bool use_opq, const size_t num_frozen_pts)
+                              const size_t num_pq_chunks, const bool use_opq, const size_t num_frozen_pts,
+                              const uint32_t num_sq_bits)
     : _dist_metric(m), _dim(dim), _max_points(max_points), _num_frozen_pts(num_frozen_pts),
-      _dynamic_index(dynamic_index), _enable_tags(enable_tags), _indexingMaxC(DEFAULT_MAXC), _query_scratch(nullptr),
-      _pq_dist(pq_dist_build), _use_opq(use_opq), _num_pq_chunks(num_pq_chunks),
+      _dynamic_index(dynamic_index), _enable_tags(enable_tags), _indexingMaxC(DEFAULT_MAXC),
+      _pq_dist(pq_dist_build), _use_opq(use_opq), _num_pq_chunks(num_pq_chunks), _num_sq_bits(num_sq_bits),
       _delete_set(new tsl::robin_set<uint32_t>), _conc_consolidate(concurrent_consolidate)
 {
     if (dynamic_index && !enable_tags)
@@ -74,6 +77,17 @@ Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_point
                                -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
+    if (_num_sq_bits != 0)
+    {
+        if (dynamic_index)
+            throw ANNException("ERROR: Dynamic Indexing not supported with scalar quantized data", -1, __FUNCSIG__,
+                               __FILE__, __LINE__);
+        if (_pq_dist)
+            throw ANNException("ERROR: PQ distance based index construction cannot be combined with scalar "
+                               "quantized data",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
     if (dynamic_index && _num_frozen_pts == 0)
     {
         _num_frozen_pts = 1;
@@ -90,7 +104,8 @@ Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_point
     {
         if (_num_pq_chunks > _dim)
             throw diskann::ANNException("ERROR: num_pq_chunks > dim", -1, __FUNCSIG__, __FILE__, __LINE__);
-        alloc_aligned(((void **)&_pq_data), total_internal_points * _num_pq_chunks * sizeof(char), 8 * sizeof(char));
+        alloc_aligned_huge(((void **)&_pq_data), total_internal_points * _num_pq_chunks * sizeof(char),
+                           8 * sizeof(char));
         std::memset(_pq_data, 0, total_internal_points * _num_pq_chunks * sizeof(char));
     }
 
@@ -108,14 +123,33 @@ Index<T, TagT, LabelT>::Index(Metric m, const size_t dim, const size_t max_point
                          "AVXNormalizedCosineDistanceFloat()."
                       << std::endl;
     }
+    else if (m == diskann::Metric::COSINE && is_half_float<T>::value)
+    {
+        // This is safe because T is float16 or bfloat16 inside the if block.
+        if (std::is_same<T, float16>::value)
+            this->_distance.reset((Distance<T> *)new DistanceNormalizedCosineHalf<float16>());
+        else
+            this->_distance.reset((Distance<T> *)new DistanceNormalizedCosineHalf<bfloat16>());
+        this->_normalize_vecs = true;
+        diskann::cout << "Normalizing vectors and using DistanceNormalizedCosineHalf for cosine." << std::endl;
+    }
     else
     {
         this->_distance.reset((Distance<T> *)get_distance_function<T>(m));
     }
     // REFACTOR: TODO This should move to a factory method.
 
-    _data_store =
-        std::make_unique<diskann::InMemDataStore<T>>((location_t)total_internal_points, _dim, this->_distance);
+    if (_num_sq_bits != 0)
+    {
+        _sq_data_store = new diskann::SQDataStore<T>((location_t)total_internal_points, _dim, this->_distance,
+                                                     _num_sq_bits);
+        _data_store.reset(_sq_data_store);
+    }
+    else
+    {
+        _data_store =
+            std::make_unique<diskann::InMemDataStore<T>>((location_t)total_internal_points, _dim, this->_distance);
+    }
 
     _locks = std::vector<non_recursive_mutex>(total_internal_points);
 
@@ -148,7 +182,12 @@ template <typename T, typename TagT, typename LabelT> Index<T, TagT, LabelT>::~I
 
     if (_opt_graph != nullptr)
     {
-        delete[] _opt_graph;
+        aligned_free_huge(_opt_graph);
+    }
+
+    if (_pq_data != nullptr)
+    {
+        aligned_free_huge(_pq_data);
     }
 
     if (!_query_scratch.empty())
@@ -238,10 +277,12 @@ template <typename T, typename TagT, typename LabelT> size_t Index<T, TagT, Labe
     // location limit.
     for (uint32_t i = 0; i < _nd + _num_frozen_pts; i++)
     {
-        uint32_t GK = (uint32_t)_final_graph[i].size();
+        const uint32_t *neighbors;
+        uint32_t GK;
+        get_neighbors(i, neighbors, GK);
         out.write((char *)&GK, sizeof(uint32_t));
-        out.write((char *)_final_graph[i].data(), GK * sizeof(uint32_t));
-        max_degree = _final_graph[i].size() > max_degree ? (uint32_t)_final_graph[i].size() : max_degree;
+        out.write((char *)neighbors, GK * sizeof(uint32_t));
+        max_degree = GK > max_degree ? GK : max_degree;
         index_size += (size_t)(sizeof(uint32_t) * (GK + 1));
     }
     out.seekp(file_offset, out.beg);
@@ -339,6 +380,8 @@ void Index<T, TagT, LabelT>::save(const char *filename, bool compact_before_save
         std::string tags_file = std::string(filename) + ".tags";
         std::string data_file = std::string(filename) + ".data";
         std::string delete_list_file = std::string(filename) + ".del";
+        std::string entry_points_file = std::string(filename) + ".entry_points";
+        std::string layout_file = std::string(filename) + ".layout";
 
         // Because the save_* functions use append mode, ensure that
         // the files are deleted before save. Ideally, we should check
@@ -352,6 +395,12 @@ void Index<T, TagT, LabelT>::save(const char *filename, bool compact_before_save
         save_tags(tags_file);
         delete_file(delete_list_file);
         save_delete_list(delete_list_file);
+        delete_file(entry_points_file);
+        if (_entry_points.size() > 0)
+            save_bin<uint32_t>(entry_points_file, _entry_points.data(), _entry_points.size(), 1);
+        delete_file(layout_file);
+        if (_opt_graph != nullptr)
+            save_optimized_layout(layout_file);
     }
     else
     {
@@ -516,6 +565,7 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
     _has_built = true;
 
     size_t tags_file_num_pts = 0, graph_num_pts = 0, data_file_num_pts = 0, label_num_pts = 0;
+    bool has_optimized_layout = false;
 
     std::string mem_index_file(filename);
     std::string labels_file = mem_index_file + "_labels.txt";
@@ -531,6 +581,8 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
         std::string tags_file = std::string(filename) + ".tags";
         std::string delete_set_file = std::string(filename) + ".del";
         std::string graph_file = std::string(filename);
+        std::string entry_points_file = std::string(filename) + ".entry_points";
+        std::string layout_file = std::string(filename) + ".layout";
         data_file_num_pts = load_data(data_file);
         if (file_exists(delete_set_file))
         {
@@ -540,7 +592,32 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
         {
             tags_file_num_pts = load_tags(tags_file);
         }
-        graph_num_pts = load_graph(graph_file, data_file_num_pts);
+        // A static index searches its saved layout as it is. A dynamic one needs
+        // the graph for updates anyway, and lays it out once loaded.
+        has_optimized_layout = file_exists(layout_file);
+        if (has_optimized_layout && !_dynamic_index)
+            graph_num_pts = load_optimized_layout(layout_file, data_file_num_pts);
+        else
+            graph_num_pts = load_graph(graph_file, data_file_num_pts);
+        if (file_exists(entry_points_file) && !_dynamic_index)
+        {
+            std::unique_ptr<uint32_t[]> entry_points;
+            size_t num_entry_points, entry_points_dim;
+            diskann::load_bin<uint32_t>(entry_points_file, entry_points, num_entry_points, entry_points_dim);
+            // the searches start from them, so a stale file must not slip by
+            const size_t num_points = data_file_num_pts - _num_frozen_pts;
+            if (entry_points_dim != 1 ||
+                std::any_of(entry_points.get(), entry_points.get() + num_entry_points,
+                            [num_points](const uint32_t id) { return id >= num_points; }))
+            {
+                std::stringstream stream;
+                stream << "ERROR: " << entry_points_file << " holds " << num_entry_points << "x" << entry_points_dim
+                       << " ids, expected one column of ids below " << num_points << std::endl;
+                diskann::cerr << stream.str() << std::endl;
+                throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+            }
+            _entry_points.assign(entry_points.get(), entry_points.get() + num_entry_points);
+        }
 #endif
     }
     else
@@ -616,6 +693,8 @@ void Index<T, TagT, LabelT>::load(const char *filename, uint32_t num_threads, ui
     }
 
     reposition_frozen_point_to_end();
+    if (has_optimized_layout && _dynamic_index)
+        optimize_index_layout();
     diskann::cout << "Num frozen points:" << _num_frozen_pts << " _nd: " << _nd << " _start: " << _start
                   << " size(_location_to_tag): " << _location_to_tag.size()
                   << " size(_tag_to_location):" << _tag_to_location.size() << " Max points: " << _max_points
@@ -822,9 +901,16 @@ template <typename T, typename TagT, typename LabelT> uint32_t Index<T, TagT, La
 template <typename T, typename TagT, typename LabelT> std::vector<uint32_t> Index<T, TagT, LabelT>::get_init_ids()
 {
     std::vector<uint32_t> init_ids;
-    init_ids.reserve(1 + _num_frozen_pts);
+    init_ids.reserve(1 + _entry_points.size() + _num_frozen_pts);
 
     init_ids.emplace_back(_start);
+    for (auto entry_point : _entry_points)
+    {
+        if (entry_point != _start)
+        {
+            init_ids.emplace_back(entry_point);
+        }
+    }
 
     for (uint32_t frozen = (uint32_t)_max_points; frozen < _max_points + _num_frozen_pts; frozen++)
     {
@@ -840,13 +926,14 @@ template <typename T, typename TagT, typename LabelT> std::vector<uint32_t> Inde
 template <typename T, typename TagT, typename LabelT>
 std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
     const T *query, const uint32_t Lsize, const std::vector<uint32_t> &init_ids, InMemQueryScratch<T> *scratch,
-    bool use_filter, const std::vector<LabelT> &filter_label, bool search_invocation)
+    bool use_filter, const std::vector<LabelT> &filter_label, bool search_invocation,
+    std::vector<Neighbor> *scored_nodes, QueryStats *stats)
 {
+    Timer query_timer;
     std::vector<Neighbor> &expanded_nodes = scratch->pool();
     NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
     best_L_nodes.reserve(Lsize);
-    tsl::robin_set<uint32_t> &inserted_into_pool_rs = scratch->inserted_into_pool_rs();
-    boost::dynamic_bitset<> &inserted_into_pool_bs = scratch->inserted_into_pool_bs();
+    VisitedSet &inserted_into_pool = scratch->inserted_into_pool();
     std::vector<uint32_t> &id_scratch = scratch->id_scratch();
     std::vector<float> &dist_scratch = scratch->dist_scratch();
     assert(id_scratch.size() == 0);
@@ -882,7 +969,7 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         pq_query_scratch->set(_dim, aligned_query);
 
         // center the query and rotate if we have a rotation matrix
-        _pq_table.preprocess_query(query_rotated);
+        _pq_table.preprocess_query(query_float, query_rotated);
         _pq_table.populate_chunk_distances(query_rotated, pq_dists);
 
         pq_coord_scratch = pq_query_scratch->aligned_pq_coord_scratch;
@@ -893,26 +980,7 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         throw ANNException("ERROR: Clear scratch space before passing.", -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
-    // Decide whether to use bitset or robin set to mark visited nodes
-    auto total_num_points = _max_points + _num_frozen_pts;
-    bool fast_iterate = total_num_points <= MAX_POINTS_FOR_USING_BITSET;
-
-    if (fast_iterate)
-    {
-        if (inserted_into_pool_bs.size() < total_num_points)
-        {
-            // hopefully using 2X will reduce the number of allocations.
-            auto resize_size =
-                2 * total_num_points > MAX_POINTS_FOR_USING_BITSET ? MAX_POINTS_FOR_USING_BITSET : 2 * total_num_points;
-            inserted_into_pool_bs.resize(resize_size);
-        }
-    }
-
-    // Lambda to determine if a node has been visited
-    auto is_not_visited = [this, fast_iterate, &inserted_into_pool_bs, &inserted_into_pool_rs](const uint32_t id) {
-        return fast_iterate ? inserted_into_pool_bs[id] == 0
-                            : inserted_into_pool_rs.find(id) == inserted_into_pool_rs.end();
-    };
+    inserted_into_pool.resize(_max_points + _num_frozen_pts);
 
     // Lambda to batch compute query<-> node distances in PQ space
     auto compute_dists = [this, pq_coord_scratch, pq_dists](const std::vector<uint32_t> &ids,
@@ -921,6 +989,20 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         diskann::pq_dist_lookup(pq_coord_scratch, ids.size(), this->_num_pq_chunks, pq_dists, dists_out);
     };
 
+    // Lambdas to compute and prefetch from the optimized layout when it holds
+    // the vectors, else from the data store
+    const bool use_opt_vectors = _opt_graph != nullptr && _data_len > 0;
+    auto get_distance = [this, aligned_query, use_opt_vectors](const uint32_t id) {
+        return use_opt_vectors ? get_optimized_layout_distance(aligned_query, id)
+                               : _data_store->get_distance(aligned_query, id);
+    };
+    auto prefetch_vector = [this, use_opt_vectors](const uint32_t id) {
+        if (use_opt_vectors)
+            diskann::prefetch_vector(_opt_graph + _node_size * id, ROUND_UP(_data_len, 64));
+        else
+            _data_store->prefetch_vector(id);
+    };
+
     // Initialize the candidate pool with starting points
     for (auto id : init_ids)
     {
@@ -948,17 +1030,8 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
                 continue;
         }
 
-        if (is_not_visited(id))
+        if (inserted_into_pool.insert(id))
         {
-            if (fast_iterate)
-            {
-                inserted_into_pool_bs[id] = 1;
-            }
-            else
-            {
-                inserted_into_pool_rs.insert(id);
-            }
-
             float distance;
             if (_pq_dist)
             {
@@ -966,10 +1039,12 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
             }
             else
             {
-                distance = _data_store->get_distance(aligned_query, id);
+                distance = get_distance(id);
             }
             Neighbor nn = Neighbor(id, distance);
             best_L_nodes.insert(nn);
+            if (scored_nodes != nullptr)
+                scored_nodes->emplace_back(nn);
         }
     }
 
@@ -980,9 +1055,41 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
     {
         auto nbr = best_L_nodes.closest_unexpanded();
         auto n = nbr.id;
+        hops++;
 
-        // Add node to expanded nodes to create pool for prune later
-        if (!search_invocation)
+        HopTrace *hop = nullptr;
+        if (stats != nullptr && stats->hops != nullptr)
+        {
+            stats->hops->emplace_back();
+            hop = &stats->hops->back();
+            hop->start_us = (float)query_timer.elapsed();
+        }
+
+        // Likely the next node to expand. The rows of a dynamic index can be
+        // reallocated by inserts, so only those of a static one, or the slots
+        // of the optimized layout, are prefetched.
+        if (_prefetch_distance > 0 && (!_dynamic_index || _opt_graph != nullptr) && best_L_nodes.has_unexpanded_node())
+        {
+            const uint32_t next = best_L_nodes.peek_closest_unexpanded().id;
+            if (_opt_graph != nullptr)
+            {
+                diskann::prefetch_vector(_opt_graph + _node_size * next + _data_len, ROUND_UP(_neighbor_len, 64));
+            }
+            else
+            {
+                const std::vector<uint32_t> &next_nbrs = _final_graph[next];
+                diskann::prefetch_vector((const char *)next_nbrs.data(),
+                                         ROUND_UP(next_nbrs.size() * sizeof(uint32_t), 64));
+            }
+        }
+
+        // Add node to expanded nodes to create pool for prune later, or for
+        // a resumed search not to expand it again
+        if (scored_nodes != nullptr)
+        {
+            expanded_nodes.emplace_back(nbr);
+        }
+        else if (!search_invocation)
         {
             if (!use_filter)
             {
@@ -1005,8 +1112,12 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
         {
             if (_dynamic_index)
                 _locks[n].lock();
-            for (auto id : _final_graph[n])
+            const uint32_t *neighbors;
+            uint32_t num_neighbors;
+            get_neighbors(n, neighbors, num_neighbors);
+            for (uint32_t i = 0; i < num_neighbors; i++)
             {
+                const uint32_t id = neighbors[i];
                 assert(id < _max_points + _num_frozen_pts);
 
                 if (use_filter)
@@ -1025,32 +1136,34 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
                     }
 
                     if (common_filters.size() == 0)
+                    {
+                        if (stats != nullptr)
+                            stats->n_filter_rejects++;
                         continue;
+                    }
                 }
 
-                if (is_not_visited(id))
+                // marks the node visited
+                if (inserted_into_pool.insert(id))
                 {
+                    // the PQ codes are gathered right after this loop, the
+                    // first vectors are compared right after
+                    if (_pq_dist && _prefetch_distance > 0)
+                        _mm_prefetch((const char *)_pq_data + (size_t)id * _num_pq_chunks, _MM_HINT_T0);
+                    else if (!_pq_dist && id_scratch.size() < _prefetch_distance)
+                        prefetch_vector(id);
                     id_scratch.push_back(id);
                 }
+                else if (stats != nullptr)
+                {
+                    stats->n_cmps_saved++;
+                }
             }
 
             if (_dynamic_index)
                 _locks[n].unlock();
         }
 
-        // Mark nodes visited
-        for (auto id : id_scratch)
-        {
-            if (fast_iterate)
-            {
-                inserted_into_pool_bs[id] = 1;
-            }
-            else
-            {
-                inserted_into_pool_rs.insert(id);
-            }
-        }
-
         // Compute distances to unvisited nodes in the expansion
         if (_pq_dist)
         {
@@ -1064,22 +1177,34 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::iterate_to_fixed_point(
             {
                 uint32_t id = id_scratch[m];
 
-                if (m + 1 < id_scratch.size())
+                if (_prefetch_distance > 0 && m + _prefetch_distance < id_scratch.size())
                 {
-                    auto nextn = id_scratch[m + 1];
-                    _data_store->prefetch_vector(nextn);
+                    prefetch_vector(id_scratch[m + _prefetch_distance]);
                 }
 
-                dist_scratch.push_back(_data_store->get_distance(aligned_query, id));
+                dist_scratch.push_back(get_distance(id));
             }
         }
         cmps += (uint32_t)id_scratch.size();
+        if (stats != nullptr)
+        {
+            stats->n_hops++;
+            stats->n_cmps += (uint32_t)id_scratch.size();
+            (_pq_dist ? stats->n_pq_cmps : stats->n_full_cmps) += (uint32_t)id_scratch.size();
+        }
+        if (hop != nullptr)
+            (_pq_dist ? hop->n_pq_cmps : hop->n_full_cmps) = (uint32_t)id_scratch.size();
 
         // Insert <id, dist> pairs into the pool of candidates
         for (size_t m = 0; m < id_scratch.size(); ++m)
         {
             best_L_nodes.insert(Neighbor(id_scratch[m], dist_scratch[m]));
         }
+        if (scored_nodes != nullptr)
+        {
+            for (size_t m = 0; m < id_scratch.size(); ++m)
+                scored_nodes->emplace_back(id_scratch[m], dist_scratch[m]);
+        }
     }
     return std::make_pair(hops, cmps);
 }
@@ -1152,6 +1277,24 @@ void Index<T, TagT, LabelT>::occlude_list(const uint32_t location, std::vector<N
     // Initialize occlude_factor to pool.size() many 0.0f values for correctness
     occlude_factor.insert(occlude_factor.end(), pool.size(), 0.0f);
 
+    // Gather the candidates once so that the pairwise distances below read
+    // them sequentially. Each pool vector is needed by the first selected
+    // candidate anyway, so this costs no extra random accesses. The scalar
+    // quantized store computes pair distances on its codes, so it keeps
+    // going through the data store.
+    const size_t aligned_dim = _data_store->get_aligned_dim();
+    T *tile = nullptr;
+    if (_sq_data_store == nullptr)
+    {
+        tile = scratch->occlude_tile(pool.size());
+        for (size_t i = 0; i < pool.size(); i++)
+        {
+            if (i + 4 < pool.size())
+                _data_store->prefetch_vector(pool[i + 4].id);
+            _data_store->get_vector(pool[i].id, tile + i * aligned_dim);
+        }
+    }
+
     float cur_alpha = 1;
     while (cur_alpha <= alpha && result.size() < degree)
     {
@@ -1202,7 +1345,10 @@ void Index<T, TagT, LabelT>::occlude_list(const uint32_t location, std::vector<N
                 if (!prune_allowed)
                     continue;
 
-                float djk = _data_store->get_distance(iter2->id, iter->id);
+                float djk = tile != nullptr
+                                ? _distance->compare(tile + t * aligned_dim, tile + (iter - pool.begin()) * aligned_dim,
+                                                     (uint32_t)aligned_dim)
+                                : _data_store->get_distance(iter2->id, iter->id);
                 if (_dist_metric == diskann::Metric::L2 || _dist_metric == diskann::Metric::COSINE)
                 {
                     occlude_factor[t] = (djk == 0) ? std::numeric_limits<float>::max()
@@ -1296,6 +1442,7 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
                 if (des_pool.size() < (uint64_t)(GRAPH_SLACK_FACTOR * range))
                 {
                     des_pool.emplace_back(n);
+                    update_optimized_layout_neighbors(des);
                     prune_needed = false;
                 }
                 else
@@ -1332,6 +1479,7 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
                 LockGuard guard(_locks[des]);
 
                 _final_graph[des] = new_out_neighbors;
+                update_optimized_layout_neighbors(des);
             }
         }
     }
@@ -1343,6 +1491,155 @@ void Index<T, TagT, LabelT>::inter_insert(uint32_t n, std::vector<uint32_t> &pru
     inter_insert(n, pruned_list, _indexingRange, scratch);
 }
 
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::batch_inter_insert(
+    const std::vector<uint32_t> &visit_order, const size_t begin, const size_t end,
+    std::vector<std::vector<std::vector<std::pair<uint32_t, uint32_t>>>> &edge_buckets)
+{
+    const size_t num_buckets = edge_buckets[0].size();
+    const size_t bucket_width = DIV_ROUND_UP(_max_points + _num_frozen_pts, num_buckets);
+
+    // Scatter the edges (des, n) by range of des into per-thread buffers.
+#pragma omp parallel
+    {
+        auto &local_buckets = edge_buckets[omp_get_thread_num()];
+#pragma omp for schedule(dynamic, 256)
+        for (int64_t node_ctr = (int64_t)begin; node_ctr < (int64_t)end; node_ctr++)
+        {
+            const uint32_t n = visit_order[node_ctr];
+            for (const uint32_t des : _final_graph[n])
+                local_buckets[des / bucket_width].emplace_back(des, n);
+        }
+    }
+
+    // Every neighbor list belongs to exactly one bucket, so the buckets can be
+    // merged concurrently without taking _locks.
+    const uint32_t slack_range = (uint32_t)(GRAPH_SLACK_FACTOR * _indexingRange);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t bucket = 0; bucket < (int64_t)num_buckets; bucket++)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (auto &local_buckets : edge_buckets)
+        {
+            edges.insert(edges.end(), local_buckets[bucket].begin(), local_buckets[bucket].end());
+            local_buckets[bucket].clear();
+        }
+        if (edges.empty())
+            continue;
+        // the merged lists must not depend on which thread buffered an edge
+        std::sort(edges.begin(), edges.end());
+
+        ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+        auto scratch = manager.scratch_space();
+
+        for (size_t i = 0; i < edges.size();)
+        {
+            const uint32_t des = edges[i].first;
+            auto &des_pool = _final_graph[des];
+            const auto old_end = (int64_t)des_pool.size();
+            for (; i < edges.size() && edges[i].first == des; i++)
+            {
+                const uint32_t n = edges[i].second;
+                if (std::find(des_pool.begin(), des_pool.begin() + old_end, n) == des_pool.begin() + old_end)
+                    des_pool.emplace_back(n);
+            }
+
+            if (des_pool.size() <= slack_range)
+                continue;
+
+            tsl::robin_set<uint32_t> dummy_visited(0);
+            std::vector<Neighbor> dummy_pool(0);
+            dummy_visited.reserve(des_pool.size());
+            dummy_pool.reserve(des_pool.size());
+            for (auto cur_nbr : des_pool)
+            {
+                if (dummy_visited.find(cur_nbr) == dummy_visited.end() && cur_nbr != des)
+                {
+                    float dist = _data_store->get_distance(des, cur_nbr);
+                    dummy_pool.emplace_back(Neighbor(cur_nbr, dist));
+                    dummy_visited.insert(cur_nbr);
+                }
+            }
+            std::vector<uint32_t> new_out_neighbors;
+            prune_neighbors(des, dummy_pool, new_out_neighbors, scratch);
+            des_pool = new_out_neighbors;
+        }
+    }
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::link_in_batches(const std::vector<uint32_t> &visit_order, const uint32_t batch_size,
+                                             const bool frozen_snapshot)
+{
+    const size_t num_threads = omp_get_max_threads();
+    // Several buckets per thread so that ranges of ids holding many hubs do
+    // not leave the other threads idle.
+    const size_t num_buckets = std::max((size_t)1, std::min(num_threads * 64, _max_points + _num_frozen_pts));
+    std::vector<std::vector<std::vector<std::pair<uint32_t, uint32_t>>>> edge_buckets(
+        num_threads, std::vector<std::vector<std::pair<uint32_t, uint32_t>>>(num_buckets));
+    std::vector<std::vector<uint32_t>> round_out_neighbors;
+
+    size_t num_rounds = 0;
+    for (size_t begin = 0; begin < visit_order.size(); num_rounds++)
+    {
+        // Points of a round only see each other's reverse edges once the round
+        // is merged, so rounds start at a single point and double up to
+        // batch_size while the graph is still small.
+        const size_t round_size = std::min((size_t)batch_size, std::max(begin, (size_t)1));
+        const size_t end = std::min(visit_order.size(), begin + round_size);
+        if (frozen_snapshot)
+            round_out_neighbors.resize(end - begin);
+
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int64_t node_ctr = (int64_t)begin; node_ctr < (int64_t)end; node_ctr++)
+        {
+            auto node = visit_order[node_ctr];
+
+            ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+            auto scratch = manager.scratch_space();
+
+            std::vector<uint32_t> pruned_list;
+            if (_filtered_index)
+            {
+                search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch, _filtered_index,
+                                           _filterIndexingQueueSize);
+            }
+            else
+            {
+                search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch);
+            }
+            assert(pruned_list.size() <= _indexingRange);
+            if (frozen_snapshot)
+            {
+                round_out_neighbors[node_ctr - begin].swap(pruned_list);
+            }
+            else
+            {
+                LockGuard guard(_locks[node]);
+                _final_graph[node] = pruned_list;
+            }
+        }
+
+        if (frozen_snapshot)
+        {
+#pragma omp parallel for schedule(static, 2048)
+            for (int64_t node_ctr = (int64_t)begin; node_ctr < (int64_t)end; node_ctr++)
+                _final_graph[visit_order[node_ctr]].swap(round_out_neighbors[node_ctr - begin]);
+        }
+
+        batch_inter_insert(visit_order, begin, end, edge_buckets);
+
+        if (begin / 100000 != end / 100000)
+        {
+            diskann::cout << "\r" << (100.0 * end) / (visit_order.size()) << "% of index build completed."
+                          << std::flush;
+        }
+        begin = end;
+    }
+    diskann::cout << std::endl << "Linked " << visit_order.size() << " points in " << num_rounds << " rounds."
+                  << std::endl;
+}
+
 template <typename T, typename TagT, typename LabelT>
 void Index<T, TagT, LabelT>::link(const IndexWriteParameters &parameters)
 {
@@ -1387,37 +1684,52 @@ void Index<T, TagT, LabelT>::link(const IndexWriteParameters &parameters)
 
     diskann::Timer link_timer;
 
-#pragma omp parallel for schedule(dynamic, 2048)
-    for (int64_t node_ctr = 0; node_ctr < (int64_t)(visit_order.size()); node_ctr++)
+    if (parameters.deterministic_build)
     {
-        auto node = visit_order[node_ctr];
+        const uint32_t batch_size =
+            parameters.insert_batch_size > 0
+                ? parameters.insert_batch_size
+                : std::max(1u, (uint32_t)(defaults::MAX_BATCH_FRACTION * visit_order.size()));
+        link_in_batches(visit_order, batch_size, true);
+    }
+    else if (parameters.insert_batch_size > 0)
+    {
+        link_in_batches(visit_order, parameters.insert_batch_size, false);
+    }
+    else
+    {
+#pragma omp parallel for schedule(dynamic, 2048)
+        for (int64_t node_ctr = 0; node_ctr < (int64_t)(visit_order.size()); node_ctr++)
+        {
+            auto node = visit_order[node_ctr];
 
-        ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
-        auto scratch = manager.scratch_space();
+            ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+            auto scratch = manager.scratch_space();
 
-        std::vector<uint32_t> pruned_list;
-        if (_filtered_index)
-        {
-            search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch, _filtered_index,
-                                       _filterIndexingQueueSize);
-        }
-        else
-        {
-            search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch);
-        }
-        {
-            LockGuard guard(_locks[node]);
-            _final_graph[node].reserve((size_t)(_indexingRange * GRAPH_SLACK_FACTOR * 1.05));
-            _final_graph[node] = pruned_list;
-            assert(_final_graph[node].size() <= _indexingRange);
-        }
+            std::vector<uint32_t> pruned_list;
+            if (_filtered_index)
+            {
+                search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch, _filtered_index,
+                                           _filterIndexingQueueSize);
+            }
+            else
+            {
+                search_for_point_and_prune(node, _indexingQueueSize, pruned_list, scratch);
+            }
+            {
+                LockGuard guard(_locks[node]);
+                _final_graph[node].reserve((size_t)(_indexingRange * GRAPH_SLACK_FACTOR * 1.05));
+                _final_graph[node] = pruned_list;
+                assert(_final_graph[node].size() <= _indexingRange);
+            }
 
-        inter_insert(node, pruned_list, scratch);
+            inter_insert(node, pruned_list, scratch);
 
-        if (node_ctr % 100000 == 0)
-        {
-            diskann::cout << "\r" << (100.0 * node_ctr) / (visit_order.size()) << "% of index build completed."
-                          << std::flush;
+            if (node_ctr % 100000 == 0)
+            {
+                diskann::cout << "\r" << (100.0 * node_ctr) / (visit_order.size()) << "% of index build completed."
+                              << std::flush;
+            }
         }
     }
 
@@ -1543,6 +1855,7 @@ void Index<T, TagT, LabelT>::set_start_points(const T *data, size_t data_count)
     for (location_t i = 0; i < _num_frozen_pts; i++)
     {
         _data_store->set_vector((location_t)(i + _max_points), data + i * _dim);
+        update_optimized_layout_vector((uint32_t)(i + _max_points));
     }
     _has_built = true;
     diskann::cout << "Index start points set: #" << _num_frozen_pts << std::endl;
@@ -1700,7 +2013,10 @@ void Index<T, TagT, LabelT>::build(const char *filename, const size_t num_points
                << "index can support only " << _max_points << " points as specified in constructor." << std::endl;
 
         if (_pq_dist)
-            aligned_free(_pq_data);
+        {
+            aligned_free_huge(_pq_data);
+            _pq_data = nullptr;
+        }
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
@@ -1711,7 +2027,10 @@ void Index<T, TagT, LabelT>::build(const char *filename, const size_t num_points
                << file_num_points << " points." << std::endl;
 
         if (_pq_dist)
-            aligned_free(_pq_data);
+        {
+            aligned_free_huge(_pq_data);
+            _pq_data = nullptr;
+        }
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
@@ -1723,7 +2042,10 @@ void Index<T, TagT, LabelT>::build(const char *filename, const size_t num_points
         diskann::cerr << stream.str() << std::endl;
 
         if (_pq_dist)
-            aligned_free(_pq_data);
+        {
+            aligned_free_huge(_pq_data);
+            _pq_data = nullptr;
+        }
         throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
@@ -1752,6 +2074,11 @@ void Index<T, TagT, LabelT>::build(const char *filename, const size_t num_points
     _data_store->populate_data(filename, 0U);
     diskann::cout << "Using only first " << num_points_to_load << " from file.. " << std::endl;
 
+    // The source file is the full precision copy of the quantized data, so
+    // searches on the freshly built index can re-rank against it.
+    if (_sq_data_store != nullptr)
+        _sq_data_store->set_full_precision_data(filename);
+
     {
         std::unique_lock<std::shared_timed_mutex> tl(_tag_lock);
         _nd = num_points_to_load;
@@ -1969,14 +2296,17 @@ void Index<T, TagT, LabelT>::build_filtered_index(const char *filename, const st
 template <typename T, typename TagT, typename LabelT>
 template <typename IdType>
 std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search(const T *query, const size_t K, const uint32_t L,
-                                                             IdType *indices, float *distances)
+                                                             IdType *indices, float *distances, QueryStats *stats)
 {
     if (K > (uint64_t)L)
     {
         throw ANNException("Set L to a value of at least K", -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
+    Timer query_timer, lock_timer;
     ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
     auto scratch = manager.scratch_space();
 
     if (L > scratch->get_L())
@@ -1990,11 +2320,15 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search(const T *query, con
     const std::vector<LabelT> unused_filter_label;
     const std::vector<uint32_t> init_ids = get_init_ids();
 
+    lock_timer.reset();
     std::shared_lock<std::shared_timed_mutex> lock(_update_lock);
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
 
     _distance->preprocess_query(query, _data_store->get_dims(), scratch->aligned_query());
-    auto retval =
-        iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, false, unused_filter_label, true);
+    auto retval = iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, false, unused_filter_label,
+                                         true, nullptr, stats);
+    rerank_with_full_precision(scratch->aligned_query(), scratch, stats);
 
     NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
 
@@ -2023,9 +2357,117 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search(const T *query, con
     }
     if (pos < K)
     {
-        diskann::cerr << "Found fewer than K elements for query" << std::endl;
+        DISKANN_LOG_EVERY_MS(LogLevel::LL_Error, 1000, "Found fewer than K elements for query");
+    }
+
+    if (stats != nullptr)
+        stats->total_us = (float)query_timer.elapsed();
+    return retval;
+}
+
+template <typename T, typename TagT, typename LabelT>
+std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::range_search(const T *query, const float range,
+                                                                   const uint32_t min_L, const uint32_t max_L,
+                                                                   std::vector<uint32_t> &indices,
+                                                                   std::vector<float> &distances,
+                                                                   const size_t max_results)
+{
+    if (min_L == 0 || min_L > max_L)
+    {
+        throw ANNException("Set min_L to a value between 1 and max_L", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+    auto scratch = manager.scratch_space();
+    uint32_t L = min_L;
+    if (L > scratch->get_L())
+    {
+        scratch->resize_for_new_L(L);
+    }
+
+    // distances are negated inner products for INNER_PRODUCT
+    const float max_distance = _dist_metric == diskann::Metric::INNER_PRODUCT ? -range : range;
+    const std::vector<LabelT> unused_filter_label;
+    const std::vector<uint32_t> init_ids = get_init_ids();
+
+    std::shared_lock<std::shared_timed_mutex> lock(_update_lock);
+
+    _distance->preprocess_query(query, _data_store->get_dims(), scratch->aligned_query());
+    // every candidate scored so far, offered again when the list grows
+    std::vector<Neighbor> scored_nodes;
+    auto retval = iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, false, unused_filter_label,
+                                         true, &scored_nodes);
+    // nodes expanded so far, not to expand again when they are offered again
+    tsl::robin_set<uint32_t> &expanded_ids = scratch->expanded_nodes_set();
+    expanded_ids.clear();
+    auto collect_expanded = [&]() {
+        for (const Neighbor &nbr : scratch->pool())
+            expanded_ids.insert(nbr.id);
+        scratch->pool().clear();
+    };
+    collect_expanded();
+
+    NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
+    while (L < max_L)
+    {
+        size_t num_in_range = 0;
+        for (size_t i = 0; i < best_L_nodes.size(); i++)
+        {
+            if (best_L_nodes[i].distance <= max_distance)
+                num_in_range++;
+        }
+        // a list mostly within range may have cut results off
+        if (num_in_range < L / 2.0 || (max_results != 0 && num_in_range >= max_results + _num_frozen_pts))
+            break;
+
+        L = std::min(2 * L, max_L);
+        scratch->resize_for_new_L(L);
+        best_L_nodes.reserve(L);
+        for (const Neighbor &nbr : scored_nodes)
+        {
+            best_L_nodes.insert(nbr);
+        }
+        best_L_nodes.mark_expanded(expanded_ids);
+        scratch->id_scratch().clear();
+        scratch->dist_scratch().clear();
+        const std::vector<uint32_t> no_init_ids;
+        auto resumed = iterate_to_fixed_point(scratch->aligned_query(), L, no_init_ids, scratch, false,
+                                              unused_filter_label, true, &scored_nodes);
+        collect_expanded();
+        retval.first += resumed.first;
+        retval.second += resumed.second;
+    }
+
+    // the quantized distances of points within range may be slightly out of
+    // it, so candidates are only dropped on them past a slack when reranking
+    const bool rerank = _sq_data_store != nullptr && _sq_data_store->has_full_precision_data();
+    const float cutoff = rerank ? max_distance + std::abs(max_distance) * (RANGE_SEARCH_SQ_SLACK - 1) : max_distance;
+    std::vector<Neighbor> results;
+    for (const Neighbor &nbr : scored_nodes)
+    {
+        if (nbr.id >= _max_points || nbr.distance > cutoff)
+            continue;
+        const float distance =
+            rerank ? _sq_data_store->get_full_precision_distance(scratch->aligned_query(), nbr.id) : nbr.distance;
+        if (distance <= max_distance)
+            results.emplace_back(nbr.id, distance);
     }
+    std::sort(results.begin(), results.end());
+    if (max_results != 0 && results.size() > max_results)
+        results.resize(max_results);
 
+    indices.clear();
+    distances.clear();
+    for (const Neighbor &nbr : results)
+    {
+        indices.push_back(nbr.id);
+#ifdef EXEC_ENV_OLS
+        // DLVS expects negative distances
+        distances.push_back(nbr.distance);
+#else
+        distances.push_back(_dist_metric == diskann::Metric::INNER_PRODUCT ? -1 * nbr.distance : nbr.distance);
+#endif
+    }
     return retval;
 }
 
@@ -2033,14 +2475,18 @@ template <typename T, typename TagT, typename LabelT>
 template <typename IdType>
 std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search_with_filters(const T *query, const LabelT &filter_label,
                                                                           const size_t K, const uint32_t L,
-                                                                          IdType *indices, float *distances)
+                                                                          IdType *indices, float *distances,
+                                                                          QueryStats *stats)
 {
     if (K > (uint64_t)L)
     {
         throw ANNException("Set L to a value of at least K", -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
+    Timer query_timer, lock_timer;
     ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
     auto scratch = manager.scratch_space();
 
     if (L > scratch->get_L())
@@ -2054,7 +2500,10 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search_with_filters(const
     std::vector<LabelT> filter_vec;
     std::vector<uint32_t> init_ids = get_init_ids();
 
+    lock_timer.reset();
     std::shared_lock<std::shared_timed_mutex> lock(_update_lock);
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
 
     if (_label_to_medoid_id.find(filter_label) != _label_to_medoid_id.end())
     {
@@ -2072,7 +2521,9 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search_with_filters(const
     // T *aligned_query = scratch->aligned_query();
     // memcpy(aligned_query, query, _dim * sizeof(T));
     _distance->preprocess_query(query, _data_store->get_dims(), scratch->aligned_query());
-    auto retval = iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, true, filter_vec, true);
+    auto retval =
+        iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, true, filter_vec, true, nullptr, stats);
+    rerank_with_full_precision(scratch->aligned_query(), scratch, stats);
 
     auto best_L_nodes = scratch->best_l_nodes();
 
@@ -2101,12 +2552,146 @@ std::pair<uint32_t, uint32_t> Index<T, TagT, LabelT>::search_with_filters(const
     }
     if (pos < K)
     {
-        diskann::cerr << "Found fewer than K elements for query" << std::endl;
+        DISKANN_LOG_EVERY_MS(LogLevel::LL_Error, 1000, "Found fewer than K elements for query");
     }
 
+    if (stats != nullptr)
+        stats->total_us = (float)query_timer.elapsed();
     return retval;
 }
 
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::build_entry_points(const uint32_t num_entry_points, const uint32_t random_seed)
+{
+    if (_dynamic_index)
+    {
+        throw ANNException("Entry points are only supported for static indices, since deletes and compaction move "
+                           "points",
+                           -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (num_entry_points == 0 || num_entry_points > _nd)
+    {
+        throw ANNException("num_entry_points must be between 1 and the number of points", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+
+    std::unique_lock<std::shared_timed_mutex> ul(_update_lock);
+    diskann::Timer timer;
+
+    // k-means on a random sample of the points, whose vectors are as stored,
+    // i.e. normalized for cosine
+    const size_t sample_size = std::min(_nd, (size_t)num_entry_points * ENTRY_POINT_SAMPLES_PER_CENTER);
+    // Floyd's algorithm, which draws sample_size distinct points in
+    // O(sample_size) time and memory
+    std::mt19937 gen{random_seed};
+    tsl::robin_set<uint32_t> sampled;
+    for (size_t j = _nd - sample_size; j < _nd; j++)
+    {
+        const uint32_t id = (uint32_t)std::uniform_int_distribution<size_t>(0, j)(gen);
+        if (!sampled.insert(id).second)
+            sampled.insert((uint32_t)j);
+    }
+    std::vector<uint32_t> sample_ids(sampled.begin(), sampled.end());
+    std::sort(sample_ids.begin(), sample_ids.end());
+
+    std::vector<T> vec(_data_store->get_aligned_dim());
+    std::vector<float> sample_data(sample_size * _dim);
+    for (size_t i = 0; i < sample_size; i++)
+    {
+        _data_store->get_vector(sample_ids[i], vec.data());
+        for (size_t d = 0; d < _dim; d++)
+            sample_data[i * _dim + d] = (float)vec[d];
+    }
+
+    std::vector<float> centers(num_entry_points * _dim);
+    kmeans::kmeanspp_selecting_pivots(sample_data.data(), sample_size, _dim, centers.data(), num_entry_points,
+                                      random_seed);
+    // Lloyd's iterations as in kmeans::run_lloyds, which sums each cluster
+    // in the order its threads gather the points; summing in sample order
+    // instead gives the same centroids, and entry points, for a seed.
+    std::vector<uint32_t> closest_center(sample_size);
+    std::vector<double> center_sums(num_entry_points * _dim);
+    std::vector<size_t> center_sizes(num_entry_points);
+    for (uint32_t rep = 0; rep < ENTRY_POINT_KMEANS_REPS; rep++)
+    {
+        math_utils::compute_closest_centers(sample_data.data(), sample_size, _dim, centers.data(), num_entry_points,
+                                            1, closest_center.data());
+        std::fill(center_sums.begin(), center_sums.end(), 0.0);
+        std::fill(center_sizes.begin(), center_sizes.end(), 0);
+        for (size_t i = 0; i < sample_size; i++)
+        {
+            const uint32_t c = closest_center[i];
+            center_sizes[c]++;
+            for (size_t d = 0; d < _dim; d++)
+                center_sums[c * _dim + d] += sample_data[i * _dim + d];
+        }
+        for (size_t c = 0; c < num_entry_points; c++)
+        {
+            // an empty cluster keeps its centroid
+            if (center_sizes[c] == 0)
+                continue;
+            for (size_t d = 0; d < _dim; d++)
+                centers[c * _dim + d] = (float)(center_sums[c * _dim + d] / center_sizes[c]);
+        }
+    }
+
+    // the sampled point closest to each centroid
+    std::vector<uint32_t> closest_samples(num_entry_points);
+    math_utils::compute_closest_centers(centers.data(), num_entry_points, _dim, sample_data.data(), sample_size, 1,
+                                        closest_samples.data());
+
+    tsl::robin_set<uint32_t> entry_points;
+    for (auto sample : closest_samples)
+        entry_points.insert(sample_ids[sample]);
+    _entry_points.assign(entry_points.begin(), entry_points.end());
+    std::sort(_entry_points.begin(), _entry_points.end());
+
+    diskann::cout << "Picked " << _entry_points.size() << " entry points in " << timer.elapsed() / 1000000.0 << "s."
+                  << std::endl;
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::set_prefetch_distance(const uint32_t prefetch_distance)
+{
+    _prefetch_distance = prefetch_distance;
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::rerank_with_full_precision(const T *aligned_query, InMemQueryScratch<T> *scratch,
+                                                        QueryStats *stats)
+{
+    if (_sq_data_store == nullptr || !_sq_data_store->has_full_precision_data())
+        return;
+    if (stats != nullptr)
+        stats->n_full_cmps += (uint32_t)scratch->best_l_nodes().size();
+
+    NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
+    std::vector<Neighbor> &candidates = scratch->pool();
+    candidates.clear();
+    for (size_t i = 0; i < best_L_nodes.size(); ++i)
+    {
+        const uint32_t id = best_L_nodes[i].id;
+        candidates.emplace_back(id, _sq_data_store->get_full_precision_distance(aligned_query, id));
+    }
+
+    best_L_nodes.clear();
+    for (const Neighbor &nbr : candidates)
+    {
+        best_L_nodes.insert(nbr);
+    }
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::set_full_precision_data_for_reranking(const std::string &data_file)
+{
+    if (_sq_data_store == nullptr)
+    {
+        throw ANNException("ERROR: Re-ranking with full precision data requires an index with scalar quantized data",
+                           -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    _sq_data_store->set_full_precision_data(data_file);
+}
+
 template <typename T, typename TagT, typename LabelT>
 size_t Index<T, TagT, LabelT>::search_with_tags(const T *query, const uint64_t K, const uint32_t L, TagT *tags,
                                                 float *distances, std::vector<T *> &res_vectors)
@@ -2133,6 +2718,7 @@ size_t Index<T, TagT, LabelT>::search_with_tags(const T *query, const uint64_t K
 
     _distance->preprocess_query(query, _data_store->get_dims(), scratch->aligned_query());
     iterate_to_fixed_point(scratch->aligned_query(), L, init_ids, scratch, false, unused_filter_label, true);
+    rerank_with_full_precision(scratch->aligned_query(), scratch);
 
     NeighborPriorityQueue &best_L_nodes = scratch->best_l_nodes();
     assert(best_L_nodes.size() <= L);
@@ -2287,6 +2873,7 @@ inline void Index<T, TagT, LabelT>::process_delete(const tsl::robin_set<uint32_t
             _final_graph[loc].clear();
             for (auto &ngh : expanded_nodes_set)
                 _final_graph[loc].push_back(ngh);
+            update_optimized_layout_neighbors((uint32_t)loc);
         }
         else
         {
@@ -2302,6 +2889,7 @@ inline void Index<T, TagT, LabelT>::process_delete(const tsl::robin_set<uint32_t
                          &old_delete_set);
             std::unique_lock<non_recursive_mutex> adj_list_lock(_locks[loc]);
             _final_graph[loc] = occlude_list_output;
+            update_optimized_layout_neighbors((uint32_t)loc);
         }
     }
 }
@@ -2416,6 +3004,8 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
     {
         reposition_points((uint32_t)_max_points, (uint32_t)_nd, (uint32_t)_num_frozen_pts);
         _start = (uint32_t)_nd;
+        if (_opt_graph != nullptr)
+            populate_optimized_layout();
     }
 }
 
@@ -2530,6 +3120,8 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
         _empty_slots.insert((uint32_t)i);
     }
     _data_compacted = true;
+    if (_opt_graph != nullptr)
+        populate_optimized_layout();
     diskann::cout << "Time taken for compact_data: " << timer.elapsed() / 1000000. << "s." << std::endl;
 }
 
@@ -2603,6 +3195,11 @@ void Index<T, TagT, LabelT>::reposition_points(uint32_t old_location_start, uint
     {
         return;
     }
+    if (_opt_graph != nullptr && !_dynamic_index)
+    {
+        throw ANNException("Can not move the points of a static index with an optimized layout", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
 
     // Update pointers to the moved nodes. Note: the computation is correct even
     // when new_location_start < old_location_start given the C++ uint32_t
@@ -2673,6 +3270,8 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
 
     reposition_points((uint32_t)_nd, (uint32_t)_max_points, (uint32_t)_num_frozen_pts);
     _start = (uint32_t)_max_points;
+    if (_opt_graph != nullptr)
+        populate_optimized_layout();
 }
 
 template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::resize(size_t new_max_points)
@@ -2697,6 +3296,8 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
     {
         _empty_slots.insert((uint32_t)i);
     }
+    if (_opt_graph != nullptr)
+        populate_optimized_layout();
 
     auto stop = std::chrono::high_resolution_clock::now();
     diskann::cout << "Resizing took: " << std::chrono::duration<double>(stop - start).count() << "s" << std::endl;
@@ -2775,6 +3376,7 @@ int Index<T, TagT, LabelT>::insert_point(const T *point, const TagT tag)
     tl.unlock();
 
     _data_store->set_vector(location, point);
+    update_optimized_layout_vector(location);
 
     // Find and add appropriate graph edges
     ScratchStoreManager<InMemQueryScratch<T>> manager(_query_scratch);
@@ -2805,6 +3407,7 @@ int Index<T, TagT, LabelT>::insert_point(const T *point, const TagT tag)
             _final_graph[location].emplace_back(link);
         }
         assert(_final_graph[location].size() <= _indexingRange);
+        update_optimized_layout_neighbors(location);
 
         if (_conc_consolidate)
             tlock.unlock();
@@ -2928,8 +3531,12 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
             break;
         for (auto node : bfs_sets[l])
         {
-            for (auto nghbr : _final_graph[node])
+            const uint32_t *neighbors;
+            uint32_t num_neighbors;
+            get_neighbors(node, neighbors, num_neighbors);
+            for (uint32_t i = 0; i < num_neighbors; i++)
             {
+                const uint32_t nghbr = neighbors[i];
                 if (!visited.test(nghbr))
                 {
                     visited.set(nghbr);
@@ -2942,136 +3549,190 @@ template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT
     delete[] bfs_sets;
 }
 
-// REFACTOR: This should be an OptimizedDataStore class, dummy impl here for
-// compiling sake template <typename T, typename TagT, typename LabelT> void
-// Index<T, TagT, LabelT>::optimize_index_layout()
-//{ // use after build or load
-//}
-
-// REFACTOR: This should be an OptimizedDataStore class
 template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::optimize_index_layout()
 { // use after build or load
-    if (_dynamic_index)
+    if (_opt_graph != nullptr)
     {
-        throw diskann::ANNException("Optimize_index_layout not implemented for dyanmic indices", -1, __FUNCSIG__,
-                                    __FILE__, __LINE__);
+        diskann::cerr << "Warning! Index layout is already optimized" << std::endl;
+        return;
     }
 
-    float *cur_vec = new float[_data_store->get_aligned_dim()];
-    std::memset(cur_vec, 0, _data_store->get_aligned_dim() * sizeof(float));
-    _data_len = (_data_store->get_aligned_dim() + 1) * sizeof(float);
-    _neighbor_len = (_max_observed_degree + 1) * sizeof(uint32_t);
-    _node_size = _data_len + _neighbor_len;
-    _opt_graph = new char[_node_size * _nd];
-    DistanceFastL2<T> *dist_fast = (DistanceFastL2<T> *)_data_store->get_dist_fn();
-    for (uint32_t i = 0; i < _nd; i++)
-    {
-        char *cur_node_offset = _opt_graph + i * _node_size;
-        _data_store->get_vector(i, (T *)cur_vec);
-        float cur_norm = dist_fast->norm((T *)cur_vec, (uint32_t)_data_store->get_aligned_dim());
-        std::memcpy(cur_node_offset, &cur_norm, sizeof(float));
-        std::memcpy(cur_node_offset + sizeof(float), cur_vec, _data_len - sizeof(float));
+    // The adjacency list of a node of a dynamic index grows up to the slack
+    // degree before inter_insert prunes it.
+    uint32_t max_degree = _max_observed_degree;
+    if (_dynamic_index)
+        max_degree = std::max(max_degree, (uint32_t)std::ceil(GRAPH_SLACK_FACTOR * _indexingRange));
 
-        cur_node_offset += _data_len;
-        uint32_t k = (uint32_t)_final_graph[i].size();
-        std::memcpy(cur_node_offset, &k, sizeof(uint32_t));
-        std::memcpy(cur_node_offset + sizeof(uint32_t), _final_graph[i].data(), k * sizeof(uint32_t));
-        std::vector<uint32_t>().swap(_final_graph[i]);
+    _data_len = get_optimized_layout_data_len();
+    _neighbor_len = (max_degree + 1) * sizeof(uint32_t);
+    _node_size = ROUND_UP(_data_len + _neighbor_len, 64);
+    populate_optimized_layout();
+
+    if (!_dynamic_index)
+    {
+        for (size_t i = 0; i < _final_graph.size(); i++)
+            std::vector<uint32_t>().swap(_final_graph[i]);
+        _final_graph.clear();
+        _final_graph.shrink_to_fit();
     }
-    _final_graph.clear();
-    _final_graph.shrink_to_fit();
-    delete[] cur_vec;
 }
 
-//  REFACTOR: once optimized layout becomes its own Data+Graph store, we should
-//  just invoke regular search
-// template <typename T, typename TagT, typename LabelT>
-// void Index<T, TagT, LabelT>::search_with_optimized_layout(const T *query,
-// size_t K, size_t L, uint32_t *indices)
-//{
-//}
-
 template <typename T, typename TagT, typename LabelT>
-void Index<T, TagT, LabelT>::search_with_optimized_layout(const T *query, size_t K, size_t L, uint32_t *indices)
+size_t Index<T, TagT, LabelT>::get_optimized_layout_data_len() const
 {
-    DistanceFastL2<T> *dist_fast = (DistanceFastL2<T> *)_data_store->get_dist_fn();
+    // PQ and SQ distances are computed from the codes, so only the graph
+    // moves into the layout for them.
+    if (_pq_dist || _sq_data_store != nullptr)
+        return 0;
+    return _data_store->get_aligned_dim() * sizeof(T) + sizeof(float);
+}
 
-    NeighborPriorityQueue retset(L);
-    std::vector<uint32_t> init_ids(L);
+template <typename T, typename TagT, typename LabelT> void Index<T, TagT, LabelT>::populate_optimized_layout()
+{
+    if (_opt_graph != nullptr)
+        aligned_free_huge(_opt_graph);
 
-    boost::dynamic_bitset<> flags{_nd, 0};
-    uint32_t tmp_l = 0;
-    uint32_t *neighbors = (uint32_t *)(_opt_graph + _node_size * _start + _data_len);
-    uint32_t MaxM_ep = *neighbors;
-    neighbors++;
+    const size_t total_internal_points = _max_points + _num_frozen_pts;
+    alloc_aligned_huge((void **)&_opt_graph, _node_size * total_internal_points, 64);
+    std::memset(_opt_graph, 0, _node_size * total_internal_points);
 
-    for (; tmp_l < L && tmp_l < MaxM_ep; tmp_l++)
+    for (uint32_t i = 0; i < total_internal_points; i++)
     {
-        init_ids[tmp_l] = neighbors[tmp_l];
-        flags[init_ids[tmp_l]] = true;
+        update_optimized_layout_vector(i);
+        update_optimized_layout_neighbors(i);
     }
+}
 
-    while (tmp_l < L)
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::update_optimized_layout_vector(const uint32_t location)
+{
+    if (_opt_graph == nullptr || _data_len == 0)
+        return;
+
+    char *cur_node_offset = _opt_graph + _node_size * location;
+    _data_store->get_vector((location_t)location, (T *)cur_node_offset);
+    if (_dist_metric == diskann::Metric::FAST_L2)
     {
-        uint32_t id = rand() % _nd;
-        if (flags[id])
-            continue;
-        flags[id] = true;
-        init_ids[tmp_l] = id;
-        tmp_l++;
+        const size_t aligned_dim = _data_store->get_aligned_dim();
+        DistanceFastL2<T> *dist_fast = (DistanceFastL2<T> *)_distance.get();
+        float cur_norm = dist_fast->norm((T *)cur_node_offset, (uint32_t)aligned_dim);
+        std::memcpy(cur_node_offset + aligned_dim * sizeof(T), &cur_norm, sizeof(float));
     }
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::update_optimized_layout_neighbors(const uint32_t location)
+{
+    if (_opt_graph == nullptr)
+        return;
+
+    char *cur_node_offset = _opt_graph + _node_size * location + _data_len;
+    const std::vector<uint32_t> &neighbors = _final_graph[location];
+    const uint32_t max_degree = (uint32_t)(_neighbor_len / sizeof(uint32_t)) - 1;
+    assert(neighbors.size() <= max_degree);
+    uint32_t k = std::min((uint32_t)neighbors.size(), max_degree);
+    std::memcpy(cur_node_offset, &k, sizeof(uint32_t));
+    std::memcpy(cur_node_offset + sizeof(uint32_t), neighbors.data(), k * sizeof(uint32_t));
+}
+
+template <typename T, typename TagT, typename LabelT>
+size_t Index<T, TagT, LabelT>::save_optimized_layout(const std::string &layout_file)
+{
+    std::ofstream out;
+    open_file_to_write(out, layout_file);
+
+    const uint64_t num_slots = _nd + _num_frozen_pts;
+    const uint64_t header[] = {num_slots, _num_frozen_pts, _node_size, _data_len, _neighbor_len};
+    const uint32_t graph_header[] = {(uint32_t)_dist_metric, _start, _max_observed_degree};
+    out.write((char *)header, sizeof(header));
+    out.write((char *)graph_header, sizeof(graph_header));
+    out.write(_opt_graph, num_slots * _node_size);
+    out.close();
+    return sizeof(header) + sizeof(graph_header) + num_slots * _node_size;
+}
 
-    for (uint32_t i = 0; i < init_ids.size(); i++)
+template <typename T, typename TagT, typename LabelT>
+size_t Index<T, TagT, LabelT>::load_optimized_layout(const std::string &layout_file, size_t expected_num_points)
+{
+    std::ifstream in;
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+    in.open(layout_file, std::ios::binary);
+
+    uint64_t header[5];
+    uint32_t graph_header[3];
+    in.read((char *)header, sizeof(header));
+    in.read((char *)graph_header, sizeof(graph_header));
+    const uint64_t num_slots = header[0], file_frozen_pts = header[1], node_size = header[2], data_len = header[3],
+                   neighbor_len = header[4];
+
+    if (num_slots != expected_num_points || file_frozen_pts != _num_frozen_pts ||
+        data_len != get_optimized_layout_data_len() || graph_header[0] != (uint32_t)_dist_metric ||
+        neighbor_len < sizeof(uint32_t) || node_size != ROUND_UP(data_len + neighbor_len, 64))
     {
-        uint32_t id = init_ids[i];
-        if (id >= _nd)
-            continue;
-        _mm_prefetch(_opt_graph + _node_size * id, _MM_HINT_T0);
+        std::stringstream stream;
+        stream << "ERROR: Optimized layout " << layout_file << " has " << num_slots << " slots of " << node_size
+               << " bytes with " << data_len << " bytes of vector data, " << file_frozen_pts
+               << " frozen points and metric " << graph_header[0] << ", which do not match the index" << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
     }
-    L = 0;
-    for (uint32_t i = 0; i < init_ids.size(); i++)
+
+    _node_size = node_size;
+    _data_len = data_len;
+    _neighbor_len = neighbor_len;
+    _start = graph_header[1];
+    _max_observed_degree = graph_header[2];
+    _max_range_of_loaded_graph = _max_observed_degree;
+    if (_max_points < num_slots - _num_frozen_pts)
+        _max_points = num_slots - _num_frozen_pts;
+
+    const size_t total_internal_points = _max_points + _num_frozen_pts;
+    alloc_aligned_huge((void **)&_opt_graph, _node_size * total_internal_points, 64);
+    std::memset(_opt_graph, 0, _node_size * total_internal_points);
+    in.read(_opt_graph, num_slots * _node_size);
+
+    // the graph is only searched from the layout
+    std::vector<std::vector<uint32_t>>().swap(_final_graph);
+
+    diskann::cout << "Loaded the optimized layout " << layout_file << " of " << num_slots << " nodes, _start is set to "
+                  << _start << std::endl;
+    return num_slots;
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::search_with_optimized_layout(const T *query, size_t K, size_t L, uint32_t *indices)
+{
+    search(query, K, (uint32_t)L, indices);
+}
+
+template <typename T, typename TagT, typename LabelT>
+void Index<T, TagT, LabelT>::get_neighbors(const uint32_t location, const uint32_t *&neighbors,
+                                           uint32_t &num_neighbors) const
+{
+    if (_opt_graph != nullptr)
     {
-        uint32_t id = init_ids[i];
-        if (id >= _nd)
-            continue;
-        T *x = (T *)(_opt_graph + _node_size * id);
-        float norm_x = *x;
-        x++;
-        float dist = dist_fast->compare(x, query, norm_x, (uint32_t)_data_store->get_aligned_dim());
-        retset.insert(Neighbor(id, dist));
-        flags[id] = true;
-        L++;
+        neighbors = (const uint32_t *)(_opt_graph + _node_size * location + _data_len);
+        num_neighbors = *neighbors++;
     }
-
-    while (retset.has_unexpanded_node())
+    else
     {
-        auto nbr = retset.closest_unexpanded();
-        auto n = nbr.id;
-        _mm_prefetch(_opt_graph + _node_size * n + _data_len, _MM_HINT_T0);
-        neighbors = (uint32_t *)(_opt_graph + _node_size * n + _data_len);
-        uint32_t MaxM = *neighbors;
-        neighbors++;
-        for (uint32_t m = 0; m < MaxM; ++m)
-            _mm_prefetch(_opt_graph + _node_size * neighbors[m], _MM_HINT_T0);
-        for (uint32_t m = 0; m < MaxM; ++m)
-        {
-            uint32_t id = neighbors[m];
-            if (flags[id])
-                continue;
-            flags[id] = 1;
-            T *data = (T *)(_opt_graph + _node_size * id);
-            float norm = *data;
-            data++;
-            float dist = dist_fast->compare(query, data, norm, (uint32_t)_data_store->get_aligned_dim());
-            Neighbor nn(id, dist);
-            retset.insert(nn);
-        }
+        neighbors = _final_graph[location].data();
+        num_neighbors = (uint32_t)_final_graph[location].size();
     }
+}
 
-    for (size_t i = 0; i < K; i++)
+template <typename T, typename TagT, typename LabelT>
+float Index<T, TagT, LabelT>::get_optimized_layout_distance(const T *query, const uint32_t location) const
+{
+    const T *vec = (const T *)(_opt_graph + _node_size * location);
+    const uint32_t aligned_dim = (uint32_t)_data_store->get_aligned_dim();
+    if (_dist_metric == diskann::Metric::FAST_L2)
     {
-        indices[i] = retset[i].id;
+        float norm;
+        std::memcpy(&norm, vec + aligned_dim, sizeof(float));
+        return ((DistanceFastL2<T> *)_distance.get())->compare(query, vec, norm, aligned_dim);
     }
+    return _distance->compare(query, vec, aligned_dim);
 }
 
 /*  Internals of the library */
@@ -3081,155 +3742,251 @@ template <typename T, typename TagT, typename LabelT> const float Index<T, TagT,
 template DISKANN_DLLEXPORT class Index<float, int32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, int32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<float16, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, int32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<float, uint32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, uint32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<float16, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, uint32_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<float, int64_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, int64_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<float16, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, int64_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<float, uint64_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, uint64_t, uint32_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<float16, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, uint64_t, uint32_t>;
 // Label with short int 2 byte
 template DISKANN_DLLEXPORT class Index<float, int32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, int32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<float16, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, int32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<float, uint32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, uint32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<float16, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, uint32_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<float, int64_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, int64_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<float16, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, int64_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<float, uint64_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<int8_t, uint64_t, uint16_t>;
 template DISKANN_DLLEXPORT class Index<uint8_t, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<float16, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class Index<bfloat16, uint64_t, uint16_t>;
 
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint32_t>::search<uint64_t>(
-    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint32_t>::search<uint32_t>(
-    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint32_t>::search<uint64_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint32_t>::search<uint32_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint32_t>::search<uint64_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint32_t>::search<uint64_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint32_t>::search<uint64_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint32_t>::search<uint32_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint32_t>::search<uint32_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint32_t>::search<uint32_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 // TagT==uint32_t
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint32_t>::search<uint64_t>(
-    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint32_t>::search<uint32_t>(
-    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint32_t>::search<uint64_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint32_t>::search<uint32_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint32_t>::search<uint64_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint32_t>::search<uint64_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint32_t>::search<uint64_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint32_t>::search<uint32_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint32_t>::search<uint32_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint32_t>::search<uint32_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint32_t>::search_with_filters<
     uint64_t>(const float *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint32_t>::search_with_filters<
     uint32_t>(const float *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint32_t>::search_with_filters<
     uint64_t>(const uint8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint32_t>::search_with_filters<
     uint32_t>(const uint8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint32_t>::search_with_filters<
     uint64_t>(const int8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint32_t>::search_with_filters<
+    uint64_t>(const float16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint32_t>::search_with_filters<
+    uint64_t>(const bfloat16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint32_t>::search_with_filters<
     uint32_t>(const int8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint32_t>::search_with_filters<
+    uint32_t>(const float16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint32_t>::search_with_filters<
+    uint32_t>(const bfloat16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
 // TagT==uint32_t
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint32_t>::search_with_filters<
     uint64_t>(const float *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint32_t>::search_with_filters<
     uint32_t>(const float *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint32_t>::search_with_filters<
     uint64_t>(const uint8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint32_t>::search_with_filters<
     uint32_t>(const uint8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint32_t>::search_with_filters<
     uint64_t>(const int8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint32_t>::search_with_filters<
+    uint64_t>(const float16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint32_t>::search_with_filters<
+    uint64_t>(const bfloat16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint32_t>::search_with_filters<
     uint32_t>(const int8_t *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint32_t>::search_with_filters<
+    uint32_t>(const float16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint32_t>::search_with_filters<
+    uint32_t>(const bfloat16 *query, const uint32_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
 
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint16_t>::search<uint64_t>(
-    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint16_t>::search<uint32_t>(
-    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint16_t>::search<uint64_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint16_t>::search<uint32_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint16_t>::search<uint64_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint16_t>::search<uint64_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint16_t>::search<uint64_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint16_t>::search<uint32_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint16_t>::search<uint32_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint16_t>::search<uint32_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 // TagT==uint32_t
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint16_t>::search<uint64_t>(
-    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint16_t>::search<uint32_t>(
-    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const float *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint16_t>::search<uint64_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint16_t>::search<uint32_t>(
-    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const uint8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint16_t>::search<uint64_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint16_t>::search<uint64_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint16_t>::search<uint64_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint64_t *indices, float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint16_t>::search<uint32_t>(
-    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances);
+    const int8_t *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint16_t>::search<uint32_t>(
+    const float16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint16_t>::search<uint32_t>(
+    const bfloat16 *query, const size_t K, const uint32_t L, uint32_t *indices, float *distances, QueryStats *stats);
 
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint16_t>::search_with_filters<
     uint64_t>(const float *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint64_t, uint16_t>::search_with_filters<
     uint32_t>(const float *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint16_t>::search_with_filters<
     uint64_t>(const uint8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint64_t, uint16_t>::search_with_filters<
     uint32_t>(const uint8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint16_t>::search_with_filters<
     uint64_t>(const int8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint16_t>::search_with_filters<
+    uint64_t>(const float16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint16_t>::search_with_filters<
+    uint64_t>(const bfloat16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint64_t, uint16_t>::search_with_filters<
     uint32_t>(const int8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint64_t, uint16_t>::search_with_filters<
+    uint32_t>(const float16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint64_t, uint16_t>::search_with_filters<
+    uint32_t>(const bfloat16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
 // TagT==uint32_t
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint16_t>::search_with_filters<
     uint64_t>(const float *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float, uint32_t, uint16_t>::search_with_filters<
     uint32_t>(const float *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint16_t>::search_with_filters<
     uint64_t>(const uint8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<uint8_t, uint32_t, uint16_t>::search_with_filters<
     uint32_t>(const uint8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint16_t>::search_with_filters<
     uint64_t>(const int8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint16_t>::search_with_filters<
+    uint64_t>(const float16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint16_t>::search_with_filters<
+    uint64_t>(const bfloat16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint64_t *indices,
+              float *distances, QueryStats *stats);
 template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<int8_t, uint32_t, uint16_t>::search_with_filters<
     uint32_t>(const int8_t *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
-              float *distances);
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<float16, uint32_t, uint16_t>::search_with_filters<
+    uint32_t>(const float16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
+template DISKANN_DLLEXPORT std::pair<uint32_t, uint32_t> Index<bfloat16, uint32_t, uint16_t>::search_with_filters<
+    uint32_t>(const bfloat16 *query, const uint16_t &filter_label, const size_t K, const uint32_t L, uint32_t *indices,
+              float *distances, QueryStats *stats);
 
 } // namespace diskann
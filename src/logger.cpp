@@ -1,14 +1,287 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "logger_impl.h"
 #include "windows_customizations.h"
 
 namespace diskann
 {
+namespace
+{
+std::function<void(LogLevel, const char *)> g_logger;
+std::atomic<int> g_log_level((int)LogLevel::LL_Info);
+
+void write_message(const LogLevel level, const std::string &message)
+{
+    if (g_logger)
+    {
+        g_logger(level, message.c_str());
+        return;
+    }
+    FILE *fp = level == LogLevel::LL_Error ? stderr : stdout;
+    fwrite(message.data(), sizeof(char), message.size(), fp);
+    fflush(fp);
+}
+
+// Messages of one thread, from the thread to the writer thread. head is only
+// written by the thread and tail by the writer; the messages in [tail, head)
+// are waiting to be written.
+struct LogRing
+{
+    struct Slot
+    {
+        LogLevel level;
+        std::string message;
+    };
+
+    explicit LogRing(const size_t size) : slots(size), head(0), tail(0), in_use(true)
+    {
+    }
+
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    // cleared when the thread exits, so that a new thread can take the ring
+    std::atomic<bool> in_use;
+};
+
+class AsyncLogger
+{
+  public:
+    explicit AsyncLogger(const size_t ring_size)
+        : _ring_size(ring_size), _stopped(false), _sleeping(false), _writer(&AsyncLogger::run, this)
+    {
+    }
+
+    // Returns false once the logger is stopped, for the caller to write the
+    // message itself.
+    bool log(const LogLevel level, const std::string &message)
+    {
+        if (_stopped.load())
+            return false;
+        LogRing *ring = thread_ring();
+        if (ring == nullptr)
+            return false;
+        const uint64_t head = ring->head.load(std::memory_order_relaxed);
+        while (head - ring->tail.load(std::memory_order_acquire) >= _ring_size)
+        {
+            if (_stopped.load())
+                return false;
+            wake_writer();
+            std::this_thread::yield();
+        }
+        LogRing::Slot &slot = ring->slots[head % _ring_size];
+        slot.level = level;
+        slot.message = message;
+        ring->head.store(head + 1);
+        if (_sleeping.load())
+            wake_writer();
+        return true;
+    }
+
+    void flush()
+    {
+        std::vector<std::pair<LogRing *, uint64_t>> targets;
+        {
+            std::lock_guard<std::mutex> guard(_rings_lock);
+            for (auto &ring : _rings)
+                targets.emplace_back(ring.get(), ring->head.load(std::memory_order_acquire));
+        }
+        for (auto &target : targets)
+            wait_written(target.first, target.second);
+    }
+
+    // Writes the pending messages and stops the writer thread. The rings are
+    // not freed, as threads still running may hold them.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_wake_lock);
+            _stopped.store(true);
+        }
+        _wake.notify_one();
+        _writer.join();
+    }
+
+  private:
+    // Releases the ring of a thread when the thread exits, once its messages
+    // are written: the thread writes the ones it logs after that itself, and
+    // they must not get ahead of them.
+    struct RingOwner
+    {
+        AsyncLogger *logger = nullptr;
+        LogRing *ring = nullptr;
+        ~RingOwner()
+        {
+            if (ring != nullptr)
+            {
+                logger->wait_written(ring, ring->head.load(std::memory_order_relaxed));
+                ring->in_use.store(false, std::memory_order_release);
+            }
+            ring = nullptr;
+            ring_released() = true;
+        }
+    };
+
+    // Set once the RingOwner of the thread is destroyed. Being trivially
+    // destructible, it can still be read by the thread_local destructors that
+    // run after that one, like the one logging the leftover text of a thread.
+    static bool &ring_released()
+    {
+        thread_local bool released = false;
+        return released;
+    }
+
+    // The ring of the calling thread, or null once the thread has released it
+    // on exit, as a new thread may own it by then.
+    LogRing *thread_ring()
+    {
+        if (ring_released())
+            return nullptr;
+        thread_local RingOwner owner;
+        if (owner.ring == nullptr)
+        {
+            std::lock_guard<std::mutex> guard(_rings_lock);
+            for (auto &ring : _rings)
+            {
+                bool in_use = false;
+                if (ring->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                {
+                    owner.logger = this;
+                    owner.ring = ring.get();
+                    break;
+                }
+            }
+            if (owner.ring == nullptr)
+            {
+                _rings.emplace_back(new LogRing(_ring_size));
+                owner.logger = this;
+                owner.ring = _rings.back().get();
+            }
+        }
+        return owner.ring;
+    }
+
+    // waits until the messages of the ring before head are written
+    void wait_written(LogRing *ring, const uint64_t head)
+    {
+        if (ring->tail.load(std::memory_order_acquire) < head)
+            wake_writer();
+        while (ring->tail.load(std::memory_order_acquire) < head && !_stopped.load())
+            std::this_thread::yield();
+    }
+
+    // Taking _wake_lock makes sure the writer is either waiting or has not
+    // checked the rings yet, so the notification is not lost.
+    void wake_writer()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_wake_lock);
+        }
+        _wake.notify_one();
+    }
+
+    // writes the pending messages, returns whether there were any
+    bool drain()
+    {
+        std::vector<LogRing *> rings;
+        {
+            std::lock_guard<std::mutex> guard(_rings_lock);
+            for (auto &ring : _rings)
+                rings.push_back(ring.get());
+        }
+        bool wrote = false;
+        for (LogRing *ring : rings)
+        {
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (uint64_t pos = ring->tail.load(std::memory_order_relaxed); pos < head; pos++)
+            {
+                LogRing::Slot &slot = ring->slots[pos % _ring_size];
+                write_message(slot.level, slot.message);
+                ring->tail.store(pos + 1, std::memory_order_release);
+                wrote = true;
+            }
+        }
+        return wrote;
+    }
+
+    bool has_pending()
+    {
+        std::lock_guard<std::mutex> guard(_rings_lock);
+        for (auto &ring : _rings)
+        {
+            if (ring->tail.load() != ring->head.load())
+                return true;
+        }
+        return false;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            if (drain())
+                continue;
+            std::unique_lock<std::mutex> lock(_wake_lock);
+            if (_stopped.load())
+                break;
+            _sleeping.store(true);
+            if (!has_pending())
+                _wake.wait_for(lock, std::chrono::milliseconds(100));
+            _sleeping.store(false);
+        }
+        drain();
+    }
+
+    const size_t _ring_size;
+    std::atomic<bool> _stopped;
+    std::atomic<bool> _sleeping;
+
+    std::mutex _rings_lock;
+    std::vector<std::unique_ptr<LogRing>> _rings;
+
+    std::mutex _wake_lock;
+    std::condition_variable _wake;
+    std::thread _writer;
+};
+
+// never freed, as threads may log while the process exits
+std::atomic<AsyncLogger *> g_async_logger(nullptr);
+
+// writes the messages still pending when the process exits
+struct AsyncLoggerStopper
+{
+    ~AsyncLoggerStopper()
+    {
+        AsyncLogger *async_logger = g_async_logger.load();
+        if (async_logger != nullptr)
+            async_logger->stop();
+    }
+} g_async_logger_stopper;
+
+// The text of a thread not logged yet, per stream. Logged when the thread
+// exits, as the text of the main thread when the process exits.
+struct ThreadBuffers
+{
+    std::string text[2];
+    ~ThreadBuffers()
+    {
+        if (!text[0].empty())
+            log_message(LogLevel::LL_Info, text[0]);
+        if (!text[1].empty())
+            log_message(LogLevel::LL_Error, text[1]);
+    }
+};
+} // namespace
 
 DISKANN_DLLEXPORT ANNStreamBuf coutBuff(stdout);
 DISKANN_DLLEXPORT ANNStreamBuf cerrBuff(stderr);
@@ -16,14 +289,60 @@ DISKANN_DLLEXPORT ANNStreamBuf cerrBuff(stderr);
 DISKANN_DLLEXPORT std::basic_ostream<char> cout(&coutBuff);
 DISKANN_DLLEXPORT std::basic_ostream<char> cerr(&cerrBuff);
 
-#ifdef EXEC_ENV_OLS
-std::function<void(LogLevel, const char *)> g_logger;
-
 void SetCustomLogger(std::function<void(LogLevel, const char *)> logger)
 {
     g_logger = logger;
 }
-#endif
+
+void set_log_level(LogLevel level)
+{
+    g_log_level.store((int)level, std::memory_order_relaxed);
+}
+
+bool is_log_level_enabled(LogLevel level)
+{
+    return (int)level >= g_log_level.load(std::memory_order_relaxed);
+}
+
+void enable_async_logging(size_t ring_size)
+{
+    static std::mutex enable_lock;
+    std::lock_guard<std::mutex> guard(enable_lock);
+    if (g_async_logger.load() == nullptr)
+        g_async_logger.store(new AsyncLogger(ring_size == 0 ? 1 : ring_size));
+}
+
+void flush_logs()
+{
+    AsyncLogger *async_logger = g_async_logger.load();
+    if (async_logger != nullptr)
+        async_logger->flush();
+}
+
+void log_message(LogLevel level, const std::string &message)
+{
+    if (!is_log_level_enabled(level))
+        return;
+    AsyncLogger *async_logger = g_async_logger.load(std::memory_order_acquire);
+    if (async_logger != nullptr && async_logger->log(level, message))
+    {
+        if (level == LogLevel::LL_Error)
+            async_logger->flush();
+        return;
+    }
+    write_message(level, message);
+}
+
+bool is_log_rate_allowed(std::atomic<int64_t> &last_log_ms, int64_t interval_ms)
+{
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+    int64_t last = last_log_ms.load(std::memory_order_relaxed);
+    if (last != INT64_MIN && now - last < interval_ms)
+        return false;
+    return last_log_ms.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
 
 ANNStreamBuf::ANNStreamBuf(FILE *fp)
 {
@@ -37,39 +356,46 @@ ANNStreamBuf::ANNStreamBuf(FILE *fp)
     }
     _fp = fp;
     _logLevel = (_fp == stdout) ? LogLevel::LL_Info : LogLevel::LL_Error;
-#ifdef EXEC_ENV_OLS
-    _buf = new char[BUFFER_SIZE + 1]; // See comment in the header
-#else
-    _buf = new char[BUFFER_SIZE]; // See comment in the header
-#endif
-
-    std::memset(_buf, 0, (BUFFER_SIZE) * sizeof(char));
-    setp(_buf, _buf + BUFFER_SIZE - 1);
+    // no put area, see the comment in the header
+    setp(nullptr, nullptr);
 }
 
 ANNStreamBuf::~ANNStreamBuf()
 {
-    sync();
+    // the text of the threads is logged when they exit
     _fp = nullptr; // we'll not close because we can't.
-    delete[] _buf;
+}
+
+std::string &ANNStreamBuf::thread_buffer()
+{
+    thread_local ThreadBuffers buffers;
+    return buffers.text[_logLevel == LogLevel::LL_Error ? 1 : 0];
 }
 
 int ANNStreamBuf::overflow(int c)
 {
-    std::lock_guard<std::mutex> lock(_mutex);
     if (c != EOF)
     {
-        *pptr() = (char)c;
-        pbump(1);
+        std::string &buffer = thread_buffer();
+        buffer.push_back((char)c);
+        if (c == '\n')
+            flush(buffer, false);
     }
-    flush();
     return c;
 }
 
+std::streamsize ANNStreamBuf::xsputn(const char *s, std::streamsize n)
+{
+    std::string &buffer = thread_buffer();
+    buffer.append(s, (size_t)n);
+    if (std::memchr(s, '\n', (size_t)n) != nullptr)
+        flush(buffer, false);
+    return n;
+}
+
 int ANNStreamBuf::sync()
 {
-    std::lock_guard<std::mutex> lock(_mutex);
-    flush();
+    flush(thread_buffer(), true);
     return 0;
 }
 
@@ -78,26 +404,13 @@ int ANNStreamBuf::underflow()
     throw diskann::ANNException("Attempt to read on streambuf meant only for writing.", -1);
 }
 
-int ANNStreamBuf::flush()
-{
-    const int num = (int)(pptr() - pbase());
-    logImpl(pbase(), num);
-    pbump(-num);
-    return num;
-}
-void ANNStreamBuf::logImpl(char *str, int num)
+void ANNStreamBuf::flush(std::string &buffer, bool partial)
 {
-#ifdef EXEC_ENV_OLS
-    str[num] = '\0'; // Safe. See the c'tor.
-    // Invoke the OLS custom logging function.
-    if (g_logger)
-    {
-        g_logger(_logLevel, str);
-    }
-#else
-    fwrite(str, sizeof(char), num, _fp);
-    fflush(_fp);
-#endif
+    const size_t end = partial ? buffer.size() : buffer.rfind('\n') + 1;
+    if (end == 0)
+        return;
+    log_message(_logLevel, buffer.substr(0, end));
+    buffer.erase(0, end);
 }
 
 } // namespace diskann
@@ -357,13 +357,18 @@ float run_lloyds(float *data, size_t num_points, size_t dim, float *centers, con
 // float[num_centers*dim]
 // and select randomly num_centers points as pivots
 void selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers)
+{
+    std::random_device rd;
+    selecting_pivots(data, num_points, dim, pivot_data, num_centers, rd());
+}
+
+void selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers,
+                      const uint32_t random_seed)
 {
     //	pivot_data = new float[num_centers * dim];
 
     std::vector<size_t> picked;
-    std::random_device rd;
-    auto x = rd();
-    std::mt19937 generator(x);
+    std::mt19937 generator(random_seed);
     std::uniform_int_distribution<size_t> distribution(0, num_points - 1);
 
     size_t tmp_pivot;
@@ -378,6 +383,13 @@ void selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_d
 }
 
 void kmeanspp_selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers)
+{
+    std::random_device rd;
+    kmeanspp_selecting_pivots(data, num_points, dim, pivot_data, num_centers, rd());
+}
+
+void kmeanspp_selecting_pivots(float *data, size_t num_points, size_t dim, float *pivot_data, size_t num_centers,
+                               const uint32_t random_seed)
 {
     if (num_points > 1 << 23)
     {
@@ -386,14 +398,12 @@ void kmeanspp_selecting_pivots(float *data, size_t num_points, size_t dim, float
                          "8388608. Falling back to random pivot "
                          "selection."
                       << std::endl;
-        selecting_pivots(data, num_points, dim, pivot_data, num_centers);
+        selecting_pivots(data, num_points, dim, pivot_data, num_centers, random_seed);
         return;
     }
 
     std::vector<size_t> picked;
-    std::random_device rd;
-    auto x = rd();
-    std::mt19937 generator(x);
+    std::mt19937 generator(random_seed);
     std::uniform_real_distribution<> distribution(0, 1);
     std::uniform_int_distribution<size_t> int_dist(0, num_points - 1);
     size_t init_id = int_dist(generator);
@@ -0,0 +1,149 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _WINDOWS
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "logger.h"
+#include "numa_utils.h"
+
+namespace diskann
+{
+namespace
+{
+struct NumaTopology
+{
+    // dense node index -> CPUs, nodes without CPUs (memory only) are skipped
+    std::vector<std::vector<uint32_t>> node_cpus;
+    // CPU -> dense node index
+    std::vector<uint32_t> cpu_to_node;
+};
+
+#ifndef _WINDOWS
+// Parses sysfs lists such as "0-15,32-47".
+std::vector<uint32_t> parse_id_list(const std::string &list)
+{
+    std::vector<uint32_t> ids;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+        const size_t dash = range.find('-');
+        const uint32_t first = (uint32_t)std::stoul(range.substr(0, dash));
+        const uint32_t last = dash == std::string::npos ? first : (uint32_t)std::stoul(range.substr(dash + 1));
+        for (uint32_t id = first; id <= last; id++)
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+bool read_line(const std::string &path, std::string &line)
+{
+    std::ifstream reader(path);
+    return reader.is_open() && std::getline(reader, line);
+}
+#endif
+
+NumaTopology detect_topology()
+{
+    NumaTopology topology;
+#ifndef _WINDOWS
+    std::string online;
+    if (read_line("/sys/devices/system/node/online", online))
+    {
+        try
+        {
+            for (const uint32_t node : parse_id_list(online))
+            {
+                std::string cpulist;
+                if (!read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpulist))
+                    continue;
+                std::vector<uint32_t> cpus = parse_id_list(cpulist);
+                if (!cpus.empty())
+                    topology.node_cpus.push_back(cpus);
+            }
+        }
+        catch (const std::exception &)
+        {
+            diskann::cerr << "Could not parse the NUMA topology from sysfs, assuming a single node." << std::endl;
+            topology.node_cpus.clear();
+        }
+    }
+#endif
+
+    if (topology.node_cpus.empty())
+    {
+        std::vector<uint32_t> cpus;
+        for (uint32_t cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+            cpus.push_back(cpu);
+        topology.node_cpus.push_back(cpus);
+    }
+
+    for (uint32_t node = 0; node < topology.node_cpus.size(); node++)
+    {
+        for (const uint32_t cpu : topology.node_cpus[node])
+        {
+            if (cpu >= topology.cpu_to_node.size())
+                topology.cpu_to_node.resize(cpu + 1, 0);
+            topology.cpu_to_node[cpu] = node;
+        }
+    }
+    return topology;
+}
+
+const NumaTopology &get_topology()
+{
+    static const NumaTopology topology = detect_topology();
+    return topology;
+}
+} // namespace
+
+uint32_t get_num_numa_nodes()
+{
+    return (uint32_t)get_topology().node_cpus.size();
+}
+
+const std::vector<uint32_t> &get_numa_node_cpus(const uint32_t node)
+{
+    return get_topology().node_cpus[node % get_num_numa_nodes()];
+}
+
+uint32_t get_current_numa_node()
+{
+    const NumaTopology &topology = get_topology();
+    if (topology.node_cpus.size() == 1)
+        return 0;
+#ifndef _WINDOWS
+    const int cpu = sched_getcpu();
+    if (cpu >= 0 && (size_t)cpu < topology.cpu_to_node.size())
+        return topology.cpu_to_node[cpu];
+#endif
+    return 0;
+}
+
+bool pin_thread_to_numa_node(const uint32_t node)
+{
+#ifndef _WINDOWS
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const uint32_t cpu : get_numa_node_cpus(node))
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpu_set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
+} // namespace diskann
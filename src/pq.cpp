@@ -7,12 +7,22 @@
 #include "partition.h"
 #include "math_utils.h"
 #include "tsl/robin_map.h"
+#include "simd_utils.h"
 
 // block size for reading/processing large files and matrices in blocks
 #define BLOCK_SIZE 5000000
 
 namespace diskann
 {
+#if defined(USE_AVX2) && !defined(__AVX512F__)
+// mask selecting the first min(rem, 8) lanes for _mm256_maskload_ps
+static inline __m256i avx2_tail_mask(size_t rem)
+{
+    static const int32_t mask_table[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+    return _mm256_loadu_si256((const __m256i *)(mask_table + 8 - (rem >= 8 ? 8 : rem)));
+}
+#endif
+
 FixedChunkPQTable::FixedChunkPQTable()
 {
 }
@@ -23,7 +33,7 @@ FixedChunkPQTable::~FixedChunkPQTable()
     if (tables != nullptr)
         delete[] tables;
     if (tables_tr != nullptr)
-        delete[] tables_tr;
+        diskann::aligned_free(tables_tr);
     if (chunk_offsets != nullptr)
         delete[] chunk_offsets;
     if (centroid != nullptr)
@@ -148,8 +158,9 @@ void FixedChunkPQTable::load_pq_centroid_bin(const char *pq_table_file, size_t n
         use_rotation = true;
     }
 
-    // alloc and compute transpose
-    tables_tr = new float[256 * this->ndims];
+    // alloc and compute transpose; aligned so that the SIMD table builders can
+    // use aligned loads on every 256-entry column
+    diskann::alloc_aligned((void **)&tables_tr, 256 * this->ndims * sizeof(float), 64);
     for (size_t i = 0; i < 256; i++)
     {
         for (size_t j = 0; j < this->ndims; j++)
@@ -164,49 +175,154 @@ uint32_t FixedChunkPQTable::get_num_chunks()
     return static_cast<uint32_t>(n_chunks);
 }
 
-void FixedChunkPQTable::preprocess_query(float *query_vec)
+// centers the query and rotates it if we have a rotation matrix. query_vec and
+// rotated_query may be the same buffer only when no rotation is used.
+void FixedChunkPQTable::preprocess_query(const float *query_vec, float *rotated_query)
 {
-    for (uint32_t d = 0; d < ndims; d++)
+    if (!use_rotation)
     {
-        query_vec[d] -= centroid[d];
+        for (uint64_t d = 0; d < ndims; d++)
+        {
+            rotated_query[d] = query_vec[d] - centroid[d];
+        }
+        return;
     }
-    std::vector<float> tmp(ndims, 0);
-    if (use_rotation)
+
+    // rotated_query = (query_vec - centroid) * rotmat_tr, accumulated one row
+    // of rotmat_tr at a time so that all loads are contiguous
+    memset(rotated_query, 0, ndims * sizeof(float));
+    for (uint64_t d1 = 0; d1 < ndims; d1++)
     {
-        for (uint32_t d = 0; d < ndims; d++)
+        const float q = query_vec[d1] - centroid[d1];
+        const float *row = rotmat_tr + d1 * ndims;
+        uint64_t d = 0;
+#if defined(__AVX512F__)
+        const __m512 q_vec = _mm512_set1_ps(q);
+        for (; d + 16 <= ndims; d += 16)
         {
-            for (uint32_t d1 = 0; d1 < ndims; d1++)
-            {
-                tmp[d] += query_vec[d1] * rotmat_tr[d1 * ndims + d];
-            }
+            __m512 acc = _mm512_loadu_ps(rotated_query + d);
+            _mm512_storeu_ps(rotated_query + d, _mm512_fmadd_ps(q_vec, _mm512_loadu_ps(row + d), acc));
+        }
+#elif defined(USE_AVX2)
+        const __m256 q_vec = _mm256_set1_ps(q);
+        for (; d + 8 <= ndims; d += 8)
+        {
+            __m256 acc = _mm256_loadu_ps(rotated_query + d);
+            _mm256_storeu_ps(rotated_query + d, _mm256_fmadd_ps(q_vec, _mm256_loadu_ps(row + d), acc));
+        }
+#endif
+        for (; d < ndims; d++)
+        {
+            rotated_query[d] += q * row[d];
         }
-        std::memcpy(query_vec, tmp.data(), ndims * sizeof(float));
     }
 }
 
 // assumes pre-processed query
 void FixedChunkPQTable::populate_chunk_distances(const float *query_vec, float *dist_vec)
 {
-    memset(dist_vec, 0, 256 * n_chunks * sizeof(float));
     // chunk wise distance computation
     for (size_t chunk = 0; chunk < n_chunks; chunk++)
     {
         // sum (q-c)^2 for the dimensions associated with this chunk
         float *chunk_dists = dist_vec + (256 * chunk);
+#if defined(__AVX512F__)
+        // 256 centers = 16 registers; keep 4 accumulators live per pass
+        for (size_t idx = 0; idx < 256; idx += 64)
+        {
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+            __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+            for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+            {
+                const float *centers_dim_vec = tables_tr + (256 * j) + idx;
+                const __m512 q_vec = _mm512_set1_ps(query_vec[j]);
+                __m512 diff0 = _mm512_sub_ps(_mm512_load_ps(centers_dim_vec), q_vec);
+                __m512 diff1 = _mm512_sub_ps(_mm512_load_ps(centers_dim_vec + 16), q_vec);
+                __m512 diff2 = _mm512_sub_ps(_mm512_load_ps(centers_dim_vec + 32), q_vec);
+                __m512 diff3 = _mm512_sub_ps(_mm512_load_ps(centers_dim_vec + 48), q_vec);
+                acc0 = _mm512_fmadd_ps(diff0, diff0, acc0);
+                acc1 = _mm512_fmadd_ps(diff1, diff1, acc1);
+                acc2 = _mm512_fmadd_ps(diff2, diff2, acc2);
+                acc3 = _mm512_fmadd_ps(diff3, diff3, acc3);
+            }
+            _mm512_storeu_ps(chunk_dists + idx, acc0);
+            _mm512_storeu_ps(chunk_dists + idx + 16, acc1);
+            _mm512_storeu_ps(chunk_dists + idx + 32, acc2);
+            _mm512_storeu_ps(chunk_dists + idx + 48, acc3);
+        }
+#elif defined(USE_AVX2)
+        for (size_t idx = 0; idx < 256; idx += 32)
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+            {
+                const float *centers_dim_vec = tables_tr + (256 * j) + idx;
+                const __m256 q_vec = _mm256_set1_ps(query_vec[j]);
+                __m256 diff0 = _mm256_sub_ps(_mm256_load_ps(centers_dim_vec), q_vec);
+                __m256 diff1 = _mm256_sub_ps(_mm256_load_ps(centers_dim_vec + 8), q_vec);
+                __m256 diff2 = _mm256_sub_ps(_mm256_load_ps(centers_dim_vec + 16), q_vec);
+                __m256 diff3 = _mm256_sub_ps(_mm256_load_ps(centers_dim_vec + 24), q_vec);
+                acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+                acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+                acc2 = _mm256_fmadd_ps(diff2, diff2, acc2);
+                acc3 = _mm256_fmadd_ps(diff3, diff3, acc3);
+            }
+            _mm256_storeu_ps(chunk_dists + idx, acc0);
+            _mm256_storeu_ps(chunk_dists + idx + 8, acc1);
+            _mm256_storeu_ps(chunk_dists + idx + 16, acc2);
+            _mm256_storeu_ps(chunk_dists + idx + 24, acc3);
+        }
+#else
+        memset(chunk_dists, 0, 256 * sizeof(float));
         for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
         {
             const float *centers_dim_vec = tables_tr + (256 * j);
             for (size_t idx = 0; idx < 256; idx++)
             {
-                double diff = centers_dim_vec[idx] - (query_vec[j]);
-                chunk_dists[idx] += (float)(diff * diff);
+                float diff = centers_dim_vec[idx] - (query_vec[j]);
+                chunk_dists[idx] += diff * diff;
             }
         }
+#endif
     }
 }
 
+// The full-vector distances below gather one center per chunk. The dimensions
+// of a chunk are contiguous in the row-major tables, so each chunk is one
+// (masked) vector load instead of a strided walk over tables_tr.
 float FixedChunkPQTable::l2_distance(const float *query_vec, uint8_t *base_vec)
 {
+#if defined(__AVX512F__)
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        const float *center = tables + (size_t)base_vec[chunk] * ndims;
+        for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j += 16)
+        {
+            size_t rem = chunk_offsets[chunk + 1] - j;
+            __mmask16 mask = rem >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << rem) - 1);
+            __m512 diff =
+                _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, center + j), _mm512_maskz_loadu_ps(mask, query_vec + j));
+            sum = _mm512_fmadd_ps(diff, diff, sum);
+        }
+    }
+    return _mm512_horizontal_add_ps(sum);
+#elif defined(USE_AVX2)
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        const float *center = tables + (size_t)base_vec[chunk] * ndims;
+        for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j += 8)
+        {
+            size_t rem = chunk_offsets[chunk + 1] - j;
+            __m256i mask = avx2_tail_mask(rem);
+            __m256 diff = _mm256_sub_ps(_mm256_maskload_ps(center + j, mask), _mm256_maskload_ps(query_vec + j, mask));
+            sum = _mm256_fmadd_ps(diff, diff, sum);
+        }
+    }
+    return _mm256_reduce_add_ps(sum);
+#else
     float res = 0;
     for (size_t chunk = 0; chunk < n_chunks; chunk++)
     {
@@ -218,21 +334,50 @@ float FixedChunkPQTable::l2_distance(const float *query_vec, uint8_t *base_vec)
         }
     }
     return res;
+#endif
 }
 
 float FixedChunkPQTable::inner_product(const float *query_vec, uint8_t *base_vec)
 {
+    // assumes centroid is 0 to prevent translation errors
+#if defined(__AVX512F__)
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        const float *center = tables + (size_t)base_vec[chunk] * ndims;
+        for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j += 16)
+        {
+            size_t rem = chunk_offsets[chunk + 1] - j;
+            __mmask16 mask = rem >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << rem) - 1);
+            sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, center + j), _mm512_maskz_loadu_ps(mask, query_vec + j),
+                                  sum);
+        }
+    }
+    float res = _mm512_horizontal_add_ps(sum);
+#elif defined(USE_AVX2)
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        const float *center = tables + (size_t)base_vec[chunk] * ndims;
+        for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j += 8)
+        {
+            size_t rem = chunk_offsets[chunk + 1] - j;
+            __m256i mask = avx2_tail_mask(rem);
+            sum = _mm256_fmadd_ps(_mm256_maskload_ps(center + j, mask), _mm256_maskload_ps(query_vec + j, mask), sum);
+        }
+    }
+    float res = _mm256_reduce_add_ps(sum);
+#else
     float res = 0;
     for (size_t chunk = 0; chunk < n_chunks; chunk++)
     {
         for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
         {
             const float *centers_dim_vec = tables_tr + (256 * j);
-            float diff = centers_dim_vec[base_vec[chunk]] * query_vec[j]; // assumes centroid is 0 to
-                                                                          // prevent translation errors
-            res += diff;
+            res += centers_dim_vec[base_vec[chunk]] * query_vec[j];
         }
     }
+#endif
     return -res; // returns negative value to simulate distances (max -> min
                  // conversion)
 }
@@ -250,27 +395,86 @@ void FixedChunkPQTable::inflate_vector(uint8_t *base_vec, float *out_vec)
     }
 }
 
+void FixedChunkPQTable::compress_vector(const float *vec, uint8_t *out_code)
+{
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        float best_dist = std::numeric_limits<float>::max();
+        for (size_t center = 0; center < 256; center++)
+        {
+            float dist = 0;
+            for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+            {
+                const float diff = vec[j] - centroid[j] - tables_tr[256 * j + center];
+                dist += diff * diff;
+            }
+            if (dist < best_dist)
+            {
+                best_dist = dist;
+                out_code[chunk] = (uint8_t)center;
+            }
+        }
+    }
+}
+
 void FixedChunkPQTable::populate_chunk_inner_products(const float *query_vec, float *dist_vec)
 {
-    memset(dist_vec, 0, 256 * n_chunks * sizeof(float));
-    // chunk wise distance computation
+    // chunk wise distance computation. Assumes that we are not shifting the
+    // vectors to mean zero, i.e., centroid array should be all zeros. Returns
+    // negative values to keep the search code clean (max inner product vs min
+    // distance).
     for (size_t chunk = 0; chunk < n_chunks; chunk++)
     {
-        // sum (q-c)^2 for the dimensions associated with this chunk
         float *chunk_dists = dist_vec + (256 * chunk);
+#if defined(__AVX512F__)
+        for (size_t idx = 0; idx < 256; idx += 64)
+        {
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+            __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+            for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+            {
+                const float *centers_dim_vec = tables_tr + (256 * j) + idx;
+                const __m512 q_vec = _mm512_set1_ps(query_vec[j]);
+                acc0 = _mm512_fnmadd_ps(_mm512_load_ps(centers_dim_vec), q_vec, acc0);
+                acc1 = _mm512_fnmadd_ps(_mm512_load_ps(centers_dim_vec + 16), q_vec, acc1);
+                acc2 = _mm512_fnmadd_ps(_mm512_load_ps(centers_dim_vec + 32), q_vec, acc2);
+                acc3 = _mm512_fnmadd_ps(_mm512_load_ps(centers_dim_vec + 48), q_vec, acc3);
+            }
+            _mm512_storeu_ps(chunk_dists + idx, acc0);
+            _mm512_storeu_ps(chunk_dists + idx + 16, acc1);
+            _mm512_storeu_ps(chunk_dists + idx + 32, acc2);
+            _mm512_storeu_ps(chunk_dists + idx + 48, acc3);
+        }
+#elif defined(USE_AVX2)
+        for (size_t idx = 0; idx < 256; idx += 32)
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
+            {
+                const float *centers_dim_vec = tables_tr + (256 * j) + idx;
+                const __m256 q_vec = _mm256_set1_ps(query_vec[j]);
+                acc0 = _mm256_fnmadd_ps(_mm256_load_ps(centers_dim_vec), q_vec, acc0);
+                acc1 = _mm256_fnmadd_ps(_mm256_load_ps(centers_dim_vec + 8), q_vec, acc1);
+                acc2 = _mm256_fnmadd_ps(_mm256_load_ps(centers_dim_vec + 16), q_vec, acc2);
+                acc3 = _mm256_fnmadd_ps(_mm256_load_ps(centers_dim_vec + 24), q_vec, acc3);
+            }
+            _mm256_storeu_ps(chunk_dists + idx, acc0);
+            _mm256_storeu_ps(chunk_dists + idx + 8, acc1);
+            _mm256_storeu_ps(chunk_dists + idx + 16, acc2);
+            _mm256_storeu_ps(chunk_dists + idx + 24, acc3);
+        }
+#else
+        memset(chunk_dists, 0, 256 * sizeof(float));
         for (size_t j = chunk_offsets[chunk]; j < chunk_offsets[chunk + 1]; j++)
         {
             const float *centers_dim_vec = tables_tr + (256 * j);
             for (size_t idx = 0; idx < 256; idx++)
             {
-                double prod = centers_dim_vec[idx] * query_vec[j]; // assumes that we are not
-                                                                   // shifting the vectors to
-                                                                   // mean zero, i.e., centroid
-                                                                   // array should be all zeros
-                chunk_dists[idx] -= (float)prod;                   // returning negative to keep the search code
-                                                                   // clean (max inner product vs min distance)
+                chunk_dists[idx] -= centers_dim_vec[idx] * query_vec[j];
             }
         }
+#endif
     }
 }
 
@@ -1016,6 +1220,16 @@ template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<float>(const std::st
                                                                    const std::string &pq_pivots_path,
                                                                    const std::string &pq_compressed_vectors_path,
                                                                    bool use_opq);
+template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<float16>(const std::string &data_file, uint32_t num_centers,
+                                                                     uint32_t num_pq_chunks,
+                                                                     const std::string &pq_pivots_path,
+                                                                     const std::string &pq_compressed_vectors_path,
+                                                                     bool use_opq);
+template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<bfloat16>(const std::string &data_file,
+                                                                      uint32_t num_centers, uint32_t num_pq_chunks,
+                                                                      const std::string &pq_pivots_path,
+                                                                      const std::string &pq_compressed_vectors_path,
+                                                                      bool use_opq);
 
 template DISKANN_DLLEXPORT void generate_disk_quantized_data<int8_t>(const std::string &data_file_to_use,
                                                                      const std::string &disk_pq_pivots_path,
@@ -1027,6 +1241,14 @@ template DISKANN_DLLEXPORT void generate_disk_quantized_data<uint8_t>(
     const std::string &data_file_to_use, const std::string &disk_pq_pivots_path,
     const std::string &disk_pq_compressed_vectors_path, diskann::Metric compareMetric, const double p_val,
     size_t &disk_pq_dims);
+template DISKANN_DLLEXPORT void generate_disk_quantized_data<float16>(
+    const std::string &data_file_to_use, const std::string &disk_pq_pivots_path,
+    const std::string &disk_pq_compressed_vectors_path, diskann::Metric compareMetric, const double p_val,
+    size_t &disk_pq_dims);
+template DISKANN_DLLEXPORT void generate_disk_quantized_data<bfloat16>(
+    const std::string &data_file_to_use, const std::string &disk_pq_pivots_path,
+    const std::string &disk_pq_compressed_vectors_path, diskann::Metric compareMetric, const double p_val,
+    size_t &disk_pq_dims);
 
 template DISKANN_DLLEXPORT void generate_disk_quantized_data<float>(const std::string &data_file_to_use,
                                                                     const std::string &disk_pq_pivots_path,
@@ -1054,4 +1276,18 @@ template DISKANN_DLLEXPORT void generate_quantized_data<float>(const std::string
                                                                diskann::Metric compareMetric, const double p_val,
                                                                const size_t num_pq_chunks, const bool use_opq,
                                                                const std::string &codebook_prefix);
+
+template DISKANN_DLLEXPORT void generate_quantized_data<float16>(const std::string &data_file_to_use,
+                                                                 const std::string &pq_pivots_path,
+                                                                 const std::string &pq_compressed_vectors_path,
+                                                                 diskann::Metric compareMetric, const double p_val,
+                                                                 const size_t num_pq_chunks, const bool use_opq,
+                                                                 const std::string &codebook_prefix);
+
+template DISKANN_DLLEXPORT void generate_quantized_data<bfloat16>(const std::string &data_file_to_use,
+                                                                  const std::string &pq_pivots_path,
+                                                                  const std::string &pq_compressed_vectors_path,
+                                                                  diskann::Metric compareMetric, const double p_val,
+                                                                  const size_t num_pq_chunks, const bool use_opq,
+                                                                  const std::string &codebook_prefix);
 } // namespace diskann
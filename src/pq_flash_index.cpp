@@ -2,8 +2,12 @@
 // Licensed under the MIT license.
 
 #include "common_includes.h"
+#include <condition_variable>
+#include <thread>
 
 #include "timer.h"
+#include "huge_page_allocator.h"
+#include "numa_utils.h"
 #include "pq_flash_index.h"
 #include "cosine_similarity.h"
 
@@ -20,6 +24,12 @@
 // sector # on disk where node_id is present with in the graph part
 #define NODE_SECTOR_NO(node_id) (((uint64_t)(node_id)) / nnodes_per_sector + 1)
 
+// bumped whenever the layout written by save_cache changes
+#define CACHE_FILE_VERSION 2
+
+// cached nodes that load_cache compares with their records on disk
+#define CACHE_NODES_TO_VERIFY 64
+
 // obtains region of sector containing node
 #define OFFSET_TO_NODE(sector_buf, node_id)                                                                            \
     ((char *)sector_buf + (((uint64_t)node_id) % nnodes_per_sector) * max_node_len)
@@ -45,7 +55,7 @@ PQFlashIndex<T, LabelT>::PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileRe
 {
     if (m == diskann::Metric::COSINE || m == diskann::Metric::INNER_PRODUCT)
     {
-        if (std::is_floating_point<T>::value)
+        if (std::is_floating_point<T>::value || is_half_float<T>::value)
         {
             diskann::cout << "Cosine metric chosen for (normalized) float data."
                              "Changing distance to L2 to boost accuracy."
@@ -67,9 +77,10 @@ PQFlashIndex<T, LabelT>::PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileRe
 template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
 {
 #ifndef EXEC_ENV_OLS
-    if (data != nullptr)
+    // otherwise owned by the first NUMA replica
+    if (data != nullptr && numa_replicas.empty())
     {
-        delete[] data;
+        aligned_free_huge(data);
     }
 #endif
 
@@ -82,12 +93,24 @@ template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
         diskann::aligned_free(coord_cache_buf);
     }
 
-    if (load_flag)
+    for (auto &replica : numa_replicas)
     {
-        diskann::cout << "Clearing scratch" << std::endl;
-        ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
+        aligned_free_huge(replica->data);
+        delete[] replica->nhood_cache_buf;
+        diskann::aligned_free(replica->coord_cache_buf);
+        ScratchStoreManager<SSDThreadData<T>> manager(replica->thread_data);
         manager.destroy();
-        this->reader->deregister_all_threads();
+    }
+
+    if (load_flag)
+    {
+        if (_shared_scratch == nullptr)
+        {
+            diskann::cout << "Clearing scratch" << std::endl;
+            ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
+            manager.destroy();
+            this->reader->deregister_all_threads();
+        }
         reader->close();
     }
     if (_pts_to_label_offsets != nullptr)
@@ -104,6 +127,19 @@ template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
 template <typename T, typename LabelT>
 void PQFlashIndex<T, LabelT>::setup_thread_data(uint64_t nthreads, uint64_t visited_reserve)
 {
+    if (_shared_scratch != nullptr)
+    {
+        if (this->aligned_dim > _shared_scratch->get_aligned_dim())
+        {
+            std::stringstream stream;
+            stream << "Index dimension " << this->data_dim << " does not fit the shared scratch of "
+                   << _shared_scratch->get_aligned_dim() << " dimensions" << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        load_flag = true;
+        return;
+    }
+
     diskann::cout << "Setting up thread-specific contexts for nthreads: " << nthreads << std::endl;
 // omp parallel for to generate unique thread IDs
 #pragma omp parallel for num_threads((int)nthreads)
@@ -120,78 +156,478 @@ void PQFlashIndex<T, LabelT>::setup_thread_data(uint64_t nthreads, uint64_t visi
     load_flag = true;
 }
 
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::read_nodes_parallel(const std::vector<uint32_t> &node_ids,
+                                                  const std::function<void(size_t, char *)> &node_visitor)
+{
+    if (node_ids.empty())
+        return;
+
+    // (sector, position in node_ids), sorted so that the nodes sharing a
+    // sector are adjacent
+    std::vector<std::pair<uint64_t, size_t>> node_sectors(node_ids.size());
+    for (size_t i = 0; i < node_ids.size(); i++)
+        node_sectors[i] = std::make_pair(NODE_SECTOR_NO(node_ids[i]), i);
+    std::sort(node_sectors.begin(), node_sectors.end());
+
+    // first entry of node_sectors for each distinct sector, plus an end marker
+    std::vector<size_t> sector_starts;
+    for (size_t i = 0; i < node_sectors.size(); i++)
+    {
+        if (i == 0 || node_sectors[i].first != node_sectors[i - 1].first)
+            sector_starts.push_back(i);
+    }
+    const size_t num_sectors = sector_starts.size();
+    sector_starts.push_back(node_sectors.size());
+
+    // Every IO context can have a batch of reads in flight at once; the
+    // batches share one buffer, a slice per thread.
+    const size_t SECTORS_PER_BATCH = 512;
+    const size_t num_batches = DIV_ROUND_UP(num_sectors, SECTORS_PER_BATCH);
+    const int num_threads = (int)(std::min)((uint64_t)num_batches, (std::max)((uint64_t)1, scratch_queue().size()));
+    char *sector_buf = nullptr;
+    alloc_aligned((void **)&sector_buf, num_threads * SECTORS_PER_BATCH * SECTOR_LEN, SECTOR_LEN);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (int64_t batch = 0; batch < (int64_t)num_batches; batch++)
+    {
+        ScratchStoreManager<SSDThreadData<T>> manager(scratch_queue());
+        IOContext &ctx = manager.scratch_space()->ctx;
+        char *batch_buf = sector_buf + omp_get_thread_num() * SECTORS_PER_BATCH * SECTOR_LEN;
+
+        const size_t first_sector = batch * SECTORS_PER_BATCH;
+        const size_t last_sector = (std::min)(num_sectors, first_sector + SECTORS_PER_BATCH);
+        std::vector<AlignedRead> read_reqs;
+        read_reqs.reserve(last_sector - first_sector);
+        for (size_t sector = first_sector; sector < last_sector; sector++)
+        {
+            read_reqs.emplace_back(node_sectors[sector_starts[sector]].first * SECTOR_LEN, SECTOR_LEN,
+                                   batch_buf + (sector - first_sector) * SECTOR_LEN);
+        }
+        reader->read(read_reqs, ctx);
+
+        for (size_t sector = first_sector; sector < last_sector; sector++)
+        {
+#if defined(_WINDOWS) && defined(USE_BING_INFRA) // this block is to handle failed reads in
+                                                 // production settings
+            if ((*ctx.m_pRequestsStatus)[sector - first_sector] != IOContext::READ_SUCCESS)
+            {
+                continue;
+            }
+#endif
+            char *buf = batch_buf + (sector - first_sector) * SECTOR_LEN;
+            for (size_t i = sector_starts[sector]; i < sector_starts[sector + 1]; i++)
+            {
+                const size_t node_idx = node_sectors[i].second;
+                node_visitor(node_idx, OFFSET_TO_NODE(buf, node_ids[node_idx]));
+            }
+        }
+    }
+    aligned_free(sector_buf);
+}
+
 template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::load_cache_list(std::vector<uint32_t> &node_list)
 {
     diskann::cout << "Loading the cache list into memory.." << std::flush;
     size_t num_cached_nodes = node_list.size();
 
-    // borrow thread data
-    ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
-    auto this_thread_data = manager.scratch_space();
-    IOContext &ctx = this_thread_data->ctx;
-
     nhood_cache_buf = new uint32_t[num_cached_nodes * (max_degree + 1)];
-    memset(nhood_cache_buf, 0, num_cached_nodes * (max_degree + 1));
+    memset(nhood_cache_buf, 0, num_cached_nodes * (max_degree + 1) * sizeof(uint32_t));
 
     size_t coord_cache_buf_len = num_cached_nodes * aligned_dim;
     diskann::alloc_aligned((void **)&coord_cache_buf, coord_cache_buf_len * sizeof(T), 8 * sizeof(T));
     memset(coord_cache_buf, 0, coord_cache_buf_len * sizeof(T));
 
-    size_t BLOCK_SIZE = 8;
-    size_t num_blocks = DIV_ROUND_UP(num_cached_nodes, BLOCK_SIZE);
+    // the caches are filled in parallel, but the maps are built afterwards
+    // since they cannot be inserted into concurrently
+    const uint32_t NOT_READ = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> num_nbrs(num_cached_nodes, NOT_READ);
+    read_nodes_parallel(node_list, [&](size_t node_idx, char *node_buf) {
+        memcpy(coord_cache_buf + node_idx * aligned_dim, OFFSET_TO_NODE_COORDS(node_buf), disk_bytes_per_point);
+
+        uint32_t *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
+        memcpy(nhood_cache_buf + node_idx * (max_degree + 1), node_nhood + 1, *node_nhood * sizeof(uint32_t));
+        num_nbrs[node_idx] = *node_nhood;
+    });
 
-    for (size_t block = 0; block < num_blocks; block++)
+    for (size_t node_idx = 0; node_idx < num_cached_nodes; node_idx++)
     {
-        size_t start_idx = block * BLOCK_SIZE;
-        size_t end_idx = (std::min)(num_cached_nodes, (block + 1) * BLOCK_SIZE);
-        std::vector<AlignedRead> read_reqs;
-        std::vector<std::pair<uint32_t, char *>> nhoods;
-        for (size_t node_idx = start_idx; node_idx < end_idx; node_idx++)
+        if (num_nbrs[node_idx] == NOT_READ)
+            continue;
+        coord_cache.insert(std::make_pair(node_list[node_idx], coord_cache_buf + node_idx * aligned_dim));
+        std::pair<uint32_t, uint32_t *> cnhood(num_nbrs[node_idx], nhood_cache_buf + node_idx * (max_degree + 1));
+        nhood_cache.insert(std::make_pair(node_list[node_idx], cnhood));
+    }
+    diskann::cout << "..done." << std::endl;
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::read_index_header(std::vector<char> &header)
+{
+    char *buf = nullptr;
+    alloc_aligned((void **)&buf, SECTOR_LEN, SECTOR_LEN);
+    {
+        ScratchStoreManager<SSDThreadData<T>> manager(scratch_queue());
+        std::vector<AlignedRead> read_reqs(1, AlignedRead(0, SECTOR_LEN, buf));
+        reader->read(read_reqs, manager.scratch_space()->ctx);
+    }
+    header.assign(buf, buf + SECTOR_LEN);
+    aligned_free(buf);
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::hash_pq_codes()
+{
+    // FNV-1a over blocks of the codes, hashed in parallel, then over the
+    // hashes of the blocks
+    const uint64_t FNV_OFFSET = 14695981039346656037ull, FNV_PRIME = 1099511628211ull;
+    const uint64_t BLOCK_SIZE = 1 << 20;
+    const uint64_t num_bytes = num_points * n_chunks;
+    const int64_t num_blocks = (int64_t)DIV_ROUND_UP(num_bytes, BLOCK_SIZE);
+    std::vector<uint64_t> block_hashes(num_blocks);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t block = 0; block < num_blocks; block++)
+    {
+        uint64_t hash = FNV_OFFSET;
+        const uint64_t block_end = (std::min)(num_bytes, (block + 1) * BLOCK_SIZE);
+        for (uint64_t i = block * BLOCK_SIZE; i < block_end; i++)
+            hash = (hash ^ data[i]) * FNV_PRIME;
+        block_hashes[block] = hash;
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    for (auto block_hash : block_hashes)
+        hash = (hash ^ block_hash) * FNV_PRIME;
+    return hash;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::save_cache(const std::string &cache_file, uint64_t num_nodes_to_cache)
+{
+    diskann::cout << "Saving " << nhood_cache.size() << " cached nodes to " << cache_file << ".." << std::flush;
+
+    // cached nodes in the order of their slots in the cache buffers, which is
+    // that of the cache list, so that the rows below are copied sequentially
+    // and the first ones are those to keep for a smaller cache
+    std::vector<std::pair<uint32_t *, uint32_t>> slots;
+    slots.reserve(nhood_cache.size());
+    for (auto &cached : nhood_cache)
+        slots.emplace_back(cached.second.second, cached.first);
+    std::sort(slots.begin(), slots.end());
+
+    std::vector<char> header;
+    read_index_header(header);
+
+    const uint64_t num_cached = slots.size();
+    const uint64_t layout[] = {CACHE_FILE_VERSION, num_cached, num_nodes_to_cache, max_degree, aligned_dim,
+                               sizeof(T),          hash_pq_codes()};
+
+    std::ofstream writer(cache_file, std::ios::binary | std::ios::out);
+    if (!writer)
+    {
+        throw ANNException("Could not open " + cache_file + " for writing", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    writer.write(header.data(), header.size());
+    writer.write((char *)layout, sizeof(layout));
+    for (auto &slot : slots)
+        writer.write((char *)&slot.second, sizeof(uint32_t));
+    for (auto &slot : slots)
+        writer.write((char *)&nhood_cache.find(slot.second)->second.first, sizeof(uint32_t));
+    for (auto &slot : slots)
+        writer.write((char *)slot.first, (max_degree + 1) * sizeof(uint32_t));
+    for (auto &slot : slots)
+        writer.write((char *)coord_cache.find(slot.second)->second, aligned_dim * sizeof(T));
+    if (!writer)
+    {
+        throw ANNException("Failed to write " + cache_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    diskann::cout << "done." << std::endl;
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::load_cache(const std::string &cache_file, uint64_t num_nodes_to_cache)
+{
+    if (nhood_cache_buf != nullptr)
+    {
+        throw ANNException("The node cache has already been loaded", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (!file_exists(cache_file))
+    {
+        diskann::cout << "Cache file " << cache_file << " does not exist." << std::endl;
+        return false;
+    }
+
+    std::ifstream reader_stream(cache_file, std::ios::binary);
+    std::vector<char> header, saved_header(SECTOR_LEN);
+    read_index_header(header);
+    reader_stream.read(saved_header.data(), saved_header.size());
+    uint64_t layout[7] = {0};
+    reader_stream.read((char *)layout, sizeof(layout));
+    if (!reader_stream || saved_header != header || layout[6] != hash_pq_codes())
+    {
+        diskann::cerr << "Cache file " << cache_file << " was not written for this disk index, ignoring it."
+                      << std::endl;
+        return false;
+    }
+    const uint64_t num_saved = layout[1];
+    const uint64_t row_bytes = (max_degree + 3) * sizeof(uint32_t) + aligned_dim * sizeof(T);
+    if (layout[0] != CACHE_FILE_VERSION || layout[3] != max_degree || layout[4] != aligned_dim ||
+        layout[5] != sizeof(T) || get_file_size(cache_file) != SECTOR_LEN + sizeof(layout) + num_saved * row_bytes)
+    {
+        diskann::cerr << "Cache file " << cache_file << " has an unexpected layout, ignoring it." << std::endl;
+        return false;
+    }
+    if (num_nodes_to_cache > layout[2])
+    {
+        diskann::cout << "Cache file " << cache_file << " was saved for " << layout[2] << " cached nodes, fewer than "
+                      << num_nodes_to_cache << ", ignoring it." << std::endl;
+        return false;
+    }
+
+    // the saved rows are in the order of the cache list, so a smaller cache
+    // keeps the first ones of each array
+    const uint64_t num_cached = (std::min)(num_saved, num_nodes_to_cache);
+    diskann::cout << "Loading " << num_cached << " cached nodes from " << cache_file << ".." << std::flush;
+    const uint64_t arrays_start = SECTOR_LEN + sizeof(layout);
+    std::vector<uint32_t> ids(num_cached), num_nbrs(num_cached);
+    reader_stream.read((char *)ids.data(), num_cached * sizeof(uint32_t));
+    reader_stream.seekg(arrays_start + num_saved * sizeof(uint32_t), std::ios::beg);
+    reader_stream.read((char *)num_nbrs.data(), num_cached * sizeof(uint32_t));
+
+    nhood_cache_buf = new uint32_t[num_cached * (max_degree + 1)];
+    reader_stream.seekg(arrays_start + 2 * num_saved * sizeof(uint32_t), std::ios::beg);
+    reader_stream.read((char *)nhood_cache_buf, num_cached * (max_degree + 1) * sizeof(uint32_t));
+    diskann::alloc_aligned((void **)&coord_cache_buf, num_cached * aligned_dim * sizeof(T), 8 * sizeof(T));
+    reader_stream.seekg(arrays_start + num_saved * (max_degree + 3) * sizeof(uint32_t), std::ios::beg);
+    reader_stream.read((char *)coord_cache_buf, num_cached * aligned_dim * sizeof(T));
+    if (!reader_stream)
+    {
+        throw ANNException("Failed to read " + cache_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    // The header and the PQ codes match for an index rebuilt over the same
+    // data with the same parameters, whose graph may still differ, so a
+    // sample of the cached nodes is compared with their records on disk.
+    std::vector<uint32_t> verify_ids;
+    std::vector<size_t> verify_slots;
+    const uint64_t num_to_verify = (std::min)(num_cached, (uint64_t)CACHE_NODES_TO_VERIFY);
+    for (uint64_t i = 0; i < num_to_verify; i++)
+    {
+        verify_slots.push_back(i * num_cached / num_to_verify);
+        verify_ids.push_back(ids[verify_slots.back()]);
+    }
+    std::atomic<bool> matches(true);
+    read_nodes_parallel(verify_ids, [&](size_t i, char *node_buf) {
+        const size_t slot = verify_slots[i];
+        const uint32_t *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
+        if (*node_nhood != num_nbrs[slot] ||
+            memcmp(node_nhood + 1, nhood_cache_buf + slot * (max_degree + 1), *node_nhood * sizeof(uint32_t)) != 0 ||
+            memcmp(OFFSET_TO_NODE_COORDS(node_buf), coord_cache_buf + slot * aligned_dim, disk_bytes_per_point) != 0)
         {
-            AlignedRead read;
-            char *buf = nullptr;
-            alloc_aligned((void **)&buf, SECTOR_LEN, SECTOR_LEN);
-            nhoods.push_back(std::make_pair(node_list[node_idx], buf));
-            read.len = SECTOR_LEN;
-            read.buf = buf;
-            read.offset = NODE_SECTOR_NO(node_list[node_idx]) * SECTOR_LEN;
-            read_reqs.push_back(read);
+            matches = false;
         }
+    });
+    if (!matches)
+    {
+        delete[] nhood_cache_buf;
+        nhood_cache_buf = nullptr;
+        aligned_free(coord_cache_buf);
+        coord_cache_buf = nullptr;
+        diskann::cerr << std::endl
+                      << "Cache file " << cache_file << " does not match the nodes on disk, ignoring it." << std::endl;
+        return false;
+    }
 
-        reader->read(read_reqs, ctx);
+    for (size_t node_idx = 0; node_idx < num_cached; node_idx++)
+    {
+        coord_cache.insert(std::make_pair(ids[node_idx], coord_cache_buf + node_idx * aligned_dim));
+        std::pair<uint32_t, uint32_t *> cnhood(num_nbrs[node_idx], nhood_cache_buf + node_idx * (max_degree + 1));
+        nhood_cache.insert(std::make_pair(ids[node_idx], cnhood));
+    }
+    diskann::cout << "done." << std::endl;
+    return true;
+}
 
-        size_t node_idx = start_idx;
-        for (uint32_t i = 0; i < read_reqs.size(); i++)
-        {
-#if defined(_WINDOWS) && defined(USE_BING_INFRA) // this block is to handle failed reads in
-                                                 // production settings
-            if ((*ctx.m_pRequestsStatus)[i] != IOContext::READ_SUCCESS)
-            {
-                continue;
-            }
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_num_nav_entry_points(const uint32_t num_entry_points)
+{
+    _num_nav_entry_points = std::min(num_entry_points, (uint32_t)NAV_INDEX_SEARCH_L);
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::enable_numa_replication(uint32_t num_threads)
+{
+    const uint32_t num_nodes = get_num_numa_nodes();
+    if (num_nodes <= 1)
+    {
+        diskann::cout << "Only one NUMA node, not replicating the index." << std::endl;
+        return;
+    }
+    if (!numa_replicas.empty())
+    {
+        throw ANNException("NUMA replicas have already been created", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+#ifdef EXEC_ENV_OLS
+    throw ANNException("NUMA replication is not supported with EXEC_ENV_OLS", -1, __FUNCSIG__, __FILE__, __LINE__);
 #endif
-            auto &nhood = nhoods[i];
-            char *node_buf = OFFSET_TO_NODE(nhood.second, nhood.first);
-            T *node_coords = OFFSET_TO_NODE_COORDS(node_buf);
-            T *cached_coords = coord_cache_buf + node_idx * aligned_dim;
-            memcpy(cached_coords, node_coords, disk_bytes_per_point);
-            coord_cache.insert(std::make_pair(nhood.first, cached_coords));
-
-            // insert node nhood into nhood_cache
-            uint32_t *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
-
-            auto nnbrs = *node_nhood;
-            uint32_t *nbrs = node_nhood + 1;
-            std::pair<uint32_t, uint32_t *> cnhood;
-            cnhood.first = nnbrs;
-            cnhood.second = nhood_cache_buf + node_idx * (max_degree + 1);
-            memcpy(cnhood.second, nbrs, nnbrs * sizeof(uint32_t));
-            nhood_cache.insert(std::make_pair(nhood.first, cnhood));
-            aligned_free(nhood.second);
+
+    diskann::cout << "Replicating PQ data and " << nhood_cache.size() << " cached nodes on " << num_nodes
+                  << " NUMA nodes, with " << num_threads << " scratch spaces per node.." << std::flush;
+    for (uint32_t node = 0; node < num_nodes; node++)
+        numa_replicas.emplace_back(new NumaReplica());
+
+    // Everything is allocated and first written by threads pinned to the
+    // replica's node, which places the pages there under the default policy.
+    // All the threads stay alive until every one of them has registered with
+    // the reader, since IO contexts are keyed by thread id.
+    std::mutex register_lock;
+    std::condition_variable registered_cv;
+    uint32_t num_registered = 0;
+    const uint32_t num_workers = num_nodes * num_threads;
+
+    auto build_replica = [this](NumaReplica &replica) {
+        const size_t data_size = num_points * n_chunks * sizeof(uint8_t);
+        alloc_aligned_huge((void **)&replica.data, data_size, 8 * sizeof(uint8_t), -1);
+        memcpy(replica.data, this->data, data_size);
+
+        const size_t num_cached_nodes = nhood_cache.size();
+        replica.nhood_cache_buf = new uint32_t[num_cached_nodes * (max_degree + 1)];
+        diskann::alloc_aligned((void **)&replica.coord_cache_buf, num_cached_nodes * aligned_dim * sizeof(T),
+                               8 * sizeof(T));
+        size_t node_idx = 0;
+        for (auto &cached : nhood_cache)
+        {
+            std::pair<uint32_t, uint32_t *> cnhood(cached.second.first,
+                                                   replica.nhood_cache_buf + node_idx * (max_degree + 1));
+            memcpy(cnhood.second, cached.second.second, cnhood.first * sizeof(uint32_t));
+            replica.nhood_cache.insert(std::make_pair(cached.first, cnhood));
+
+            T *cached_coords = replica.coord_cache_buf + node_idx * aligned_dim;
+            memcpy(cached_coords, coord_cache.find(cached.first)->second, aligned_dim * sizeof(T));
+            replica.coord_cache.insert(std::make_pair(cached.first, cached_coords));
             node_idx++;
         }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t node = 0; node < num_nodes; node++)
+    {
+        for (uint32_t thread = 0; thread < num_threads; thread++)
+        {
+            workers.emplace_back([&, node, thread]() {
+                if (!pin_thread_to_numa_node(node))
+                    diskann::cerr << "Could not pin thread to NUMA node " << node << std::endl;
+                NumaReplica &replica = *numa_replicas[node];
+                if (thread == 0)
+                    build_replica(replica);
+
+                SSDThreadData<T> *scratch = new SSDThreadData<T>(this->aligned_dim, 4096);
+                std::unique_lock<std::mutex> lock(register_lock);
+                this->reader->register_thread();
+                scratch->ctx = this->reader->get_ctx();
+                replica.thread_data.push(scratch);
+                num_registered++;
+                registered_cv.notify_all();
+                registered_cv.wait(lock, [&]() { return num_registered == num_workers; });
+            });
+        }
     }
-    diskann::cout << "..done." << std::endl;
+    for (auto &worker : workers)
+        worker.join();
+
+    // the replicas now serve every search, the first one's codes double as
+    // `data` for code paths that are not NUMA aware
+    aligned_free_huge(this->data);
+    this->data = numa_replicas[0]->data;
+    diskann::cout << "done." << std::endl;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_deleted_points(const std::vector<uint32_t> &ids)
+{
+    std::shared_ptr<DeletedBitmap> bitmap(new DeletedBitmap(DIV_ROUND_UP(this->num_points, 64)));
+    for (auto &word : *bitmap)
+        word.store(0, std::memory_order_relaxed);
+    for (const uint32_t id : ids)
+    {
+        if (id >= this->num_points)
+        {
+            throw ANNException("Deleted point " + std::to_string(id) + " is not in the index", -1, __FUNCSIG__,
+                               __FILE__, __LINE__);
+        }
+        set_deleted_bits(*bitmap, id, true);
+    }
+
+    std::lock_guard<std::mutex> guard(_deleted_points_lock);
+    std::atomic_store(&_deleted_points, bitmap);
+    diskann::cout << "Marked " << ids.size() << " points as deleted" << std::endl;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::load_deleted_points(const std::string &deleted_points_file)
+{
+    std::unique_ptr<uint32_t[]> ids;
+    size_t num_ids, dim;
+    diskann::load_bin<uint32_t>(deleted_points_file, ids, num_ids, dim);
+    set_deleted_points(std::vector<uint32_t>(ids.get(), ids.get() + num_ids * dim));
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::mark_deleted(const uint32_t id)
+{
+    if (id >= this->num_points)
+    {
+        throw ANNException("Deleted point " + std::to_string(id) + " is not in the index", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+
+    std::lock_guard<std::mutex> guard(_deleted_points_lock);
+    std::shared_ptr<DeletedBitmap> bitmap = std::atomic_load(&_deleted_points);
+    if (bitmap == nullptr)
+    {
+        bitmap.reset(new DeletedBitmap(DIV_ROUND_UP(this->num_points, 64)));
+        for (auto &word : *bitmap)
+            word.store(0, std::memory_order_relaxed);
+        std::atomic_store(&_deleted_points, bitmap);
+    }
+    set_deleted_bits(*bitmap, id, true);
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::unmark_deleted(const uint32_t id)
+{
+    std::lock_guard<std::mutex> guard(_deleted_points_lock);
+    std::shared_ptr<DeletedBitmap> bitmap = std::atomic_load(&_deleted_points);
+    if (bitmap != nullptr && id < this->num_points)
+        set_deleted_bits(*bitmap, id, false);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_deleted_bits(DeletedBitmap &bitmap, const uint32_t id, const bool deleted)
+{
+    // the dummy copies of a point in a filtered index are searched and mapped
+    // back to it in the results, so they share its tombstone
+    auto set_bit = [&bitmap, deleted](const uint32_t bit) {
+        if (deleted)
+            bitmap[bit / 64].fetch_or((uint64_t)1 << (bit % 64), std::memory_order_relaxed);
+        else
+            bitmap[bit / 64].fetch_and(~((uint64_t)1 << (bit % 64)), std::memory_order_relaxed);
+    };
+    set_bit(id);
+    auto dummies = _real_to_dummy_map.find(id);
+    if (dummies != _real_to_dummy_map.end())
+    {
+        for (const uint32_t dummy_id : dummies->second)
+            set_bit(dummy_id);
+    }
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::clear_deleted_points()
+{
+    std::lock_guard<std::mutex> guard(_deleted_points_lock);
+    std::atomic_store(&_deleted_points, std::shared_ptr<DeletedBitmap>());
+}
+
+template <typename T, typename LabelT> bool PQFlashIndex<T, LabelT>::is_deleted(const uint32_t id)
+{
+    const std::shared_ptr<DeletedBitmap> bitmap = std::atomic_load(&_deleted_points);
+    return bitmap != nullptr && id < this->num_points &&
+           (((*bitmap)[id / 64].load(std::memory_order_relaxed) >> (id % 64)) & 1);
 }
 
 #ifdef EXEC_ENV_OLS
@@ -283,11 +719,6 @@ void PQFlashIndex<T, LabelT>::cache_bfs_levels(uint64_t num_nodes_to_cache, std:
     }
     diskann::cout << "Caching " << num_nodes_to_cache << "..." << std::endl;
 
-    // borrow thread data
-    ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
-    auto this_thread_data = manager.scratch_space();
-    IOContext &ctx = this_thread_data->ctx;
-
     std::unique_ptr<tsl::robin_set<uint32_t>> cur_level, prev_level;
     cur_level = std::make_unique<tsl::robin_set<uint32_t>>();
     prev_level = std::make_unique<tsl::robin_set<uint32_t>>();
@@ -326,60 +757,36 @@ void PQFlashIndex<T, LabelT>::cache_bfs_levels(uint64_t num_nodes_to_cache, std:
         diskann::cout << "Level: " << lvl << std::flush;
         bool finish_flag = false;
 
-        uint64_t BLOCK_SIZE = 1024;
+        // Large blocks keep every IO context busy, and the level is still
+        // cut short once enough nodes have been found.
+        uint64_t BLOCK_SIZE = 65536;
         uint64_t nblocks = DIV_ROUND_UP(nodes_to_expand.size(), BLOCK_SIZE);
         for (size_t block = 0; block < nblocks && !finish_flag; block++)
         {
             diskann::cout << "." << std::flush;
             size_t start = block * BLOCK_SIZE;
             size_t end = (std::min)((block + 1) * BLOCK_SIZE, nodes_to_expand.size());
-            std::vector<AlignedRead> read_reqs;
-            std::vector<std::pair<uint32_t, char *>> nhoods;
-            for (size_t cur_pt = start; cur_pt < end; cur_pt++)
-            {
-                char *buf = nullptr;
-                alloc_aligned((void **)&buf, SECTOR_LEN, SECTOR_LEN);
-                nhoods.emplace_back(nodes_to_expand[cur_pt], buf);
-                AlignedRead read;
-                read.len = SECTOR_LEN;
-                read.buf = buf;
-                read.offset = NODE_SECTOR_NO(nodes_to_expand[cur_pt]) * SECTOR_LEN;
-                read_reqs.push_back(read);
-            }
-
-            // issue read requests
-            reader->read(read_reqs, ctx);
+            std::vector<uint32_t> block_nodes(nodes_to_expand.begin() + start, nodes_to_expand.begin() + end);
+            std::vector<std::vector<uint32_t>> block_nbrs(block_nodes.size());
+            read_nodes_parallel(block_nodes, [&](size_t node_idx, char *node_buf) {
+                uint32_t *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
+                block_nbrs[node_idx].assign(node_nhood + 1, node_nhood + 1 + *node_nhood);
+            });
 
-            // process each nhood buf
-            for (uint32_t i = 0; i < read_reqs.size(); i++)
+            // explore next level
+            for (size_t i = 0; i < block_nbrs.size() && !finish_flag; i++)
             {
-#if defined(_WINDOWS) && defined(USE_BING_INFRA) // this block is to handle read failures in
-                                                 // production settings
-                if ((*ctx.m_pRequestsStatus)[i] != IOContext::READ_SUCCESS)
+                for (size_t j = 0; j < block_nbrs[i].size() && !finish_flag; j++)
                 {
-                    continue;
-                }
-#endif
-                auto &nhood = nhoods[i];
-
-                // insert node coord into coord_cache
-                char *node_buf = OFFSET_TO_NODE(nhood.second, nhood.first);
-                uint32_t *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
-                uint64_t nnbrs = (uint64_t)*node_nhood;
-                uint32_t *nbrs = node_nhood + 1;
-                // explore next level
-                for (uint64_t j = 0; j < nnbrs && !finish_flag; j++)
-                {
-                    if (node_set.find(nbrs[j]) == node_set.end())
+                    if (node_set.find(block_nbrs[i][j]) == node_set.end())
                     {
-                        cur_level->insert(nbrs[j]);
+                        cur_level->insert(block_nbrs[i][j]);
                     }
                     if (cur_level->size() + node_set.size() >= num_nodes_to_cache)
                     {
                         finish_flag = true;
                     }
                 }
-                aligned_free(nhood.second);
             }
         }
 
@@ -412,7 +819,7 @@ template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::use_medoids
     std::memset(centroid_data, 0, num_medoids * aligned_dim * sizeof(float));
 
     // borrow ctx
-    ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
+    ScratchStoreManager<SSDThreadData<T>> manager(scratch_queue());
     auto data = manager.scratch_space();
     IOContext &ctx = data->ctx;
     diskann::cout << "Loading centroid data from medoids vector data of " << num_medoids << " medoid(s)" << std::endl;
@@ -689,7 +1096,12 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
 #ifdef EXEC_ENV_OLS
     diskann::load_bin<uint8_t>(files, pq_compressed_vectors, this->data, npts_u64, nchunks_u64);
 #else
-    diskann::load_bin<uint8_t>(pq_compressed_vectors, this->data, npts_u64, nchunks_u64);
+    // the PQ codes are probed at random for every expanded neighbor, so they
+    // go on hugepages when those are enabled
+    diskann::get_bin_metadata(pq_compressed_vectors, npts_u64, nchunks_u64);
+    alloc_aligned_huge((void **)&this->data, npts_u64 * nchunks_u64 * sizeof(uint8_t), 8 * sizeof(uint8_t));
+    diskann::copy_aligned_data_from_file<uint8_t>(pq_compressed_vectors.c_str(), this->data, npts_u64, nchunks_u64,
+                                                  nchunks_u64);
 #endif
 
     this->num_points = npts_u64;
@@ -972,6 +1384,51 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         use_medoids_data_as_centroids();
     }
 
+#ifndef EXEC_ENV_OLS
+    std::string nav_index_file = std::string(disk_index_file) + "_nav.index";
+    std::string nav_ids_file = std::string(disk_index_file) + "_nav_ids.bin";
+    if (file_exists(nav_index_file) && file_exists(nav_ids_file))
+    {
+        size_t nav_num_points, nav_dim;
+        diskann::get_bin_metadata(nav_index_file + ".data", nav_num_points, nav_dim);
+        if (nav_dim != data_dim)
+        {
+            std::stringstream stream;
+            stream << "Error loading navigation index. Expected dimension " << data_dim << ", found " << nav_dim;
+            diskann::cerr << stream.str() << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+
+        std::unique_ptr<uint32_t[]> nav_ids;
+        size_t num_nav_ids, nav_ids_dim;
+        diskann::load_bin<uint32_t>(nav_ids_file, nav_ids, num_nav_ids, nav_ids_dim);
+        if (num_nav_ids != nav_num_points)
+        {
+            std::stringstream stream;
+            stream << "Error loading navigation index. " << nav_ids_file << " maps " << num_nav_ids
+                   << " points, but the navigation index has " << nav_num_points;
+            diskann::cerr << stream.str() << std::endl;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        for (size_t i = 0; i < num_nav_ids; i++)
+        {
+            if (nav_ids[i] >= this->num_points)
+            {
+                std::stringstream stream;
+                stream << "Error loading navigation index. " << nav_ids_file << " holds id " << nav_ids[i]
+                       << ", but the disk index has " << this->num_points << " points";
+                diskann::cerr << stream.str() << std::endl;
+                throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+            }
+        }
+        _nav_ids.assign(nav_ids.get(), nav_ids.get() + num_nav_ids);
+
+        _nav_index = std::make_unique<Index<T>>(diskann::Metric::L2, nav_dim);
+        _nav_index->load(nav_index_file.c_str(), num_threads, NAV_INDEX_SEARCH_L);
+        diskann::cout << "Loaded navigation index over " << num_nav_ids << " points" << std::endl;
+    }
+#endif
+
     std::string norm_file = std::string(disk_index_file) + "_max_base_norm.bin";
 
     if (file_exists(norm_file) && metric == diskann::Metric::INNER_PRODUCT)
@@ -1053,36 +1510,27 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 }
 
 template <typename T, typename LabelT>
-void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
-                                                 uint64_t *indices, float *distances, const uint64_t beam_width,
-                                                 const bool use_filter, const LabelT &filter_label,
-                                                 const uint32_t io_limit, const bool use_reorder_data,
-                                                 QueryStats *stats)
+typename PQFlashIndex<T, LabelT>::NumaReplica *PQFlashIndex<T, LabelT>::current_replica()
 {
-    int32_t filter_num = 0;
-    if (use_filter)
-    {
-        filter_num = get_filter_number(filter_label);
-        if (filter_num < 0)
-        {
-            if (!_use_universal_label)
-            {
-                return;
-            }
-            else
-            {
-                filter_num = _universal_filter_num;
-            }
-        }
-    }
-
-    if (beam_width > MAX_N_SECTOR_READS)
-        throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS", -1, __FUNCSIG__, __FILE__, __LINE__);
+    return numa_replicas.empty() ? nullptr : numa_replicas[get_current_numa_node() % numa_replicas.size()].get();
+}
 
-    ScratchStoreManager<SSDThreadData<T>> manager(this->thread_data);
-    auto data = manager.scratch_space();
-    IOContext &ctx = data->ctx;
-    auto query_scratch = &(data->scratch);
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::start_query(const T *query1, NumaReplica *replica, SSDThreadData<T> *thread_data,
+                                          const bool use_filter, const int32_t filter_num, QueryStats *stats,
+                                          QueryContext &query)
+{
+    // with NUMA replication, read only from the replica of the node this
+    // thread runs on
+    query.pq_data = replica != nullptr ? replica->data : this->data;
+    query.nhood_cache = replica != nullptr ? &replica->nhood_cache : &this->nhood_cache;
+    query.coord_cache = replica != nullptr ? &replica->coord_cache : &this->coord_cache;
+    query.thread_data = thread_data;
+    query.use_filter = use_filter;
+    query.filter_num = filter_num;
+    query.stats = stats;
+
+    auto query_scratch = &(thread_data->scratch);
     auto pq_query_scratch = query_scratch->_pq_scratch;
 
     // reset query scratch
@@ -1090,7 +1538,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
     // copy query to thread specific aligned and allocated memory (for distance
     // calculations we need aligned data)
-    float query_norm = 0;
+    query.query_norm = 0;
     T *aligned_query_T = query_scratch->aligned_query_T;
     float *query_float = pq_query_scratch->aligned_query_float;
     float *query_rotated = pq_query_scratch->rotated_query;
@@ -1102,15 +1550,15 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         for (size_t i = 0; i < this->data_dim - 1; i++)
         {
             aligned_query_T[i] = query1[i];
-            query_norm += query1[i] * query1[i];
+            query.query_norm += query1[i] * query1[i];
         }
         aligned_query_T[this->data_dim - 1] = 0;
 
-        query_norm = std::sqrt(query_norm);
+        query.query_norm = std::sqrt(query.query_norm);
 
         for (size_t i = 0; i < this->data_dim - 1; i++)
         {
-            aligned_query_T[i] = (T)(aligned_query_T[i] / query_norm);
+            aligned_query_T[i] = (T)(aligned_query_T[i] / query.query_norm);
         }
         pq_query_scratch->set(this->data_dim, aligned_query_T);
     }
@@ -1122,47 +1570,51 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         }
         pq_query_scratch->set(this->data_dim, aligned_query_T);
     }
+    // a shared scratch may hold the query of an index of more dimensions
+    memset(aligned_query_T + this->data_dim, 0, (this->aligned_dim - this->data_dim) * sizeof(T));
 
-    // pointers to buffers for data
-    T *data_buf = query_scratch->coord_scratch;
-    uint64_t &data_buf_idx = query_scratch->coord_idx;
-    _mm_prefetch((char *)data_buf, _MM_HINT_T1);
-
-    // sector scratch
-    char *sector_scratch = query_scratch->sector_scratch;
-    uint64_t &sector_scratch_idx = query_scratch->sector_idx;
+    _mm_prefetch((char *)query_scratch->coord_scratch, _MM_HINT_T1);
 
     // query <-> PQ chunk centers distances
-    pq_table.preprocess_query(query_rotated); // center the query and rotate if
-                                              // we have a rotation matrix
-    float *pq_dists = pq_query_scratch->aligned_pqtable_dist_scratch;
-    pq_table.populate_chunk_distances(query_rotated, pq_dists);
-
-    // query <-> neighbor list
-    float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
-    uint8_t *pq_coord_scratch = pq_query_scratch->aligned_pq_coord_scratch;
+    pq_table.preprocess_query(query_float, query_rotated); // center the query and rotate if
+                                                           // we have a rotation matrix
+    pq_table.populate_chunk_distances(query_rotated, pq_query_scratch->aligned_pqtable_dist_scratch);
 
-    // lambda to batch compute query<-> node distances in PQ space
-    auto compute_dists = [this, pq_coord_scratch, pq_dists](const uint32_t *ids, const uint64_t n_ids,
-                                                            float *dists_out) {
-        diskann::aggregate_coords(ids, n_ids, this->data, this->n_chunks, pq_coord_scratch);
-        diskann::pq_dist_lookup(pq_coord_scratch, n_ids, this->n_chunks, pq_dists, dists_out);
-    };
-    Timer query_timer, io_timer, cpu_timer;
+    query_scratch->visited.resize(num_points);
+    query.deleted_points = std::atomic_load(&_deleted_points);
+    query.query_timer.reset();
+}
 
-    tsl::robin_set<uint64_t> &visited = query_scratch->visited;
-    NeighborPriorityQueue &retset = query_scratch->retset;
-    retset.reserve(l_search);
-    std::vector<Neighbor> &full_retset = query_scratch->full_retset;
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::add_entry_points(QueryContext &query, const LabelT &filter_label,
+                                               NeighborPriorityQueue &retset)
+{
+    auto query_scratch = &(query.thread_data->scratch);
+    auto pq_query_scratch = query_scratch->_pq_scratch;
+    QueryStats *stats = query.stats;
 
+    std::vector<uint32_t> entry_points;
     uint32_t best_medoid = 0;
     float best_dist = (std::numeric_limits<float>::max)();
-    if (!use_filter)
+    if (!query.use_filter && _nav_index != nullptr && _num_nav_entry_points > 0)
+    {
+        entry_points.resize(_num_nav_entry_points);
+        auto nav_stats = _nav_index->search(query_scratch->aligned_query_T, _num_nav_entry_points,
+                                            NAV_INDEX_SEARCH_L, entry_points.data());
+        for (auto &entry_point : entry_points)
+            entry_point = _nav_ids[entry_point];
+        if (stats != nullptr)
+        {
+            stats->n_cmps += nav_stats.second;
+            stats->n_full_cmps += nav_stats.second;
+        }
+    }
+    else if (!query.use_filter)
     {
         for (uint64_t cur_m = 0; cur_m < num_medoids; cur_m++)
         {
-            float cur_expanded_dist =
-                dist_cmp_float->compare(query_float, centroid_data + aligned_dim * cur_m, (uint32_t)aligned_dim);
+            float cur_expanded_dist = dist_cmp_float->compare(
+                pq_query_scratch->aligned_query_float, centroid_data + aligned_dim * cur_m, (uint32_t)aligned_dim);
             if (cur_expanded_dist < best_dist)
             {
                 best_medoid = medoids[cur_m];
@@ -1179,221 +1631,308 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         throw ANNException("Cannot find medoid for specified filter.", -1, __FUNCSIG__, __FILE__, __LINE__);
     }
 
-    compute_dists(&best_medoid, 1, dist_scratch);
-    retset.insert(Neighbor(best_medoid, dist_scratch[0]));
-    visited.insert(best_medoid);
+    if (entry_points.empty())
+        entry_points.push_back(best_medoid);
 
-    uint32_t cmps = 0;
-    uint32_t hops = 0;
-    uint32_t num_ios = 0;
+    float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
+    compute_pq_dists(query, entry_points.data(), entry_points.size(), dist_scratch);
+    if (stats != nullptr)
+        stats->n_pq_cmps += (uint32_t)entry_points.size();
+    for (size_t i = 0; i < entry_points.size(); i++)
+    {
+        if (query_scratch->visited.insert(entry_points[i]))
+            retset.insert(Neighbor(entry_points[i], dist_scratch[i]));
+    }
+}
 
-    // cleared every iteration
-    std::vector<uint32_t> frontier;
-    frontier.reserve(2 * beam_width);
-    std::vector<std::pair<uint32_t, char *>> frontier_nhoods;
-    frontier_nhoods.reserve(2 * beam_width);
-    std::vector<AlignedRead> frontier_read_reqs;
-    frontier_read_reqs.reserve(2 * beam_width);
-    std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t *>>> cached_nhoods;
-    cached_nhoods.reserve(2 * beam_width);
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::compute_pq_dists(const QueryContext &query, const uint32_t *ids, const uint64_t n_ids,
+                                               float *dists_out)
+{
+    auto pq_query_scratch = query.thread_data->scratch._pq_scratch;
+    diskann::aggregate_coords(ids, n_ids, query.pq_data, this->n_chunks, pq_query_scratch->aligned_pq_coord_scratch);
+    diskann::pq_dist_lookup(pq_query_scratch->aligned_pq_coord_scratch, n_ids, this->n_chunks,
+                            pq_query_scratch->aligned_pqtable_dist_scratch, dists_out);
+}
 
-    while (retset.has_unexpanded_node() && num_ios < io_limit)
+template <typename T, typename LabelT>
+uint32_t PQFlashIndex<T, LabelT>::expand_beam(QueryContext &query, const std::vector<uint32_t> &beam,
+                                              NeighborPriorityQueue &retset, std::vector<Neighbor> *scored)
+{
+    if (beam.empty())
+        return 0;
+
+    IOContext &ctx = query.thread_data->ctx;
+    auto query_scratch = &(query.thread_data->scratch);
+    auto pq_query_scratch = query_scratch->_pq_scratch;
+    QueryStats *stats = query.stats;
+    T *aligned_query_T = query_scratch->aligned_query_T;
+    float *query_float = pq_query_scratch->aligned_query_float;
+    float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
+    VisitedSet &visited = query_scratch->visited;
+    std::vector<Neighbor> &full_retset = query_scratch->full_retset;
+
+    // pointers to buffers for data
+    T *data_buf = query_scratch->coord_scratch;
+    uint64_t &data_buf_idx = query_scratch->coord_idx;
+
+    // sector scratch
+    char *sector_scratch = query_scratch->sector_scratch;
+    uint64_t &sector_scratch_idx = query_scratch->sector_idx;
+    sector_scratch_idx = 0;
+
+    Timer io_timer, cpu_timer;
+    HopTrace *hop = nullptr;
+    if (stats != nullptr && stats->hops != nullptr)
     {
-        // clear iteration state
-        frontier.clear();
-        frontier_nhoods.clear();
-        frontier_read_reqs.clear();
-        cached_nhoods.clear();
-        sector_scratch_idx = 0;
-        // find new beam
-        uint32_t num_seen = 0;
-        while (retset.has_unexpanded_node() && frontier.size() < beam_width && num_seen < beam_width)
+        stats->hops->emplace_back();
+        hop = &stats->hops->back();
+        hop->start_us = (float)query.query_timer.elapsed();
+    }
+
+    // full precision distance of an expanded node, from its coordinates or
+    // their PQ codes if the disk index stores those
+    auto full_distance = [&](T *node_fp_coords) {
+        if (use_disk_index_pq)
         {
-            auto nbr = retset.closest_unexpanded();
-            num_seen++;
-            auto iter = nhood_cache.find(nbr.id);
-            if (iter != nhood_cache.end())
-            {
-                cached_nhoods.push_back(std::make_pair(nbr.id, iter->second));
-                if (stats != nullptr)
-                {
-                    stats->n_cache_hits++;
-                }
-            }
-            else
-            {
-                frontier.push_back(nbr.id);
-            }
-            if (this->count_visited_nodes)
-            {
-                reinterpret_cast<std::atomic<uint32_t> &>(this->node_visit_counter[nbr.id].second).fetch_add(1);
-            }
+            if (metric == diskann::Metric::INNER_PRODUCT)
+                return disk_pq_table.inner_product(query_float, (uint8_t *)node_fp_coords);
+            return disk_pq_table.l2_distance(query_float, (uint8_t *)node_fp_coords); // disk_pq does not support OPQ
         }
+        if (stats != nullptr)
+            stats->n_full_cmps++;
+        if (hop != nullptr)
+            hop->n_full_cmps++;
+        return dist_cmp->compare(aligned_query_T, node_fp_coords, (uint32_t)aligned_dim);
+    };
 
-        // read nhoods of frontier ids
-        if (!frontier.empty())
+    // scores the neighbors of an expanded node
+    auto process_nbrs = [&](const uint32_t *node_nbrs, const uint64_t nnbrs) {
+        // compute node_nbrs <-> query dists in PQ space
+        cpu_timer.reset();
+        compute_pq_dists(query, node_nbrs, nnbrs, dist_scratch);
+        if (stats != nullptr)
         {
-            if (stats != nullptr)
-                stats->n_hops++;
-            for (uint64_t i = 0; i < frontier.size(); i++)
-            {
-                auto id = frontier[i];
-                std::pair<uint32_t, char *> fnhood;
-                fnhood.first = id;
-                fnhood.second = sector_scratch + sector_scratch_idx * SECTOR_LEN;
-                sector_scratch_idx++;
-                frontier_nhoods.push_back(fnhood);
-                frontier_read_reqs.emplace_back(NODE_SECTOR_NO(((size_t)id)) * SECTOR_LEN, SECTOR_LEN, fnhood.second);
-                if (stats != nullptr)
-                {
-                    stats->n_4k++;
-                    stats->n_ios++;
-                }
-                num_ios++;
-            }
-            io_timer.reset();
-#ifdef USE_BING_INFRA
-            reader->read(frontier_read_reqs, ctx,
-                         true); // async reader windows.
-#else
-            reader->read(frontier_read_reqs, ctx); // synchronous IO linux
-#endif
-            if (stats != nullptr)
-            {
-                stats->io_us += (float)io_timer.elapsed();
-            }
+            stats->n_cmps += (uint32_t)nnbrs;
+            stats->n_pq_cmps += (uint32_t)nnbrs;
         }
+        if (hop != nullptr)
+            hop->n_pq_cmps += (uint32_t)nnbrs;
 
-        // process cached nhoods
-        for (auto &cached_nhood : cached_nhoods)
+        for (uint64_t m = 0; m < nnbrs; ++m)
         {
-            auto global_cache_iter = coord_cache.find(cached_nhood.first);
-            T *node_fp_coords_copy = global_cache_iter->second;
-            float cur_expanded_dist;
-            if (!use_disk_index_pq)
+            uint32_t id = node_nbrs[m];
+            if (visited.insert(id))
             {
-                cur_expanded_dist = dist_cmp->compare(aligned_query_T, node_fp_coords_copy, (uint32_t)aligned_dim);
+                if (!query.use_filter && _dummy_pts.find(id) != _dummy_pts.end())
+                    continue;
+
+                if (query.use_filter && !point_has_label(id, query.filter_num) &&
+                    !point_has_label(id, _universal_filter_num))
+                {
+                    if (stats != nullptr)
+                        stats->n_filter_rejects++;
+                    continue;
+                }
+                Neighbor nn(id, dist_scratch[m]);
+                retset.insert(nn);
+                if (scored != nullptr)
+                    scored->push_back(nn);
             }
-            else
+            else if (stats != nullptr)
             {
-                if (metric == diskann::Metric::INNER_PRODUCT)
-                    cur_expanded_dist = disk_pq_table.inner_product(query_float, (uint8_t *)node_fp_coords_copy);
-                else
-                    cur_expanded_dist = disk_pq_table.l2_distance( // disk_pq does not support OPQ yet
-                        query_float, (uint8_t *)node_fp_coords_copy);
+                stats->n_cmps_saved++;
             }
-            full_retset.push_back(Neighbor((uint32_t)cached_nhood.first, cur_expanded_dist));
+        }
+        if (stats != nullptr)
+            stats->cpu_us += (float)cpu_timer.elapsed();
+    };
 
-            uint64_t nnbrs = cached_nhood.second.first;
-            uint32_t *node_nbrs = cached_nhood.second.second;
+    std::vector<uint32_t> &frontier = query.frontier;
+    std::vector<std::pair<uint32_t, char *>> &frontier_nhoods = query.frontier_nhoods;
+    std::vector<AlignedRead> &frontier_read_reqs = query.frontier_read_reqs;
+    std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t *>>> &cached_nhoods = query.cached_nhoods;
+    frontier.clear();
+    frontier_nhoods.clear();
+    frontier_read_reqs.clear();
+    cached_nhoods.clear();
 
-            // compute node_nbrs <-> query dists in PQ space
-            cpu_timer.reset();
-            compute_dists(node_nbrs, nnbrs, dist_scratch);
+    for (const uint32_t id : beam)
+    {
+        auto iter = query.nhood_cache->find(id);
+        if (iter != query.nhood_cache->end())
+        {
+            cached_nhoods.push_back(std::make_pair(id, iter->second));
             if (stats != nullptr)
-            {
-                stats->n_cmps += (uint32_t)nnbrs;
-                stats->cpu_us += (float)cpu_timer.elapsed();
-            }
+                stats->n_cache_hits++;
+            if (hop != nullptr)
+                hop->n_cache_hits++;
+        }
+        else
+        {
+            frontier.push_back(id);
+        }
+        if (this->count_visited_nodes)
+        {
+            reinterpret_cast<std::atomic<uint32_t> &>(this->node_visit_counter[id].second).fetch_add(1);
+        }
+    }
 
-            // process prefetched nhood
-            for (uint64_t m = 0; m < nnbrs; ++m)
+    // read nhoods of frontier ids
+    if (!frontier.empty())
+    {
+        if (stats != nullptr)
+            stats->n_hops++;
+        for (uint64_t i = 0; i < frontier.size(); i++)
+        {
+            auto id = frontier[i];
+            std::pair<uint32_t, char *> fnhood;
+            fnhood.first = id;
+            fnhood.second = sector_scratch + sector_scratch_idx * SECTOR_LEN;
+            sector_scratch_idx++;
+            frontier_nhoods.push_back(fnhood);
+            frontier_read_reqs.emplace_back(NODE_SECTOR_NO(((size_t)id)) * SECTOR_LEN, SECTOR_LEN, fnhood.second);
+            if (stats != nullptr)
             {
-                uint32_t id = node_nbrs[m];
-                if (visited.insert(id).second)
-                {
-                    if (!use_filter && _dummy_pts.find(id) != _dummy_pts.end())
-                        continue;
-
-                    if (use_filter && !point_has_label(id, filter_num) && !point_has_label(id, _universal_filter_num))
-                        continue;
-                    cmps++;
-                    float dist = dist_scratch[m];
-                    Neighbor nn(id, dist);
-                    retset.insert(nn);
-                }
+                stats->n_4k++;
+                stats->n_ios++;
+                stats->read_size += SECTOR_LEN;
             }
         }
+        io_timer.reset();
 #ifdef USE_BING_INFRA
-        // process each frontier nhood - compute distances to unvisited nodes
-        int completedIndex = -1;
-        long requestCount = static_cast<long>(frontier_read_reqs.size());
-        // If we issued read requests and if a read is complete or there are
-        // reads in wait state, then enter the while loop.
-        while (requestCount > 0 && getNextCompletedRequest(ctx, requestCount, completedIndex))
-        {
-            assert(completedIndex >= 0);
-            auto &frontier_nhood = frontier_nhoods[completedIndex];
-            (*ctx.m_pRequestsStatus)[completedIndex] = IOContext::PROCESS_COMPLETE;
+        reader->read(frontier_read_reqs, ctx,
+                     true); // async reader windows.
 #else
-        for (auto &frontier_nhood : frontier_nhoods)
+        reader->read(frontier_read_reqs, ctx); // synchronous IO linux
+#endif
+        if (stats != nullptr)
         {
+            stats->io_us += (float)io_timer.elapsed();
+        }
+        if (hop != nullptr)
+        {
+            hop->io_us = (float)io_timer.elapsed();
+            hop->n_ios = (unsigned)frontier.size();
+        }
+    }
+
+    // process cached nhoods
+    for (auto &cached_nhood : cached_nhoods)
+    {
+        T *node_fp_coords_copy = query.coord_cache->find(cached_nhood.first)->second;
+        float cur_expanded_dist = full_distance(node_fp_coords_copy);
+        if (query.is_live(cached_nhood.first))
+            full_retset.push_back(Neighbor((uint32_t)cached_nhood.first, cur_expanded_dist));
+        process_nbrs(cached_nhood.second.second, cached_nhood.second.first);
+    }
+#ifdef USE_BING_INFRA
+    // process each frontier nhood - compute distances to unvisited nodes
+    int completedIndex = -1;
+    long requestCount = static_cast<long>(frontier_read_reqs.size());
+    // If we issued read requests and if a read is complete or there are
+    // reads in wait state, then enter the while loop.
+    while (requestCount > 0 && getNextCompletedRequest(ctx, requestCount, completedIndex))
+    {
+        assert(completedIndex >= 0);
+        auto &frontier_nhood = frontier_nhoods[completedIndex];
+        (*ctx.m_pRequestsStatus)[completedIndex] = IOContext::PROCESS_COMPLETE;
+#else
+    for (auto &frontier_nhood : frontier_nhoods)
+    {
 #endif
-            char *node_disk_buf = OFFSET_TO_NODE(frontier_nhood.second, frontier_nhood.first);
-            uint32_t *node_buf = OFFSET_TO_NODE_NHOOD(node_disk_buf);
-            uint64_t nnbrs = (uint64_t)(*node_buf);
-            T *node_fp_coords = OFFSET_TO_NODE_COORDS(node_disk_buf);
-            //        assert(data_buf_idx < MAX_N_CMPS);
-            if (data_buf_idx == MAX_N_CMPS)
-                data_buf_idx = 0;
-
-            T *node_fp_coords_copy = data_buf + (data_buf_idx * aligned_dim);
-            data_buf_idx++;
-            memcpy(node_fp_coords_copy, node_fp_coords, disk_bytes_per_point);
-            float cur_expanded_dist;
-            if (!use_disk_index_pq)
+        char *node_disk_buf = OFFSET_TO_NODE(frontier_nhood.second, frontier_nhood.first);
+        uint32_t *node_buf = OFFSET_TO_NODE_NHOOD(node_disk_buf);
+        uint64_t nnbrs = (uint64_t)(*node_buf);
+        T *node_fp_coords = OFFSET_TO_NODE_COORDS(node_disk_buf);
+        //        assert(data_buf_idx < MAX_N_CMPS);
+        if (data_buf_idx == MAX_N_CMPS)
+            data_buf_idx = 0;
+
+        T *node_fp_coords_copy = data_buf + (data_buf_idx * aligned_dim);
+        data_buf_idx++;
+        memcpy(node_fp_coords_copy, node_fp_coords, disk_bytes_per_point);
+        // zero the padding, which a shared scratch may hold from an index of more dimensions
+        memset((char *)node_fp_coords_copy + disk_bytes_per_point, 0, aligned_dim * sizeof(T) - disk_bytes_per_point);
+        float cur_expanded_dist = full_distance(node_fp_coords_copy);
+        if (query.is_live(frontier_nhood.first))
+            full_retset.push_back(Neighbor(frontier_nhood.first, cur_expanded_dist));
+        process_nbrs(node_buf + 1, nnbrs);
+    }
+    return (uint32_t)frontier.size();
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                                 uint64_t *indices, float *distances, const uint64_t beam_width,
+                                                 const bool use_filter, const LabelT &filter_label,
+                                                 const uint32_t io_limit, const bool use_reorder_data,
+                                                 QueryStats *stats)
+{
+    int32_t filter_num = 0;
+    if (use_filter)
+    {
+        filter_num = get_filter_number(filter_label);
+        if (filter_num < 0)
+        {
+            if (!_use_universal_label)
             {
-                cur_expanded_dist = dist_cmp->compare(aligned_query_T, node_fp_coords_copy, (uint32_t)aligned_dim);
+                return;
             }
             else
             {
-                if (metric == diskann::Metric::INNER_PRODUCT)
-                    cur_expanded_dist = disk_pq_table.inner_product(query_float, (uint8_t *)node_fp_coords_copy);
-                else
-                    cur_expanded_dist = disk_pq_table.l2_distance(query_float, (uint8_t *)node_fp_coords_copy);
-            }
-            full_retset.push_back(Neighbor(frontier_nhood.first, cur_expanded_dist));
-            uint32_t *node_nbrs = (node_buf + 1);
-            // compute node_nbrs <-> query dist in PQ space
-            cpu_timer.reset();
-            compute_dists(node_nbrs, nnbrs, dist_scratch);
-            if (stats != nullptr)
-            {
-                stats->n_cmps += (uint32_t)nnbrs;
-                stats->cpu_us += (float)cpu_timer.elapsed();
+                filter_num = _universal_filter_num;
             }
+        }
+    }
 
-            cpu_timer.reset();
-            // process prefetch-ed nhood
-            for (uint64_t m = 0; m < nnbrs; ++m)
-            {
-                uint32_t id = node_nbrs[m];
-                if (visited.insert(id).second)
-                {
-                    if (!use_filter && _dummy_pts.find(id) != _dummy_pts.end())
-                        continue;
+    if (beam_width > MAX_N_SECTOR_READS)
+        throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS", -1, __FUNCSIG__, __FILE__, __LINE__);
 
-                    if (use_filter && !point_has_label(id, filter_num) && !point_has_label(id, _universal_filter_num))
-                        continue;
-                    cmps++;
-                    float dist = dist_scratch[m];
-                    if (stats != nullptr)
-                    {
-                        stats->n_cmps++;
-                    }
+    NumaReplica *replica = current_replica();
+    Timer lock_timer;
+    ScratchStoreManager<SSDThreadData<T>> manager(replica != nullptr ? replica->thread_data : scratch_queue());
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
+    QueryContext query;
+    start_query(query1, replica, manager.scratch_space(), use_filter, filter_num, stats, query);
+    IOContext &ctx = query.thread_data->ctx;
+    auto query_scratch = &(query.thread_data->scratch);
+    T *aligned_query_T = query_scratch->aligned_query_T;
+    char *sector_scratch = query_scratch->sector_scratch;
 
-                    Neighbor nn(id, dist);
-                    retset.insert(nn);
-                }
-            }
+    NeighborPriorityQueue &retset = query_scratch->retset;
+    retset.reserve(l_search);
+    std::vector<Neighbor> &full_retset = query_scratch->full_retset;
 
-            if (stats != nullptr)
-            {
-                stats->cpu_us += (float)cpu_timer.elapsed();
-            }
-        }
+    // Deleted points are expanded like any other, but stay out of
+    // full_retset. retset grows by the number of deleted points it holds, so
+    // that it keeps about l_search live candidates.
+    const uint64_t max_l_search = query.deleted_points == nullptr ? l_search : l_search * MAX_TOMBSTONE_L_EXPANSION;
+
+    add_entry_points(query, filter_label, retset);
+
+    uint32_t num_ios = 0;
+    // cleared every iteration
+    std::vector<uint32_t> beam;
+    beam.reserve(beam_width);
+    while (retset.has_unexpanded_node() && num_ios < io_limit)
+    {
+        // find new beam
+        beam.clear();
+        while (retset.has_unexpanded_node() && beam.size() < beam_width)
+            beam.push_back(retset.closest_unexpanded().id);
+
+        num_ios += expand_beam(query, beam, retset, nullptr);
 
-        hops++;
+        if (retset.capacity() < max_l_search)
+        {
+            uint64_t num_deleted = 0;
+            for (size_t i = 0; i < retset.size(); i++)
+                num_deleted += !query.is_live(retset[i].id);
+            if (l_search + num_deleted > retset.capacity())
+                retset.reserve((std::min)(l_search + num_deleted, max_l_search));
+        }
     }
 
     // re-sort by distance
@@ -1423,10 +1962,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             {
                 stats->n_4k++;
                 stats->n_ios++;
+                stats->read_size += SECTOR_LEN;
             }
         }
 
-        io_timer.reset();
+        Timer io_timer;
 #ifdef USE_BING_INFRA
         reader->read(vec_read_reqs, ctx, false); // sync reader windows.
 #else
@@ -1443,6 +1983,8 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             auto location = (sector_scratch + i * SECTOR_LEN) + VECTOR_SECTOR_OFFSET(id);
             full_retset[i].distance = dist_cmp->compare(aligned_query_T, (T *)location, (uint32_t)this->data_dim);
         }
+        if (stats != nullptr)
+            stats->n_full_cmps += (uint32_t)full_retset.size();
 
         std::sort(full_retset.begin(), full_retset.end());
     }
@@ -1450,6 +1992,13 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     // copy k_search values
     for (uint64_t i = 0; i < k_search; i++)
     {
+        if (i >= full_retset.size())
+        {
+            indices[i] = std::numeric_limits<uint64_t>::max();
+            if (distances != nullptr)
+                distances[i] = std::numeric_limits<float>::max();
+            continue;
+        }
         indices[i] = full_retset[i].id;
         auto key = (uint32_t)indices[i];
         if (_dummy_pts.find(key) != _dummy_pts.end())
@@ -1467,7 +2016,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                 // rescale to revert back to original norms (cancelling the
                 // effect of base and query pre-processing)
                 if (max_base_norm != 0)
-                    distances[i] *= (max_base_norm * query_norm);
+                    distances[i] *= (max_base_norm * query.query_norm);
             }
         }
     }
@@ -1478,52 +2027,118 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
     if (stats != nullptr)
     {
-        stats->total_us = (float)query_timer.elapsed();
+        stats->total_us = (float)query.query_timer.elapsed();
     }
 }
 
-// range search returns results of all neighbors within distance of range.
-// indices and distances need to be pre-allocated of size l_search and the
-// return value is the number of matching hits.
+// Range search that resumes instead of restarting: when at least half of
+// the current search list is within range, the list doubles (up to
+// max_l_search) and the candidates that did not fit before are offered
+// again, so only the new frontier is read from disk.
+// With stop_beyond_range, for L2 and cosine the traversal also stops once
+// the closest unexpanded candidate is beyond range by more than
+// RANGE_SEARCH_PQ_SLACK in PQ distance. This trades recall for IOs: PQ
+// distances are approximate, and points in range can be reachable only
+// through points out of range.
+// Returns all the points found within range, sorted by distance.
 template <typename T, typename LabelT>
 uint32_t PQFlashIndex<T, LabelT>::range_search(const T *query1, const double range, const uint64_t min_l_search,
                                                const uint64_t max_l_search, std::vector<uint64_t> &indices,
                                                std::vector<float> &distances, const uint64_t min_beam_width,
-                                               QueryStats *stats)
+                                               QueryStats *stats, const bool stop_beyond_range)
 {
-    uint32_t res_count = 0;
+    NumaReplica *replica = current_replica();
+    Timer lock_timer;
+    ScratchStoreManager<SSDThreadData<T>> manager(replica != nullptr ? replica->thread_data : scratch_queue());
+    if (stats != nullptr)
+        stats->lock_wait_us += (float)lock_timer.elapsed();
+    QueryContext query;
+    start_query(query1, replica, manager.scratch_space(), false, 0, stats, query);
+    auto query_scratch = &(query.thread_data->scratch);
+
+    // distances as returned to the caller, see cached_beam_search
+    const float query_norm = query.query_norm;
+    auto to_output_distance = [this, query_norm](const float dist) {
+        if (metric != diskann::Metric::INNER_PRODUCT)
+            return dist;
+        return max_base_norm != 0 ? -dist * max_base_norm * query_norm : -dist;
+    };
+
+    const bool frontier_cutoff = stop_beyond_range && metric != diskann::Metric::INNER_PRODUCT;
+    const float pq_cutoff = (float)range * RANGE_SEARCH_PQ_SLACK;
+
+    NeighborPriorityQueue &retset = query_scratch->retset;
+    std::vector<Neighbor> &full_retset = query_scratch->full_retset;
+    uint64_t l_search = min_l_search;
+    retset.reserve(l_search);
+    // every candidate scored so far, and the ones expanded. Candidates that
+    // fall off retset are offered again when it grows.
+    std::vector<Neighbor> scored;
+    tsl::robin_set<uint32_t> expanded;
 
-    bool stop_flag = false;
+    add_entry_points(query, LabelT(), retset);
 
-    uint32_t l_search = (uint32_t)min_l_search; // starting size of the candidate list
-    while (!stop_flag)
+    std::vector<uint32_t> beam;
+    uint64_t num_in_range = 0;
+    bool frontier_out_of_range = false;
+    while (true)
     {
-        indices.resize(l_search);
-        distances.resize(l_search);
-        uint64_t cur_bw = min_beam_width > (l_search / 5) ? min_beam_width : l_search / 5;
-        cur_bw = (cur_bw > 100) ? 100 : cur_bw;
-        for (auto &x : distances)
-            x = std::numeric_limits<float>::max();
-        this->cached_beam_search(query1, l_search, l_search, indices.data(), distances.data(), cur_bw, false, stats);
-        for (uint32_t i = 0; i < l_search; i++)
+        uint64_t beam_width = (std::max)(min_beam_width, l_search / 5);
+        beam_width = (std::min)(beam_width, (uint64_t)100);
+
+        while (retset.has_unexpanded_node() && !frontier_out_of_range)
         {
-            if (distances[i] > (float)range)
+            beam.clear();
+            while (retset.has_unexpanded_node() && beam.size() < beam_width)
             {
-                res_count = i;
-                break;
+                auto nbr = retset.closest_unexpanded();
+                if (frontier_cutoff && num_in_range > 0 && nbr.distance > pq_cutoff)
+                {
+                    frontier_out_of_range = true;
+                    break;
+                }
+                expanded.insert(nbr.id);
+                beam.push_back(nbr.id);
             }
-            else if (i == l_search - 1)
-                res_count = l_search;
+
+            const size_t num_results = full_retset.size();
+            expand_beam(query, beam, retset, &scored);
+            for (size_t i = num_results; i < full_retset.size(); i++)
+                num_in_range += to_output_distance(full_retset[i].distance) <= (float)range;
         }
-        if (res_count < (uint32_t)(l_search / 2.0))
-            stop_flag = true;
-        l_search = l_search * 2;
-        if (l_search > max_l_search)
-            stop_flag = true;
-    }
-    indices.resize(res_count);
-    distances.resize(res_count);
-    return res_count;
+
+        // a search list mostly within range may have cut results off
+        if (frontier_out_of_range || num_in_range < l_search / 2.0 || l_search * 2 > max_l_search)
+            break;
+        l_search *= 2;
+        retset.reserve(l_search);
+        for (auto &candidate : scored)
+        {
+            if (expanded.find(candidate.id) == expanded.end())
+                retset.insert(candidate);
+        }
+    }
+
+    std::sort(full_retset.begin(), full_retset.end());
+    indices.clear();
+    distances.clear();
+    for (auto &neighbor : full_retset)
+    {
+        const float dist = to_output_distance(neighbor.distance);
+        if (dist > (float)range)
+            continue;
+        auto dummy_iter = _dummy_to_real_map.find(neighbor.id);
+        indices.push_back(dummy_iter == _dummy_to_real_map.end() ? neighbor.id : dummy_iter->second);
+        distances.push_back(dist);
+    }
+
+#ifdef USE_BING_INFRA
+    query.thread_data->ctx.m_completeCount = 0;
+#endif
+
+    if (stats != nullptr)
+        stats->total_us = (float)query.query_timer.elapsed();
+    return (uint32_t)indices.size();
 }
 
 template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_data_dim()
@@ -1531,6 +2146,32 @@ template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_dat
     return data_dim;
 }
 
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::use_shared_scratch(std::shared_ptr<SSDScratchPool<T>> scratch_pool)
+{
+#ifdef EXEC_ENV_OLS
+    throw ANNException("Shared scratch is not supported in the OLS environment", -1, __FUNCSIG__, __FILE__,
+                       __LINE__);
+#else
+    if (load_flag)
+        throw ANNException("use_shared_scratch must be called before load", -1, __FUNCSIG__, __FILE__, __LINE__);
+    _shared_scratch = scratch_pool;
+#endif
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_memory_usage()
+{
+    uint64_t pq_bytes = num_points * n_chunks + 2 * NUM_PQ_CENTROIDS * data_dim * sizeof(float);
+    uint64_t cache_bytes = nhood_cache.size() * ((max_degree + 1) * sizeof(uint32_t) + aligned_dim * sizeof(T));
+    return pq_bytes + cache_bytes;
+}
+
+template <typename T, typename LabelT>
+ConcurrentPool<SSDThreadData<T>> &PQFlashIndex<T, LabelT>::scratch_queue()
+{
+    return _shared_scratch != nullptr ? _shared_scratch->thread_data() : this->thread_data;
+}
+
 template <typename T, typename LabelT> diskann::Metric PQFlashIndex<T, LabelT>::get_metric()
 {
     return this->metric;
@@ -1558,8 +2199,12 @@ template <typename T, typename LabelT> char *PQFlashIndex<T, LabelT>::getHeaderB
 template class PQFlashIndex<uint8_t>;
 template class PQFlashIndex<int8_t>;
 template class PQFlashIndex<float>;
+template class PQFlashIndex<float16>;
+template class PQFlashIndex<bfloat16>;
 template class PQFlashIndex<uint8_t, uint16_t>;
 template class PQFlashIndex<int8_t, uint16_t>;
 template class PQFlashIndex<float, uint16_t>;
+template class PQFlashIndex<float16, uint16_t>;
+template class PQFlashIndex<bfloat16, uint16_t>;
 
 } // namespace diskann
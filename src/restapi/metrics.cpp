@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <restapi/metrics.h>
+
+namespace diskann
+{
+namespace
+{
+// name{labels,extra_label} or name{extra_label} without labels, and name
+// alone without either
+std::string sample_name(const std::string &name, const std::string &labels, const std::string &extra_label = "")
+{
+    std::string all_labels = labels;
+    if (!extra_label.empty())
+        all_labels += (all_labels.empty() ? "" : ",") + extra_label;
+    return all_labels.empty() ? name : name + "{" + all_labels + "}";
+}
+
+void write_help_and_type(std::ostringstream &out, const std::string &name, const std::string &type,
+                         const std::string &help)
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram() : _count(0), _sum(0)
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+        _counts[i].store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::get_bucket(const uint64_t value)
+{
+    if (value < ((uint64_t)1 << SUB_BUCKET_BITS))
+        return (uint32_t)value;
+    uint32_t exponent = 63;
+    while (!((value >> exponent) & 1))
+        exponent--;
+    const uint32_t sub_bucket = (uint32_t)(value >> (exponent - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return ((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::get_bucket_max(const uint32_t bucket)
+{
+    if (bucket < (1 << SUB_BUCKET_BITS))
+        return bucket;
+    const uint32_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    const uint64_t sub_bucket = bucket & ((1 << SUB_BUCKET_BITS) - 1);
+    const uint64_t lowest = (((uint64_t)1 << SUB_BUCKET_BITS) + sub_bucket) << shift;
+    return lowest + (((uint64_t)1 << shift) - 1);
+}
+
+void LatencyHistogram::record(const uint64_t value)
+{
+    _counts[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_count() const
+{
+    return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_sum() const
+{
+    return _sum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_percentile(const double fraction) const
+{
+    // the buckets rather than _count, which records may have moved past them
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        counts[i] = _counts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(fraction * total + 0.5);
+    rank = rank == 0 ? 1 : (rank > total ? total : rank);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return get_bucket_max(i);
+    }
+    return get_bucket_max(NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::write_prometheus(std::ostringstream &out, const std::string &name,
+                                        const std::string &labels) const
+{
+    const std::pair<double, const char *> quantiles[] = {{0.5, "0.5"}, {0.99, "0.99"}, {0.999, "0.999"}};
+    for (auto &quantile : quantiles)
+    {
+        out << sample_name(name, labels, std::string("quantile=\"") + quantile.second + "\"") << " "
+            << get_percentile(quantile.first) << "\n";
+    }
+    out << sample_name(name + "_sum", labels) << " " << get_sum() << "\n";
+    out << sample_name(name + "_count", labels) << " " << get_count() << "\n";
+}
+
+SearchMetrics::SearchMetrics() : _num_searches(0), _num_ios(0), _num_cache_hits(0)
+{
+}
+
+void SearchMetrics::record(const uint64_t latency_us, const QueryStats &stats)
+{
+    _num_searches.fetch_add(1, std::memory_order_relaxed);
+    _num_ios.fetch_add(stats.n_ios, std::memory_order_relaxed);
+    _num_cache_hits.fetch_add(stats.n_cache_hits, std::memory_order_relaxed);
+    _latency_us.record(latency_us);
+    _lock_wait_us.record((uint64_t)stats.lock_wait_us);
+    _ios.record(stats.n_ios);
+    _hops.record(stats.n_hops);
+}
+
+void SearchMetrics::write_prometheus(std::ostringstream &out, const uint32_t metric, const std::string &labels,
+                                     const bool write_headers) const
+{
+    switch (metric)
+    {
+    case 0:
+        if (write_headers)
+            write_help_and_type(out, "diskann_searches_total", "counter", "Searches served by the index.");
+        out << sample_name("diskann_searches_total", labels) << " "
+            << _num_searches.load(std::memory_order_relaxed) << "\n";
+        break;
+    case 1:
+        if (write_headers)
+            write_help_and_type(out, "diskann_ios_total", "counter", "Nodes read from disk by the searches.");
+        out << sample_name("diskann_ios_total", labels) << " " << _num_ios.load(std::memory_order_relaxed) << "\n";
+        break;
+    case 2:
+        if (write_headers)
+            write_help_and_type(out, "diskann_cache_hits_total", "counter",
+                                "Nodes the searches found in the node cache.");
+        out << sample_name("diskann_cache_hits_total", labels) << " "
+            << _num_cache_hits.load(std::memory_order_relaxed) << "\n";
+        break;
+    case 3:
+    {
+        if (write_headers)
+            write_help_and_type(out, "diskann_cache_hit_ratio", "gauge",
+                                "Fraction of the nodes the searches expanded that were in the node cache.");
+        const uint64_t hits = _num_cache_hits.load(std::memory_order_relaxed);
+        const uint64_t ios = _num_ios.load(std::memory_order_relaxed);
+        out << sample_name("diskann_cache_hit_ratio", labels) << " "
+            << (hits + ios == 0 ? 0.0 : (double)hits / (double)(hits + ios)) << "\n";
+        break;
+    }
+    case 4:
+        if (write_headers)
+            write_help_and_type(out, "diskann_search_latency_microseconds", "summary", "Latency of the searches.");
+        _latency_us.write_prometheus(out, "diskann_search_latency_microseconds", labels);
+        break;
+    case 5:
+        if (write_headers)
+            write_help_and_type(out, "diskann_scratch_wait_microseconds", "summary",
+                                "Time the searches waited for a scratch space and the index locks.");
+        _lock_wait_us.write_prometheus(out, "diskann_scratch_wait_microseconds", labels);
+        break;
+    case 6:
+        if (write_headers)
+            write_help_and_type(out, "diskann_search_ios", "summary", "Nodes read from disk per search.");
+        _ios.write_prometheus(out, "diskann_search_ios", labels);
+        break;
+    case 7:
+        if (write_headers)
+            write_help_and_type(out, "diskann_search_hops", "summary", "Hops per search.");
+        _hops.write_prometheus(out, "diskann_search_hops", labels);
+        break;
+    default:
+        break;
+    }
+}
+} // namespace diskann
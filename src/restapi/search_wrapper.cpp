@@ -112,11 +112,14 @@ SearchResult InMemorySearch<T>::search(const T *query, const unsigned int dimens
     unsigned int *indices = new unsigned int[K];
     float *distances = new float[K];
 
+    QueryStats stats;
     auto startTime = std::chrono::high_resolution_clock::now();
-    _index->search(query, K, Ls, indices, distances);
-    auto duration =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime)
+    _index->search(query, K, Ls, indices, distances, &stats);
+    auto duration_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime)
             .count();
+    _metrics.record(duration_us, stats);
+    auto duration = duration_us / 1000;
 
     std::string *tags = nullptr;
     if (_tags_enabled)
@@ -180,11 +183,14 @@ SearchResult PQFlashSearch<T>::search(const T *query, const unsigned int dimensi
     unsigned *indices = new unsigned[K];
     float *distances = new float[K];
 
+    QueryStats stats;
     auto startTime = std::chrono::high_resolution_clock::now();
-    _index->cached_beam_search(query, K, Ls, indices_u64, distances, DEFAULT_W);
-    auto duration =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime)
+    _index->cached_beam_search(query, K, Ls, indices_u64, distances, DEFAULT_W, false, &stats);
+    auto duration_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime)
             .count();
+    _metrics.record(duration_us, stats);
+    auto duration = duration_us / 1000;
     for (unsigned k = 0; k < K; ++k)
         indices[k] = indices_u64[k];
 
@@ -205,6 +211,52 @@ template <typename T> PQFlashSearch<T>::~PQFlashSearch()
 {
 }
 
+template <typename T>
+ManagedPQFlashSearch<T>::ManagedPQFlashSearch(std::shared_ptr<diskann::DiskIndexManager<T>> manager,
+                                              const std::string &indexPrefix, const std::string &tagsFile)
+    : BaseSearch(tagsFile), _manager(manager), _name(indexPrefix)
+{
+    _manager->add_index(_name, indexPrefix);
+}
+
+template <typename T>
+SearchResult ManagedPQFlashSearch<T>::search(const T *query, const unsigned int dimensions, const unsigned int K,
+                                             const unsigned int Ls)
+{
+    uint64_t *indices_u64 = new uint64_t[K];
+    unsigned *indices = new unsigned[K];
+    float *distances = new float[K];
+
+    QueryStats stats;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    _manager->search(_name, query, K, Ls, indices_u64, distances, DEFAULT_W, &stats);
+    auto duration_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime)
+            .count();
+    _metrics.record(duration_us, stats);
+    auto duration = duration_us / 1000;
+    for (unsigned k = 0; k < K; ++k)
+        indices[k] = indices_u64[k];
+
+    std::string *tags = nullptr;
+    if (_tags_enabled)
+    {
+        tags = new std::string[K];
+        lookup_tags(K, indices, tags);
+    }
+    SearchResult result(K, (unsigned int)duration, indices, distances, tags);
+    delete[] indices_u64;
+    delete[] indices;
+    delete[] distances;
+    delete[] tags;
+    return result;
+}
+
+template <typename T> ManagedPQFlashSearch<T>::~ManagedPQFlashSearch()
+{
+    _manager->remove_index(_name);
+}
+
 template class InMemorySearch<float>;
 template class InMemorySearch<int8_t>;
 template class InMemorySearch<uint8_t>;
@@ -212,4 +264,8 @@ template class InMemorySearch<uint8_t>;
 template class PQFlashSearch<float>;
 template class PQFlashSearch<int8_t>;
 template class PQFlashSearch<uint8_t>;
+
+template class ManagedPQFlashSearch<float>;
+template class ManagedPQFlashSearch<int8_t>;
+template class ManagedPQFlashSearch<uint8_t>;
 } // namespace diskann
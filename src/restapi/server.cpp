@@ -15,14 +15,19 @@ namespace diskann
 {
 
 Server::Server(web::uri &uri, std::vector<std::unique_ptr<diskann::BaseSearch>> &multi_searcher,
-               const std::string &typestring)
-    : _multi_search(multi_searcher.size() > 1 ? true : false)
+               const std::string &typestring, const bool route_by_partition)
+    : _multi_search(multi_searcher.size() > 1 ? true : false), _route_by_partition(route_by_partition),
+      _num_requests(0), _num_errors(0)
 {
     for (auto &searcher : multi_searcher)
         _multi_searcher.push_back(std::move(searcher));
 
     _listener = std::unique_ptr<web::http::experimental::listener::http_listener>(
         new web::http::experimental::listener::http_listener(uri));
+    // GET serves the metrics whatever the data type. For float, the search
+    // handler is registered for all methods, but a method's own handler takes
+    // priority over it, so GET requests never reach handle_post<float>.
+    _listener->support(web::http::methods::GET, std::bind(&Server::handle_get, this, std::placeholders::_1));
     if (typestring == std::string("float"))
     {
         _listener->support(std::bind(&Server::handle_post<float>, this, std::placeholders::_1));
@@ -56,6 +61,40 @@ pplx::task<void> Server::close()
     return _listener->close();
 }
 
+void Server::handle_get(web::http::http_request message)
+{
+    if (message.relative_uri().path() != U("/metrics"))
+    {
+        message.reply(web::http::status_codes::NotFound);
+        return;
+    }
+    message.reply(web::http::status_codes::OK, get_metrics(), "text/plain; version=0.0.4");
+}
+
+std::string Server::get_metrics()
+{
+    std::ostringstream out;
+    out << "# HELP diskann_requests_total Search requests received.\n"
+        << "# TYPE diskann_requests_total counter\n"
+        << "diskann_requests_total " << _num_requests.load(std::memory_order_relaxed) << "\n";
+    out << "# HELP diskann_request_errors_total Search requests that failed.\n"
+        << "# TYPE diskann_request_errors_total counter\n"
+        << "diskann_request_errors_total " << _num_errors.load(std::memory_order_relaxed) << "\n";
+    out << "# HELP diskann_request_latency_microseconds Latency of the search requests, across all searchers.\n"
+        << "# TYPE diskann_request_latency_microseconds summary\n";
+    _request_latency_us.write_prometheus(out, "diskann_request_latency_microseconds", "");
+
+    for (uint32_t metric = 0; metric < SearchMetrics::NUM_METRICS; metric++)
+    {
+        for (size_t i = 0; i < _multi_searcher.size(); i++)
+        {
+            _multi_searcher[i]->get_metrics().write_prometheus(out, metric, "searcher=\"" + std::to_string(i) + "\"",
+                                                               i == 0);
+        }
+    }
+    return out.str();
+}
+
 diskann::SearchResult Server::aggregate_results(const unsigned K, const std::vector<diskann::SearchResult> &results)
 {
     if (_multi_search)
@@ -86,7 +125,7 @@ diskann::SearchResult Server::aggregate_results(const unsigned K, const std::vec
             best_partitions[k] = best_partition;
             if (results[best_partition].tags_enabled())
                 best_tags[k] = results[best_partition].get_tags()[pos[best_partition]];
-            std::cout << best_partition << " " << pos[best_partition] << std::endl;
+            DISKANN_LOG(LogLevel::LL_Debug, best_partition << " " << pos[best_partition]);
             pos[best_partition]++;
         }
 
@@ -115,19 +154,29 @@ template <class T> void Server::handle_post(web::http::http_request message)
         .then([=](utility::string_t body) {
             int64_t queryId = -1;
             unsigned int K = 0;
+            _num_requests.fetch_add(1, std::memory_order_relaxed);
             try
             {
                 T *queryVector = nullptr;
                 unsigned int dimensions = 0;
                 unsigned int Ls;
-                parseJson(body, K, queryId, queryVector, dimensions, Ls);
+                int64_t partition;
+                parseJson(body, K, queryId, queryVector, dimensions, Ls, partition);
 
                 auto startTime = std::chrono::high_resolution_clock::now();
                 std::vector<diskann::SearchResult> results;
 
-                for (auto &searcher : _multi_searcher)
-                    results.push_back(searcher->search(queryVector, dimensions, (unsigned int)K, Ls));
-                diskann::SearchResult result = aggregate_results(K, results);
+                if (partition >= 0)
+                {
+                    results.push_back(
+                        _multi_searcher[partition]->search(queryVector, dimensions, (unsigned int)K, Ls));
+                }
+                else
+                {
+                    for (auto &searcher : _multi_searcher)
+                        results.push_back(searcher->search(queryVector, dimensions, (unsigned int)K, Ls));
+                }
+                diskann::SearchResult result = partition >= 0 ? results[0] : aggregate_results(K, results);
                 diskann::aligned_free(queryVector);
                 web::json::value response = prepareResponse(queryId, K);
                 response[INDICES_KEY] = idsToJsonArray(result);
@@ -137,23 +186,27 @@ template <class T> void Server::handle_post(web::http::http_request message)
                 if (result.partitions_enabled())
                     response[PARTITION_KEY] = partitionsToJsonArray(result);
 
-                response[TIME_TAKEN_KEY] = std::chrono::duration_cast<std::chrono::microseconds>(
-                                               std::chrono::high_resolution_clock::now() - startTime)
-                                               .count();
+                auto timeTaken = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - startTime)
+                                     .count();
+                response[TIME_TAKEN_KEY] = timeTaken;
+                _request_latency_us.record(timeTaken);
 
-                std::cout << "Responding to: " << queryId << std::endl;
+                DISKANN_LOG(LogLevel::LL_Debug, "Responding to: " << queryId);
                 return std::make_pair(web::http::status_codes::OK, response);
             }
             catch (const std::exception &ex)
             {
-                std::cerr << "Exception while processing query: " << queryId << ":" << ex.what() << std::endl;
+                _num_errors.fetch_add(1, std::memory_order_relaxed);
+                DISKANN_LOG(LogLevel::LL_Error, "Exception while processing query: " << queryId << ":" << ex.what());
                 web::json::value response = prepareResponse(queryId, K);
                 response[ERROR_MESSAGE_KEY] = web::json::value::string(ex.what());
                 return std::make_pair(web::http::status_codes::InternalError, response);
             }
             catch (...)
             {
-                std::cerr << "Uncaught exception while processing query: " << queryId;
+                _num_errors.fetch_add(1, std::memory_order_relaxed);
+                DISKANN_LOG(LogLevel::LL_Error, "Uncaught exception while processing query: " << queryId);
                 web::json::value response = prepareResponse(queryId, K);
                 response[ERROR_MESSAGE_KEY] = web::json::value::string(UNKNOWN_ERROR);
                 return std::make_pair(web::http::status_codes::InternalError, response);
@@ -166,7 +219,7 @@ template <class T> void Server::handle_post(web::http::http_request message)
             }
             catch (const std::exception &ex)
             {
-                std::cerr << "Exception while processing reply: " << ex.what() << std::endl;
+                DISKANN_LOG(LogLevel::LL_Error, "Exception while processing reply: " << ex.what());
             };
         });
 }
@@ -182,14 +235,15 @@ web::json::value Server::prepareResponse(const int64_t &queryId, const int k)
 
 template <class T>
 void Server::parseJson(const utility::string_t &body, unsigned int &k, int64_t &queryId, T *&queryVector,
-                       unsigned int &dimensions, unsigned &Ls)
+                       unsigned int &dimensions, unsigned &Ls, int64_t &partition)
 {
-    std::cout << body << std::endl;
+    DISKANN_LOG(LogLevel::LL_Debug, body);
     web::json::value val = web::json::value::parse(body);
     web::json::array queryArr = val.at(VECTOR_KEY).as_array();
     queryId = val.has_field(QUERY_ID_KEY) ? val.at(QUERY_ID_KEY).as_number().to_int64() : -1;
     Ls = val.has_field(L_KEY) ? val.at(L_KEY).as_number().to_uint32() : DEFAULT_L;
     k = val.at(K_KEY).as_integer();
+    partition = val.has_field(PARTITION_KEY) ? val.at(PARTITION_KEY).as_number().to_int64() : -1;
 
     if (k <= 0 || k > Ls)
     {
@@ -200,6 +254,15 @@ void Server::parseJson(const utility::string_t &body, unsigned int &k, int64_t &
     {
         throw new std::invalid_argument("Query vector has zero elements.");
     }
+    if (partition >= (int64_t)_multi_searcher.size() || (val.has_field(PARTITION_KEY) && partition < 0))
+    {
+        throw std::invalid_argument("Partition must be the position of one of the " +
+                                    std::to_string(_multi_searcher.size()) + " searchers.");
+    }
+    if (partition < 0 && _route_by_partition)
+    {
+        throw std::invalid_argument("Requests to this server must give the partition to search.");
+    }
 
     dimensions = static_cast<unsigned int>(queryArr.size());
     unsigned new_dim = ROUND_UP(dimensions, 8);
@@ -232,7 +295,7 @@ web::json::value Server::idsToJsonArray(const diskann::SearchResult &result)
         auto idVal = web::json::value::number(ids[i]);
         idArray[i] = idVal;
     }
-    std::cout << "Vector size: " << ids.size() << std::endl;
+    DISKANN_LOG(LogLevel::LL_Debug, "Vector size: " << ids.size());
     return idArray;
 }
 
@@ -2,7 +2,6 @@
 // Licensed under the MIT license.
 
 #include <vector>
-#include <boost/dynamic_bitset.hpp>
 
 #include "scratch.h"
 
@@ -14,7 +13,7 @@ namespace diskann
 template <typename T>
 InMemQueryScratch<T>::InMemQueryScratch(uint32_t search_l, uint32_t indexing_l, uint32_t r, uint32_t maxc, size_t dim,
                                         size_t aligned_dim, size_t alignment_factor, bool init_pq_scratch)
-    : _L(0), _R(r), _maxc(maxc)
+    : _L(0), _R(r), _maxc(maxc), _aligned_dim(aligned_dim), _alignment_factor(alignment_factor)
 {
     if (search_l == 0 || indexing_l == 0 || r == 0 || dim == 0)
     {
@@ -33,7 +32,6 @@ InMemQueryScratch<T>::InMemQueryScratch(uint32_t search_l, uint32_t indexing_l,
         _pq_scratch = nullptr;
 
     _occlude_factor.reserve(maxc);
-    _inserted_into_pool_bs = new boost::dynamic_bitset<>();
     _id_scratch.reserve((size_t)std::ceil(1.5 * GRAPH_SLACK_FACTOR * _R));
     _dist_scratch.reserve((size_t)std::ceil(1.5 * GRAPH_SLACK_FACTOR * _R));
 
@@ -46,8 +44,7 @@ template <typename T> void InMemQueryScratch<T>::clear()
     _best_l_nodes.clear();
     _occlude_factor.clear();
 
-    _inserted_into_pool_rs.clear();
-    _inserted_into_pool_bs->reset();
+    _inserted_into_pool.clear();
 
     _id_scratch.clear();
     _dist_scratch.clear();
@@ -65,10 +62,24 @@ template <typename T> void InMemQueryScratch<T>::resize_for_new_L(uint32_t new_l
         _pool.reserve(3 * _L + _R);
         _best_l_nodes.reserve(_L);
 
-        _inserted_into_pool_rs.reserve(20 * _L);
+        _inserted_into_pool.reserve(20 * _L);
     }
 }
 
+template <typename T> T *InMemQueryScratch<T>::occlude_tile(size_t num_vectors)
+{
+    if (num_vectors > _occlude_tile_capacity)
+    {
+        if (_occlude_tile != nullptr)
+            aligned_free(_occlude_tile);
+        _occlude_tile_capacity = std::max(num_vectors, (size_t)_maxc);
+        alloc_aligned(((void **)&_occlude_tile), _occlude_tile_capacity * _aligned_dim * sizeof(T),
+                      _alignment_factor * sizeof(T));
+        memset(_occlude_tile, 0, _occlude_tile_capacity * _aligned_dim * sizeof(T));
+    }
+    return _occlude_tile;
+}
+
 template <typename T> InMemQueryScratch<T>::~InMemQueryScratch()
 {
     if (_aligned_query != nullptr)
@@ -76,8 +87,12 @@ template <typename T> InMemQueryScratch<T>::~InMemQueryScratch()
         aligned_free(_aligned_query);
     }
 
+    if (_occlude_tile != nullptr)
+    {
+        aligned_free(_occlude_tile);
+    }
+
     delete _pq_scratch;
-    delete _inserted_into_pool_bs;
 }
 
 //
@@ -92,7 +107,8 @@ template <typename T> void SSDQueryScratch<T>::reset()
     full_retset.clear();
 }
 
-template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, size_t visited_reserve)
+template <typename T>
+SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, size_t visited_reserve) : visited(true)
 {
     size_t coord_alloc_size = ROUND_UP(MAX_N_CMPS * aligned_dim, 256);
 
@@ -127,15 +143,60 @@ template <typename T> void SSDThreadData<T>::clear()
     scratch.reset();
 }
 
+template <typename T>
+SSDScratchPool<T>::SSDScratchPool(std::shared_ptr<AlignedFileReader> io_reader, uint64_t num_threads,
+                                  uint64_t max_aligned_dim, uint64_t visited_reserve)
+    : _io_reader(io_reader), _num_threads(num_threads), _aligned_dim(ROUND_UP(max_aligned_dim, 8))
+{
+#ifdef _WINDOWS
+    throw ANNException("Shared SSD scratch is not supported on Windows, where IO contexts are bound to a file", -1,
+                       __FUNCSIG__, __FILE__, __LINE__);
+#else
+    diskann::cout << "Setting up " << num_threads << " shared scratch spaces for up to " << _aligned_dim
+                  << " dimensions" << std::endl;
+// omp parallel for to generate unique thread IDs
+#pragma omp parallel for num_threads((int)num_threads)
+    for (int64_t thread = 0; thread < (int64_t)num_threads; thread++)
+    {
+#pragma omp critical
+        {
+            SSDThreadData<T> *data = new SSDThreadData<T>(_aligned_dim, visited_reserve);
+            _io_reader->register_thread();
+            data->ctx = _io_reader->get_ctx();
+            _thread_data.push(data);
+        }
+    }
+#endif
+}
+
+template <typename T> SSDScratchPool<T>::~SSDScratchPool()
+{
+    ScratchStoreManager<SSDThreadData<T>> manager(_thread_data);
+    manager.destroy();
+    _io_reader->deregister_all_threads();
+}
+
 template DISKANN_DLLEXPORT class InMemQueryScratch<int8_t>;
 template DISKANN_DLLEXPORT class InMemQueryScratch<uint8_t>;
 template DISKANN_DLLEXPORT class InMemQueryScratch<float>;
+template DISKANN_DLLEXPORT class InMemQueryScratch<float16>;
+template DISKANN_DLLEXPORT class InMemQueryScratch<bfloat16>;
 
 template DISKANN_DLLEXPORT class SSDQueryScratch<int8_t>;
 template DISKANN_DLLEXPORT class SSDQueryScratch<uint8_t>;
 template DISKANN_DLLEXPORT class SSDQueryScratch<float>;
+template DISKANN_DLLEXPORT class SSDQueryScratch<float16>;
+template DISKANN_DLLEXPORT class SSDQueryScratch<bfloat16>;
 
 template DISKANN_DLLEXPORT class SSDThreadData<int8_t>;
 template DISKANN_DLLEXPORT class SSDThreadData<uint8_t>;
 template DISKANN_DLLEXPORT class SSDThreadData<float>;
+template DISKANN_DLLEXPORT class SSDThreadData<float16>;
+template DISKANN_DLLEXPORT class SSDThreadData<bfloat16>;
+
+template DISKANN_DLLEXPORT class SSDScratchPool<int8_t>;
+template DISKANN_DLLEXPORT class SSDScratchPool<uint8_t>;
+template DISKANN_DLLEXPORT class SSDScratchPool<float>;
+template DISKANN_DLLEXPORT class SSDScratchPool<float16>;
+template DISKANN_DLLEXPORT class SSDScratchPool<bfloat16>;
 } // namespace diskann
\ No newline at end of file
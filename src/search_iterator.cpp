@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+
+#include "search_iterator.h"
+
+namespace diskann
+{
+template <typename T, typename TagT, typename LabelT>
+SearchIterator<T, TagT, LabelT>::SearchIterator(Index<T, TagT, LabelT> &index, const T *query, const uint32_t L)
+    : _index(index), _manager(index._query_scratch), _scratch(_manager.scratch_space()), _L(L)
+{
+    if (L == 0)
+    {
+        throw ANNException("Set L to a value of at least 1", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (L > _scratch->get_L())
+    {
+        _scratch->resize_for_new_L(L);
+    }
+
+    const std::vector<LabelT> unused_filter_label;
+    const std::vector<uint32_t> init_ids = _index.get_init_ids();
+
+    std::shared_lock<std::shared_timed_mutex> lock(_index._update_lock);
+
+    _index._distance->preprocess_query(query, _index._data_store->get_dims(), _scratch->aligned_query());
+    _index.iterate_to_fixed_point(_scratch->aligned_query(), _L, init_ids, _scratch, false, unused_filter_label, true,
+                                  &_scored_nodes);
+    collect_expanded();
+}
+
+template <typename T, typename TagT, typename LabelT> bool SearchIterator<T, TagT, LabelT>::expand()
+{
+    NeighborPriorityQueue &best_L_nodes = _scratch->best_l_nodes();
+    if (_scored_nodes.size() <= best_L_nodes.size())
+        return false;
+
+    _L *= 2;
+    _scratch->resize_for_new_L(_L);
+    best_L_nodes.reserve(_L);
+    // candidates already in the list are skipped by insert, as their
+    // distances are the same
+    for (const Neighbor &nbr : _scored_nodes)
+    {
+        best_L_nodes.insert(nbr);
+    }
+    // insert marks them unexpanded, including those expanded before they
+    // fell out of the list
+    best_L_nodes.mark_expanded(_expanded);
+
+    const std::vector<LabelT> unused_filter_label;
+    const std::vector<uint32_t> no_init_ids;
+    _scratch->id_scratch().clear();
+    _scratch->dist_scratch().clear();
+    _index.iterate_to_fixed_point(_scratch->aligned_query(), _L, no_init_ids, _scratch, false, unused_filter_label,
+                                  true, &_scored_nodes);
+    collect_expanded();
+    return true;
+}
+
+template <typename T, typename TagT, typename LabelT> void SearchIterator<T, TagT, LabelT>::collect_expanded()
+{
+    for (const Neighbor &nbr : _scratch->pool())
+    {
+        _expanded.insert(nbr.id);
+    }
+    _scratch->pool().clear();
+}
+
+template <typename T, typename TagT, typename LabelT>
+size_t SearchIterator<T, TagT, LabelT>::next(const size_t K, uint32_t *indices, float *distances)
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_index._update_lock);
+
+    NeighborPriorityQueue &best_L_nodes = _scratch->best_l_nodes();
+    std::vector<Neighbor> page;
+    while (page.size() < K)
+    {
+        for (size_t i = 0; i < best_L_nodes.size() && page.size() < K; i++)
+        {
+            const uint32_t id = best_L_nodes[i].id;
+            // skip the frozen points
+            if (id >= _index._max_points || _returned.find(id) != _returned.end())
+                continue;
+            _returned.insert(id);
+            page.emplace_back(id, best_L_nodes[i].distance);
+        }
+        if (page.size() == K || !expand())
+            break;
+    }
+
+    // same as rerank_with_full_precision, within the page; pages are thus
+    // ordered by the approximate distances, see the header
+    if (_index._sq_data_store != nullptr && _index._sq_data_store->has_full_precision_data())
+    {
+        for (Neighbor &nbr : page)
+        {
+            nbr.distance = _index._sq_data_store->get_full_precision_distance(_scratch->aligned_query(), nbr.id);
+        }
+    }
+    // a page that spans an expand() holds points from both lists
+    std::sort(page.begin(), page.end());
+
+    for (size_t i = 0; i < page.size(); i++)
+    {
+        indices[i] = page[i].id;
+        if (distances != nullptr)
+        {
+#ifdef EXEC_ENV_OLS
+            // DLVS expects negative distances
+            distances[i] = page[i].distance;
+#else
+            distances[i] =
+                _index._dist_metric == diskann::Metric::INNER_PRODUCT ? -1 * page[i].distance : page[i].distance;
+#endif
+        }
+    }
+    return page.size();
+}
+
+template <typename T, typename TagT, typename LabelT> uint32_t SearchIterator<T, TagT, LabelT>::get_L() const
+{
+    return _L;
+}
+
+template <typename T, typename TagT, typename LabelT> size_t SearchIterator<T, TagT, LabelT>::get_num_cmps() const
+{
+    return _scored_nodes.size();
+}
+
+template DISKANN_DLLEXPORT class SearchIterator<float, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, int32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, uint32_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, int64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, uint64_t, uint32_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, uint64_t, uint32_t>;
+// Label with short int 2 byte
+template DISKANN_DLLEXPORT class SearchIterator<float, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, int32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, uint32_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, int64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<int8_t, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<uint8_t, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<float16, uint64_t, uint16_t>;
+template DISKANN_DLLEXPORT class SearchIterator<bfloat16, uint64_t, uint16_t>;
+
+} // namespace diskann
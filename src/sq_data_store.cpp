@@ -0,0 +1,668 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "sq_data_store.h"
+#include "huge_page_allocator.h"
+#include "simd_utils.h"
+#include "utils.h"
+
+// number of points read at a time when populating the store from a file
+#define SQ_FILE_BLOCK_SIZE 65536
+
+namespace diskann
+{
+namespace
+{
+struct SQSums
+{
+    float l2 = 0;
+    float dot = 0;
+    float a_sq = 0;
+    float b_sq = 0;
+};
+
+// level of dimension d in a code: one byte per dimension for SQ8, and two
+// dimensions per byte (even dimension in the low nibble) for SQ4
+inline uint32_t code_level(const uint8_t *code, const size_t d, const uint32_t num_bits)
+{
+    return num_bits == 8 ? code[d] : (code[d / 2] >> ((d & 1) * 4)) & 0x0F;
+}
+
+// Operand for the distance kernels that reads full precision vectors
+template <typename T> struct VectorOperand
+{
+    const T *vec;
+
+    float at(const size_t d) const
+    {
+        return (float)vec[d];
+    }
+
+#ifdef USE_AVX2
+    __m256 load8(const size_t d) const;
+#endif
+};
+
+#ifdef USE_AVX2
+template <> inline __m256 VectorOperand<float>::load8(const size_t d) const
+{
+    return _mm256_loadu_ps(vec + d);
+}
+
+template <> inline __m256 VectorOperand<int8_t>::load8(const size_t d) const
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(vec + d))));
+}
+
+template <> inline __m256 VectorOperand<uint8_t>::load8(const size_t d) const
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(vec + d))));
+}
+
+template <> inline __m256 VectorOperand<float16>::load8(const size_t d) const
+{
+#ifdef __F16C__
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(vec + d)));
+#else
+    float widened[8];
+    for (size_t i = 0; i < 8; i++)
+        widened[i] = vec[d + i];
+    return _mm256_loadu_ps(widened);
+#endif
+}
+
+template <> inline __m256 VectorOperand<bfloat16>::load8(const size_t d) const
+{
+    const __m256i widened = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(vec + d)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(widened, 16));
+}
+#endif
+
+// Operand for the distance kernels that decodes a scalar quantized vector
+struct CodeOperand
+{
+    const uint8_t *code;
+    uint32_t num_bits;
+    const float *mins;
+    const float *scales;
+
+    float at(const size_t d) const
+    {
+        return mins[d] + scales[d] * (float)code_level(code, d, num_bits);
+    }
+
+#ifdef USE_AVX2
+    // decodes dimensions [d, d + 8)
+    __m256 load8(const size_t d) const
+    {
+        __m128i levels;
+        if (num_bits == 8)
+        {
+            levels = _mm_loadl_epi64((const __m128i *)(code + d));
+        }
+        else
+        {
+            int32_t packed;
+            std::memcpy(&packed, code + d / 2, sizeof(packed));
+            const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+            const __m128i bytes = _mm_cvtsi32_si128(packed);
+            const __m128i lo = _mm_and_si128(bytes, nibble_mask);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+            levels = _mm_unpacklo_epi8(lo, hi);
+        }
+        const __m256 levels_ps = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(levels));
+        return _mm256_fmadd_ps(levels_ps, _mm256_loadu_ps(scales + d), _mm256_loadu_ps(mins + d));
+    }
+#endif
+};
+
+// Computes either the squared L2 distance (use_l2) or the inner product and
+// both squared norms over the first dim dimensions.
+template <typename A, typename B> SQSums compute_sums(const A &a, const B &b, const size_t dim, const bool use_l2)
+{
+    SQSums sums;
+    size_t d = 0;
+#ifdef USE_AVX2
+    if (use_l2)
+    {
+        __m256 l2 = _mm256_setzero_ps();
+        for (; d + 8 <= dim; d += 8)
+        {
+            const __m256 diff = _mm256_sub_ps(a.load8(d), b.load8(d));
+            l2 = _mm256_fmadd_ps(diff, diff, l2);
+        }
+        sums.l2 = _mm256_reduce_add_ps(l2);
+    }
+    else
+    {
+        __m256 dot = _mm256_setzero_ps(), a_sq = _mm256_setzero_ps(), b_sq = _mm256_setzero_ps();
+        for (; d + 8 <= dim; d += 8)
+        {
+            const __m256 a_vec = a.load8(d);
+            const __m256 b_vec = b.load8(d);
+            dot = _mm256_fmadd_ps(a_vec, b_vec, dot);
+            a_sq = _mm256_fmadd_ps(a_vec, a_vec, a_sq);
+            b_sq = _mm256_fmadd_ps(b_vec, b_vec, b_sq);
+        }
+        sums.dot = _mm256_reduce_add_ps(dot);
+        sums.a_sq = _mm256_reduce_add_ps(a_sq);
+        sums.b_sq = _mm256_reduce_add_ps(b_sq);
+    }
+#endif
+    for (; d < dim; d++)
+    {
+        const float a_d = a.at(d);
+        const float b_d = b.at(d);
+        sums.l2 += (a_d - b_d) * (a_d - b_d);
+        sums.dot += a_d * b_d;
+        sums.a_sq += a_d * a_d;
+        sums.b_sq += b_d * b_d;
+    }
+    return sums;
+}
+
+template <typename T> inline T level_to_value(const float value)
+{
+    if (std::is_floating_point<T>::value || is_half_float<T>::value)
+        return (T)value;
+    const float lo = (float)std::numeric_limits<T>::lowest(), hi = (float)std::numeric_limits<T>::max();
+    return (T)std::round(std::min(hi, std::max(lo, value)));
+}
+} // namespace
+
+template <typename data_t>
+SQDataStore<data_t>::SQDataStore(const location_t num_points, const size_t dim,
+                                 std::shared_ptr<Distance<data_t>> distance_fn, const uint32_t num_bits)
+    : AbstractDataStore<data_t>(num_points, dim), _num_bits(num_bits), _distance_fn(distance_fn)
+{
+    if (num_bits != 4 && num_bits != 8)
+    {
+        std::stringstream stream;
+        stream << "ERROR: Scalar quantization supports 4 or 8 bits per dimension, but " << num_bits
+               << " were requested." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    const diskann::Metric metric = _distance_fn->get_metric();
+    _use_l2 = (metric == diskann::Metric::L2 || metric == diskann::Metric::FAST_L2);
+    _max_level = (1u << num_bits) - 1;
+
+    _aligned_dim = ROUND_UP(dim, std::max((size_t)8, _distance_fn->get_required_alignment()));
+    _code_len = _aligned_dim * num_bits / 8;
+
+    alloc_aligned((void **)&_mins, _aligned_dim * sizeof(float), 8 * sizeof(float));
+    alloc_aligned((void **)&_scales, _aligned_dim * sizeof(float), 8 * sizeof(float));
+    std::memset(_mins, 0, _aligned_dim * sizeof(float));
+    std::memset(_scales, 0, _aligned_dim * sizeof(float));
+
+    alloc_aligned_huge((void **)&_codes, ROUND_UP(this->_capacity * _code_len, 64), 64);
+    std::memset(_codes, 0, this->_capacity * _code_len);
+}
+
+template <typename data_t> SQDataStore<data_t>::~SQDataStore()
+{
+    aligned_free_huge(_codes);
+    aligned_free(_mins);
+    aligned_free(_scales);
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::get_aligned_dim() const
+{
+    return _aligned_dim;
+}
+
+template <typename data_t> size_t SQDataStore<data_t>::get_alignment_factor() const
+{
+    return _distance_fn->get_required_alignment();
+}
+
+template <typename data_t> uint32_t SQDataStore<data_t>::get_num_bits() const
+{
+    return _num_bits;
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::train(const data_t *vectors, const size_t num_pts, std::vector<float> &dim_min,
+                                std::vector<float> &dim_max) const
+{
+    std::vector<data_t> prepared(_aligned_dim, 0);
+    for (size_t i = 0; i < num_pts; i++)
+    {
+        std::memcpy(prepared.data(), vectors + i * this->_dim, this->_dim * sizeof(data_t));
+        if (_distance_fn->preprocessing_required())
+        {
+            _distance_fn->preprocess_base_points(prepared.data(), _aligned_dim, 1);
+        }
+        for (size_t d = 0; d < this->_dim; d++)
+        {
+            dim_min[d] = std::min(dim_min[d], (float)prepared[d]);
+            dim_max[d] = std::max(dim_max[d], (float)prepared[d]);
+        }
+    }
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::set_quantizer(const std::vector<float> &dim_min, const std::vector<float> &dim_max)
+{
+    for (size_t d = 0; d < this->_dim; d++)
+    {
+        const float range = dim_max[d] - dim_min[d];
+        _mins[d] = dim_min[d];
+        _scales[d] = range > 0 ? range / (float)_max_level : 0.0f;
+    }
+    _trained = true;
+}
+
+template <typename data_t> void SQDataStore<data_t>::encode(const data_t *vector, uint8_t *code) const
+{
+    std::vector<data_t> prepared(_aligned_dim, 0);
+    std::memcpy(prepared.data(), vector, this->_dim * sizeof(data_t));
+    if (_distance_fn->preprocessing_required())
+    {
+        _distance_fn->preprocess_base_points(prepared.data(), _aligned_dim, 1);
+    }
+
+    std::memset(code, 0, _code_len);
+    for (size_t d = 0; d < this->_dim; d++)
+    {
+        uint32_t level = 0;
+        if (_scales[d] > 0)
+        {
+            const float scaled = std::round(((float)prepared[d] - _mins[d]) / _scales[d]);
+            level = (uint32_t)std::min((float)_max_level, std::max(0.0f, scaled));
+        }
+        if (_num_bits == 8)
+            code[d] = (uint8_t)level;
+        else
+            code[d / 2] |= (uint8_t)(level << ((d & 1) * 4));
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::decode(const uint8_t *code, float *out) const
+{
+    const CodeOperand operand{code, _num_bits, _mins, _scales};
+    for (size_t d = 0; d < _aligned_dim; d++)
+    {
+        out[d] = operand.at(d);
+    }
+}
+
+template <typename data_t>
+float SQDataStore<data_t>::distance_from_sums(const float l2, const float dot, const float a_sq,
+                                              const float b_sq) const
+{
+    switch (_distance_fn->get_metric())
+    {
+    case diskann::Metric::L2:
+    case diskann::Metric::FAST_L2:
+        return l2;
+    case diskann::Metric::INNER_PRODUCT:
+        return -dot;
+    default: {
+        const float norms = std::sqrt(a_sq * b_sq);
+        return norms > 0 ? 1.0f - dot / norms : 1.0f;
+    }
+    }
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::load(const std::string &filename)
+{
+    size_t file_num_points, file_dim;
+    if (!file_exists(filename))
+    {
+        std::stringstream stream;
+        stream << "ERROR: data file " << filename << " does not exist." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    diskann::get_bin_metadata(filename, file_num_points, file_dim);
+
+    std::ifstream reader(filename, std::ios::binary);
+    reader.seekg(2 * sizeof(uint32_t), reader.beg);
+    uint32_t file_num_bits = 0;
+    reader.read((char *)&file_num_bits, sizeof(uint32_t));
+
+    if (file_dim != this->_dim || file_num_bits != _num_bits)
+    {
+        std::stringstream stream;
+        stream << "ERROR: Driver requests loading " << this->_dim << " dimension with " << _num_bits
+               << " bits per dimension, but file has " << file_dim << " dimension with " << file_num_bits
+               << " bits per dimension." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    if (file_num_points > this->capacity())
+    {
+        this->resize((location_t)file_num_points);
+    }
+
+    reader.read((char *)_mins, this->_dim * sizeof(float));
+    reader.read((char *)_scales, this->_dim * sizeof(float));
+    reader.read((char *)_codes, file_num_points * _code_len);
+    _trained = true;
+
+    return (location_t)file_num_points;
+}
+
+// File layout: the usual bin header (#pts, #dims as int32) so that
+// get_bin_metadata works on it, followed by the number of bits, the
+// per-dimension mins and scales and finally the codes.
+template <typename data_t> size_t SQDataStore<data_t>::save(const std::string &filename, const location_t num_points)
+{
+    std::ofstream writer;
+    open_file_to_write(writer, filename);
+
+    int npts_i32 = (int)num_points, ndims_i32 = (int)this->_dim;
+    writer.write((char *)&npts_i32, sizeof(int));
+    writer.write((char *)&ndims_i32, sizeof(int));
+    writer.write((char *)&_num_bits, sizeof(uint32_t));
+    writer.write((char *)_mins, this->_dim * sizeof(float));
+    writer.write((char *)_scales, this->_dim * sizeof(float));
+    writer.write((char *)_codes, (size_t)num_points * _code_len);
+    writer.close();
+
+    return 3 * sizeof(uint32_t) + 2 * this->_dim * sizeof(float) + (size_t)num_points * _code_len;
+}
+
+template <typename data_t> void SQDataStore<data_t>::populate_data(const data_t *vectors, const location_t num_pts)
+{
+    std::vector<float> dim_min(this->_dim, std::numeric_limits<float>::max());
+    std::vector<float> dim_max(this->_dim, std::numeric_limits<float>::lowest());
+    train(vectors, num_pts, dim_min, dim_max);
+    set_quantizer(dim_min, dim_max);
+
+    for (location_t i = 0; i < num_pts; i++)
+    {
+        encode(vectors + (size_t)i * this->_dim, _codes + (size_t)i * _code_len);
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::populate_data(const std::string &filename, const size_t offset)
+{
+    size_t npts, ndim;
+    diskann::get_bin_metadata(filename, npts, ndim, offset);
+
+    if ((location_t)npts > this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Number of points in the file: " << filename
+           << " is greater than the capacity of data store: " << this->capacity()
+           << ". Must invoke resize before calling populate_data()" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+
+    if (ndim != this->get_dims())
+    {
+        std::stringstream ss;
+        ss << "Number of dimensions of a point in the file: " << filename
+           << " is not equal to dimensions of data store: " << this->get_dims() << "." << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+
+    // Stream the file twice, once to train and once to encode, so that the
+    // full precision vectors are never resident in memory all at once.
+    std::ifstream reader(filename, std::ios::binary);
+    const size_t block_size = std::min(npts, (size_t)SQ_FILE_BLOCK_SIZE);
+    std::vector<data_t> block(block_size * this->_dim);
+    std::vector<float> dim_min(this->_dim, std::numeric_limits<float>::max());
+    std::vector<float> dim_max(this->_dim, std::numeric_limits<float>::lowest());
+
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        reader.seekg(offset + 2 * sizeof(uint32_t), reader.beg);
+        for (size_t start = 0; start < npts; start += block_size)
+        {
+            const size_t cur_block = std::min(block_size, npts - start);
+            reader.read((char *)block.data(), cur_block * this->_dim * sizeof(data_t));
+            if (pass == 0)
+            {
+                train(block.data(), cur_block, dim_min, dim_max);
+                continue;
+            }
+            for (size_t i = 0; i < cur_block; i++)
+            {
+                encode(block.data() + i * this->_dim, _codes + (start + i) * _code_len);
+            }
+        }
+        if (pass == 0)
+        {
+            set_quantizer(dim_min, dim_max);
+        }
+    }
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::extract_data_to_bin(const std::string &filename, const location_t num_points)
+{
+    std::unique_ptr<data_t[]> decoded = std::make_unique<data_t[]>((size_t)num_points * this->_dim);
+    for (location_t i = 0; i < num_points; i++)
+    {
+        get_vector(i, decoded.get() + (size_t)i * this->_dim);
+    }
+    save_bin<data_t>(filename, decoded.get(), num_points, this->_dim);
+}
+
+template <typename data_t> void SQDataStore<data_t>::get_vector(const location_t i, data_t *dest) const
+{
+    const CodeOperand operand{_codes + (size_t)i * _code_len, _num_bits, _mins, _scales};
+    for (size_t d = 0; d < this->_dim; d++)
+    {
+        dest[d] = level_to_value<data_t>(operand.at(d));
+    }
+}
+
+template <typename data_t> void SQDataStore<data_t>::set_vector(const location_t loc, const data_t *const vector)
+{
+    if (!_trained)
+    {
+        throw diskann::ANNException("ERROR: SQDataStore must be populated before vectors can be set individually",
+                                    -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    encode(vector, _codes + (size_t)loc * _code_len);
+}
+
+template <typename data_t> void SQDataStore<data_t>::prefetch_vector(const location_t loc)
+{
+    const char *code = (const char *)_codes + (size_t)loc * _code_len;
+    for (size_t d = 0; d < _code_len; d += 64)
+        _mm_prefetch(code + d, _MM_HINT_T0);
+}
+
+template <typename data_t> float SQDataStore<data_t>::get_distance(const data_t *query, const location_t loc) const
+{
+    const VectorOperand<data_t> a{query};
+    const CodeOperand b{_codes + (size_t)loc * _code_len, _num_bits, _mins, _scales};
+    const SQSums sums = compute_sums(a, b, _aligned_dim, _use_l2);
+    return distance_from_sums(sums.l2, sums.dot, sums.a_sq, sums.b_sq);
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::get_distance(const data_t *query, const location_t *locations, const uint32_t location_count,
+                                       float *distances) const
+{
+    for (uint32_t i = 0; i < location_count; i++)
+    {
+        distances[i] = get_distance(query, locations[i]);
+    }
+}
+
+template <typename data_t> float SQDataStore<data_t>::get_distance(const location_t loc1, const location_t loc2) const
+{
+    const CodeOperand a{_codes + (size_t)loc1 * _code_len, _num_bits, _mins, _scales};
+    const CodeOperand b{_codes + (size_t)loc2 * _code_len, _num_bits, _mins, _scales};
+    const SQSums sums = compute_sums(a, b, _aligned_dim, _use_l2);
+    return distance_from_sums(sums.l2, sums.dot, sums.a_sq, sums.b_sq);
+}
+
+template <typename data_t> void SQDataStore<data_t>::set_full_precision_data(const std::string &filename)
+{
+    size_t file_num_points, file_dim;
+    if (!file_exists(filename))
+    {
+        std::stringstream stream;
+        stream << "ERROR: full precision data file " << filename << " does not exist." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    diskann::get_bin_metadata(filename, file_num_points, file_dim);
+    if (file_dim != this->_dim)
+    {
+        std::stringstream stream;
+        stream << "ERROR: full precision data file " << filename << " has " << file_dim
+               << " dimensions, but data store has " << this->_dim << "." << std::endl;
+        diskann::cerr << stream.str() << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _full_precision_mapper = std::make_unique<MemoryMapper>(filename);
+    _full_precision_data = (const data_t *)(_full_precision_mapper->getBuf() + 2 * sizeof(uint32_t));
+    _full_precision_num_points = (location_t)file_num_points;
+    diskann::cout << "Re-ranking with full precision vectors from " << filename << std::endl;
+}
+
+template <typename data_t> bool SQDataStore<data_t>::has_full_precision_data() const
+{
+    return _full_precision_data != nullptr;
+}
+
+template <typename data_t>
+float SQDataStore<data_t>::get_full_precision_distance(const data_t *query, const location_t loc) const
+{
+    if (loc >= _full_precision_num_points)
+    {
+        return get_distance(query, loc);
+    }
+    const VectorOperand<data_t> a{query};
+    const VectorOperand<data_t> b{_full_precision_data + (size_t)loc * this->_dim};
+    const SQSums sums = compute_sums(a, b, this->_dim, _use_l2);
+    return distance_from_sums(sums.l2, sums.dot, sums.a_sq, sums.b_sq);
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::expand(const location_t new_size)
+{
+    if (new_size == this->capacity())
+    {
+        return this->capacity();
+    }
+    else if (new_size < this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Cannot 'expand' datastore when new capacity (" << new_size << ") < existing capacity("
+           << this->capacity() << ")" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+    uint8_t *new_codes;
+    alloc_aligned_huge((void **)&new_codes, ROUND_UP((size_t)new_size * _code_len, 64), 64);
+    memcpy(new_codes, _codes, (size_t)this->capacity() * _code_len);
+    memset(new_codes + (size_t)this->capacity() * _code_len, 0, (size_t)(new_size - this->capacity()) * _code_len);
+    aligned_free_huge(_codes);
+    _codes = new_codes;
+    this->_capacity = new_size;
+    return this->_capacity;
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::shrink(const location_t new_size)
+{
+    if (new_size == this->capacity())
+    {
+        return this->capacity();
+    }
+    else if (new_size > this->capacity())
+    {
+        std::stringstream ss;
+        ss << "Cannot 'shrink' datastore when new capacity (" << new_size << ") > existing capacity("
+           << this->capacity() << ")" << std::endl;
+        throw diskann::ANNException(ss.str(), -1);
+    }
+    uint8_t *new_codes;
+    alloc_aligned_huge((void **)&new_codes, ROUND_UP((size_t)new_size * _code_len, 64), 64);
+    memcpy(new_codes, _codes, (size_t)new_size * _code_len);
+    aligned_free_huge(_codes);
+    _codes = new_codes;
+    this->_capacity = new_size;
+    return this->_capacity;
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::move_vectors(const location_t old_location_start, const location_t new_location_start,
+                                       const location_t num_locations)
+{
+    if (num_locations == 0 || old_location_start == new_location_start)
+    {
+        return;
+    }
+
+    // The [start, end) interval which will contain obsolete points to be
+    // cleared. Same as InMemDataStore::move_vectors.
+    uint32_t mem_clear_loc_start = old_location_start;
+    uint32_t mem_clear_loc_end_limit = old_location_start + num_locations;
+
+    if (new_location_start < old_location_start)
+    {
+        if (mem_clear_loc_start < new_location_start + num_locations)
+        {
+            mem_clear_loc_start = new_location_start + num_locations;
+        }
+    }
+    else
+    {
+        if (mem_clear_loc_end_limit > new_location_start)
+        {
+            mem_clear_loc_end_limit = new_location_start;
+        }
+    }
+
+    copy_vectors(old_location_start, new_location_start, num_locations);
+    memset(_codes + _code_len * mem_clear_loc_start, 0,
+           _code_len * (mem_clear_loc_end_limit - mem_clear_loc_start));
+}
+
+template <typename data_t>
+void SQDataStore<data_t>::copy_vectors(const location_t from_loc, const location_t to_loc, const location_t num_points)
+{
+    assert(from_loc < this->_capacity);
+    assert(to_loc < this->_capacity);
+    assert(num_points < this->_capacity);
+    memmove(_codes + _code_len * to_loc, _codes + _code_len * from_loc, (size_t)num_points * _code_len);
+}
+
+template <typename data_t> location_t SQDataStore<data_t>::calculate_medoid() const
+{
+    std::vector<float> center(_aligned_dim, 0), decoded(_aligned_dim);
+    for (location_t i = 0; i < this->capacity(); i++)
+    {
+        decode(_codes + (size_t)i * _code_len, decoded.data());
+        for (size_t j = 0; j < _aligned_dim; j++)
+            center[j] += decoded[j];
+    }
+    for (size_t j = 0; j < _aligned_dim; j++)
+        center[j] /= (float)this->capacity();
+
+    uint32_t min_idx = 0;
+    float min_dist = std::numeric_limits<float>::max();
+    for (location_t i = 0; i < this->capacity(); i++)
+    {
+        const VectorOperand<float> a{center.data()};
+        const CodeOperand b{_codes + (size_t)i * _code_len, _num_bits, _mins, _scales};
+        const float dist = compute_sums(a, b, _aligned_dim, true).l2;
+        if (dist < min_dist)
+        {
+            min_idx = i;
+            min_dist = dist;
+        }
+    }
+    return min_idx;
+}
+
+template DISKANN_DLLEXPORT class SQDataStore<float>;
+template DISKANN_DLLEXPORT class SQDataStore<int8_t>;
+template DISKANN_DLLEXPORT class SQDataStore<uint8_t>;
+template DISKANN_DLLEXPORT class SQDataStore<float16>;
+template DISKANN_DLLEXPORT class SQDataStore<bfloat16>;
+
+} // namespace diskann
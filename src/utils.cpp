@@ -434,6 +434,10 @@ template DISKANN_DLLEXPORT void load_bin<int64_t>(AlignedFileReader &reader, std
                                                   size_t &npts, size_t &ndim, size_t offset);
 template DISKANN_DLLEXPORT void load_bin<float>(AlignedFileReader &reader, std::unique_ptr<float[]> &data, size_t &npts,
                                                 size_t &ndim, size_t offset);
+template DISKANN_DLLEXPORT void load_bin<float16>(AlignedFileReader &reader, std::unique_ptr<float16[]> &data,
+                                                  size_t &npts, size_t &ndim, size_t offset);
+template DISKANN_DLLEXPORT void load_bin<bfloat16>(AlignedFileReader &reader, std::unique_ptr<bfloat16[]> &data,
+                                                   size_t &npts, size_t &ndim, size_t offset);
 
 template DISKANN_DLLEXPORT void load_bin<uint8_t>(AlignedFileReader &reader, uint8_t *&data, size_t &npts, size_t &ndim,
                                                   size_t offset);
@@ -445,6 +449,10 @@ template DISKANN_DLLEXPORT void load_bin<uint32_t>(AlignedFileReader &reader, ui
                                                    size_t &ndim, size_t offset);
 template DISKANN_DLLEXPORT void load_bin<int32_t>(AlignedFileReader &reader, int32_t *&data, size_t &npts, size_t &ndim,
                                                   size_t offset);
+template DISKANN_DLLEXPORT void load_bin<float16>(AlignedFileReader &reader, float16 *&data, size_t &npts, size_t &ndim,
+                                                  size_t offset);
+template DISKANN_DLLEXPORT void load_bin<bfloat16>(AlignedFileReader &reader, bfloat16 *&data, size_t &npts,
+                                                   size_t &ndim, size_t offset);
 
 template DISKANN_DLLEXPORT void copy_aligned_data_from_file<uint8_t>(AlignedFileReader &reader, uint8_t *&data,
                                                                      size_t &npts, size_t &dim,
@@ -455,6 +463,12 @@ template DISKANN_DLLEXPORT void copy_aligned_data_from_file<int8_t>(AlignedFileR
 template DISKANN_DLLEXPORT void copy_aligned_data_from_file<float>(AlignedFileReader &reader, float *&data,
                                                                    size_t &npts, size_t &dim, const size_t &rounded_dim,
                                                                    size_t offset);
+template DISKANN_DLLEXPORT void copy_aligned_data_from_file<float16>(AlignedFileReader &reader, float16 *&data,
+                                                                     size_t &npts, size_t &dim,
+                                                                     const size_t &rounded_dim, size_t offset);
+template DISKANN_DLLEXPORT void copy_aligned_data_from_file<bfloat16>(AlignedFileReader &reader, bfloat16 *&data,
+                                                                      size_t &npts, size_t &dim,
+                                                                      const size_t &rounded_dim, size_t offset);
 
 template DISKANN_DLLEXPORT void read_array<char>(AlignedFileReader &reader, char *data, size_t size, size_t offset);
 
@@ -464,12 +478,18 @@ template DISKANN_DLLEXPORT void read_array<int8_t>(AlignedFileReader &reader, in
 template DISKANN_DLLEXPORT void read_array<uint32_t>(AlignedFileReader &reader, uint32_t *data, size_t size,
                                                      size_t offset);
 template DISKANN_DLLEXPORT void read_array<float>(AlignedFileReader &reader, float *data, size_t size, size_t offset);
+template DISKANN_DLLEXPORT void read_array<float16>(AlignedFileReader &reader, float16 *data, size_t size,
+                                                    size_t offset);
+template DISKANN_DLLEXPORT void read_array<bfloat16>(AlignedFileReader &reader, bfloat16 *data, size_t size,
+                                                     size_t offset);
 
 template DISKANN_DLLEXPORT void read_value<uint8_t>(AlignedFileReader &reader, uint8_t &value, size_t offset);
 template DISKANN_DLLEXPORT void read_value<int8_t>(AlignedFileReader &reader, int8_t &value, size_t offset);
 template DISKANN_DLLEXPORT void read_value<float>(AlignedFileReader &reader, float &value, size_t offset);
 template DISKANN_DLLEXPORT void read_value<uint32_t>(AlignedFileReader &reader, uint32_t &value, size_t offset);
 template DISKANN_DLLEXPORT void read_value<uint64_t>(AlignedFileReader &reader, uint64_t &value, size_t offset);
+template DISKANN_DLLEXPORT void read_value<float16>(AlignedFileReader &reader, float16 &value, size_t offset);
+template DISKANN_DLLEXPORT void read_value<bfloat16>(AlignedFileReader &reader, bfloat16 &value, size_t offset);
 
 #endif
 
@@ -18,6 +18,7 @@ int main(int argc, char **argv)
         label_type;
     uint32_t num_threads, R, L, disk_PQ, build_PQ, QD, Lf, filter_threshold;
     float B, M;
+    double nav_sampling_rate;
     bool append_reorder_data = false;
     bool use_opq = false;
 
@@ -25,7 +26,8 @@ int main(int argc, char **argv)
     try
     {
         desc.add_options()("help,h", "Print information on arguments");
-        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                           "data type <int8/uint8/float/float16/bfloat16>");
         desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(), "distance function <l2/mips>");
         desc.add_options()("data_path", po::value<std::string>(&data_path)->required(),
                            "Input data file in bin format");
@@ -76,6 +78,9 @@ int main(int argc, char **argv)
         desc.add_options()("label_type", po::value<std::string>(&label_type)->default_value("uint"),
                            "Storage type of Labels <uint/ushort>, default value is uint which "
                            "will consume memory 4 bytes per filter");
+        desc.add_options()("nav_sampling_rate", po::value<double>(&nav_sampling_rate)->default_value(0.0),
+                           "Fraction of the points to build an in-memory navigation index over, which "
+                           "searches use to find their entry points, e.g. 0.01; 0 for none");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -144,15 +149,23 @@ int main(int argc, char **argv)
             if (data_type == std::string("int8"))
                 return diskann::build_disk_index<int8_t>(data_path.c_str(), index_path_prefix.c_str(), params.c_str(),
                                                          metric, use_opq, codebook_prefix, use_filters, label_file,
-                                                         universal_label, filter_threshold, Lf);
+                                                         universal_label, filter_threshold, Lf, nav_sampling_rate);
             else if (data_type == std::string("uint8"))
                 return diskann::build_disk_index<uint8_t, uint16_t>(
                     data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
-                    use_filters, label_file, universal_label, filter_threshold, Lf);
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
             else if (data_type == std::string("float"))
                 return diskann::build_disk_index<float, uint16_t>(
                     data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
-                    use_filters, label_file, universal_label, filter_threshold, Lf);
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
+            else if (data_type == std::string("float16"))
+                return diskann::build_disk_index<diskann::float16, uint16_t>(
+                    data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
+            else if (data_type == std::string("bfloat16"))
+                return diskann::build_disk_index<diskann::bfloat16, uint16_t>(
+                    data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
             else
             {
                 diskann::cerr << "Error. Unsupported data type" << std::endl;
@@ -164,15 +177,23 @@ int main(int argc, char **argv)
             if (data_type == std::string("int8"))
                 return diskann::build_disk_index<int8_t>(data_path.c_str(), index_path_prefix.c_str(), params.c_str(),
                                                          metric, use_opq, codebook_prefix, use_filters, label_file,
-                                                         universal_label, filter_threshold, Lf);
+                                                         universal_label, filter_threshold, Lf, nav_sampling_rate);
             else if (data_type == std::string("uint8"))
                 return diskann::build_disk_index<uint8_t>(data_path.c_str(), index_path_prefix.c_str(), params.c_str(),
                                                           metric, use_opq, codebook_prefix, use_filters, label_file,
-                                                          universal_label, filter_threshold, Lf);
+                                                          universal_label, filter_threshold, Lf, nav_sampling_rate);
             else if (data_type == std::string("float"))
                 return diskann::build_disk_index<float>(data_path.c_str(), index_path_prefix.c_str(), params.c_str(),
                                                         metric, use_opq, codebook_prefix, use_filters, label_file,
-                                                        universal_label, filter_threshold, Lf);
+                                                        universal_label, filter_threshold, Lf, nav_sampling_rate);
+            else if (data_type == std::string("float16"))
+                return diskann::build_disk_index<diskann::float16>(
+                    data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
+            else if (data_type == std::string("bfloat16"))
+                return diskann::build_disk_index<diskann::bfloat16>(
+                    data_path.c_str(), index_path_prefix.c_str(), params.c_str(), metric, use_opq, codebook_prefix,
+                    use_filters, label_file, universal_label, filter_threshold, Lf, nav_sampling_rate);
             else
             {
                 diskann::cerr << "Error. Unsupported data type" << std::endl;
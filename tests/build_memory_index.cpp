@@ -24,13 +24,18 @@ template <typename T, typename TagT = uint32_t, typename LabelT = uint32_t>
 int build_in_memory_index(const diskann::Metric &metric, const std::string &data_path, const uint32_t R,
                           const uint32_t L, const float alpha, const std::string &save_path, const uint32_t num_threads,
                           const bool use_pq_build, const size_t num_pq_bytes, const bool use_opq,
-                          const std::string &label_file, const std::string &universal_label, const uint32_t Lf)
+                          const std::string &label_file, const std::string &universal_label, const uint32_t Lf,
+                          const uint32_t sq_bits, const uint32_t insert_batch_size,
+                          const bool deterministic_build, const uint32_t num_entry_points,
+                          const bool optimized_layout)
 {
     diskann::IndexWriteParameters paras = diskann::IndexWriteParametersBuilder(L, R)
                                               .with_filter_list_size(Lf)
                                               .with_alpha(alpha)
                                               .with_saturate_graph(false)
                                               .with_num_threads(num_threads)
+                                              .with_insert_batch_size(insert_batch_size)
+                                              .with_deterministic_build(deterministic_build)
                                               .build();
     std::string labels_file_to_use = save_path + "_label_formatted.txt";
     std::string mem_labels_int_map_file = save_path + "_labels_map.txt";
@@ -39,7 +44,7 @@ int build_in_memory_index(const diskann::Metric &metric, const std::string &data
     diskann::get_bin_metadata(data_path, data_num, data_dim);
 
     diskann::Index<T, TagT, LabelT> index(metric, data_dim, data_num, false, false, false, use_pq_build, num_pq_bytes,
-                                          use_opq);
+                                          use_opq, 0, sq_bits);
     auto s = std::chrono::high_resolution_clock::now();
     if (label_file == "")
     {
@@ -58,6 +63,10 @@ int build_in_memory_index(const diskann::Metric &metric, const std::string &data
     std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - s;
 
     std::cout << "Indexing time: " << diff.count() << "\n";
+    if (num_entry_points > 0)
+        index.build_entry_points(num_entry_points);
+    if (optimized_layout)
+        index.optimize_index_layout();
     index.save(save_path.c_str());
     if (label_file != "")
         std::remove(labels_file_to_use.c_str());
@@ -67,15 +76,16 @@ int build_in_memory_index(const diskann::Metric &metric, const std::string &data
 int main(int argc, char **argv)
 {
     std::string data_type, dist_fn, data_path, index_path_prefix, label_file, universal_label, label_type;
-    uint32_t num_threads, R, L, Lf, build_PQ_bytes;
+    uint32_t num_threads, R, L, Lf, build_PQ_bytes, sq_bits, insert_batch_size, num_entry_points;
     float alpha;
-    bool use_pq_build, use_opq;
+    bool use_pq_build, use_opq, deterministic_build, optimized_layout;
 
     po::options_description desc{"Arguments"};
     try
     {
         desc.add_options()("help,h", "Print information on arguments");
-        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                           "data type <int8/uint8/float/float16/bfloat16>");
         desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(),
                            "distance function <l2/mips/cosine>");
         desc.add_options()("data_path", po::value<std::string>(&data_path)->required(),
@@ -99,6 +109,17 @@ int main(int argc, char **argv)
                            "Set true for OPQ compression while using PQ "
                            "distance comparisons for "
                            "building the index, and false for PQ compression");
+        desc.add_options()("sq_bits", po::value<uint32_t>(&sq_bits)->default_value(0),
+                           "Bits per dimension <4/8> for storing the data scalar quantized; "
+                           "0 for full precision data");
+        desc.add_options()("insert_batch_size", po::value<uint32_t>(&insert_batch_size)->default_value(0),
+                           "Link points in rounds of up to this many points, merging their "
+                           "reverse edges once per round (a few percent of the points keeps recall "
+                           "on par); 0 to insert reverse edges per point");
+        desc.add_options()("deterministic_build", po::bool_switch()->default_value(false),
+                           "Insert points in doubling batches against a frozen snapshot of the graph, "
+                           "so that the graph is identical for any number of threads. Batches grow up "
+                           "to insert_batch_size, or 2% of the points if it is 0");
         desc.add_options()("label_file", po::value<std::string>(&label_file)->default_value(""),
                            "Input label file in txt format for Filtered Index search. "
                            "The file should contain comma separated filters for each node "
@@ -112,6 +133,12 @@ int main(int argc, char **argv)
         desc.add_options()("label_type", po::value<std::string>(&label_type)->default_value("uint"),
                            "Storage type of Labels <uint/ushort>, default value is uint which "
                            "will consume memory 4 bytes per filter");
+        desc.add_options()("num_entry_points", po::value<uint32_t>(&num_entry_points)->default_value(0),
+                           "Number of k-means entry points to start searches from besides the medoid, "
+                           "0 for the medoid only");
+        desc.add_options()("optimized_layout", po::bool_switch(&optimized_layout),
+                           "Save the index with its optimized layout, which loading then restores "
+                           "without reading the graph");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -123,6 +150,7 @@ int main(int argc, char **argv)
         po::notify(vm);
         use_pq_build = (build_PQ_bytes > 0);
         use_opq = vm["use_opq"].as<bool>();
+        deterministic_build = vm["deterministic_build"].as<bool>();
     }
     catch (const std::exception &ex)
     {
@@ -160,18 +188,31 @@ int main(int argc, char **argv)
             if (data_type == std::string("int8"))
                 return build_in_memory_index<int8_t, uint32_t, uint16_t>(
                     metric, data_path, R, L, alpha, index_path_prefix, num_threads, use_pq_build, build_PQ_bytes,
-                    use_opq, label_file, universal_label, Lf);
+                    use_opq, label_file, universal_label, Lf, sq_bits, insert_batch_size, deterministic_build,
+                    num_entry_points, optimized_layout);
             else if (data_type == std::string("uint8"))
                 return build_in_memory_index<uint8_t, uint32_t, uint16_t>(
                     metric, data_path, R, L, alpha, index_path_prefix, num_threads, use_pq_build, build_PQ_bytes,
-                    use_opq, label_file, universal_label, Lf);
+                    use_opq, label_file, universal_label, Lf, sq_bits, insert_batch_size, deterministic_build,
+                    num_entry_points, optimized_layout);
             else if (data_type == std::string("float"))
                 return build_in_memory_index<float, uint32_t, uint16_t>(
                     metric, data_path, R, L, alpha, index_path_prefix, num_threads, use_pq_build, build_PQ_bytes,
-                    use_opq, label_file, universal_label, Lf);
+                    use_opq, label_file, universal_label, Lf, sq_bits, insert_batch_size, deterministic_build,
+                    num_entry_points, optimized_layout);
+            else if (data_type == std::string("float16"))
+                return build_in_memory_index<diskann::float16, uint32_t, uint16_t>(
+                    metric, data_path, R, L, alpha, index_path_prefix, num_threads, use_pq_build, build_PQ_bytes,
+                    use_opq, label_file, universal_label, Lf, sq_bits, insert_batch_size, deterministic_build,
+                    num_entry_points, optimized_layout);
+            else if (data_type == std::string("bfloat16"))
+                return build_in_memory_index<diskann::bfloat16, uint32_t, uint16_t>(
+                    metric, data_path, R, L, alpha, index_path_prefix, num_threads, use_pq_build, build_PQ_bytes,
+                    use_opq, label_file, universal_label, Lf, sq_bits, insert_batch_size, deterministic_build,
+                    num_entry_points, optimized_layout);
             else
             {
-                std::cout << "Unsupported type. Use one of int8, uint8 or float." << std::endl;
+                std::cout << "Unsupported type. Use one of int8, uint8, float, float16 or bfloat16." << std::endl;
                 return -1;
             }
         }
@@ -180,18 +221,31 @@ int main(int argc, char **argv)
             if (data_type == std::string("int8"))
                 return build_in_memory_index<int8_t>(metric, data_path, R, L, alpha, index_path_prefix, num_threads,
                                                      use_pq_build, build_PQ_bytes, use_opq, label_file, universal_label,
-                                                     Lf);
+                                                     Lf, sq_bits, insert_batch_size, deterministic_build,
+                                                     num_entry_points, optimized_layout);
             else if (data_type == std::string("uint8"))
                 return build_in_memory_index<uint8_t>(metric, data_path, R, L, alpha, index_path_prefix, num_threads,
                                                       use_pq_build, build_PQ_bytes, use_opq, label_file,
-                                                      universal_label, Lf);
+                                                      universal_label, Lf, sq_bits, insert_batch_size,
+                                                      deterministic_build, num_entry_points, optimized_layout);
             else if (data_type == std::string("float"))
                 return build_in_memory_index<float>(metric, data_path, R, L, alpha, index_path_prefix, num_threads,
                                                     use_pq_build, build_PQ_bytes, use_opq, label_file, universal_label,
-                                                    Lf);
+                                                    Lf, sq_bits, insert_batch_size, deterministic_build,
+                                                    num_entry_points, optimized_layout);
+            else if (data_type == std::string("float16"))
+                return build_in_memory_index<diskann::float16>(metric, data_path, R, L, alpha, index_path_prefix,
+                                                           num_threads, use_pq_build, build_PQ_bytes, use_opq,
+                                                           label_file, universal_label, Lf, sq_bits, insert_batch_size,
+                                                           deterministic_build, num_entry_points, optimized_layout);
+            else if (data_type == std::string("bfloat16"))
+                return build_in_memory_index<diskann::bfloat16>(metric, data_path, R, L, alpha, index_path_prefix,
+                                                           num_threads, use_pq_build, build_PQ_bytes, use_opq,
+                                                           label_file, universal_label, Lf, sq_bits, insert_batch_size,
+                                                           deterministic_build, num_entry_points, optimized_layout);
             else
             {
-                std::cout << "Unsupported type. Use one of int8, uint8 or float." << std::endl;
+                std::cout << "Unsupported type. Use one of int8, uint8, float, float16 or bfloat16." << std::endl;
                 return -1;
             }
         }
@@ -52,7 +52,8 @@ void print_stats(std::string category, std::vector<float> percentiles, std::vect
 template <typename T, typename LabelT = uint32_t>
 int search_disk_index(diskann::Metric &metric, const std::string &index_path_prefix, const std::string &query_file,
                       std::string &gt_file, const uint32_t num_threads, const float search_range,
-                      const uint32_t beamwidth, const uint32_t num_nodes_to_cache, const std::vector<uint32_t> &Lvec)
+                      const uint32_t beamwidth, const uint32_t num_nodes_to_cache, const std::vector<uint32_t> &Lvec,
+                      const bool stop_beyond_range)
 {
     std::string pq_prefix = index_path_prefix + "_pq";
     std::string disk_index_file = index_path_prefix + "_disk.index";
@@ -207,7 +208,7 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
             std::vector<float> distances;
             uint32_t res_count =
                 _pFlashIndex->range_search(query + (i * query_aligned_dim), search_range, L, max_list_size, indices,
-                                           distances, optimized_beamwidth, stats + i);
+                                           distances, optimized_beamwidth, stats + i, stop_beyond_range);
             query_result_ids[test_id][i].reserve(res_count);
             query_result_ids[test_id][i].resize(res_count);
             for (uint32_t idx = 0; idx < res_count; idx++)
@@ -271,6 +272,7 @@ int main(int argc, char **argv)
     uint32_t num_threads, W, num_nodes_to_cache;
     std::vector<uint32_t> Lvec;
     float range;
+    bool stop_beyond_range = false;
 
     po::options_description desc{"Arguments"};
     try
@@ -295,6 +297,9 @@ int main(int argc, char **argv)
         desc.add_options()("num_threads,T", po::value<uint32_t>(&num_threads)->default_value(omp_get_num_procs()),
                            "Number of threads used for building index (defaults to "
                            "omp_get_num_procs())");
+        desc.add_options()("stop_beyond_range", po::bool_switch()->default_value(false),
+                           "Stop once the closest unexpanded candidate is out of range by a margin in PQ distance. "
+                           "Saves IOs at some loss of recall");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -304,6 +309,7 @@ int main(int argc, char **argv)
             return 0;
         }
         po::notify(vm);
+        stop_beyond_range = vm["stop_beyond_range"].as<bool>();
     }
     catch (const std::exception &ex)
     {
@@ -342,13 +348,13 @@ int main(int argc, char **argv)
     {
         if (data_type == std::string("float"))
             return search_disk_index<float>(metric, index_path_prefix, query_file, gt_file, num_threads, range, W,
-                                            num_nodes_to_cache, Lvec);
+                                            num_nodes_to_cache, Lvec, stop_beyond_range);
         else if (data_type == std::string("int8"))
             return search_disk_index<int8_t>(metric, index_path_prefix, query_file, gt_file, num_threads, range, W,
-                                             num_nodes_to_cache, Lvec);
+                                             num_nodes_to_cache, Lvec, stop_beyond_range);
         else if (data_type == std::string("uint8"))
             return search_disk_index<uint8_t>(metric, index_path_prefix, query_file, gt_file, num_threads, range, W,
-                                              num_nodes_to_cache, Lvec);
+                                              num_nodes_to_cache, Lvec, stop_beyond_range);
         else
         {
             std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
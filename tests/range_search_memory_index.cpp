@@ -0,0 +1,194 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <omp.h>
+#include <boost/program_options.hpp>
+
+#include "index.h"
+#include "utils.h"
+
+namespace po = boost::program_options;
+
+template <typename T>
+int range_search_memory_index(diskann::Metric &metric, const std::string &index_path, const std::string &query_file,
+                              const std::string &gt_file, const uint32_t num_threads, const float search_range,
+                              const std::vector<uint32_t> &Lvec, const uint32_t max_L, const uint32_t max_results,
+                              const uint32_t sq_bits, const std::string &full_precision_data)
+{
+    T *query = nullptr;
+    size_t query_num, query_dim, query_aligned_dim, gt_num;
+    diskann::load_aligned_bin<T>(query_file, query, query_num, query_dim, query_aligned_dim);
+
+    std::vector<std::vector<uint32_t>> groundtruth_ids;
+    bool calc_recall_flag = false;
+    if (gt_file != std::string("null") && file_exists(gt_file))
+    {
+        diskann::load_range_truthset(gt_file, groundtruth_ids, gt_num);
+        if (gt_num != query_num)
+        {
+            diskann::cout << "Error. Mismatch in number of queries and ground truth data" << std::endl;
+            return -1;
+        }
+        calc_recall_flag = true;
+    }
+
+    using IndexType = diskann::Index<T>;
+    const size_t num_frozen_pts = IndexType::get_graph_num_frozen_points(index_path);
+    IndexType index(metric, query_dim, 0, false, false, false, false, 0, false, num_frozen_pts, sq_bits);
+    index.load(index_path.c_str(), num_threads, *(std::max_element(Lvec.begin(), Lvec.end())));
+    diskann::cout << "Index loaded" << std::endl;
+    if (sq_bits != 0 && !full_precision_data.empty())
+        index.set_full_precision_data_for_reranking(full_precision_data);
+
+    diskann::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    diskann::cout.precision(2);
+    diskann::cout << std::setw(6) << "L" << std::setw(12) << "QPS" << std::setw(18) << "Avg dist cmps"
+                  << std::setw(20) << "Mean Latency (mus)" << std::setw(15) << "99.9 Latency" << std::setw(16)
+                  << "Avg results";
+    if (calc_recall_flag)
+        diskann::cout << std::setw(16) << "Recall";
+    diskann::cout << std::endl;
+    diskann::cout << std::string(calc_recall_flag ? 103 : 87, '=') << std::endl;
+
+    omp_set_num_threads(num_threads);
+    for (const uint32_t L : Lvec)
+    {
+        std::vector<std::vector<uint32_t>> query_result_ids(query_num);
+        std::vector<float> latency_stats(query_num, 0);
+        std::vector<uint32_t> cmp_stats(query_num, 0);
+
+        auto s = std::chrono::high_resolution_clock::now();
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t i = 0; i < (int64_t)query_num; i++)
+        {
+            auto qs = std::chrono::high_resolution_clock::now();
+            std::vector<float> distances;
+            cmp_stats[i] = index
+                               .range_search(query + i * query_aligned_dim, search_range, L, std::max(L, max_L),
+                                             query_result_ids[i], distances, max_results)
+                               .second;
+            std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - qs;
+            latency_stats[i] = (float)(diff.count() * 1000000);
+        }
+        std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - s;
+        const double qps = query_num / diff.count();
+
+        std::sort(latency_stats.begin(), latency_stats.end());
+        double mean_latency = 0, avg_cmps = 0, avg_results = 0;
+        for (size_t i = 0; i < query_num; i++)
+        {
+            mean_latency += latency_stats[i];
+            avg_cmps += cmp_stats[i];
+            avg_results += query_result_ids[i].size();
+        }
+
+        diskann::cout << std::setw(6) << L << std::setw(12) << qps << std::setw(18) << avg_cmps / query_num
+                      << std::setw(20) << mean_latency / query_num << std::setw(15)
+                      << latency_stats[(uint64_t)(0.999 * query_num)] << std::setw(16) << avg_results / query_num;
+        if (calc_recall_flag)
+        {
+            diskann::cout << std::setw(16)
+                          << diskann::calculate_range_search_recall((uint32_t)query_num, groundtruth_ids,
+                                                                    query_result_ids);
+        }
+        diskann::cout << std::endl;
+    }
+
+    diskann::aligned_free(query);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string data_type, dist_fn, index_path_prefix, query_file, gt_file, full_precision_data;
+    uint32_t num_threads, max_L, max_results, sq_bits;
+    std::vector<uint32_t> Lvec;
+    float range;
+
+    po::options_description desc{"Arguments"};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(), "distance function <l2/mips>");
+        desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                           "Path prefix to the index");
+        desc.add_options()("query_file", po::value<std::string>(&query_file)->required(),
+                           "Query file in binary format");
+        desc.add_options()("gt_file", po::value<std::string>(&gt_file)->default_value(std::string("null")),
+                           "Range ground truth file for the queryset");
+        desc.add_options()("range_threshold,K", po::value<float>(&range)->required(),
+                           "Distance below which points are returned, or inner product above which for mips");
+        desc.add_options()("search_list,L", po::value<std::vector<uint32_t>>(&Lvec)->multitoken()->required(),
+                           "List of initial search list sizes");
+        desc.add_options()("max_search_list", po::value<uint32_t>(&max_L)->default_value(10000),
+                           "Largest size the search list can grow to");
+        desc.add_options()("max_results", po::value<uint32_t>(&max_results)->default_value(0),
+                           "Most points returned per query, 0 for no limit");
+        desc.add_options()("num_threads,T", po::value<uint32_t>(&num_threads)->default_value(omp_get_num_procs()),
+                           "Number of threads used for searching (defaults to omp_get_num_procs())");
+        desc.add_options()("sq_bits", po::value<uint32_t>(&sq_bits)->default_value(0),
+                           "Bits per dimension <4/8> the index data was scalar quantized with "
+                           "at build time; 0 for full precision data");
+        desc.add_options()("full_precision_data",
+                           po::value<std::string>(&full_precision_data)->default_value(std::string("")),
+                           "Full precision data file the index was built from, used to re-rank "
+                           "the candidates of a scalar quantized index");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    diskann::Metric metric;
+    if (dist_fn == std::string("mips"))
+    {
+        metric = diskann::Metric::INNER_PRODUCT;
+    }
+    else if (dist_fn == std::string("l2"))
+    {
+        metric = diskann::Metric::L2;
+    }
+    else
+    {
+        std::cout << "Unsupported distance function. Use l2/mips." << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        if (data_type == std::string("float"))
+            return range_search_memory_index<float>(metric, index_path_prefix, query_file, gt_file, num_threads, range,
+                                                    Lvec, max_L, max_results, sq_bits, full_precision_data);
+        else if (data_type == std::string("int8"))
+            return range_search_memory_index<int8_t>(metric, index_path_prefix, query_file, gt_file, num_threads,
+                                                     range, Lvec, max_L, max_results, sq_bits, full_precision_data);
+        else if (data_type == std::string("uint8"))
+            return range_search_memory_index<uint8_t>(metric, index_path_prefix, query_file, gt_file, num_threads,
+                                                      range, Lvec, max_L, max_results, sq_bits, full_precision_data);
+        else
+        {
+            std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
+            return -1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        diskann::cerr << "Index search failed." << std::endl;
+        return -1;
+    }
+}
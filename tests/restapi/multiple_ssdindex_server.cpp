@@ -18,14 +18,15 @@ namespace po = boost::program_options;
 std::unique_ptr<Server> g_httpServer(nullptr);
 std::vector<std::unique_ptr<diskann::BaseSearch>> g_ssdSearch;
 
-void setup(const utility::string_t &address, const std::string &typestring)
+void setup(const utility::string_t &address, const std::string &typestring, const bool route_by_partition)
 {
     web::http::uri_builder uriBldr(address);
     auto uri = uriBldr.to_uri();
 
+    diskann::enable_async_logging();
     std::cout << "Attempting to start server on " << uri.to_string() << std::endl;
 
-    g_httpServer = std::unique_ptr<Server>(new Server(uri, g_ssdSearch, typestring));
+    g_httpServer = std::unique_ptr<Server>(new Server(uri, g_ssdSearch, typestring, route_by_partition));
     std::cout << "Created a server object" << std::endl;
 
     g_httpServer->open().wait();
@@ -42,6 +43,7 @@ int main(int argc, char *argv[])
     std::string data_type, index_prefix_paths, address, dist_fn, tags_file;
     uint32_t num_nodes_to_cache;
     uint32_t num_threads;
+    float memory_budget_gb;
 
     po::options_description desc{"Arguments"};
     try
@@ -60,6 +62,12 @@ int main(int argc, char *argv[])
                            "distance function <l2/mips>");
         desc.add_options()("tags_file", po::value<std::string>(&tags_file)->default_value(std::string()),
                            "Tags file location");
+        desc.add_options()("memory_budget_gb", po::value<float>(&memory_budget_gb)->default_value(0.0f),
+                           "Memory budget of the loaded indices in GB, beyond which the least recently searched "
+                           "ones are unloaded; 0 for no limit. Indices are loaded on their first search. With a "
+                           "budget, each request must give in its \"partition\" field the position of the index "
+                           "to search in index_prefix_paths, since searching all of them would reload the "
+                           "indices that do not fit on every request.");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -118,30 +126,43 @@ int main(int argc, char *argv[])
     index_in.close();
     tags_in.close();
 
+    // all the indices search with the scratch of one manager, sized for the
+    // largest of them
+    size_t max_dim = 0;
+    for (auto &index_tag : index_tag_paths)
+        max_dim = (std::max)(max_dim, diskann::DiskIndexManager<float>::get_index_dim(index_tag.first));
+    const size_t memory_budget = (size_t)(memory_budget_gb * 1024 * 1024 * 1024);
+
     if (data_type == std::string("float"))
     {
+        auto manager = std::make_shared<diskann::DiskIndexManager<float>>(metric, num_threads, max_dim,
+                                                                          memory_budget, num_nodes_to_cache);
         for (auto &index_tag : index_tag_paths)
         {
-            auto searcher = std::unique_ptr<diskann::BaseSearch>(new diskann::PQFlashSearch<float>(
-                index_tag.first.c_str(), num_nodes_to_cache, num_threads, index_tag.second.c_str(), metric));
+            auto searcher = std::unique_ptr<diskann::BaseSearch>(
+                new diskann::ManagedPQFlashSearch<float>(manager, index_tag.first, index_tag.second));
             g_ssdSearch.push_back(std::move(searcher));
         }
     }
     else if (data_type == std::string("int8"))
     {
+        auto manager = std::make_shared<diskann::DiskIndexManager<int8_t>>(metric, num_threads, max_dim,
+                                                                           memory_budget, num_nodes_to_cache);
         for (auto &index_tag : index_tag_paths)
         {
-            auto searcher = std::unique_ptr<diskann::BaseSearch>(new diskann::PQFlashSearch<int8_t>(
-                index_tag.first.c_str(), num_nodes_to_cache, num_threads, index_tag.second.c_str(), metric));
+            auto searcher = std::unique_ptr<diskann::BaseSearch>(
+                new diskann::ManagedPQFlashSearch<int8_t>(manager, index_tag.first, index_tag.second));
             g_ssdSearch.push_back(std::move(searcher));
         }
     }
     else if (data_type == std::string("uint8"))
     {
+        auto manager = std::make_shared<diskann::DiskIndexManager<uint8_t>>(metric, num_threads, max_dim,
+                                                                            memory_budget, num_nodes_to_cache);
         for (auto &index_tag : index_tag_paths)
         {
-            auto searcher = std::unique_ptr<diskann::BaseSearch>(new diskann::PQFlashSearch<uint8_t>(
-                index_tag.first.c_str(), num_nodes_to_cache, num_threads, index_tag.second.c_str(), metric));
+            auto searcher = std::unique_ptr<diskann::BaseSearch>(
+                new diskann::ManagedPQFlashSearch<uint8_t>(manager, index_tag.first, index_tag.second));
             g_ssdSearch.push_back(std::move(searcher));
         }
     }
@@ -155,7 +176,7 @@ int main(int argc, char *argv[])
     {
         try
         {
-            setup(address, data_type);
+            setup(address, data_type, memory_budget > 0);
             std::cout << "Type 'exit' (case-sensitive) to exit" << std::endl;
             std::string line;
             std::getline(std::cin, line);
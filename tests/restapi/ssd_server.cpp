@@ -23,6 +23,7 @@ void setup(const utility::string_t &address, const std::string &typestring)
     web::http::uri_builder uriBldr(address);
     auto uri = uriBldr.to_uri();
 
+    diskann::enable_async_logging();
     std::cout << "Attempting to start server on " << uri.to_string() << std::endl;
 
     g_httpServer = std::unique_ptr<Server>(new Server(uri, g_ssdSearch, typestring));
@@ -7,7 +7,9 @@
 #include "index.h"
 #include "disk_utils.h"
 #include "math_utils.h"
+#include "huge_page_allocator.h"
 #include "memory_mapper.h"
+#include "numa_utils.h"
 #include "partition.h"
 #include "pq_flash_index.h"
 #include "timer.h"
@@ -52,7 +54,11 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
                       const uint32_t num_threads, const uint32_t recall_at, const uint32_t beamwidth,
                       const uint32_t num_nodes_to_cache, const uint32_t search_io_limit,
                       const std::vector<uint32_t> &Lvec, const float fail_if_recall_below,
-                      const std::vector<std::string> &query_filters, const bool use_reorder_data = false)
+                      const std::vector<std::string> &query_filters, const bool use_reorder_data = false,
+                      const bool numa_replication = false, const std::string &cache_file = std::string(""),
+                      const std::string &deleted_points_file = std::string(""),
+                      const uint32_t num_nav_entry_points = NAV_INDEX_NUM_ENTRY_POINTS,
+                      const std::string &trace_path = std::string(""), const float trace_sampling_rate = 0.01f)
 {
     diskann::cout << "Search parameters: #threads: " << num_threads << ", ";
     if (beamwidth <= 0)
@@ -117,19 +123,38 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
     {
         return res;
     }
-    // cache bfs levels
-    std::vector<uint32_t> node_list;
-    diskann::cout << "Caching " << num_nodes_to_cache << " BFS nodes around medoid(s)" << std::endl;
-    //_pFlashIndex->cache_bfs_levels(num_nodes_to_cache, node_list);
-    if (num_nodes_to_cache > 0)
-        _pFlashIndex->generate_cache_list_from_sample_queries(warmup_query_file, 15, 6, num_nodes_to_cache, num_threads,
-                                                              node_list);
-    _pFlashIndex->load_cache_list(node_list);
-    node_list.clear();
-    node_list.shrink_to_fit();
+    _pFlashIndex->set_num_nav_entry_points(num_nav_entry_points);
+    if (cache_file.empty() || !_pFlashIndex->load_cache(cache_file, num_nodes_to_cache))
+    {
+        // cache bfs levels
+        std::vector<uint32_t> node_list;
+        diskann::cout << "Caching " << num_nodes_to_cache << " BFS nodes around medoid(s)" << std::endl;
+        //_pFlashIndex->cache_bfs_levels(num_nodes_to_cache, node_list);
+        if (num_nodes_to_cache > 0)
+            _pFlashIndex->generate_cache_list_from_sample_queries(warmup_query_file, 15, 6, num_nodes_to_cache,
+                                                                  num_threads, node_list);
+        _pFlashIndex->load_cache_list(node_list);
+        node_list.clear();
+        node_list.shrink_to_fit();
+        if (!cache_file.empty())
+            _pFlashIndex->save_cache(cache_file, num_nodes_to_cache);
+    }
+
+    if (!deleted_points_file.empty())
+        _pFlashIndex->load_deleted_points(deleted_points_file);
 
     omp_set_num_threads(num_threads);
 
+    if (numa_replication)
+    {
+        const uint32_t num_numa_nodes = diskann::get_num_numa_nodes();
+        _pFlashIndex->enable_numa_replication(DIV_ROUND_UP(num_threads, num_numa_nodes));
+        // spread the search threads evenly over the nodes. OpenMP reuses the
+        // same threads for all the parallel regions below, so this sticks.
+#pragma omp parallel num_threads(num_threads)
+        diskann::pin_thread_to_numa_node(omp_get_thread_num() % num_numa_nodes);
+    }
+
     uint64_t warmup_L = 20;
     uint64_t warmup_num = 0, warmup_dim = 0, warmup_aligned_dim = 0;
     T *warmup = nullptr;
@@ -195,6 +220,7 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
     uint32_t optimized_beamwidth = 2;
 
     float best_recall = 0.0;
+    uint64_t num_deleted_results = 0;
 
     for (uint32_t test_id = 0; test_id < Lvec.size(); test_id++)
     {
@@ -219,6 +245,17 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         query_result_dists[test_id].resize(recall_at * query_num);
 
         auto stats = new diskann::QueryStats[query_num];
+        // hop traces of a sample of the queries
+        std::vector<std::vector<diskann::HopTrace>> hop_traces;
+        if (!trace_path.empty())
+        {
+            hop_traces.resize(query_num);
+            for (uint64_t i = 0; i < query_num; i++)
+            {
+                if (diskann::is_traced_query(i, trace_sampling_rate))
+                    stats[i].hops = &hop_traces[i];
+            }
+        }
 
         std::vector<uint64_t> query_result_ids_64(recall_at * query_num);
         auto s = std::chrono::high_resolution_clock::now();
@@ -257,6 +294,12 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         diskann::convert_types<uint64_t, uint32_t>(query_result_ids_64.data(), query_result_ids[test_id].data(),
                                                    query_num, recall_at);
 
+        if (!deleted_points_file.empty())
+        {
+            for (uint64_t i = 0; i < query_num * recall_at; i++)
+                num_deleted_results += _pFlashIndex->is_deleted(query_result_ids[test_id][i]);
+        }
+
         auto mean_latency = diskann::get_mean_stats<float>(
             stats, query_num, [](const diskann::QueryStats &stats) { return stats.total_us; });
 
@@ -286,6 +329,13 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         }
         else
             diskann::cout << std::endl;
+
+        if (!trace_path.empty())
+        {
+            const std::string trace_prefix = trace_path + "_L" + std::to_string(L);
+            diskann::save_query_stats_histograms(trace_prefix + "_histograms.csv", stats, query_num);
+            diskann::save_query_traces(trace_prefix + "_hops.csv", stats, query_num);
+        }
         delete[] stats;
     }
 
@@ -306,6 +356,11 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
     diskann::aligned_free(query);
     if (warmup != nullptr)
         diskann::aligned_free(warmup);
+    if (num_deleted_results > 0)
+    {
+        diskann::cerr << "Searches returned " << num_deleted_results << " deleted points" << std::endl;
+        return -1;
+    }
     return best_recall >= fail_if_recall_below ? 0 : -1;
 }
 
@@ -313,16 +368,21 @@ int main(int argc, char **argv)
 {
     std::string data_type, dist_fn, index_path_prefix, result_path_prefix, query_file, gt_file, filter_label,
         label_type, query_filters_file;
-    uint32_t num_threads, K, W, num_nodes_to_cache, search_io_limit;
+    uint32_t num_threads, K, W, num_nodes_to_cache, search_io_limit, num_nav_entry_points;
     std::vector<uint32_t> Lvec;
     bool use_reorder_data = false;
-    float fail_if_recall_below = 0.0f;
+    bool numa_replication = false;
+    std::string cache_file, deleted_points_file, trace_path;
+    float fail_if_recall_below = 0.0f, trace_sampling_rate;
+    std::string huge_pages;
+    int numa_node;
 
     po::options_description desc{"Arguments"};
     try
     {
         desc.add_options()("help,h", "Print information on arguments");
-        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                           "data type <int8/uint8/float/float16/bfloat16>");
         desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(),
                            "distance function <l2/mips/fast_l2>");
         desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
@@ -357,6 +417,30 @@ int main(int argc, char **argv)
         desc.add_options()("label_type", po::value<std::string>(&label_type)->default_value("uint"),
                            "Storage type of Labels <uint/ushort>, default value is uint which "
                            "will consume memory 4 bytes per filter");
+        desc.add_options()("numa_replication", po::bool_switch()->default_value(false),
+                           "Replicate the PQ data and node cache on every NUMA node and pin the "
+                           "search threads evenly across the nodes");
+        desc.add_options()("cache_file", po::value<std::string>(&cache_file)->default_value(std::string("")),
+                           "Load the node cache from this file if it was saved for this index, "
+                           "otherwise build the cache and save it here");
+        desc.add_options()("deleted_points_file",
+                           po::value<std::string>(&deleted_points_file)->default_value(std::string("")),
+                           "Ids to leave out of the search results, in uint32 bin format");
+        desc.add_options()("nav_entry_points",
+                           po::value<uint32_t>(&num_nav_entry_points)->default_value(NAV_INDEX_NUM_ENTRY_POINTS),
+                           "Number of entry points taken from the navigation index, if the index has one; "
+                           "0 to start from the medoids");
+        desc.add_options()("huge_pages", po::value<std::string>(&huge_pages)->default_value(std::string("none")),
+                           "Page size for the in-memory PQ codes <none/thp/2mb/1gb>. 2mb/1gb need "
+                           "hugepages reserved in vm.nr_hugepages and fall back to thp otherwise");
+        desc.add_options()("numa_node", po::value<int>(&numa_node)->default_value(-1),
+                           "Bind the hugepage backed arrays to this NUMA node, -1 to not bind");
+        desc.add_options()("trace_path", po::value<std::string>(&trace_path)->default_value(std::string("")),
+                           "If set, write the histograms of the per query counters to "
+                           "<trace_path>_L<L>_histograms.csv and the hops of a sample of the queries to "
+                           "<trace_path>_L<L>_hops.csv");
+        desc.add_options()("trace_sampling_rate", po::value<float>(&trace_sampling_rate)->default_value(0.01f),
+                           "Fraction of the queries whose hops are traced");
         desc.add_options()("fail_if_recall_below", po::value<float>(&fail_if_recall_below)->default_value(0.0f),
                            "If set to a value >0 and <100%, program returns -1 if best recall "
                            "found is below this threshold. ");
@@ -371,6 +455,12 @@ int main(int argc, char **argv)
         po::notify(vm);
         if (vm["use_reorder_data"].as<bool>())
             use_reorder_data = true;
+        numa_replication = vm["numa_replication"].as<bool>();
+
+        diskann::HugePageConfig huge_page_config;
+        huge_page_config.mode = diskann::huge_page_mode_from_string(huge_pages);
+        huge_page_config.numa_node = numa_node;
+        diskann::set_huge_page_config(huge_page_config);
     }
     catch (const std::exception &ex)
     {
@@ -436,38 +526,74 @@ int main(int argc, char **argv)
             if (data_type == std::string("float"))
                 return search_disk_index<float, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else if (data_type == std::string("int8"))
                 return search_disk_index<int8_t, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else if (data_type == std::string("uint8"))
                 return search_disk_index<uint8_t, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
+            else if (data_type == std::string("float16"))
+                return search_disk_index<diskann::float16, uint16_t>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
+            else if (data_type == std::string("bfloat16"))
+                return search_disk_index<diskann::bfloat16, uint16_t>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else
             {
-                std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
+                std::cerr << "Unsupported data type. Use float, int8, uint8, float16 or bfloat16" << std::endl;
                 return -1;
             }
         }
         else
         {
             if (data_type == std::string("float"))
-                return search_disk_index<float>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
-                                                num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                fail_if_recall_below, query_filters, use_reorder_data);
+                return search_disk_index<float>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else if (data_type == std::string("int8"))
-                return search_disk_index<int8_t>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
-                                                 num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                 fail_if_recall_below, query_filters, use_reorder_data);
+                return search_disk_index<int8_t>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else if (data_type == std::string("uint8"))
-                return search_disk_index<uint8_t>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
-                                                  num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                  fail_if_recall_below, query_filters, use_reorder_data);
+                return search_disk_index<uint8_t>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
+            else if (data_type == std::string("float16"))
+                return search_disk_index<diskann::float16>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
+            else if (data_type == std::string("bfloat16"))
+                return search_disk_index<diskann::bfloat16>(
+                    metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, use_reorder_data,
+                    numa_replication, cache_file, deleted_points_file, num_nav_entry_points, trace_path,
+                    trace_sampling_rate);
             else
             {
-                std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
+                std::cerr << "Unsupported data type. Use float, int8, uint8, float16 or bfloat16" << std::endl;
                 return -1;
             }
         }
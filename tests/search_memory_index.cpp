@@ -17,7 +17,10 @@
 #include <unistd.h>
 #endif
 
+#include "cache_miss_counter.h"
 #include "index.h"
+#include "search_iterator.h"
+#include "huge_page_allocator.h"
 #include "memory_mapper.h"
 #include "utils.h"
 
@@ -28,7 +31,10 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                         const std::string &query_file, const std::string &truthset_file, const uint32_t num_threads,
                         const uint32_t recall_at, const bool print_all_recalls, const std::vector<uint32_t> &Lvec,
                         const bool dynamic, const bool tags, const bool show_qps_per_thread,
-                        const std::vector<std::string> &query_filters, const float fail_if_recall_below)
+                        const std::vector<std::string> &query_filters, const float fail_if_recall_below,
+                        const uint32_t sq_bits, const std::string &full_precision_data, const uint32_t page_size,
+                        const uint32_t prefetch_distance, bool count_cache_misses, const bool optimized_layout,
+                        const std::string &trace_path, const float trace_sampling_rate)
 {
     // Load the query file
     T *query = nullptr;
@@ -72,12 +78,21 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
     using IndexType = diskann::Index<T, TagT, LabelT>;
     const size_t num_frozen_pts = IndexType::get_graph_num_frozen_points(index_path);
     IndexType index(metric, query_dim, 0, dynamic, tags, concurrent, pq_dist_build, num_pq_chunks, use_opq,
-                    num_frozen_pts);
+                    num_frozen_pts, sq_bits);
     std::cout << "Index class instantiated" << std::endl;
     index.load(index_path.c_str(), num_threads, *(std::max_element(Lvec.begin(), Lvec.end())));
     std::cout << "Index loaded" << std::endl;
-    if (metric == diskann::FAST_L2)
+    if (sq_bits != 0 && !full_precision_data.empty())
+        index.set_full_precision_data_for_reranking(full_precision_data);
+    if (optimized_layout || metric == diskann::FAST_L2)
         index.optimize_index_layout();
+    index.set_prefetch_distance(prefetch_distance);
+
+    if (count_cache_misses && !diskann::CacheMissCounter().is_available())
+    {
+        std::cout << "Cache miss counters are not available on this machine" << std::endl;
+        count_cache_misses = false;
+    }
 
     std::cout << "Using " << num_threads << " threads to search" << std::endl;
     std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
@@ -96,6 +111,11 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                   << std::setw(20) << "Mean Latency (mus)" << std::setw(15) << "99.9 Latency";
         table_width += 4 + 12 + 18 + 20 + 15;
     }
+    if (count_cache_misses)
+    {
+        std::cout << std::setw(20) << "Avg cache misses";
+        table_width += 20;
+    }
     uint32_t recalls_to_print = 0;
     const uint32_t first_recall = print_all_recalls ? 1 : recall_at;
     if (calc_recall_flag)
@@ -114,6 +134,7 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
     std::vector<std::vector<float>> query_result_dists(Lvec.size());
     std::vector<float> latency_stats(query_num, 0);
     std::vector<uint32_t> cmp_stats;
+    std::vector<uint64_t> cache_miss_stats(query_num, 0);
     if (not tags)
     {
         cmp_stats = std::vector<uint32_t>(query_num, 0);
@@ -126,11 +147,12 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
     }
 
     float best_recall = 0.0;
+    bool pages_sorted = true;
 
     for (uint32_t test_id = 0; test_id < Lvec.size(); test_id++)
     {
         uint64_t L = Lvec[test_id];
-        if (L < recall_at)
+        if (L < recall_at && page_size == 0)
         {
             diskann::cout << "Ignoring search with L:" << L << " since it's smaller than K:" << recall_at << std::endl;
             continue;
@@ -140,11 +162,42 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
         query_result_dists[test_id].resize(recall_at * query_num);
         std::vector<T *> res = std::vector<T *>();
 
+        // pages returned out of distance order, per query
+        std::vector<uint32_t> unsorted_pages(query_num, 0);
+
+        // one per thread, created by the thread it counts
+        std::vector<std::unique_ptr<diskann::CacheMissCounter>> cache_miss_counters(num_threads);
+
+        // per query counters and, for a sample of the queries, hop traces
+        std::vector<diskann::QueryStats> query_stats;
+        std::vector<std::vector<diskann::HopTrace>> hop_traces;
+        if (!trace_path.empty())
+        {
+            query_stats.resize(query_num);
+            hop_traces.resize(query_num);
+            for (uint64_t i = 0; i < query_num; i++)
+            {
+                if (diskann::is_traced_query(i, trace_sampling_rate))
+                    query_stats[i].hops = &hop_traces[i];
+            }
+        }
+
         auto s = std::chrono::high_resolution_clock::now();
         omp_set_num_threads(num_threads);
 #pragma omp parallel for schedule(dynamic, 1)
         for (int64_t i = 0; i < (int64_t)query_num; i++)
         {
+            diskann::CacheMissCounter *cache_miss_counter = nullptr;
+            uint64_t cache_misses_before = 0;
+            if (count_cache_misses)
+            {
+                auto &counter = cache_miss_counters[omp_get_thread_num()];
+                if (counter == nullptr)
+                    counter.reset(new diskann::CacheMissCounter());
+                cache_miss_counter = counter.get();
+                cache_misses_before = cache_miss_counter->read();
+            }
+            diskann::QueryStats *stats = query_stats.empty() ? nullptr : &query_stats[i];
             auto qs = std::chrono::high_resolution_clock::now();
             if (filtered_search)
             {
@@ -159,14 +212,9 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                 }
                 auto retval = index.search_with_filters(query + i * query_aligned_dim, filter_label_as_num, recall_at,
                                                         L, query_result_ids[test_id].data() + i * recall_at,
-                                                        query_result_dists[test_id].data() + i * recall_at);
+                                                        query_result_dists[test_id].data() + i * recall_at, stats);
                 cmp_stats[i] = retval.second;
             }
-            else if (metric == diskann::FAST_L2)
-            {
-                index.search_with_optimized_layout(query + i * query_aligned_dim, recall_at, L,
-                                                   query_result_ids[test_id].data() + i * recall_at);
-            }
             else if (tags)
             {
                 index.search_with_tags(query + i * query_aligned_dim, recall_at, L,
@@ -176,16 +224,43 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                     query_result_ids[test_id][recall_at * i + r] = query_result_tags[recall_at * i + r];
                 }
             }
+            else if (page_size > 0)
+            {
+                // fetch the results page by page, resuming the search
+                diskann::SearchIterator<T, TagT, LabelT> iterator(index, query + i * query_aligned_dim, L);
+                size_t num_found = 0;
+                while (num_found < recall_at)
+                {
+                    const size_t num_to_fetch = std::min((size_t)page_size, recall_at - num_found);
+                    float *page_dists = query_result_dists[test_id].data() + i * recall_at + num_found;
+                    const size_t num_fetched = iterator.next(
+                        num_to_fetch, query_result_ids[test_id].data() + i * recall_at + num_found, page_dists);
+                    // every page comes closest first, also when it spans a
+                    // growth of the search list, e.g. with K > L
+                    const bool sorted =
+                        metric == diskann::Metric::INNER_PRODUCT
+                            ? std::is_sorted(page_dists, page_dists + num_fetched, std::greater<float>())
+                            : std::is_sorted(page_dists, page_dists + num_fetched);
+                    if (!sorted)
+                        unsorted_pages[i]++;
+                    num_found += num_fetched;
+                    if (num_fetched < num_to_fetch)
+                        break;
+                }
+                cmp_stats[i] = (uint32_t)iterator.get_num_cmps();
+            }
             else
             {
                 cmp_stats[i] = index
                                    .search(query + i * query_aligned_dim, recall_at, L,
-                                           query_result_ids[test_id].data() + i * recall_at)
+                                           query_result_ids[test_id].data() + i * recall_at, nullptr, stats)
                                    .second;
             }
             auto qe = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> diff = qe - qs;
             latency_stats[i] = diff.count() * 1000000;
+            if (cache_miss_counter != nullptr)
+                cache_miss_stats[i] = cache_miss_counter->read() - cache_misses_before;
         }
         std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - s;
 
@@ -222,19 +297,41 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
                       << std::setw(20) << (float)mean_latency << std::setw(15)
                       << (float)latency_stats[(uint64_t)(0.999 * query_num)];
         }
+        if (count_cache_misses)
+        {
+            std::cout << std::setw(20)
+                      << (float)std::accumulate(cache_miss_stats.begin(), cache_miss_stats.end(), (uint64_t)0) /
+                             (float)query_num;
+        }
         for (float recall : recalls)
         {
             std::cout << std::setw(12) << recall;
             best_recall = std::max(recall, best_recall);
         }
         std::cout << std::endl;
+
+        const uint64_t num_unsorted_pages =
+            std::accumulate(unsorted_pages.begin(), unsorted_pages.end(), (uint64_t)0);
+        if (num_unsorted_pages > 0)
+        {
+            diskann::cerr << num_unsorted_pages << " pages with L " << L << " were not sorted by distance"
+                          << std::endl;
+            pages_sorted = false;
+        }
+
+        if (!trace_path.empty())
+        {
+            const std::string trace_prefix = trace_path + "_L" + std::to_string(L);
+            diskann::save_query_stats_histograms(trace_prefix + "_histograms.csv", query_stats.data(), query_num);
+            diskann::save_query_traces(trace_prefix + "_hops.csv", query_stats.data(), query_num);
+        }
     }
 
     std::cout << "Done searching. Now saving results " << std::endl;
     uint64_t test_id = 0;
     for (auto L : Lvec)
     {
-        if (L < recall_at)
+        if (L < recall_at && page_size == 0)
         {
             diskann::cout << "Ignoring search with L:" << L << " since it's smaller than K:" << recall_at << std::endl;
             continue;
@@ -246,23 +343,26 @@ int search_memory_index(diskann::Metric &metric, const std::string &index_path,
 
     diskann::aligned_free(query);
 
-    return best_recall >= fail_if_recall_below ? 0 : -1;
+    return best_recall >= fail_if_recall_below && pages_sorted ? 0 : -1;
 }
 
 int main(int argc, char **argv)
 {
     std::string data_type, dist_fn, index_path_prefix, result_path, query_file, gt_file, filter_label, label_type,
-        query_filters_file;
-    uint32_t num_threads, K;
+        query_filters_file, full_precision_data, trace_path;
+    uint32_t num_threads, K, sq_bits, page_size, prefetch_distance;
     std::vector<uint32_t> Lvec;
-    bool print_all_recalls, dynamic, tags, show_qps_per_thread;
-    float fail_if_recall_below = 0.0f;
+    bool print_all_recalls, dynamic, tags, show_qps_per_thread, count_cache_misses, optimized_layout;
+    float fail_if_recall_below = 0.0f, trace_sampling_rate;
+    std::string huge_pages;
+    int numa_node;
 
     po::options_description desc{"Arguments"};
     try
     {
         desc.add_options()("help,h", "Print information on arguments");
-        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                           "data type <int8/uint8/float/float16/bfloat16>");
         desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(),
                            "distance function <l2/mips/fast_l2/cosine>");
         desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
@@ -297,6 +397,36 @@ int main(int argc, char **argv)
         desc.add_options()("qps_per_thread", po::bool_switch(&show_qps_per_thread),
                            "Print overall QPS divided by the number of threads in "
                            "the output table");
+        desc.add_options()("sq_bits", po::value<uint32_t>(&sq_bits)->default_value(0),
+                           "Bits per dimension <4/8> the index data was scalar quantized with "
+                           "at build time; 0 for full precision data");
+        desc.add_options()("full_precision_data",
+                           po::value<std::string>(&full_precision_data)->default_value(std::string("")),
+                           "Full precision data file the index was built from, used to re-rank "
+                           "the candidates of a scalar quantized index");
+        desc.add_options()("page_size", po::value<uint32_t>(&page_size)->default_value(0),
+                           "If set, fetch the K results in pages of this size with a SearchIterator, "
+                           "starting from a search list of size L");
+        desc.add_options()("prefetch_distance",
+                           po::value<uint32_t>(&prefetch_distance)->default_value(diskann::defaults::PREFETCH_DISTANCE),
+                           "Number of neighbor vectors or PQ code rows prefetched ahead of the distance being "
+                           "computed, 0 to disable prefetching");
+        desc.add_options()("cache_misses", po::bool_switch(&count_cache_misses),
+                           "Report the average number of cache misses per query, read from hardware counters");
+        desc.add_options()("optimized_layout", po::bool_switch(&optimized_layout),
+                           "Interleave the vectors and adjacency lists of a static index before searching; "
+                           "always on for fast_l2");
+        desc.add_options()("huge_pages", po::value<std::string>(&huge_pages)->default_value(std::string("none")),
+                           "Page size for the vectors and PQ codes <none/thp/2mb/1gb>. 2mb/1gb need hugepages "
+                           "reserved in vm.nr_hugepages and fall back to thp otherwise");
+        desc.add_options()("numa_node", po::value<int>(&numa_node)->default_value(-1),
+                           "Bind the hugepage backed arrays to this NUMA node, -1 to not bind");
+        desc.add_options()("trace_path", po::value<std::string>(&trace_path)->default_value(std::string("")),
+                           "If set, write the histograms of the per query counters to "
+                           "<trace_path>_L<L>_histograms.csv and the hops of a sample of the queries to "
+                           "<trace_path>_L<L>_hops.csv. Not supported with tags or page_size");
+        desc.add_options()("trace_sampling_rate", po::value<float>(&trace_sampling_rate)->default_value(0.01f),
+                           "Fraction of the queries whose hops are traced");
         desc.add_options()("fail_if_recall_below", po::value<float>(&fail_if_recall_below)->default_value(0.0f),
                            "If set to a value >0 and <100%, program returns -1 if best recall "
                            "found is below this threshold. ");
@@ -309,6 +439,11 @@ int main(int argc, char **argv)
             return 0;
         }
         po::notify(vm);
+
+        diskann::HugePageConfig huge_page_config;
+        huge_page_config.mode = diskann::huge_page_mode_from_string(huge_pages);
+        huge_page_config.numa_node = numa_node;
+        diskann::set_huge_page_config(huge_page_config);
     }
     catch (const std::exception &ex)
     {
@@ -316,8 +451,10 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    const bool floating_point_data = data_type == std::string("float") || data_type == std::string("float16") ||
+                                     data_type == std::string("bfloat16");
     diskann::Metric metric;
-    if ((dist_fn == std::string("mips")) && (data_type == std::string("float")))
+    if ((dist_fn == std::string("mips")) && floating_point_data)
     {
         metric = diskann::Metric::INNER_PRODUCT;
     }
@@ -329,7 +466,7 @@ int main(int argc, char **argv)
     {
         metric = diskann::Metric::COSINE;
     }
-    else if ((dist_fn == std::string("fast_l2")) && (data_type == std::string("float")))
+    else if ((dist_fn == std::string("fast_l2")) && floating_point_data)
     {
         metric = diskann::Metric::FAST_L2;
     }
@@ -378,23 +515,45 @@ int main(int argc, char **argv)
             {
                 return search_memory_index<int8_t, uint16_t>(
                     metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
-                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below);
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else if (data_type == std::string("uint8"))
             {
                 return search_memory_index<uint8_t, uint16_t>(
                     metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
-                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below);
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else if (data_type == std::string("float"))
             {
-                return search_memory_index<float, uint16_t>(metric, index_path_prefix, result_path, query_file, gt_file,
-                                                            num_threads, K, print_all_recalls, Lvec, dynamic, tags,
-                                                            show_qps_per_thread, query_filters, fail_if_recall_below);
+                return search_memory_index<float, uint16_t>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
+            }
+            else if (data_type == std::string("float16"))
+            {
+                return search_memory_index<diskann::float16, uint16_t>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
+            }
+            else if (data_type == std::string("bfloat16"))
+            {
+                return search_memory_index<diskann::bfloat16, uint16_t>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else
             {
-                std::cout << "Unsupported type. Use float/int8/uint8" << std::endl;
+                std::cout << "Unsupported type. Use float/int8/uint8/float16/bfloat16" << std::endl;
                 return -1;
             }
         }
@@ -402,25 +561,47 @@ int main(int argc, char **argv)
         {
             if (data_type == std::string("int8"))
             {
-                return search_memory_index<int8_t>(metric, index_path_prefix, result_path, query_file, gt_file,
-                                                   num_threads, K, print_all_recalls, Lvec, dynamic, tags,
-                                                   show_qps_per_thread, query_filters, fail_if_recall_below);
+                return search_memory_index<int8_t>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else if (data_type == std::string("uint8"))
             {
-                return search_memory_index<uint8_t>(metric, index_path_prefix, result_path, query_file, gt_file,
-                                                    num_threads, K, print_all_recalls, Lvec, dynamic, tags,
-                                                    show_qps_per_thread, query_filters, fail_if_recall_below);
+                return search_memory_index<uint8_t>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else if (data_type == std::string("float"))
             {
-                return search_memory_index<float>(metric, index_path_prefix, result_path, query_file, gt_file,
-                                                  num_threads, K, print_all_recalls, Lvec, dynamic, tags,
-                                                  show_qps_per_thread, query_filters, fail_if_recall_below);
+                return search_memory_index<float>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
+            }
+            else if (data_type == std::string("float16"))
+            {
+                return search_memory_index<diskann::float16>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
+            }
+            else if (data_type == std::string("bfloat16"))
+            {
+                return search_memory_index<diskann::bfloat16>(
+                    metric, index_path_prefix, result_path, query_file, gt_file, num_threads, K, print_all_recalls,
+                    Lvec, dynamic, tags, show_qps_per_thread, query_filters, fail_if_recall_below, sq_bits,
+                    full_precision_data, page_size, prefetch_distance, count_cache_misses, optimized_layout,
+                    trace_path, trace_sampling_rate);
             }
             else
             {
-                std::cout << "Unsupported type. Use float/int8/uint8" << std::endl;
+                std::cout << "Unsupported type. Use float/int8/uint8/float16/bfloat16" << std::endl;
                 return -1;
             }
         }
@@ -0,0 +1,202 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <omp.h>
+#include <boost/program_options.hpp>
+
+#include "fresh_disk_index.h"
+#include "timer.h"
+#include "utils.h"
+
+namespace po = boost::program_options;
+
+// Searches the queries and reports recall against the ground truth, which is
+// computed over the disk index points followed by the points of the insert
+// file. Returns false if a deleted id shows up in the results.
+template <typename T>
+bool search_and_check(diskann::FreshDiskIndex<T> &index, const T *queries, const size_t num_queries,
+                      const size_t query_aligned_dim, const uint32_t K, const uint32_t L, const uint32_t beam_width,
+                      const uint32_t num_threads, const uint32_t first_insert_id,
+                      const std::vector<uint32_t> &insert_position, const uint32_t num_deleted, uint32_t *gt_ids,
+                      float *gt_dists, const size_t gt_dim, const std::string &stage)
+{
+    std::vector<uint32_t> results(num_queries * K, std::numeric_limits<uint32_t>::max());
+    diskann::Timer timer;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (int64_t i = 0; i < (int64_t)num_queries; i++)
+    {
+        index.search(queries + i * query_aligned_dim, K, L, beam_width, results.data() + i * K, nullptr);
+    }
+    const double qps = num_queries / (timer.elapsed() / 1000000.0);
+
+    size_t num_deleted_returned = 0;
+    for (auto &id : results)
+    {
+        if (id == std::numeric_limits<uint32_t>::max())
+            continue;
+        if (id < num_deleted)
+            num_deleted_returned++;
+        if (id >= first_insert_id)
+            id = first_insert_id + insert_position[id - first_insert_id];
+    }
+
+    std::cout << stage << ": " << qps << " QPS";
+    if (gt_ids != nullptr)
+    {
+        std::cout << ", recall@" << K << " "
+                  << diskann::calculate_recall((uint32_t)num_queries, gt_ids, gt_dists, (uint32_t)gt_dim,
+                                               results.data(), K, K);
+    }
+    std::cout << ", " << num_deleted_returned << " deleted ids returned" << std::endl;
+    return num_deleted_returned == 0;
+}
+
+template <typename T>
+int run_fresh_disk_index(const std::string &index_path_prefix, const std::string &insert_path,
+                         const std::string &query_file, const std::string &gt_file, const uint32_t num_deletes,
+                         const uint32_t R, const uint32_t Lbuild, const float alpha, const uint32_t K, const uint32_t L,
+                         const uint32_t beam_width, const uint32_t num_threads)
+{
+    auto params = diskann::IndexWriteParametersBuilder(Lbuild, R).with_alpha(alpha).build();
+    diskann::FreshDiskIndex<T> index(diskann::Metric::L2, index_path_prefix, num_threads, params);
+    if (index.load() != 0)
+        return -1;
+    const uint32_t first_insert_id = (uint32_t)index.get_num_points();
+
+    T *queries = nullptr;
+    size_t num_queries, query_dim, query_aligned_dim;
+    diskann::load_aligned_bin<T>(query_file, queries, num_queries, query_dim, query_aligned_dim);
+    uint32_t *gt_ids = nullptr;
+    float *gt_dists = nullptr;
+    size_t gt_num, gt_dim = 0;
+    if (!gt_file.empty())
+        diskann::load_truthset(gt_file, gt_ids, gt_dists, gt_num, gt_dim);
+
+    T *insert_data = nullptr;
+    size_t num_inserts, insert_dim, insert_aligned_dim;
+    diskann::load_aligned_bin<T>(insert_path, insert_data, num_inserts, insert_dim, insert_aligned_dim);
+
+    // inserts run concurrently, so ids are not assigned in file order
+    std::vector<uint32_t> insert_position(num_inserts);
+    diskann::Timer timer;
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+    for (int64_t i = 0; i < (int64_t)num_inserts; i++)
+    {
+        const uint32_t id = index.insert(insert_data + i * insert_aligned_dim);
+        insert_position[id - first_insert_id] = (uint32_t)i;
+    }
+    std::cout << "Inserted " << num_inserts << " points in " << timer.elapsed() / 1000000.0 << "s" << std::endl;
+
+    for (uint32_t id = 0; id < num_deletes; id++)
+        index.lazy_delete(id);
+    std::cout << "Deleted ids [0, " << num_deletes << ")" << std::endl;
+
+    bool ok = search_and_check(index, queries, num_queries, query_aligned_dim, K, L, beam_width, num_threads,
+                               first_insert_id, insert_position, num_deletes, gt_ids, gt_dists, gt_dim,
+                               "Before merge");
+
+    // a restarted index finds the saved inserts and deletes
+    index.save();
+    {
+        diskann::FreshDiskIndex<T> reloaded(diskann::Metric::L2, index_path_prefix, num_threads, params);
+        if (reloaded.load() != 0)
+            return -1;
+        ok &= reloaded.get_num_points() == index.get_num_points();
+        ok &= search_and_check(reloaded, queries, num_queries, query_aligned_dim, K, L, beam_width, num_threads,
+                               first_insert_id, insert_position, num_deletes, gt_ids, gt_dists, gt_dim,
+                               "After reload");
+    }
+
+    // search while the merge runs in the background
+    index.merge_async();
+    ok &= search_and_check(index, queries, num_queries, query_aligned_dim, K, L, beam_width, num_threads,
+                           first_insert_id, insert_position, num_deletes, gt_ids, gt_dists, gt_dim, "During merge");
+    index.wait_for_merge();
+    ok &= search_and_check(index, queries, num_queries, query_aligned_dim, K, L, beam_width, num_threads,
+                           first_insert_id, insert_position, num_deletes, gt_ids, gt_dists, gt_dim, "After merge");
+
+    diskann::aligned_free(queries);
+    diskann::aligned_free(insert_data);
+    delete[] gt_ids;
+    delete[] gt_dists;
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    std::string data_type, dist_fn, index_path_prefix, insert_path, query_file, gt_file;
+    uint32_t num_threads, R, Lbuild, K, L, beam_width, num_deletes;
+    float alpha;
+
+    po::options_description desc{"Arguments"};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+        desc.add_options()("data_type", po::value<std::string>(&data_type)->required(), "data type <int8/uint8/float>");
+        desc.add_options()("dist_fn", po::value<std::string>(&dist_fn)->required(), "distance function <l2>");
+        desc.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                           "Path prefix of the disk index, updated by the merge");
+        desc.add_options()("insert_path", po::value<std::string>(&insert_path)->required(),
+                           "Points to insert, in bin format");
+        desc.add_options()("query_file", po::value<std::string>(&query_file)->required(),
+                           "Query file in binary format");
+        desc.add_options()("gt_file", po::value<std::string>(&gt_file)->default_value(std::string("")),
+                           "Ground truth over the disk index points followed by the inserted points, with the "
+                           "deleted points excluded");
+        desc.add_options()("points_to_delete_from_beginning", po::value<uint32_t>(&num_deletes)->default_value(0),
+                           "Delete the first points of the disk index");
+        desc.add_options()("max_degree,R", po::value<uint32_t>(&R)->default_value(64),
+                           "Maximum degree of the temp index");
+        desc.add_options()("Lbuild", po::value<uint32_t>(&Lbuild)->default_value(100),
+                           "Build complexity of the temp index and the merge");
+        desc.add_options()("alpha", po::value<float>(&alpha)->default_value(1.2f), "alpha of the temp index and merge");
+        desc.add_options()("recall_at,K", po::value<uint32_t>(&K)->default_value(10), "Number of neighbors");
+        desc.add_options()("search_list,L", po::value<uint32_t>(&L)->default_value(100), "Search list size");
+        desc.add_options()("beamwidth,W", po::value<uint32_t>(&beam_width)->default_value(2),
+                           "Beamwidth for the disk index search");
+        desc.add_options()("num_threads,T", po::value<uint32_t>(&num_threads)->default_value(omp_get_num_procs()),
+                           "Number of threads used for inserts, searches and merges (defaults to "
+                           "omp_get_num_procs())");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    if (dist_fn != std::string("l2"))
+    {
+        std::cout << "FreshDiskIndex only supports l2" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        if (data_type == std::string("float"))
+            return run_fresh_disk_index<float>(index_path_prefix, insert_path, query_file, gt_file, num_deletes, R,
+                                               Lbuild, alpha, K, L, beam_width, num_threads);
+        else if (data_type == std::string("int8"))
+            return run_fresh_disk_index<int8_t>(index_path_prefix, insert_path, query_file, gt_file, num_deletes, R,
+                                                Lbuild, alpha, K, L, beam_width, num_threads);
+        else if (data_type == std::string("uint8"))
+            return run_fresh_disk_index<uint8_t>(index_path_prefix, insert_path, query_file, gt_file, num_deletes, R,
+                                                 Lbuild, alpha, K, L, beam_width, num_threads);
+        else
+            std::cout << "Unsupported type. Use float/int8/uint8" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return -1;
+    }
+    return -1;
+}
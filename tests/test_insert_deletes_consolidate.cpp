@@ -140,7 +140,7 @@ void build_incremental_index(const std::string &data_path, const uint32_t L, con
                              size_t beginning_index_size, float start_point_norm, uint32_t num_start_pts,
                              size_t points_per_checkpoint, size_t checkpoints_per_snapshot,
                              const std::string &save_path, size_t points_to_delete_from_beginning,
-                             size_t start_deletes_after, bool concurrent)
+                             size_t start_deletes_after, bool concurrent, bool optimized_layout)
 {
     diskann::IndexWriteParameters params = diskann::IndexWriteParametersBuilder(L, R)
                                                .with_max_occlusion_size(500) // C = 500
@@ -214,6 +214,8 @@ void build_incremental_index(const std::string &data_path, const uint32_t L, con
         index.set_start_points_at_random(static_cast<T>(start_point_norm));
         index.enable_delete();
     }
+    if (optimized_layout)
+        index.optimize_index_layout();
 
     const double elapsedSeconds = timer.elapsed() / 1000000.0;
     std::cout << "Initial non-incremental index build time for " << beginning_index_size << " points took "
@@ -327,7 +329,7 @@ int main(int argc, char **argv)
     float alpha, start_point_norm;
     size_t points_to_skip, max_points_to_insert, beginning_index_size, points_per_checkpoint, checkpoints_per_snapshot,
         points_to_delete_from_beginning, start_deletes_after;
-    bool concurrent;
+    bool concurrent, optimized_layout;
 
     po::options_description desc{"Arguments"};
     try
@@ -371,6 +373,8 @@ int main(int argc, char **argv)
             po::value<uint32_t>(&num_start_pts)->default_value(diskann::defaults::NUM_FROZEN_POINTS_DYNAMIC),
             "Set the number of random start (frozen) points to use when "
             "inserting and searching");
+        desc.add_options()("optimized_layout", po::bool_switch(&optimized_layout),
+                           "Insert into and delete from the optimized layout of the index, and save it");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -402,17 +406,19 @@ int main(int argc, char **argv)
             build_incremental_index<int8_t>(data_path, L, R, alpha, num_threads, points_to_skip, max_points_to_insert,
                                             beginning_index_size, start_point_norm, num_start_pts,
                                             points_per_checkpoint, checkpoints_per_snapshot, index_path_prefix,
-                                            points_to_delete_from_beginning, start_deletes_after, concurrent);
+                                            points_to_delete_from_beginning, start_deletes_after, concurrent,
+                                             optimized_layout);
         else if (data_type == std::string("uint8"))
             build_incremental_index<uint8_t>(data_path, L, R, alpha, num_threads, points_to_skip, max_points_to_insert,
                                              beginning_index_size, start_point_norm, num_start_pts,
                                              points_per_checkpoint, checkpoints_per_snapshot, index_path_prefix,
-                                             points_to_delete_from_beginning, start_deletes_after, concurrent);
+                                             points_to_delete_from_beginning, start_deletes_after, concurrent,
+                                             optimized_layout);
         else if (data_type == std::string("float"))
             build_incremental_index<float>(data_path, L, R, alpha, num_threads, points_to_skip, max_points_to_insert,
                                            beginning_index_size, start_point_norm, num_start_pts, points_per_checkpoint,
                                            checkpoints_per_snapshot, index_path_prefix, points_to_delete_from_beginning,
-                                           start_deletes_after, concurrent);
+                                           start_deletes_after, concurrent, optimized_layout);
         else
             std::cout << "Unsupported type. Use float/int8/uint8" << std::endl;
     }
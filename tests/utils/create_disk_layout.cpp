@@ -26,7 +26,7 @@ int main(int argc, char **argv)
     if (argc != 5)
     {
         std::cout << argv[0]
-                  << " data_type <float/int8/uint8> data_bin "
+                  << " data_type <float/int8/uint8/float16/bfloat16> data_bin "
                      "vamana_index_file output_diskann_index_file"
                   << std::endl;
         exit(-1);
@@ -39,9 +39,13 @@ int main(int argc, char **argv)
         ret_val = create_disk_layout<int8_t>(argv);
     else if (std::string(argv[1]) == std::string("uint8"))
         ret_val = create_disk_layout<uint8_t>(argv);
+    else if (std::string(argv[1]) == std::string("float16"))
+        ret_val = create_disk_layout<diskann::float16>(argv);
+    else if (std::string(argv[1]) == std::string("bfloat16"))
+        ret_val = create_disk_layout<diskann::bfloat16>(argv);
     else
     {
-        std::cout << "unsupported type. use int8/uint8/float " << std::endl;
+        std::cout << "unsupported type. use int8/uint8/float/float16/bfloat16 " << std::endl;
         ret_val = -2;
     }
     return ret_val;